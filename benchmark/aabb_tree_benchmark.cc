@@ -0,0 +1,158 @@
+// frustum, sphere and ray queries of DynamicAabbTree against a brute force scan over random
+// 0.2 to 4 unit boxes in a 2000^3 volume. the tree is built by single inserts, every box then
+// moves a little and a tenth is removed and inserted again before the queries. tree results must
+// hold every brute force hit, fattened leaves may add more
+//
+// usage: aabb_tree_benchmark [entity_count...]
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/scene/dynamic_aabb_tree.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kQueryRuns = 10;
+
+// average time of kQueryRuns queries, result keeps the last one sorted
+template <typename Query>
+double AverageQuery(std::vector<uint32_t>& result, Query&& query) {
+  const auto start = BenchmarkClock::now();
+  for (int i = 0; i < kQueryRuns; i++) {
+    result.clear();
+    query(result);
+  }
+  const double ms = ElapsedMs(start) / kQueryRuns;
+  std::sort(result.begin(), result.end());
+  return ms;
+}
+
+bool Contains(const std::vector<uint32_t>& tree_hits, const std::vector<uint32_t>& scan_hits) {
+  return std::includes(tree_hits.begin(), tree_hits.end(), scan_hits.begin(), scan_hits.end());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> entity_counts = {10000, 100000, 1000000};
+  if (argc > 1) {
+    entity_counts.clear();
+    for (int i = 1; i < argc; i++) {
+      entity_counts.push_back(static_cast<uint32_t>(std::atoi(argv[i])));
+    }
+  }
+
+  const Frustum frustum = Frustum::FromMatrix(glm::perspective(1.0f, 16.0f / 9.0f, 0.1f, 100.0f));
+  BoundingSphere sphere;
+  sphere.center = glm::vec3(10.0f, 20.0f, 30.0f);
+  sphere.radius = 100.0f;
+  const glm::vec3 ray_origin(0.0f);
+  const glm::vec3 ray_direction = glm::normalize(glm::vec3(1.0f, 0.3f, 0.2f));
+  const glm::vec3 ray_inverse   = 1.0f / ray_direction;
+  const float     ray_length    = 2000.0f;
+
+  for (const uint32_t count : entity_counts) {
+    std::mt19937                          rng(1);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 2.0f);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+
+    std::vector<AxisAlignedBox> boxes(count);
+    std::vector<int32_t>        proxies(count);
+    DynamicAabbTree             tree;
+    auto                        start = BenchmarkClock::now();
+    for (uint32_t i = 0; i < count; i++) {
+      const glm::vec3 center(position(rng), position(rng), position(rng));
+      const glm::vec3 half(extent(rng), extent(rng), extent(rng));
+      boxes[i].min_corner = center - half;
+      boxes[i].max_corner = center + half;
+      proxies[i]          = tree.Insert(boxes[i], i);
+    }
+    const double build_ms = ElapsedMs(start);
+
+    start             = BenchmarkClock::now();
+    uint32_t reinsert = 0;
+    for (uint32_t i = 0; i < count; i++) {
+      const glm::vec3 offset(jitter(rng), jitter(rng), jitter(rng));
+      boxes[i].min_corner = boxes[i].min_corner + offset;
+      boxes[i].max_corner = boxes[i].max_corner + offset;
+      reinsert += tree.Move(proxies[i], boxes[i]) ? 1 : 0;
+    }
+    const double move_ms = ElapsedMs(start);
+    for (uint32_t i = 0; i < count; i += 10) {
+      tree.Remove(proxies[i]);
+      proxies[i] = tree.Insert(boxes[i], i);
+    }
+
+    std::vector<uint32_t> tree_hits;
+    std::vector<uint32_t> scan_hits;
+    fmt::print(
+        "{} entities: build {:.1f} ms, move {:.1f} ms ({} left their fat box), height {}\n",
+        count,
+        build_ms,
+        move_ms,
+        reinsert,
+        tree.Height());
+
+    const double tree_frustum = AverageQuery(
+        tree_hits, [&](std::vector<uint32_t>& hits) { tree.QueryFrustum(frustum, hits); });
+    const double scan_frustum = AverageQuery(scan_hits, [&](std::vector<uint32_t>& hits) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (frustum.Intersects(boxes[i])) {
+          hits.push_back(i);
+        }
+      }
+    });
+    fmt::print(
+        "  frustum  tree {:8.3f} ms  scan {:8.3f} ms  hits {}/{}  {}\n",
+        tree_frustum,
+        scan_frustum,
+        tree_hits.size(),
+        scan_hits.size(),
+        Contains(tree_hits, scan_hits) ? "ok" : "MISSING HITS");
+
+    const double tree_sphere = AverageQuery(
+        tree_hits, [&](std::vector<uint32_t>& hits) { tree.QuerySphere(sphere, hits); });
+    const double scan_sphere = AverageQuery(scan_hits, [&](std::vector<uint32_t>& hits) {
+      for (uint32_t i = 0; i < count; i++) {
+        if (boxes[i].DistanceSquared(sphere.center) <= sphere.radius * sphere.radius) {
+          hits.push_back(i);
+        }
+      }
+    });
+    fmt::print(
+        "  sphere   tree {:8.3f} ms  scan {:8.3f} ms  hits {}/{}  {}\n",
+        tree_sphere,
+        scan_sphere,
+        tree_hits.size(),
+        scan_hits.size(),
+        Contains(tree_hits, scan_hits) ? "ok" : "MISSING HITS");
+
+    const double tree_ray = AverageQuery(tree_hits, [&](std::vector<uint32_t>& hits) {
+      tree.QueryRay(ray_origin, ray_direction, ray_length, hits);
+    });
+    const double scan_ray = AverageQuery(scan_hits, [&](std::vector<uint32_t>& hits) {
+      float distance = 0.0f;
+      for (uint32_t i = 0; i < count; i++) {
+        if (boxes[i].IntersectRay(ray_origin, ray_inverse, ray_length, distance)) {
+          hits.push_back(i);
+        }
+      }
+    });
+    fmt::print(
+        "  ray      tree {:8.3f} ms  scan {:8.3f} ms  hits {}/{}  {}\n",
+        tree_ray,
+        scan_ray,
+        tree_hits.size(),
+        scan_hits.size(),
+        Contains(tree_hits, scan_hits) ? "ok" : "MISSING HITS");
+  }
+  return 0;
+}
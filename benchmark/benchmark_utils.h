@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include "core/logsystem/log_system.h"
+#include "core/utils/thread_pool.h"
+#include "function/global/global_context.h"
+#include "function/render/mesh/mesh_welder.h"
+#include "function/render/mesh/obj_parser.h"
+#include "function/render/mesh/obj_streamer.h"
+#include "function/render/scene/render_type.h"
+#include "macro.h"
+
+namespace vkengine {
+
+using BenchmarkClock = std::chrono::steady_clock;
+
+inline double ElapsedMs(BenchmarkClock::time_point start) {
+  return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+}
+
+// best wall time of runs calls of run in milliseconds
+template <typename Run>
+double BestOf(int runs, Run&& run) {
+  double best = 1e30;
+  for (int i = 0; i < runs; i++) {
+    const auto start = BenchmarkClock::now();
+    run();
+    best = std::min(best, ElapsedMs(start));
+  }
+  return best;
+}
+
+// the log system and the worker pool behind GThreadPool, without the window and the renderer
+// GlobalContext::StartSystem brings up. 0 threads is one worker per hardware thread
+inline void StartBenchmarkContext(uint32_t thread_count = 0) {
+  GContext.SetObjectPool(std::make_shared<DefaultObjectPool>());
+  GContext.CreateObject<LogSystem>(kLogSystem, "[%^%l%$] %v");
+  GContext.CreateObject<ThreadPool>(kThreadPool, thread_count);
+}
+
+// side x side vertex grid of 2 * (side - 1)^2 triangles as an obj with a position and a uv per
+// vertex and one shared normal, 2237 makes the 10M triangle file of the mesh benchmarks. the
+// heights follow x ^ y so the grid is not flat. return false if the file can not be written
+inline bool WriteGridObj(const std::string& file, uint32_t side) {
+  FILE* out = std::fopen(file.c_str(), "wb");
+  if (!out) {
+    return false;
+  }
+  for (uint32_t y = 0; y < side; y++) {
+    for (uint32_t x = 0; x < side; x++) {
+      std::fprintf(out, "v %.6f %.6f %.6f\n", x * 0.01f, y * 0.01f, (x ^ y) * 0.0001f);
+    }
+  }
+  for (uint32_t y = 0; y < side; y++) {
+    for (uint32_t x = 0; x < side; x++) {
+      std::fprintf(out, "vt %.6f %.6f\n", x / float(side), y / float(side));
+    }
+  }
+  std::fprintf(out, "vn 0 0 1\n");
+  for (uint32_t y = 0; y + 1 < side; y++) {
+    for (uint32_t x = 0; x + 1 < side; x++) {
+      const uint32_t a = y * side + x + 1;
+      const uint32_t b = a + 1;
+      const uint32_t c = a + side;
+      const uint32_t d = c + 1;
+      std::fprintf(out, "f %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, b, b, d, d);
+      std::fprintf(out, "f %u/%u/1 %u/%u/1 %u/%u/1\n", a, a, d, d, c, c);
+    }
+  }
+  return std::fclose(out) == 0;
+}
+
+// the triangles of an obj welded into the vertex and index buffer LoadStaticMesh makes, without
+// tangents and cooking. return false and set error if the file can not be parsed
+inline bool LoadObjMesh(
+    const std::string& file, RenderMeshData& mesh_data, std::string& error, ThreadPool* pool) {
+  ObjMeshData obj;
+  ObjParser   parser(pool);
+  if (!parser.Parse(file, obj, error)) {
+    return false;
+  }
+  MeshWelder<VulkanVertexData> welder(obj.corners.size());
+  mesh_data.index_buffer.clear();
+  mesh_data.index_buffer.reserve(obj.corners.size());
+  for (size_t f = 0; f + 2 < obj.corners.size(); f += 3) {
+    VulkanVertexData triangle[3];
+    ExpandObjTriangle(
+        &obj.corners[f], obj.positions.data(), obj.normals.data(), obj.texcoords.data(), triangle);
+    for (const auto& vertex : triangle) {
+      mesh_data.index_buffer.push_back(welder.Weld(vertex));
+    }
+  }
+  mesh_data.vertex_buffer = welder.TakeVertices();
+  mesh_data.bounds        = MeshBounds::FromPositions(
+      mesh_data.vertex_buffer.empty() ? nullptr : &mesh_data.vertex_buffer[0].position,
+      mesh_data.vertex_buffer.size(),
+      sizeof(VulkanVertexData));
+  return true;
+}
+
+}  // namespace vkengine
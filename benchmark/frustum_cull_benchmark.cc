@@ -0,0 +1,70 @@
+// culls random boxes against a 60 degree frustum with every FrustumCuller kernel the cpu
+// supports, about 9% of them are visible. every kernel must return the visibility list of
+// Frustum::Intersects
+//
+// usage: frustum_cull_benchmark [entity_count...]
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/scene/frustum_culler.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace vkengine;
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> entity_counts = {100000, 1000000, 10000000};
+  if (argc > 1) {
+    entity_counts.clear();
+    for (int i = 1; i < argc; i++) {
+      entity_counts.push_back(static_cast<uint32_t>(std::atoi(argv[i])));
+    }
+  }
+
+  const Frustum frustum = Frustum::FromMatrix(glm::perspective(1.0f, 16.0f / 9.0f, 0.1f, 1000.0f));
+  fmt::print("{:>10} {:>8} {:>10} {:>9} {}\n", "entities", "kernel", "best ms", "visible", "match");
+  for (const uint32_t count : entity_counts) {
+    std::mt19937                          rng(1);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> extent(0.1f, 5.0f);
+
+    FrustumCuller culler;
+    culler.Reserve(count);
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < count; i++) {
+      const glm::vec3 center(position(rng), position(rng), position(rng));
+      const glm::vec3 half(extent(rng), extent(rng), extent(rng));
+      AxisAlignedBox  box;
+      box.min_corner = center - half;
+      box.max_corner = center + half;
+      culler.Add(box, glm::mat4(1.0f));
+      if (frustum.Intersects(box)) {
+        expected.push_back(i);
+      }
+    }
+
+    std::vector<uint32_t> visible;
+    visible.reserve(count);
+    for (const auto kernel : {CullKernel::kScalar, CullKernel::kSse, CullKernel::kAvx2}) {
+      culler.SetKernel(kernel);
+      if (culler.GetKernel() != kernel) {
+        continue;
+      }
+      const double best = BestOf(5, [&]() {
+        visible.clear();
+        culler.Cull(frustum, visible);
+      });
+      fmt::print(
+          "{:>10} {:>8} {:>10.2f} {:>9} {}\n",
+          count,
+          FrustumCuller::KernelName(kernel),
+          best,
+          visible.size(),
+          visible == expected ? "yes" : "NO");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,225 @@
+// loads the same welded mesh with tangents from an obj and from two glb files. the obj path is
+// the import of LoadStaticMesh: parse, weld and GenerateTangents. one glb is interleaved like
+// VulkanVertexData, the other has one buffer view per attribute. each glb is read mapped, the
+// accessors copied into staging memory like the upload does, and gathered into vectors like a
+// mesh that is cooked. both must give the vertices and indices of the obj path
+//
+// usage: gltf_benchmark [obj_file]
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/gltf_loader.h"
+#include "function/render/mesh/tangent_generator.h"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kRuns = 5;
+
+constexpr uint32_t kGlbMagic     = 0x46546c67;
+constexpr uint32_t kGlbJsonChunk = 0x4e4f534a;
+constexpr uint32_t kGlbBinChunk  = 0x004e4942;
+
+// byte offset and size of the attributes inside VulkanVertexData
+constexpr size_t kAttributeOffsets[4] = {0, 12, 24, 40};
+constexpr size_t kAttributeSizes[4]   = {12, 12, 16, 8};
+
+void PadTo4(std::string& bytes, char padding) {
+  while (bytes.size() % 4 != 0) {
+    bytes.push_back(padding);
+  }
+}
+
+bool WriteGlb(const std::string& file, std::string json, std::string bin) {
+  PadTo4(json, ' ');
+  PadTo4(bin, '\0');
+  const auto     length        = static_cast<uint32_t>(28 + json.size() + bin.size());
+  const uint32_t header[3]     = {kGlbMagic, 2, length};
+  const uint32_t json_chunk[2] = {static_cast<uint32_t>(json.size()), kGlbJsonChunk};
+  const uint32_t bin_chunk[2]  = {static_cast<uint32_t>(bin.size()), kGlbBinChunk};
+
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(json_chunk), sizeof(json_chunk));
+  out.write(json.data(), json.size());
+  out.write(reinterpret_cast<const char*>(bin_chunk), sizeof(bin_chunk));
+  out.write(bin.data(), bin.size());
+  return static_cast<bool>(out);
+}
+
+std::string Accessors(size_t vertex_count, size_t index_count, bool interleaved) {
+  std::string result;
+  const char* types[4] = {"VEC3", "VEC3", "VEC4", "VEC2"};
+  for (int a = 0; a < 4; a++) {
+    result += fmt::format(
+        R"({{"bufferView":{},"byteOffset":{},"componentType":5126,"count":{},"type":"{}"}},)",
+        interleaved ? 0 : a,
+        interleaved ? kAttributeOffsets[a] : 0,
+        vertex_count,
+        types[a]);
+  }
+  result += fmt::format(
+      R"({{"bufferView":{},"componentType":5125,"count":{},"type":"SCALAR"}})",
+      interleaved ? 1 : 4,
+      index_count);
+  return result;
+}
+
+// one primitive, every attribute of VulkanVertexData and 32 bit indices
+bool WriteMeshGlb(
+    const std::string&                   file,
+    const std::vector<VulkanVertexData>& vertices,
+    const std::vector<uint32_t>&         indices,
+    bool                                 interleaved) {
+  const size_t vertex_bytes = sizeof(VulkanVertexData) * vertices.size();
+  const size_t index_bytes  = sizeof(uint32_t) * indices.size();
+  std::string  bin;
+  std::string  views;
+  if (interleaved) {
+    bin.assign(reinterpret_cast<const char*>(vertices.data()), vertex_bytes);
+    views = fmt::format(
+        R"({{"buffer":0,"byteOffset":0,"byteLength":{},"byteStride":{}}},)",
+        vertex_bytes,
+        sizeof(VulkanVertexData));
+  } else {
+    for (int a = 0; a < 4; a++) {
+      views += fmt::format(
+          R"({{"buffer":0,"byteOffset":{},"byteLength":{}}},)",
+          bin.size(),
+          kAttributeSizes[a] * vertices.size());
+      for (const auto& vertex : vertices) {
+        const char* attribute = reinterpret_cast<const char*>(&vertex) + kAttributeOffsets[a];
+        bin.append(attribute, kAttributeSizes[a]);
+      }
+    }
+  }
+  views +=
+      fmt::format(R"({{"buffer":0,"byteOffset":{},"byteLength":{}}})", bin.size(), index_bytes);
+  bin.append(reinterpret_cast<const char*>(indices.data()), index_bytes);
+
+  const std::string json = fmt::format(
+      R"({{"asset":{{"version":"2.0"}},"buffers":[{{"byteLength":{}}}],"bufferViews":[{}],)"
+      R"("accessors":[{}],"meshes":[{{"primitives":[{{"attributes":{{"POSITION":0,"NORMAL":1,)"
+      R"("TANGENT":2,"TEXCOORD_0":3}},"indices":4}}]}}]}})",
+      bin.size(),
+      views,
+      Accessors(vertices.size(), indices.size(), interleaved));
+  return WriteGlb(file, json, bin);
+}
+
+double MegabytesPerSecond(const std::string& file, double ms) {
+  return std::filesystem::file_size(file) / (1024.0 * 1024.0) / ms * 1e3;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string obj_file = argc > 1 ? argv[1] : "./engine/asset/viking_room.obj";
+  ThreadPool        pool;
+
+  std::vector<VulkanVertexData> vertices;
+  std::vector<uint32_t>         indices;
+  bool                          parsed = true;
+  const double                  obj_ms = BestOf(kRuns, [&]() {
+    RenderMeshData mesh_data;
+    std::string    error;
+    parsed = parsed && LoadObjMesh(obj_file, mesh_data, error, &pool);
+    GenerateTangents(mesh_data.vertex_buffer, mesh_data.index_buffer, &pool);
+    vertices = std::move(mesh_data.vertex_buffer);
+    indices  = std::move(mesh_data.index_buffer);
+  });
+  if (!parsed || vertices.empty()) {
+    fmt::print("can not parse {}\n", obj_file);
+    return 1;
+  }
+  const size_t vertex_bytes = sizeof(VulkanVertexData) * vertices.size();
+  const size_t index_bytes  = sizeof(uint32_t) * indices.size();
+
+  const auto scratch = std::filesystem::temp_directory_path() / "vkengine_gltf_benchmark";
+  std::filesystem::create_directories(scratch);
+  const std::string interleaved_file = (scratch / "interleaved.glb").string();
+  const std::string streams_file     = (scratch / "streams.glb").string();
+  if (!WriteMeshGlb(interleaved_file, vertices, indices, true) ||
+      !WriteMeshGlb(streams_file, vertices, indices, false)) {
+    fmt::print("can not write the glb files to {}\n", scratch.string());
+    return 1;
+  }
+
+  fmt::print(
+      "{}: {} vertices, {} triangles, best of {} runs\n",
+      obj_file,
+      vertices.size(),
+      indices.size() / 3,
+      kRuns);
+  fmt::print(
+      "  obj, parse weld tangents {:9.2f} ms {:8.1f} MB/s\n",
+      obj_ms,
+      MegabytesPerSecond(obj_file, obj_ms));
+
+  // persistent like the staging ring, touched once before the runs
+  std::vector<char> staging(vertex_bytes + index_bytes, 1);
+  for (const auto& file : {interleaved_file, streams_file}) {
+    bool         mapped_same = true;
+    const double mapped_ms   = BestOf(kRuns, [&]() {
+      GltfDocument   document;
+      RenderMeshData mesh_data;
+      std::string    error;
+      if (!document.Open(file, error) ||
+          !MapGltfMesh(document, document.GetMeshes()[0], mesh_data)) {
+        mapped_same = false;
+        return;
+      }
+      mesh_data.WriteVertexData(staging.data());
+      std::memcpy(staging.data() + vertex_bytes, mesh_data.GetIndexData(), index_bytes);
+      mapped_same = mapped_same &&
+                    std::memcmp(staging.data(), vertices.data(), vertex_bytes) == 0 &&
+                    std::memcmp(staging.data() + vertex_bytes, indices.data(), index_bytes) == 0;
+    });
+
+    bool         gathered_same = true;
+    const double gathered_ms   = BestOf(kRuns, [&]() {
+      GltfDocument                  document;
+      std::string                   error;
+      std::vector<VulkanVertexData> gathered_vertices;
+      std::vector<uint32_t>         gathered_indices;
+      if (!document.Open(file, error)) {
+        gathered_same = false;
+        return;
+      }
+      const auto result =
+          GatherGltfMesh(document.GetMeshes()[0], gathered_vertices, gathered_indices);
+      MeshBounds::FromPositions(
+          &gathered_vertices[0].position, gathered_vertices.size(), sizeof(VulkanVertexData));
+      std::memcpy(staging.data(), gathered_vertices.data(), vertex_bytes);
+      std::memcpy(staging.data() + vertex_bytes, gathered_indices.data(), index_bytes);
+      gathered_same = gathered_same && result.complete && gathered_indices == indices &&
+                      gathered_vertices.size() == vertices.size() &&
+                      std::memcmp(gathered_vertices.data(), vertices.data(), vertex_bytes) == 0;
+    });
+
+    const char* name = file == interleaved_file ? "interleaved" : "streams";
+    fmt::print(
+        "  glb {:<11} mapped   {:9.2f} ms {:8.1f} MB/s  {:5.1f}x obj  {}\n",
+        name,
+        mapped_ms,
+        MegabytesPerSecond(file, mapped_ms),
+        obj_ms / mapped_ms,
+        mapped_same ? "same mesh" : "MESH DIFFERS");
+    fmt::print(
+        "  glb {:<11} gathered {:9.2f} ms {:8.1f} MB/s  {:5.1f}x obj  {}\n",
+        name,
+        gathered_ms,
+        MegabytesPerSecond(file, gathered_ms),
+        obj_ms / gathered_ms,
+        gathered_same ? "same mesh" : "MESH DIFFERS");
+  }
+  std::filesystem::remove_all(scratch);
+  return 0;
+}
@@ -0,0 +1,106 @@
+// cold and warm loads of a mesh cache entry. the obj is copied into a scratch directory, parsed and
+// welded, then stored. warm loads only stat the source, the old warm load hashed the whole
+// source first, its cost is timed on its own. a touch of the copy makes the next load hash once
+// and restamp the entry, the load after it is warm again
+//
+// usage: mesh_cache_benchmark [file]
+//        mesh_cache_benchmark --grid side   caches a grid obj, side 2237 is 10M triangles
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/mesh_cache.h"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kRuns = 5;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const auto scratch = std::filesystem::temp_directory_path() / "vkengine_mesh_cache_benchmark";
+  std::filesystem::remove_all(scratch);
+  std::filesystem::create_directories(scratch);
+  const std::string source_file = (scratch / "source.obj").string();
+
+  if (argc > 2 && std::strcmp(argv[1], "--grid") == 0) {
+    if (!WriteGridObj(source_file, static_cast<uint32_t>(std::atoi(argv[2])))) {
+      fmt::print("can not write {}\n", source_file);
+      return 1;
+    }
+  } else {
+    const std::string file = argc > 1 ? argv[1] : "./engine/asset/viking_room.obj";
+    std::error_code   error;
+    std::filesystem::copy_file(file, source_file, error);
+    if (error) {
+      fmt::print("can not copy {}: {}\n", file, error.message());
+      return 1;
+    }
+  }
+  ThreadPool pool;
+
+  RenderMeshSource source;
+  source.mesh_file = source_file;
+  MeshCache      cache((scratch / "cache").string());
+  RenderMeshData mesh_data;
+  std::string    error;
+  auto           start = BenchmarkClock::now();
+  if (!LoadObjMesh(source_file, mesh_data, error, &pool)) {
+    fmt::print("can not parse {}: {}\n", source_file, error);
+    return 1;
+  }
+  const double import_ms = ElapsedMs(start);
+
+  start = BenchmarkClock::now();
+  MeshSourceKey store_key;
+  if (!store_key.Stat({source_file}) || !cache.Store(source, store_key, mesh_data)) {
+    fmt::print("can not write {}\n", cache.EntryPath(source));
+    return 1;
+  }
+  const double store_ms = ElapsedMs(start);
+
+  // a fresh key per load, like RenderResourceBase::LoadMesh
+  bool       loaded = true;
+  const auto load   = [&]() {
+    MeshSourceKey  key;
+    RenderMeshData cached;
+    loaded = loaded && key.Stat({source_file}) && cache.Load(source, key, cached);
+  };
+  const double warm_ms = BestOf(kRuns, load);
+  const double hash_ms = BestOf(kRuns, [&]() {
+    uint64_t hash = 0;
+    loaded        = loaded && MeshCache::HashSource(source_file, hash);
+  });
+
+  std::filesystem::last_write_time(
+      source_file, std::filesystem::last_write_time(source_file) + std::chrono::seconds(1));
+  const double touched_ms  = BestOf(1, load);
+  const double restamp_ms  = BestOf(kRuns, load);
+  const auto   source_size = std::filesystem::file_size(source_file);
+  if (!loaded) {
+    fmt::print("a load of {} missed the cache\n", cache.EntryPath(source));
+    return 1;
+  }
+
+  fmt::print(
+      "{}: {:.1f} MB, {} vertices, {} indices\n",
+      source_file,
+      source_size / (1024.0 * 1024.0),
+      mesh_data.vertex_buffer.size(),
+      mesh_data.index_buffer.size());
+  fmt::print("  parse and weld            {:10.2f} ms\n", import_ms);
+  fmt::print("  store, hashes the source  {:10.2f} ms\n", store_ms);
+  fmt::print("  warm load                 {:10.3f} ms  best of {}\n", warm_ms, kRuns);
+  fmt::print("  source hash               {:10.3f} ms  every warm load paid it before\n", hash_ms);
+  fmt::print("  load after a touch        {:10.3f} ms  hashes once and restamps\n", touched_ms);
+  fmt::print("  warm load after restamp   {:10.3f} ms  best of {}\n", restamp_ms, kRuns);
+
+  std::filesystem::remove_all(scratch);
+  return 0;
+}
@@ -0,0 +1,143 @@
+// ACMR and ATVR of the 16 entry fifo cache simulation before and after OptimizeMeshData, for the
+// vertex cache stage alone, with vertex fetch and with every stage. the optimized mesh must hold
+// the same triangles as the welded one
+//
+// usage: mesh_optimizer_benchmark [file...]
+//        mesh_optimizer_benchmark --sphere segments   a uv sphere with shuffled triangles, 300
+//                                                     segments is 180K triangles
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/mesh_optimizer.h"
+
+using namespace vkengine;
+
+namespace {
+
+using Triangle = std::array<float, 9>;
+
+// segments x segments quads over the sphere, every vertex shared, triangles in random order
+RenderMeshData ShuffledSphere(uint32_t segments) {
+  RenderMeshData mesh_data;
+  for (uint32_t y = 0; y <= segments; y++) {
+    for (uint32_t x = 0; x <= segments; x++) {
+      const float      theta = 3.14159265f * y / segments;
+      const float      phi   = 6.28318531f * x / segments;
+      VulkanVertexData vertex{};
+      vertex.position = glm::vec3(
+          std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+      vertex.normal   = vertex.position;
+      vertex.texcoord = glm::vec2(float(x) / segments, float(y) / segments);
+      mesh_data.vertex_buffer.push_back(vertex);
+    }
+  }
+  std::vector<std::array<uint32_t, 3>> triangles;
+  for (uint32_t y = 0; y < segments; y++) {
+    for (uint32_t x = 0; x < segments; x++) {
+      const uint32_t a = y * (segments + 1) + x;
+      const uint32_t b = a + 1;
+      const uint32_t c = a + segments + 1;
+      const uint32_t d = c + 1;
+      triangles.push_back({a, c, b});
+      triangles.push_back({b, c, d});
+    }
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1));
+  for (const auto& triangle : triangles) {
+    mesh_data.index_buffer.insert(mesh_data.index_buffer.end(), triangle.begin(), triangle.end());
+  }
+  return mesh_data;
+}
+
+// the positions of every triangle, rotated to a canonical first corner and sorted
+std::vector<Triangle> TriangleSet(const RenderMeshData& mesh_data) {
+  std::vector<Triangle> result(mesh_data.index_buffer.size() / 3);
+  for (size_t t = 0; t < result.size(); t++) {
+    Triangle corners;
+    for (int k = 0; k < 3; k++) {
+      const auto& position = mesh_data.vertex_buffer[mesh_data.index_buffer[t * 3 + k]].position;
+      std::memcpy(&corners[k * 3], &position, sizeof(float) * 3);
+    }
+    result[t] = corners;
+    for (int rotation = 1; rotation < 3; rotation++) {
+      Triangle rotated;
+      for (int i = 0; i < 9; i++) {
+        rotated[i] = corners[(i + 3 * rotation) % 9];
+      }
+      result[t] = std::min(result[t], rotated);
+    }
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void Optimize(const char* name, const RenderMeshData& welded, uint32_t optimize_flags) {
+  RenderMeshData               mesh_data  = welded;
+  const auto                   start      = BenchmarkClock::now();
+  const MeshOptimizeStatistics statistics = OptimizeMeshData(mesh_data, optimize_flags);
+  const double                 ms         = ElapsedMs(start);
+  fmt::print(
+      "  {:<15} ACMR {:.3f} -> {:.3f}  ATVR {:.3f} -> {:.3f} {:6} clusters {:9.1f} ms  {}\n",
+      name,
+      statistics.before.acmr,
+      statistics.after.acmr,
+      statistics.before.atvr,
+      statistics.after.atvr,
+      statistics.cluster_count,
+      ms,
+      TriangleSet(mesh_data) == TriangleSet(welded) ? "same triangles" : "TRIANGLES DIFFER");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string>    names;
+  std::vector<RenderMeshData> meshes;
+  if (argc > 2 && std::strcmp(argv[1], "--sphere") == 0) {
+    const auto segments = static_cast<uint32_t>(std::atoi(argv[2]));
+    names.push_back(fmt::format("shuffled sphere of {} segments", segments));
+    meshes.push_back(ShuffledSphere(segments));
+  } else {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+      files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+      files.push_back("./engine/asset/viking_room.obj");
+    }
+    for (const auto& file : files) {
+      RenderMeshData mesh_data;
+      std::string    error;
+      if (!LoadObjMesh(file, mesh_data, error, nullptr)) {
+        fmt::print("can not parse {}: {}\n", file, error);
+        continue;
+      }
+      names.push_back(file);
+      meshes.push_back(std::move(mesh_data));
+    }
+  }
+
+  for (size_t i = 0; i < meshes.size(); i++) {
+    fmt::print(
+        "{}: {} triangles, {} vertices\n",
+        names[i],
+        meshes[i].index_buffer.size() / 3,
+        meshes[i].vertex_buffer.size());
+    Optimize("vertex cache", meshes[i], kMeshOptimizeVertexCache);
+    Optimize("cache, fetch", meshes[i], kMeshOptimizeVertexCache | kMeshOptimizeVertexFetch);
+    Optimize(
+        "every stage",
+        meshes[i],
+        kMeshOptimizeVertexCache | kMeshOptimizeOverdraw | kMeshOptimizeVertexFetch);
+  }
+  return 0;
+}
@@ -0,0 +1,107 @@
+// welds the corners of a side x side quad grid into an index buffer with MeshWelder and with the
+// std::unordered_map LoadStaticMesh used before. every interior vertex is shared by six corners
+// and a uv seam splits every 16th column. both must return the same index buffer
+//
+// usage: mesh_weld_benchmark [side...]
+
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/mesh_welder.h"
+#include "function/render/scene/render_type.h"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kRuns = 3;
+
+VulkanVertexData GridVertex(uint32_t x, uint32_t y, uint32_t seam) {
+  VulkanVertexData vertex{};
+  vertex.position = glm::vec3(float(x), float(y), 0.001f * float(x ^ y));
+  vertex.normal   = glm::vec3(0.0f, 0.0f, 1.0f);
+  vertex.tangent  = glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+  vertex.texcoord = glm::vec2(x / 16.0f + float(seam), float(y));
+  return vertex;
+}
+
+std::vector<VulkanVertexData> GridCorners(uint32_t side) {
+  std::vector<VulkanVertexData> corners;
+  corners.reserve(size_t(side) * side * 6);
+  for (uint32_t y = 0; y < side; y++) {
+    for (uint32_t x = 0; x < side; x++) {
+      const uint32_t seam = x % 16 == 15 ? 1 : 0;
+      const auto     a    = GridVertex(x, y, 0);
+      const auto     b    = GridVertex(x + 1, y, seam);
+      const auto     c    = GridVertex(x + 1, y + 1, seam);
+      const auto     d    = GridVertex(x, y + 1, 0);
+      corners.insert(corners.end(), {a, b, c, a, c, d});
+    }
+  }
+  return corners;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> sides = {100, 400, 1500};
+  if (argc > 1) {
+    sides.clear();
+    for (int i = 1; i < argc; i++) {
+      sides.push_back(static_cast<uint32_t>(std::atoi(argv[i])));
+    }
+  }
+
+  for (const uint32_t side : sides) {
+    const auto corners = GridCorners(side);
+
+    std::vector<uint32_t> welder_indices;
+    MeshWeldStatistics    statistics;
+    const double          welder_ms = BestOf(kRuns, [&]() {
+      MeshWelder<VulkanVertexData> welder(corners.size());
+      welder_indices.clear();
+      welder_indices.reserve(corners.size());
+      for (const auto& corner : corners) {
+        welder_indices.push_back(welder.Weld(corner));
+      }
+      statistics = welder.GetStatistics();
+    });
+
+    std::vector<uint32_t> map_indices;
+    size_t                map_unique = 0;
+    const double          map_ms     = BestOf(kRuns, [&]() {
+      std::unordered_map<VulkanVertexData, uint32_t, VulkanVertexData::HasHValue> unique;
+      map_indices.clear();
+      map_indices.reserve(corners.size());
+      for (const auto& corner : corners) {
+        const auto result = unique.emplace(corner, static_cast<uint32_t>(unique.size()));
+        map_indices.push_back(result.first->second);
+      }
+      map_unique = unique.size();
+    });
+
+    fmt::print(
+        "{} corners, {} unique, best of {} runs\n",
+        corners.size(),
+        statistics.unique_count,
+        kRuns);
+    fmt::print(
+        "  MeshWelder     {:9.1f} ms {:6.1f} M corners/s {:6.1f} M unique/s  {:.2f} probes per "
+        "corner, {} rehashes\n",
+        welder_ms,
+        corners.size() / welder_ms * 1e-3,
+        statistics.unique_count / welder_ms * 1e-3,
+        double(statistics.probe_count) / statistics.corner_count,
+        statistics.rehash_count);
+    fmt::print(
+        "  unordered_map  {:9.1f} ms {:6.1f} M corners/s {:6.1f} M unique/s  {}\n",
+        map_ms,
+        corners.size() / map_ms * 1e-3,
+        map_unique / map_ms * 1e-3,
+        welder_indices == map_indices ? "same indices" : "INDICES DIFFER");
+  }
+  return 0;
+}
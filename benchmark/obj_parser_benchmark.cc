@@ -0,0 +1,145 @@
+// parses obj files into attribute arrays and triangle corners with ObjParser, on one thread and
+// on the worker pool. when tinyobjloader is found at configure time the tinyobj path
+// LoadStaticMesh used before is timed as well: ObjReader::ParseFromFile followed by the
+// expansion of its faces into the same corners
+//
+// usage: obj_parser_benchmark [file...]
+//        obj_parser_benchmark --grid file side   writes a grid obj first, side 2237 is 10M
+//                                                triangles
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/obj_parser.h"
+
+#ifdef VKENGINE_BENCHMARK_TINYOBJ
+#include "tiny_obj_loader.h"
+#endif
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kRuns = 3;
+
+void Report(const char* path, double ms, size_t bytes, size_t triangles) {
+  fmt::print(
+      "  {:<22} {:10.1f} ms {:9.1f} MB/s  {} triangles\n",
+      path,
+      ms,
+      bytes / (1024.0 * 1024.0) / ms * 1e3,
+      triangles);
+}
+
+#ifdef VKENGINE_BENCHMARK_TINYOBJ
+// the corners of the triangles of the file, the way LoadStaticMesh walked the tinyobj shapes
+size_t ParseTinyobj(const std::string& file, ObjMeshData& mesh) {
+  tinyobj::ObjReader       reader;
+  tinyobj::ObjReaderConfig reader_config;
+  reader_config.vertex_color = false;
+  if (!reader.ParseFromFile(file, reader_config)) {
+    fmt::print("  tinyobj can not parse {}: {}\n", file, reader.Error());
+    return 0;
+  }
+  const auto& attrib = reader.GetAttrib();
+  mesh.positions.resize(attrib.vertices.size() / 3);
+  std::memcpy(
+      mesh.positions.data(), attrib.vertices.data(), sizeof(float) * attrib.vertices.size());
+  mesh.normals.resize(attrib.normals.size() / 3);
+  std::memcpy(mesh.normals.data(), attrib.normals.data(), sizeof(float) * attrib.normals.size());
+  mesh.texcoords.resize(attrib.texcoords.size() / 2);
+  std::memcpy(
+      mesh.texcoords.data(), attrib.texcoords.data(), sizeof(float) * attrib.texcoords.size());
+
+  mesh.corners.clear();
+  for (const auto& shape : reader.GetShapes()) {
+    size_t index_offset = 0;
+    for (const auto face_vertices : shape.mesh.num_face_vertices) {
+      // only triangles, like LoadStaticMesh did
+      if (face_vertices == 3) {
+        for (size_t v = 0; v < 3; v++) {
+          const auto& index = shape.mesh.indices[index_offset + v];
+          mesh.corners.push_back({index.vertex_index, index.texcoord_index, index.normal_index});
+        }
+      }
+      index_offset += face_vertices;
+    }
+  }
+  return mesh.corners.size() / 3;
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> files;
+  if (argc > 3 && std::strcmp(argv[1], "--grid") == 0) {
+    const auto side = static_cast<uint32_t>(std::atoi(argv[3]));
+    fmt::print("writing {} with {} triangles\n", argv[2], 2ull * (side - 1) * (side - 1));
+    if (!WriteGridObj(argv[2], side)) {
+      fmt::print("can not write {}\n", argv[2]);
+      return 1;
+    }
+    files.push_back(argv[2]);
+  } else {
+    for (int i = 1; i < argc; i++) {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    files.push_back("./engine/asset/viking_room.obj");
+  }
+  ThreadPool pool;
+
+  for (const auto& file : files) {
+    std::error_code size_error;
+    const size_t    bytes = static_cast<size_t>(std::filesystem::file_size(file, size_error));
+    if (size_error) {
+      fmt::print("can not read {}\n", file);
+      continue;
+    }
+    fmt::print("{}: {:.1f} MB, best of {} runs\n", file, bytes / (1024.0 * 1024.0), kRuns);
+
+    for (ThreadPool* parse_pool : {static_cast<ThreadPool*>(nullptr), &pool}) {
+      ObjMeshData        mesh;
+      std::string        error;
+      bool               parsed = true;
+      ObjParseStatistics statistics;
+      const double       ms = BestOf(kRuns, [&]() {
+        ObjParser parser(parse_pool);
+        mesh       = ObjMeshData{};
+        parsed     = parser.Parse(file, mesh, error);
+        statistics = parser.GetStatistics();
+      });
+      if (!parsed) {
+        fmt::print("  ObjParser fails: {}\n", error);
+        break;
+      }
+      const std::string path = parse_pool
+                                   ? fmt::format("ObjParser, {} workers", pool.ThreadCount())
+                                   : std::string("ObjParser, 1 thread");
+      Report(path.c_str(), ms, bytes, mesh.corners.size() / 3);
+      fmt::print(
+          "  {:<22} {} chunks, parse {:.1f} ms, merge {:.1f} ms\n",
+          "",
+          statistics.chunk_count,
+          statistics.parse_ms,
+          statistics.merge_ms);
+    }
+
+#ifdef VKENGINE_BENCHMARK_TINYOBJ
+    ObjMeshData  mesh;
+    size_t       triangles = 0;
+    const double ms        = BestOf(kRuns, [&]() { triangles = ParseTinyobj(file, mesh); });
+    Report("tinyobj, 1 thread", ms, bytes, triangles);
+#else
+    fmt::print("  tinyobjloader was not found at configure time, no tinyobj comparison\n");
+#endif
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+// GenerateTangents on welded meshes without a pool and on pools of 1, 2, 4 and 8 workers. the
+// vertices and indices of every pool must be bit identical to the serial run. the frames of the
+// serial run are checked for unit length, orthogonality to the normal and agreement with the
+// dP/du and uv sign of their faces
+//
+// usage: tangent_benchmark [file...]
+//        tangent_benchmark --mirrored side   a side x side grid whose u is mirrored every 16
+//                                            columns, 1001 is 2M faces
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/mesh/tangent_generator.h"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int kRuns = 3;
+
+// welded like LoadStaticMesh, without tangents
+RenderMeshData MirroredGrid(uint32_t side) {
+  RenderMeshData               mesh_data;
+  MeshWelder<VulkanVertexData> welder(size_t(side) * side * 6);
+  const auto                   vertex = [](uint32_t x, uint32_t y) {
+    VulkanVertexData result{};
+    result.position = glm::vec3(float(x), float(y), 0.0f);
+    result.normal   = glm::vec3(0.0f, 0.0f, 1.0f);
+    // u runs back and forth, the faces of every other band are mirrored
+    const uint32_t band = x / 16;
+    const float    u    = (x % 16) / 16.0f;
+    result.texcoord     = glm::vec2(band % 2 ? 1.0f - u : u, float(y) / 16.0f);
+    return result;
+  };
+  for (uint32_t y = 0; y < side; y++) {
+    for (uint32_t x = 0; x < side; x++) {
+      for (const auto& corner : {vertex(x, y),
+                                 vertex(x + 1, y),
+                                 vertex(x + 1, y + 1),
+                                 vertex(x, y),
+                                 vertex(x + 1, y + 1),
+                                 vertex(x, y + 1)}) {
+        mesh_data.index_buffer.push_back(welder.Weld(corner));
+      }
+    }
+  }
+  mesh_data.vertex_buffer = welder.TakeVertices();
+  return mesh_data;
+}
+
+void CheckFrames(
+    const std::vector<VulkanVertexData>& vertices, const std::vector<uint32_t>& indices) {
+  size_t non_unit       = 0;
+  size_t non_orthogonal = 0;
+  for (const auto& vertex : vertices) {
+    const glm::vec3 tangent(vertex.tangent);
+    non_unit += std::fabs(glm::length(tangent) - 1.0f) > 1e-4f ? 1 : 0;
+    non_orthogonal +=
+        std::fabs(glm::dot(tangent, vertex.normal)) > 1e-3f * glm::length(vertex.normal) ? 1 : 0;
+  }
+
+  size_t corners   = 0;
+  size_t agreeing  = 0;
+  size_t same_sign = 0;
+  for (size_t f = 0; f + 2 < indices.size(); f += 3) {
+    const auto&     a    = vertices[indices[f]];
+    const auto&     b    = vertices[indices[f + 1]];
+    const auto&     c    = vertices[indices[f + 2]];
+    const glm::vec2 du   = b.texcoord - a.texcoord;
+    const glm::vec2 dv   = c.texcoord - a.texcoord;
+    const float     area = du.x * dv.y - dv.x * du.y;
+    if (std::fabs(area) < 1e-12f) {
+      continue;
+    }
+    const glm::vec3 face_tangent =
+        ((b.position - a.position) * dv.y - (c.position - a.position) * du.y) / area;
+    for (const auto* corner : {&a, &b, &c}) {
+      corners++;
+      agreeing += glm::dot(glm::vec3(corner->tangent), face_tangent) > 0.0f ? 1 : 0;
+      same_sign += (corner->tangent.w > 0.0f) == (area > 0.0f) ? 1 : 0;
+    }
+  }
+  fmt::print(
+      "  {} not unit, {} not orthogonal, {:.2f}% of corners along their face dP/du, {:.2f}% with "
+      "its sign\n",
+      non_unit,
+      non_orthogonal,
+      corners ? 100.0 * agreeing / corners : 100.0,
+      corners ? 100.0 * same_sign / corners : 100.0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string>    names;
+  std::vector<RenderMeshData> meshes;
+  if (argc > 2 && std::strcmp(argv[1], "--mirrored") == 0) {
+    const auto side = static_cast<uint32_t>(std::atoi(argv[2]));
+    names.push_back(fmt::format("mirrored uv grid of side {}", side));
+    meshes.push_back(MirroredGrid(side));
+  } else {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+      files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+      files.push_back("./engine/asset/viking_room.obj");
+    }
+    for (const auto& file : files) {
+      RenderMeshData mesh_data;
+      std::string    error;
+      if (!LoadObjMesh(file, mesh_data, error, nullptr)) {
+        fmt::print("can not parse {}: {}\n", file, error);
+        continue;
+      }
+      names.push_back(file);
+      meshes.push_back(std::move(mesh_data));
+    }
+  }
+
+  for (size_t m = 0; m < meshes.size(); m++) {
+    const auto& welded = meshes[m];
+    fmt::print(
+        "{}: {} faces, {} welded vertices, best of {} runs\n",
+        names[m],
+        welded.index_buffer.size() / 3,
+        welded.vertex_buffer.size(),
+        kRuns);
+
+    std::vector<VulkanVertexData> serial_vertices;
+    std::vector<uint32_t>         serial_indices;
+    for (const uint32_t thread_count : {0u, 1u, 2u, 4u, 8u}) {
+      std::unique_ptr<ThreadPool> pool;
+      if (thread_count > 0) {
+        pool = std::make_unique<ThreadPool>(thread_count);
+      }
+      std::vector<VulkanVertexData> vertices;
+      std::vector<uint32_t>         indices;
+      TangentStatistics             statistics;
+      const double                  ms = BestOf(kRuns, [&]() {
+        vertices   = welded.vertex_buffer;
+        indices    = welded.index_buffer;
+        statistics = GenerateTangents(vertices, indices, pool.get());
+      });
+
+      bool identical = true;
+      if (thread_count == 0) {
+        serial_vertices = vertices;
+        serial_indices  = indices;
+      } else {
+        identical = vertices.size() == serial_vertices.size() && indices == serial_indices &&
+                    std::memcmp(
+                        vertices.data(),
+                        serial_vertices.data(),
+                        sizeof(VulkanVertexData) * vertices.size()) == 0;
+      }
+      fmt::print(
+          "  {} workers {:9.2f} ms  {} vertices, {} split, {} degenerate faces  {}\n",
+          thread_count,
+          ms,
+          statistics.vertex_count,
+          statistics.split_count,
+          statistics.degenerate_count,
+          thread_count == 0 ? "serial" : (identical ? "identical" : "DIFFERS FROM SERIAL"));
+    }
+    CheckFrames(serial_vertices, serial_indices);
+  }
+  return 0;
+}
@@ -0,0 +1,235 @@
+// decodes a batch of images with TextureDecoder, serially and on pools of 1, 2, 4 and 8 workers,
+// then on a pool of 4 under smaller memory budgets. every file is queued kCopies times. reports the
+// wall time, the encoded and decoded MB/s of every format, the peak reserved memory and the
+// budget waits. every texture must be bit identical to a DecodeTexture of its file
+//
+// usage: texture_decode_benchmark [file...]   files ending in .hdr decode to float texels. without
+//                                             files the jpg and png of the assets and a bmp and
+//                                             an hdr of 2048x2048 written to a scratch directory
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "core/utils/hash.h"
+#include "core/utils/mapped_file.h"
+#include "fmt/format.h"
+#include "function/render/texture/texture_decoder.h"
+
+using namespace vkengine;
+
+namespace {
+
+constexpr int      kCopies        = 8;
+constexpr uint32_t kGeneratedSide = 2048;
+
+// gradients with a bit pattern on top, so the decoded bytes depend on the position
+float Pattern(uint32_t x, uint32_t y, int channel) {
+  return float(x * (channel + 1) + y * (3 - channel)) / (4.0f * kGeneratedSide) +
+         0.05f * float((x ^ y) >> channel & 7);
+}
+
+// 24 bit uncompressed, bottom up rows padded to 4 bytes
+bool WriteBmp(const std::string& file) {
+  const uint32_t row_size  = (kGeneratedSide * 3 + 3) & ~3u;
+  const uint32_t data_size = row_size * kGeneratedSide;
+  uint8_t        header[54]{};
+  const auto     put32 = [&header](int offset, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      header[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+  };
+  header[0] = 'B';
+  header[1] = 'M';
+  put32(2, sizeof(header) + data_size);
+  put32(10, sizeof(header));
+  put32(14, 40);
+  put32(18, kGeneratedSide);
+  put32(22, kGeneratedSide);
+  header[26] = 1;
+  header[28] = 24;
+  put32(34, data_size);
+
+  std::vector<uint8_t> pixels(data_size, 0);
+  for (uint32_t y = 0; y < kGeneratedSide; y++) {
+    for (uint32_t x = 0; x < kGeneratedSide; x++) {
+      for (int c = 0; c < 3; c++) {
+        const float value = std::fmin(Pattern(x, y, c), 1.0f);
+        pixels[y * row_size + x * 3 + c] = static_cast<uint8_t>(value * 255.0f);
+      }
+    }
+  }
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+  return static_cast<bool>(out);
+}
+
+// radiance rgbe with flat scanlines, stb reads them when they do not start like a run
+bool WriteHdr(const std::string& file) {
+  const std::string header = fmt::format(
+      "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y {} +X {}\n", kGeneratedSide, kGeneratedSide);
+  std::vector<uint8_t> pixels(size_t(kGeneratedSide) * kGeneratedSide * 4);
+  for (uint32_t y = 0; y < kGeneratedSide; y++) {
+    for (uint32_t x = 0; x < kGeneratedSide; x++) {
+      float rgb[3];
+      for (int c = 0; c < 3; c++) {
+        rgb[c] = 4.0f * Pattern(x, y, c) + 0.01f;
+      }
+      int exponent = 0;
+      std::frexp(std::fmax(rgb[0], std::fmax(rgb[1], rgb[2])), &exponent);
+      uint8_t* rgbe = &pixels[(size_t(y) * kGeneratedSide + x) * 4];
+      for (int c = 0; c < 3; c++) {
+        rgbe[c] = static_cast<uint8_t>(rgb[c] * std::ldexp(256.0f, -exponent));
+      }
+      rgbe[3] = static_cast<uint8_t>(exponent + 128);
+    }
+  }
+  std::ofstream out(file, std::ios::binary | std::ios::trunc);
+  out.write(header.data(), header.size());
+  out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+  return static_cast<bool>(out);
+}
+
+TextureDecodeRequest MakeRequest(const std::string& file) {
+  TextureDecodeRequest request;
+  request.file = file;
+  request.hdr  = std::filesystem::path(file).extension() == ".hdr";
+  return request;
+}
+
+uint64_t HashTexture(const RenderMaterialData& texture) {
+  return HashBytes(
+      texture.pixels, GetMipLevelSize(texture.format, texture.width, texture.height, 0));
+}
+
+struct DecodeRun {
+  double                  ms = 0.0;
+  TextureDecodeStatistics statistics;
+  bool                    same = true;
+};
+
+DecodeRun Decode(
+    ThreadPool*                              pool,
+    size_t                                   memory_budget,
+    const std::vector<TextureDecodeRequest>& requests,
+    const std::vector<uint64_t>&             reference) {
+  DecodeRun            run;
+  TextureDecoder       decoder(pool);
+  TextureDecodeOptions options;
+  options.memory_budget = memory_budget;
+  std::vector<uint64_t> hashes(requests.size(), 0);
+  const auto            start = BenchmarkClock::now();
+  // the texels are dropped once hashed, like a consumer that uploads them
+  decoder.Decode(
+      requests, options, [&hashes](uint32_t index, std::shared_ptr<RenderMaterialData> texture) {
+        hashes[index] = texture ? HashTexture(*texture) : 0;
+      });
+  run.ms         = ElapsedMs(start);
+  run.statistics = decoder.GetStatistics();
+  run.same       = hashes == reference;
+  return run;
+}
+
+void PrintFormats(const TextureDecodeStatistics& statistics) {
+  for (size_t f = 0; f < static_cast<size_t>(TextureFileFormat::kCount); f++) {
+    const auto& format = statistics.formats[f];
+    if (format.image_count == 0) {
+      continue;
+    }
+    fmt::print(
+        "    {:<5} {:3} images {:3} failed  {:8.1f} MB/s encoded {:8.1f} MB/s decoded per "
+        "worker\n",
+        TextureFileFormatName(static_cast<TextureFileFormat>(f)),
+        format.image_count,
+        format.failed_count,
+        format.encoded_bytes / (1024.0 * 1024.0) / format.decode_ms * 1e3,
+        format.decoded_bytes / (1024.0 * 1024.0) / format.decode_ms * 1e3);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const auto scratch = std::filesystem::temp_directory_path() / "vkengine_texture_benchmark";
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    files.push_back(argv[i]);
+  }
+  if (files.empty()) {
+    std::filesystem::create_directories(scratch);
+    files = {"./engine/asset/texture.jpg",
+             "./engine/asset/viking_room.png",
+             (scratch / "generated.bmp").string(),
+             (scratch / "generated.hdr").string()};
+    if (!WriteBmp(files[2]) || !WriteHdr(files[3])) {
+      fmt::print("can not write the images to {}\n", scratch.string());
+      return 1;
+    }
+  }
+
+  // the reference of every file, decoded alone from its mapping
+  std::vector<TextureDecodeRequest> requests;
+  std::vector<uint64_t>             reference;
+  size_t                            encoded_bytes = 0;
+  for (const auto& file : files) {
+    MappedFile mapped;
+    auto       request = MakeRequest(file);
+    if (!mapped.Open(file)) {
+      fmt::print("can not read {}\n", file);
+      return 1;
+    }
+    const auto texture = DecodeTexture(mapped.Data(), mapped.Size(), request);
+    if (!texture) {
+      fmt::print("can not decode {}\n", file);
+      return 1;
+    }
+    fmt::print(
+        "{}: {}, {}x{}, {:.1f} MB\n",
+        file,
+        TextureFileFormatName(DetectTextureFileFormat(mapped.Data(), mapped.Size())),
+        texture->width,
+        texture->height,
+        mapped.Size() / (1024.0 * 1024.0));
+    for (int c = 0; c < kCopies; c++) {
+      requests.push_back(request);
+      reference.push_back(HashTexture(*texture));
+      encoded_bytes += mapped.Size();
+    }
+  }
+  fmt::print("{} images, {:.1f} MB encoded\n", requests.size(), encoded_bytes / (1024.0 * 1024.0));
+
+  for (const uint32_t thread_count : {0u, 1u, 2u, 4u, 8u}) {
+    std::unique_ptr<ThreadPool> pool;
+    if (thread_count > 0) {
+      pool = std::make_unique<ThreadPool>(thread_count);
+    }
+    const auto run = Decode(pool.get(), size_t(1) << 30, requests, reference);
+    fmt::print(
+        "  {} workers, 1 GB budget {:9.1f} ms {:8.1f} MB/s encoded  peak {:6.1f} MB  {}\n",
+        thread_count,
+        run.ms,
+        encoded_bytes / (1024.0 * 1024.0) / run.ms * 1e3,
+        run.statistics.peak_memory / (1024.0 * 1024.0),
+        run.same ? "same texels" : "TEXELS DIFFER");
+    PrintFormats(run.statistics);
+  }
+
+  ThreadPool pool(4);
+  for (const size_t budget_mb : {128, 16}) {
+    const auto run = Decode(&pool, budget_mb << 20, requests, reference);
+    fmt::print(
+        "  4 workers, {} MB budget {:9.1f} ms  peak {:6.1f} MB, {} waits  {}\n",
+        budget_mb,
+        run.ms,
+        run.statistics.peak_memory / (1024.0 * 1024.0),
+        run.statistics.budget_waits,
+        run.same ? "same texels" : "TEXELS DIFFER");
+  }
+  std::filesystem::remove_all(scratch);
+  return 0;
+}
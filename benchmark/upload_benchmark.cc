@@ -0,0 +1,146 @@
+// uploads the vertex and index buffers of mesh_count meshes into device local buffers twice. once
+// the way RenderResource did before the staging ring, a staging buffer with its own
+// vkAllocateMemory and a queue drain per buffer, once through VulkanRhi::UploadBuffer. opens a
+// window, the rhi needs a surface
+//
+// usage: upload_benchmark [mesh_count] [max_vertex_count]
+
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "benchmark_utils.h"
+#include "fmt/format.h"
+#include "function/render/rhi/vulkanrhi.h"
+#include "function/render/rhi/vulkanutils.h"
+#include "function/window/window_system.h"
+
+using namespace vkengine;
+
+namespace {
+
+struct MeshBuffers {
+  VkBuffer         vertex_buffer = VK_NULL_HANDLE;
+  VulkanAllocation vertex_memory;
+  VkDeviceSize     vertex_size = 0;
+  VkBuffer         index_buffer = VK_NULL_HANDLE;
+  VulkanAllocation index_memory;
+  VkDeviceSize     index_size = 0;
+};
+
+void UploadWithOwnStaging(VulkanRhi& rhi, VkBuffer dst, const void* data, VkDeviceSize size) {
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size        = size;
+  bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  VkBuffer staging       = VK_NULL_HANDLE;
+  vkCreateBuffer(rhi.logic_device_, &bufferInfo, nullptr, &staging);
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(rhi.logic_device_, staging, &memRequirements);
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize  = memRequirements.size;
+  allocInfo.memoryTypeIndex = FindMemoryType(
+      rhi.physical_device_,
+      memRequirements.memoryTypeBits,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  vkAllocateMemory(rhi.logic_device_, &allocInfo, nullptr, &memory);
+  vkBindBufferMemory(rhi.logic_device_, staging, memory, 0);
+
+  void* mapped = nullptr;
+  vkMapMemory(rhi.logic_device_, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+  std::memcpy(mapped, data, static_cast<size_t>(size));
+  vkUnmapMemory(rhi.logic_device_, memory);
+
+  rhi.CopyBuffer(staging, dst, size);
+  vkDestroyBuffer(rhi.logic_device_, staging, nullptr);
+  vkFreeMemory(rhi.logic_device_, memory, nullptr);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t mesh_count       = argc > 1 ? std::atoi(argv[1]) : 2000;
+  const uint32_t max_vertex_count = argc > 2 ? std::atoi(argv[2]) : 20000;
+  StartBenchmarkContext();
+
+  WindowCreateInfo windowinfo;
+  windowinfo.title = "upload_benchmark";
+  RHIInitInfo rhiinfo;
+  rhiinfo.window_system = std::make_shared<WindowSystem>(windowinfo);
+  VulkanRhi rhi;
+  rhi.Init(rhiinfo);
+
+  // meshes of 64 to max_vertex_count vertices, three indices per vertex
+  std::mt19937                            rng(1);
+  std::uniform_int_distribution<uint32_t> vertex_count(64, std::max(max_vertex_count, 64u));
+  std::vector<MeshBuffers>                meshes(mesh_count);
+  VkDeviceSize                            total_size = 0;
+  VkDeviceSize                            max_size   = 0;
+  for (auto& mesh : meshes) {
+    const uint32_t count = vertex_count(rng);
+    mesh.vertex_size     = VkDeviceSize(count) * sizeof(VulkanVertexData);
+    mesh.index_size      = VkDeviceSize(count) * 3 * sizeof(uint32_t);
+    rhi.CreateBuffer(
+        mesh.vertex_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mesh.vertex_buffer,
+        mesh.vertex_memory);
+    rhi.CreateBuffer(
+        mesh.index_size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        mesh.index_buffer,
+        mesh.index_memory);
+    total_size += mesh.vertex_size + mesh.index_size;
+    max_size = std::max(max_size, std::max(mesh.vertex_size, mesh.index_size));
+  }
+  std::vector<uint8_t> source(static_cast<size_t>(max_size));
+  for (auto& byte : source) {
+    byte = static_cast<uint8_t>(rng());
+  }
+
+  vkDeviceWaitIdle(rhi.logic_device_);
+  const double own_staging_ms = BestOf(3, [&]() {
+    for (const auto& mesh : meshes) {
+      UploadWithOwnStaging(rhi, mesh.vertex_buffer, source.data(), mesh.vertex_size);
+      UploadWithOwnStaging(rhi, mesh.index_buffer, source.data(), mesh.index_size);
+    }
+  });
+
+  vkDeviceWaitIdle(rhi.logic_device_);
+  const UploadStatistics before  = rhi.GetUploadStatistics();
+  const double           ring_ms = BestOf(3, [&]() {
+    for (const auto& mesh : meshes) {
+      rhi.UploadBuffer(mesh.vertex_buffer, source.data(), mesh.vertex_size);
+      rhi.UploadBuffer(mesh.index_buffer, source.data(), mesh.index_size);
+    }
+    rhi.FlushUploads(true);
+  });
+  const UploadStatistics& after = rhi.GetUploadStatistics();
+
+  const double megabytes = total_size / (1024.0 * 1024.0);
+  fmt::print("{} meshes, {} buffers, {:.1f} MB\n", mesh_count, mesh_count * 2, megabytes);
+  fmt::print(
+      "  staging buffer per upload  {:9.1f} ms  {:8.1f} MB/s\n",
+      own_staging_ms,
+      megabytes / own_staging_ms * 1e3);
+  fmt::print(
+      "  staging ring               {:9.1f} ms  {:8.1f} MB/s  {} batches, {} stalls in 3 runs\n",
+      ring_ms,
+      megabytes / ring_ms * 1e3,
+      after.batches - before.batches,
+      after.stalls - before.stalls);
+
+  vkDeviceWaitIdle(rhi.logic_device_);
+  for (auto& mesh : meshes) {
+    rhi.DestroyBuffer(mesh.vertex_buffer, mesh.vertex_memory);
+    rhi.DestroyBuffer(mesh.index_buffer, mesh.index_memory);
+  }
+  return 0;
+}
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Material {
+    vec4 base_color_factor;
+};
+
+layout(set = 1, binding = 0) readonly buffer Materials {
+    Material materials[];
+};
+layout(set = 1, binding = 1) uniform sampler2D baseColorTextures[];
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    Material material = materials[fragMaterialId];
+    outColor = material.base_color_factor *
+               texture(baseColorTextures[nonuniformEXT(fragMaterialId)], fragTexCoord);
+}
@@ -0,0 +1,27 @@
+#version 450
+
+layout(set = 0, binding = 0) readonly buffer PerFrame {
+    mat4 proj_view_matrix;
+    vec3 camera_position;
+} per_frame;
+
+layout(push_constant) uniform PerDraw {
+    mat4 model_matrix;
+    uint material_id;
+} per_draw;
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inTangent;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterialId;
+
+void main() {
+    gl_Position = per_frame.proj_view_matrix * per_draw.model_matrix * vec4(inPos, 1.0);
+    fragNormal = mat3(per_draw.model_matrix) * inNormal;
+    fragTexCoord = inTexCoord;
+    fragMaterialId = per_draw.material_id;
+}
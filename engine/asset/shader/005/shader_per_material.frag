@@ -0,0 +1,17 @@
+#version 450
+
+// per material set of devices without descriptor indexing, bound once per material
+layout(set = 1, binding = 0) uniform Material {
+    vec4 base_color_factor;
+} material;
+layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = material.base_color_factor * texture(baseColorTexture, fragTexCoord);
+}
@@ -0,0 +1,38 @@
+#version 450
+
+struct Instance {
+    mat4 model_matrix;
+    vec4 base_color_factor;
+    vec4 position_offset;
+    vec4 position_scale;
+    uint material_id;
+};
+
+layout(set = 0, binding = 0) readonly buffer PerFrame {
+    mat4 proj_view_matrix;
+    vec3 camera_position;
+} per_frame;
+
+// gl_InstanceIndex includes the firstInstance of the batch
+layout(set = 0, binding = 1) readonly buffer Instances {
+    Instance instances[];
+};
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inTangent;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out vec4 fragBaseColorFactor;
+layout(location = 3) flat out uint fragMaterialId;
+
+void main() {
+    Instance instance = instances[gl_InstanceIndex];
+    gl_Position = per_frame.proj_view_matrix * instance.model_matrix * vec4(inPos, 1.0);
+    fragNormal = mat3(instance.model_matrix) * inNormal;
+    fragTexCoord = inTexCoord;
+    fragBaseColorFactor = instance.base_color_factor;
+    fragMaterialId = instance.material_id;
+}
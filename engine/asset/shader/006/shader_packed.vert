@@ -0,0 +1,47 @@
+#version 450
+
+struct Instance {
+    mat4 model_matrix;
+    vec4 base_color_factor;
+    vec4 position_offset;
+    vec4 position_scale;
+    uint material_id;
+};
+
+layout(set = 0, binding = 0) readonly buffer PerFrame {
+    mat4 proj_view_matrix;
+    vec3 camera_position;
+} per_frame;
+
+// gl_InstanceIndex includes the firstInstance of the batch
+layout(set = 0, binding = 1) readonly buffer Instances {
+    Instance instances[];
+};
+
+// VulkanPackedVertexData
+layout(location = 0) in vec4 inPos;       // unorm16 over the mesh aabb, w is the tangent sign
+layout(location = 1) in vec2 inNormal;    // octahedral snorm16
+layout(location = 2) in vec2 inTangent;   // octahedral snorm16
+layout(location = 3) in vec2 inTexCoord;  // half float
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out vec4 fragBaseColorFactor;
+layout(location = 3) flat out uint fragMaterialId;
+
+vec3 DecodeOctahedral(vec2 encoded) {
+    vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-direction.z, 0.0);
+    direction.xy += vec2(direction.x >= 0.0 ? -t : t, direction.y >= 0.0 ? -t : t);
+    return normalize(direction);
+}
+
+void main() {
+    Instance instance = instances[gl_InstanceIndex];
+    vec3 position = instance.position_offset.xyz + inPos.xyz * instance.position_scale.xyz;
+    gl_Position = per_frame.proj_view_matrix * instance.model_matrix * vec4(position, 1.0);
+    fragNormal = mat3(instance.model_matrix) * DecodeOctahedral(inNormal);
+    fragTexCoord = inTexCoord;
+    fragBaseColorFactor = instance.base_color_factor;
+    fragMaterialId = instance.material_id;
+}
@@ -0,0 +1,15 @@
+#version 450
+
+// per material set of devices without descriptor indexing, bound once per material
+layout(set = 1, binding = 1) uniform sampler2D baseColorTexture;
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in vec4 fragBaseColorFactor;
+layout(location = 3) flat in uint fragMaterialId;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    outColor = fragBaseColorFactor * texture(baseColorTexture, fragTexCoord);
+}
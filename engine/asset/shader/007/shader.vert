@@ -0,0 +1,46 @@
+#version 450
+
+// matches VkCullObjectData
+struct Object {
+    mat4 model_matrix;
+    vec4 bounding_sphere;
+    vec4 base_color_factor;
+    vec4 position_offset;
+    vec4 position_scale;
+    uint index_count;
+    uint first_index;
+    int vertex_offset;
+    uint material_id;
+    uint page;
+    uint draw_base;
+    uint count_slot;
+};
+
+layout(set = 0, binding = 0) readonly buffer PerFrame {
+    mat4 proj_view_matrix;
+    vec3 camera_position;
+} per_frame;
+
+// the object buffer of the culling pass, firstInstance of every draw is the object index
+layout(set = 0, binding = 1) readonly buffer Objects {
+    Object objects[];
+};
+
+layout(location = 0) in vec3 inPos;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inTangent;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out vec4 fragBaseColorFactor;
+layout(location = 3) flat out uint fragMaterialId;
+
+void main() {
+    Object object = objects[gl_InstanceIndex];
+    gl_Position = per_frame.proj_view_matrix * object.model_matrix * vec4(inPos, 1.0);
+    fragNormal = mat3(object.model_matrix) * inNormal;
+    fragTexCoord = inTexCoord;
+    fragBaseColorFactor = object.base_color_factor;
+    fragMaterialId = object.material_id;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace vkengine {
+
+// murmur3 finalizer, every input bit affects every output bit
+inline uint64_t MixBits(uint64_t value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdull;
+  value ^= value >> 33;
+  value *= 0xc4ceb9fe1a85ec53ull;
+  value ^= value >> 33;
+  return value;
+}
+
+// hash of the raw bytes, 8 bytes per round like xxhash64, then a full avalanche. meant for small
+// pod keys such as vertices, where float fields must be compared by bit pattern
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0) {
+  constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+  constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  uint64_t    hash  = seed + kPrime1 + size;
+  size_t      i     = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, 8);
+    word *= kPrime2;
+    word = (word << 31) | (word >> 33);
+    hash ^= word * kPrime1;
+    hash = ((hash << 27) | (hash >> 37)) * kPrime1;
+  }
+  if (i + 4 <= size) {
+    uint32_t word;
+    std::memcpy(&word, bytes + i, 4);
+    hash ^= word * kPrime1;
+    hash = ((hash << 23) | (hash >> 41)) * kPrime2;
+    i += 4;
+  }
+  for (; i < size; i++) {
+    hash ^= bytes[i] * kPrime2;
+    hash = ((hash << 11) | (hash >> 53)) * kPrime1;
+  }
+  return MixBits(hash);
+}
+
+}  // namespace vkengine
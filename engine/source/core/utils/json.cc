@@ -0,0 +1,338 @@
+#include "core/utils/json.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace vkengine {
+
+namespace {
+const JsonValue kNullValue;
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+// -1 for a character that is not a hex digit
+inline int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+void AppendUtf8(uint32_t code_point, std::string& out) {
+  if (code_point < 0x80) {
+    out += static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    out += static_cast<char>(0xc0 | (code_point >> 6));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    out += static_cast<char>(0xe0 | (code_point >> 12));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    out += static_cast<char>(0xf0 | (code_point >> 18));
+    out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+    out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+}
+}  // namespace
+
+bool JsonValue::AsBool(bool fallback) const {
+  return type_ == Type::kBool ? boolean_ : fallback;
+}
+
+double JsonValue::AsNumber(double fallback) const {
+  return type_ == Type::kNumber ? number_ : fallback;
+}
+
+uint64_t JsonValue::AsUint(uint64_t fallback) const {
+  // 2^64 does not fit, every smaller double does
+  if (type_ != Type::kNumber || !(number_ >= 0.0) || number_ >= 18446744073709551616.0 ||
+      std::floor(number_) != number_) {
+    return fallback;
+  }
+  return static_cast<uint64_t>(number_);
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+  return type_ == Type::kArray && index < elements_.size() ? elements_[index] : kNullValue;
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const {
+  if (type_ == Type::kObject) {
+    for (size_t i = 0; i < keys_.size(); i++) {
+      if (keys_[i] == key) {
+        return elements_[i];
+      }
+    }
+  }
+  return kNullValue;
+}
+
+bool JsonParser::Parse(const char* data, size_t size, JsonValue& value, std::string& error) {
+  begin_  = data;
+  cursor_ = data;
+  end_    = data + size;
+  error_.clear();
+
+  value = JsonValue{};
+  if (!ParseValue(value, 0)) {
+    error = error_;
+    return false;
+  }
+  SkipWhitespace();
+  if (cursor_ != end_) {
+    Fail("trailing characters");
+    error = error_;
+    return false;
+  }
+  return true;
+}
+
+bool JsonParser::ParseValue(JsonValue& value, uint32_t depth) {
+  if (depth > kMaxDepth) {
+    return Fail("nested too deep");
+  }
+  SkipWhitespace();
+  if (cursor_ >= end_) {
+    return Fail("unexpected end");
+  }
+
+  switch (*cursor_) {
+    case '{': {
+      cursor_++;
+      value.type_ = JsonValue::Type::kObject;
+      SkipWhitespace();
+      if (cursor_ < end_ && *cursor_ == '}') {
+        cursor_++;
+        return true;
+      }
+      while (true) {
+        SkipWhitespace();
+        std::string key;
+        if (cursor_ >= end_ || *cursor_ != '"' || !ParseString(key)) {
+          return Fail("expected a member name");
+        }
+        SkipWhitespace();
+        if (cursor_ >= end_ || *cursor_ != ':') {
+          return Fail("expected ':'");
+        }
+        cursor_++;
+        value.keys_.push_back(std::move(key));
+        value.elements_.emplace_back();
+        if (!ParseValue(value.elements_.back(), depth + 1)) {
+          return false;
+        }
+        SkipWhitespace();
+        if (cursor_ < end_ && *cursor_ == ',') {
+          cursor_++;
+        } else if (cursor_ < end_ && *cursor_ == '}') {
+          cursor_++;
+          return true;
+        } else {
+          return Fail("expected ',' or '}'");
+        }
+      }
+    }
+    case '[': {
+      cursor_++;
+      value.type_ = JsonValue::Type::kArray;
+      SkipWhitespace();
+      if (cursor_ < end_ && *cursor_ == ']') {
+        cursor_++;
+        return true;
+      }
+      while (true) {
+        value.elements_.emplace_back();
+        if (!ParseValue(value.elements_.back(), depth + 1)) {
+          return false;
+        }
+        SkipWhitespace();
+        if (cursor_ < end_ && *cursor_ == ',') {
+          cursor_++;
+        } else if (cursor_ < end_ && *cursor_ == ']') {
+          cursor_++;
+          return true;
+        } else {
+          return Fail("expected ',' or ']'");
+        }
+      }
+    }
+    case '"':
+      value.type_ = JsonValue::Type::kString;
+      return ParseString(value.string_);
+    case 't':
+      value.type_    = JsonValue::Type::kBool;
+      value.boolean_ = true;
+      return Expect("true");
+    case 'f':
+      value.type_ = JsonValue::Type::kBool;
+      return Expect("false");
+    case 'n':
+      return Expect("null");
+    default:
+      value.type_ = JsonValue::Type::kNumber;
+      return ParseNumber(value.number_);
+  }
+}
+
+bool JsonParser::ParseString(std::string& value) {
+  // opening quote
+  cursor_++;
+  while (cursor_ < end_) {
+    const char c = *cursor_++;
+    if (c == '"') {
+      return true;
+    }
+    if (static_cast<unsigned char>(c) < 0x20) {
+      return Fail("control character in string");
+    }
+    if (c != '\\') {
+      value += c;
+      continue;
+    }
+    if (cursor_ >= end_) {
+      break;
+    }
+    switch (*cursor_++) {
+      case '"':
+        value += '"';
+        break;
+      case '\\':
+        value += '\\';
+        break;
+      case '/':
+        value += '/';
+        break;
+      case 'b':
+        value += '\b';
+        break;
+      case 'f':
+        value += '\f';
+        break;
+      case 'n':
+        value += '\n';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case 't':
+        value += '\t';
+        break;
+      case 'u': {
+        uint32_t code_point = 0;
+        for (int unit = 0; unit < 2; unit++) {
+          if (end_ - cursor_ < 4) {
+            return Fail("truncated \\u escape");
+          }
+          uint32_t code_unit = 0;
+          for (int i = 0; i < 4; i++) {
+            const int digit = HexDigit(*cursor_++);
+            if (digit < 0) {
+              return Fail("invalid \\u escape");
+            }
+            code_unit = code_unit << 4 | static_cast<uint32_t>(digit);
+          }
+          if (unit == 0) {
+            code_point = code_unit;
+            // a high surrogate is followed by the escape of its low surrogate
+            if (code_unit < 0xd800 || code_unit > 0xdbff) {
+              break;
+            }
+            if (end_ - cursor_ < 2 || cursor_[0] != '\\' || cursor_[1] != 'u') {
+              return Fail("unpaired surrogate");
+            }
+            cursor_ += 2;
+          } else {
+            if (code_unit < 0xdc00 || code_unit > 0xdfff) {
+              return Fail("unpaired surrogate");
+            }
+            code_point = 0x10000 + ((code_point - 0xd800) << 10) + (code_unit - 0xdc00);
+          }
+        }
+        AppendUtf8(code_point, value);
+        break;
+      }
+      default:
+        return Fail("invalid escape");
+    }
+  }
+  return Fail("unterminated string");
+}
+
+bool JsonParser::ParseNumber(double& value) {
+  // validate the json grammar first, from_chars also takes forms json does not
+  const char* start = cursor_;
+  if (cursor_ < end_ && *cursor_ == '-') {
+    cursor_++;
+  }
+  if (cursor_ < end_ && *cursor_ == '0') {
+    cursor_++;
+  } else if (cursor_ < end_ && IsDigit(*cursor_)) {
+    while (cursor_ < end_ && IsDigit(*cursor_)) {
+      cursor_++;
+    }
+  } else {
+    return Fail("invalid value");
+  }
+  if (cursor_ < end_ && *cursor_ == '.') {
+    cursor_++;
+    if (cursor_ >= end_ || !IsDigit(*cursor_)) {
+      return Fail("invalid number");
+    }
+    while (cursor_ < end_ && IsDigit(*cursor_)) {
+      cursor_++;
+    }
+  }
+  if (cursor_ < end_ && (*cursor_ == 'e' || *cursor_ == 'E')) {
+    cursor_++;
+    if (cursor_ < end_ && (*cursor_ == '+' || *cursor_ == '-')) {
+      cursor_++;
+    }
+    if (cursor_ >= end_ || !IsDigit(*cursor_)) {
+      return Fail("invalid number");
+    }
+    while (cursor_ < end_ && IsDigit(*cursor_)) {
+      cursor_++;
+    }
+  }
+  // out of range numbers are an error of from_chars, they are not needed by any asset
+  const auto result = std::from_chars(start, cursor_, value);
+  if (result.ec != std::errc() || result.ptr != cursor_) {
+    cursor_ = start;
+    return Fail("number out of range");
+  }
+  return true;
+}
+
+bool JsonParser::Expect(const char* literal) {
+  const size_t length = std::strlen(literal);
+  if (static_cast<size_t>(end_ - cursor_) < length || std::memcmp(cursor_, literal, length) != 0) {
+    return Fail("invalid value");
+  }
+  cursor_ += length;
+  return true;
+}
+
+void JsonParser::SkipWhitespace() {
+  while (cursor_ < end_ &&
+         (*cursor_ == ' ' || *cursor_ == '\t' || *cursor_ == '\n' || *cursor_ == '\r')) {
+    cursor_++;
+  }
+}
+
+bool JsonParser::Fail(const char* message) {
+  if (error_.empty()) {
+    error_ = std::string(message) + " at byte " + std::to_string(cursor_ - begin_);
+  }
+  return false;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vkengine {
+
+// read only json document, enough for asset headers such as gltf. numbers are doubles, objects
+// keep their members in file order and are searched linearly. lookups of a missing member or
+// element, or on a value of another type, give a null value, so paths can be chained
+class JsonValue {
+ public:
+  enum class Type : uint8_t { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  Type GetType() const { return type_; }
+  bool IsNull() const { return type_ == Type::kNull; }
+  bool IsNumber() const { return type_ == Type::kNumber; }
+  bool IsString() const { return type_ == Type::kString; }
+  bool IsArray() const { return type_ == Type::kArray; }
+  bool IsObject() const { return type_ == Type::kObject; }
+
+  bool               AsBool(bool fallback = false) const;
+  double             AsNumber(double fallback = 0.0) const;
+  const std::string& AsString() const { return string_; }
+  // fallback as well for negative or fractional numbers
+  uint64_t AsUint(uint64_t fallback = 0) const;
+
+  // elements of an array or members of an object
+  size_t           Size() const { return elements_.size(); }
+  const JsonValue& operator[](size_t index) const;
+  const JsonValue& operator[](const char* key) const;
+  bool             Has(const char* key) const { return !(*this)[key].IsNull(); }
+  // key of member index of an object
+  const std::string& Key(size_t index) const { return keys_[index]; }
+
+ private:
+  friend class JsonParser;
+
+  Type        type_    = Type::kNull;
+  bool        boolean_ = false;
+  double      number_  = 0.0;
+  std::string string_;
+  // array elements, or object member values in the order of keys_
+  std::vector<JsonValue>   elements_;
+  std::vector<std::string> keys_;
+};
+
+// rfc 8259 parser, recursive descent with a nesting limit
+class JsonParser {
+ public:
+  static constexpr uint32_t kMaxDepth = 128;
+
+  JsonParser() {}
+  ~JsonParser() {}
+
+  // return false and set error with the byte offset if data is not one json value
+  bool Parse(const char* data, size_t size, JsonValue& value, std::string& error);
+
+ private:
+  const char* begin_  = nullptr;
+  const char* cursor_ = nullptr;
+  const char* end_    = nullptr;
+  std::string error_;
+
+  bool ParseValue(JsonValue& value, uint32_t depth);
+  bool ParseString(std::string& value);
+  bool ParseNumber(double& value);
+  bool Expect(const char* literal);
+  void SkipWhitespace();
+  bool Fail(const char* message);
+};
+
+}  // namespace vkengine
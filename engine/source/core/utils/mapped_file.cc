@@ -0,0 +1,130 @@
+#include "core/utils/mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vkengine {
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+  if (this != &rhs) {
+    Close();
+    data_ = std::exchange(rhs.data_, nullptr);
+    size_ = std::exchange(rhs.size_, 0);
+    open_ = std::exchange(rhs.open_, false);
+#ifdef _WIN32
+    file_handle_    = std::exchange(rhs.file_handle_, nullptr);
+    mapping_handle_ = std::exchange(rhs.mapping_handle_, nullptr);
+#endif
+  }
+  return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& file) {
+  Close();
+  HANDLE handle = CreateFileA(
+      file.c_str(),
+      GENERIC_READ,
+      FILE_SHARE_READ,
+      nullptr,
+      OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size)) {
+    CloseHandle(handle);
+    return false;
+  }
+  file_handle_ = handle;
+  size_        = static_cast<size_t>(size.QuadPart);
+  open_        = true;
+  // a zero length file can not be mapped
+  if (size_ == 0) {
+    return true;
+  }
+  mapping_handle_ = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_handle_) {
+    data_ = MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0);
+  }
+  if (!data_) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_handle_) {
+    CloseHandle(mapping_handle_);
+  }
+  if (file_handle_) {
+    CloseHandle(file_handle_);
+  }
+  data_           = nullptr;
+  mapping_handle_ = nullptr;
+  file_handle_    = nullptr;
+  size_           = 0;
+  open_           = false;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& file) {
+  Close();
+  const int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(info.st_size);
+  open_ = true;
+  // a zero length file can not be mapped
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      close(fd);
+      Close();
+      return false;
+    }
+    data_ = data;
+    // parsers read front to back
+    madvise(data_, size_, MADV_SEQUENTIAL);
+  }
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  open_ = false;
+}
+
+#endif
+
+}  // namespace vkengine
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace vkengine {
+
+// read only memory map of a whole file, unmapped on destruction
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile() { Close(); }
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& rhs) noexcept { *this = std::move(rhs); }
+  MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+  // return false if the file can not be opened or mapped
+  bool Open(const std::string& file);
+  void Close();
+
+  bool        IsOpen() const { return open_; }
+  const char* Data() const { return static_cast<const char*>(data_); }
+  size_t      Size() const { return size_; }
+
+ private:
+  void*  data_ = nullptr;
+  size_t size_ = 0;
+  bool   open_ = false;
+#ifdef _WIN32
+  void* file_handle_    = nullptr;
+  void* mapping_handle_ = nullptr;
+#endif
+};
+
+}  // namespace vkengine
@@ -0,0 +1,15 @@
+#include "core/utils/temporary_path.h"
+
+#include <functional>
+#include <thread>
+
+#include "fmt/format.h"
+
+namespace vkengine {
+
+std::string ThreadTemporaryPath(const std::string& path) {
+  return fmt::format(
+      "{}.{:x}.tmp", path, std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+}  // namespace vkengine
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+
+namespace vkengine {
+
+// path + ".<thread>.tmp", one per thread. a file is written there and renamed over path, so
+// workers writing the same file at once never share a temporary
+std::string ThreadTemporaryPath(const std::string& path);
+
+}  // namespace vkengine
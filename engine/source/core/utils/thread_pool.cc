@@ -0,0 +1,97 @@
+#include "core/utils/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace vkengine {
+
+ThreadPool::ThreadPool(uint32_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(thread_count);
+  for (uint32_t i = 0; i < thread_count; i++) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop();
+    }
+    task();
+  }
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task) {
+  if (count == 0) {
+    return;
+  }
+  if (count == 1) {
+    task(0);
+    return;
+  }
+
+  // helpers and the caller pull indices from a shared counter until it runs out. the caller
+  // waits for the indices to finish, not for the helpers, so a helper still queued behind a
+  // busy worker can not block it. late helpers find no index left and never touch task
+  struct State {
+    std::atomic<uint32_t>   next{0};
+    uint32_t                done = 0;
+    std::mutex              mutex;
+    std::condition_variable finished;
+    std::exception_ptr      error;
+  };
+  auto       state = std::make_shared<State>();
+  const auto run   = [state, count, &task]() {
+    for (uint32_t i = state->next++; i < count; i = state->next++) {
+      std::exception_ptr error;
+      try {
+        task(i);
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (error && !state->error) {
+        state->error = error;
+      }
+      if (++state->done == count) {
+        state->finished.notify_all();
+      }
+    }
+  };
+
+  const uint32_t helpers = std::min(ThreadCount(), count - 1);
+  for (uint32_t i = 0; i < helpers; i++) {
+    Submit(run);
+  }
+  run();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&state, count]() { return state->done == count; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vkengine {
+
+// fixed set of worker threads fed from one fifo queue
+class ThreadPool {
+ public:
+  // 0 uses std::thread::hardware_concurrency
+  explicit ThreadPool(uint32_t thread_count = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template <typename Task>
+  std::future<std::invoke_result_t<Task>> Submit(Task&& task) {
+    using Result = std::invoke_result_t<Task>;
+
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+    auto future   = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([packaged]() { (*packaged)(); });
+    }
+    condition_.notify_one();
+    return future;
+  }
+
+  // run task(i) for every i in [0, count) and block until all finish. the calling thread takes
+  // part, so a call from inside a worker still makes progress. the first exception is rethrown
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+  uint32_t ThreadCount() const { return static_cast<uint32_t>(workers_.size()); }
+
+ private:
+  std::vector<std::thread>          workers_;
+  std::queue<std::function<void()>> tasks_;
+  std::mutex                        mutex_;
+  std::condition_variable           condition_;
+  bool                              stopping_ = false;
+
+  void WorkerLoop();
+};
+
+}  // namespace vkengine
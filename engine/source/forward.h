@@ -10,6 +10,7 @@ class Camera;
 class RenderScene;
 class RenderResourceBase;
 class RenderPipelineBase;
+class RenderPipeline;
 
 }  // namespace vkengine
 
@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "core/logsystem/log_system.h"
+#include "core/utils/thread_pool.h"
 #include "function/render/render_system.h"
 #include "function/window/window_system.h"
 
@@ -11,6 +12,8 @@ namespace vkengine {
 void GlobalContext::StartSystem() {
   SetObjectPool(std::make_shared<DefaultObjectPool>());
   CreateObject<LogSystem>(kLogSystem, "[%^%l%$] %!@%s+%# %v");
+  // shared by asset loading, one worker per hardware thread
+  CreateObject<ThreadPool>(kThreadPool);
   WindowCreateInfo windowinfo;
   auto             window = CreateObject<WindowSystem>(kWindowSystem, windowinfo);
 
@@ -6,6 +6,7 @@
 namespace vkengine {
 
 static const char kLogSystem[]    = "kLogSystem";
+static const char kThreadPool[]   = "kThreadPool";
 static const char kWindowSystem[] = "kWindowSystem";
 static const char kRenderSystem[] = "kRenderSystem";
 
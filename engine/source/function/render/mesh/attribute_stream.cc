@@ -0,0 +1,51 @@
+#include "function/render/mesh/attribute_stream.h"
+
+#include <cstring>
+
+namespace vkengine {
+
+namespace {
+// constant size copies compile to plain loads and stores instead of a memcpy call per attribute
+template <uint32_t kSize>
+inline void CopyAttribute(char* dst, const char* src) {
+  std::memcpy(dst, src, kSize);
+}
+
+inline void CopyAttribute(char* dst, const char* src, uint32_t size) {
+  switch (size) {
+    case 8:
+      CopyAttribute<8>(dst, src);
+      break;
+    case 12:
+      CopyAttribute<12>(dst, src);
+      break;
+    case 16:
+      CopyAttribute<16>(dst, src);
+      break;
+    default:
+      std::memcpy(dst, src, size);
+      break;
+  }
+}
+}  // namespace
+
+void GatherAttributeStreams(
+    const MeshAttributeStream* streams,
+    size_t                     stream_count,
+    size_t                     vertex_count,
+    uint32_t                   vertex_stride,
+    void*                      dst) {
+  auto* out = static_cast<char*>(dst);
+  for (size_t i = 0; i < vertex_count; i++) {
+    char* vertex = out + i * vertex_stride;
+    for (size_t s = 0; s < stream_count; s++) {
+      const auto& stream = streams[s];
+      CopyAttribute(
+          vertex + stream.offset,
+          static_cast<const char*>(stream.data) + i * stream.stride,
+          stream.size);
+    }
+  }
+}
+
+}  // namespace vkengine
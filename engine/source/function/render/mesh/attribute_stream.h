@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace vkengine {
+
+// one vertex attribute read in place from a file, size bytes every stride bytes that go to
+// offset inside each destination vertex
+struct MeshAttributeStream {
+  const void* data   = nullptr;
+  uint32_t    stride = 0;
+  uint32_t    offset = 0;
+  uint32_t    size   = 0;
+};
+
+// interleave vertex_count vertices of vertex_stride bytes from the streams into dst. vertex
+// major, dst is usually write combined staging memory and sees every vertex written in order
+void GatherAttributeStreams(
+    const MeshAttributeStream* streams,
+    size_t                     stream_count,
+    size_t                     vertex_count,
+    uint32_t                   vertex_stride,
+    void*                      dst);
+
+}  // namespace vkengine
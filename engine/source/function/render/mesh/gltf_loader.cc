@@ -0,0 +1,606 @@
+#include "function/render/mesh/gltf_loader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#include "core/utils/json.h"
+#include "core/utils/mapped_file.h"
+#include "fmt/format.h"
+
+namespace vkengine {
+
+namespace {
+constexpr uint32_t kGlbMagic     = 0x46546c67;  // "glTF"
+constexpr uint32_t kGlbVersion   = 2;
+constexpr uint32_t kGlbChunkJson = 0x4e4f534a;  // "JSON"
+constexpr uint32_t kGlbChunkBin  = 0x004e4942;  // "BIN\0"
+constexpr uint32_t kModeTriangles = 4;
+
+struct GlbHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t length;
+};
+
+struct GlbChunkHeader {
+  uint32_t length;
+  uint32_t type;
+};
+
+uint32_t ComponentSize(GltfComponentType type) {
+  switch (type) {
+    case GltfComponentType::kByte:
+    case GltfComponentType::kUnsignedByte:
+      return 1;
+    case GltfComponentType::kShort:
+    case GltfComponentType::kUnsignedShort:
+      return 2;
+    case GltfComponentType::kUnsignedInt:
+    case GltfComponentType::kFloat:
+      return 4;
+  }
+  return 0;
+}
+
+// components of an accessor type, 0 for the matrix types no attribute used here has
+uint32_t ComponentCount(const std::string& type) {
+  if (type == "SCALAR") {
+    return 1;
+  }
+  if (type == "VEC2") {
+    return 2;
+  }
+  if (type == "VEC3") {
+    return 3;
+  }
+  if (type == "VEC4") {
+    return 4;
+  }
+  return 0;
+}
+
+// uris are relative to the document and may be percent encoded
+std::string ResolveUri(const std::filesystem::path& directory, const std::string& uri) {
+  std::string decoded;
+  decoded.reserve(uri.size());
+  for (size_t i = 0; i < uri.size(); i++) {
+    if (uri[i] == '%' && i + 2 < uri.size()) {
+      const std::string hex = uri.substr(i + 1, 2);
+      char*             end = nullptr;
+      const long        c   = std::strtol(hex.c_str(), &end, 16);
+      if (end == hex.c_str() + 2) {
+        decoded += static_cast<char>(c);
+        i += 2;
+        continue;
+      }
+    }
+    decoded += uri[i];
+  }
+  return (directory / decoded).string();
+}
+
+bool ReadIndex(const JsonValue& value, size_t count, uint32_t& index) {
+  const uint64_t read = value.AsUint(UINT64_MAX);
+  if (read >= count) {
+    return false;
+  }
+  index = static_cast<uint32_t>(read);
+  return true;
+}
+
+template <typename T>
+uint32_t LargestIndex(const GltfAccessor& accessor) {
+  uint32_t largest = 0;
+  for (uint32_t i = 0; i < accessor.count; i++) {
+    T index;
+    std::memcpy(&index, accessor.data + static_cast<size_t>(i) * accessor.stride, sizeof(T));
+    largest = std::max<uint32_t>(largest, index);
+  }
+  return largest;
+}
+
+float ReadTexcoordComponent(const GltfAccessor& accessor, const char* element, uint32_t c) {
+  switch (accessor.component_type) {
+    case GltfComponentType::kUnsignedByte:
+      return static_cast<uint8_t>(element[c]) / 255.0f;
+    case GltfComponentType::kUnsignedShort: {
+      uint16_t value;
+      std::memcpy(&value, element + c * sizeof(uint16_t), sizeof(uint16_t));
+      return value / 65535.0f;
+    }
+    default: {
+      float value;
+      std::memcpy(&value, element + c * sizeof(float), sizeof(float));
+      return value;
+    }
+  }
+}
+
+uint32_t ReadIndexValue(const GltfAccessor& accessor, uint32_t i) {
+  const char* element = accessor.data + static_cast<size_t>(i) * accessor.stride;
+  switch (accessor.component_type) {
+    case GltfComponentType::kUnsignedByte:
+      return static_cast<uint8_t>(*element);
+    case GltfComponentType::kUnsignedShort: {
+      uint16_t value;
+      std::memcpy(&value, element, sizeof(uint16_t));
+      return value;
+    }
+    default: {
+      uint32_t value;
+      std::memcpy(&value, element, sizeof(uint32_t));
+      return value;
+    }
+  }
+}
+
+// float attribute with exactly components floats per element, the layout the upload can copy
+bool IsFloatAttribute(const GltfAccessor& accessor, uint32_t component_count) {
+  return accessor.IsValid() && accessor.component_type == GltfComponentType::kFloat &&
+         accessor.component_count == component_count;
+}
+}  // namespace
+
+uint32_t GltfAccessor::ElementSize() const {
+  return ComponentSize(component_type) * component_count;
+}
+
+bool GltfDocument::Open(const std::string& file, std::string& error) {
+  *this = GltfDocument{};
+  files_.push_back(file);
+
+  auto mapping = std::make_shared<MappedFile>();
+  if (!mapping->Open(file)) {
+    error = fmt::format("can not open {}", file);
+    return false;
+  }
+  const char* json_data = mapping->Data();
+  size_t      json_size = mapping->Size();
+  Buffer      glb_buffer;
+
+  // a glb is the header, the json chunk and an optional binary chunk, every chunk 4 byte aligned
+  GlbHeader header{};
+  if (mapping->Size() >= sizeof(header)) {
+    std::memcpy(&header, mapping->Data(), sizeof(header));
+  }
+  if (header.magic == kGlbMagic) {
+    if (header.version != kGlbVersion) {
+      error = fmt::format("{} : unsupported glb version {}", file, header.version);
+      return false;
+    }
+    if (header.length > mapping->Size()) {
+      error = fmt::format("{} : truncated, {} of {} bytes", file, mapping->Size(), header.length);
+      return false;
+    }
+    size_t         offset = sizeof(header);
+    GlbChunkHeader chunk{};
+    if (offset + sizeof(chunk) <= header.length) {
+      std::memcpy(&chunk, mapping->Data() + offset, sizeof(chunk));
+    }
+    if (chunk.type != kGlbChunkJson || offset + sizeof(chunk) + chunk.length > header.length) {
+      error = fmt::format("{} : glb without a json chunk", file);
+      return false;
+    }
+    json_data = mapping->Data() + offset + sizeof(chunk);
+    json_size = chunk.length;
+    offset += sizeof(chunk) + chunk.length;
+    if (offset + sizeof(chunk) <= header.length) {
+      std::memcpy(&chunk, mapping->Data() + offset, sizeof(chunk));
+      if (chunk.type == kGlbChunkBin && offset + sizeof(chunk) + chunk.length <= header.length) {
+        glb_buffer.file = mapping;
+        glb_buffer.data = mapping->Data() + offset + sizeof(chunk);
+        glb_buffer.size = chunk.length;
+      }
+    }
+  }
+
+  JsonValue  root;
+  JsonParser parser;
+  if (!parser.Parse(json_data, json_size, root, error)) {
+    error = fmt::format("{} : {}", file, error);
+    return false;
+  }
+  const std::string& version = root["asset"]["version"].AsString();
+  if (version.empty() || version[0] != '2') {
+    error = fmt::format("{} : unsupported gltf version '{}'", file, version);
+    return false;
+  }
+  const auto directory = std::filesystem::path(file).parent_path();
+
+  const JsonValue& buffers = root["buffers"];
+  for (size_t b = 0; b < buffers.Size(); b++) {
+    const JsonValue& buffer      = buffers[b];
+    const uint64_t   byte_length = buffer["byteLength"].AsUint();
+    Buffer           entry;
+    if (!buffer.Has("uri")) {
+      // only the first buffer of a glb may live in the binary chunk
+      if (b != 0 || !glb_buffer.data) {
+        error = fmt::format("{} : buffer {} has no uri", file, b);
+        return false;
+      }
+      entry = glb_buffer;
+    } else {
+      const std::string& uri = buffer["uri"].AsString();
+      if (uri.compare(0, 5, "data:") == 0) {
+        error = fmt::format("{} : buffer {} is a data uri, pack the asset as glb", file, b);
+        return false;
+      }
+      const std::string path     = ResolveUri(directory, uri);
+      auto              external = std::make_shared<MappedFile>();
+      if (!external->Open(path)) {
+        error = fmt::format("{} : can not open buffer {}", file, path);
+        return false;
+      }
+      entry.data = external->Data();
+      entry.size = external->Size();
+      entry.file = std::move(external);
+      files_.push_back(path);
+    }
+    if (byte_length > entry.size) {
+      error = fmt::format("{} : buffer {} is shorter than its byteLength", file, b);
+      return false;
+    }
+    entry.size = byte_length;
+    buffers_.push_back(std::move(entry));
+  }
+
+  const JsonValue& views = root["bufferViews"];
+  for (size_t v = 0; v < views.Size(); v++) {
+    const JsonValue& view = views[v];
+    BufferView       entry;
+    entry.offset = view["byteOffset"].AsUint();
+    entry.size   = view["byteLength"].AsUint();
+    entry.stride = static_cast<uint32_t>(view["byteStride"].AsUint());
+    if (!ReadIndex(view["buffer"], buffers_.size(), entry.buffer) ||
+        entry.offset > buffers_[entry.buffer].size ||
+        entry.size > buffers_[entry.buffer].size - entry.offset || entry.stride > 252) {
+      error = fmt::format("{} : buffer view {} is out of its buffer", file, v);
+      return false;
+    }
+    buffer_views_.push_back(entry);
+  }
+
+  // accessors are resolved when a primitive uses them, unused ones are not validated
+  const JsonValue& accessors     = root["accessors"];
+  const auto       read_accessor = [&](const JsonValue& index, GltfAccessor& accessor) {
+    uint32_t a = 0;
+    if (!ReadIndex(index, accessors.Size(), a)) {
+      error = fmt::format("{} : accessor index out of range", file);
+      return false;
+    }
+    const JsonValue& json = accessors[a];
+    uint32_t         v    = 0;
+    if (json.Has("sparse") || !ReadIndex(json["bufferView"], buffer_views_.size(), v)) {
+      error = fmt::format("{} : accessor {} is sparse or has no buffer view", file, a);
+      return false;
+    }
+    const BufferView& view   = buffer_views_[v];
+    const uint64_t    offset = json["byteOffset"].AsUint();
+    const uint64_t    count  = json["count"].AsUint();
+    accessor.component_type  = static_cast<GltfComponentType>(json["componentType"].AsUint());
+    accessor.component_count = ComponentCount(json["type"].AsString());
+    accessor.normalized      = json["normalized"].AsBool();
+    accessor.buffer          = view.buffer;
+
+    const uint32_t component_size = ComponentSize(accessor.component_type);
+    const uint32_t element_size   = accessor.ElementSize();
+    accessor.stride               = view.stride != 0 ? view.stride : element_size;
+    const uint64_t span           = count == 0 ? 0 : (count - 1) * accessor.stride + element_size;
+    const uint64_t start          = view.offset + offset;
+    if (element_size == 0 || count == 0 || count > UINT32_MAX || accessor.stride < element_size ||
+        offset > view.size || span > view.size - offset || start % component_size != 0 ||
+        accessor.stride % component_size != 0) {
+      error = fmt::format("{} : accessor {} is malformed or out of its buffer view", file, a);
+      return false;
+    }
+    accessor.count = static_cast<uint32_t>(count);
+    accessor.data  = buffers_[view.buffer].data + start;
+    return true;
+  };
+
+  const JsonValue& meshes = root["meshes"];
+  for (size_t m = 0; m < meshes.Size(); m++) {
+    GltfMesh mesh;
+    mesh.name                   = meshes[m]["name"].AsString();
+    const JsonValue& primitives = meshes[m]["primitives"];
+    for (size_t p = 0; p < primitives.Size(); p++) {
+      const JsonValue& json = primitives[p];
+      const JsonValue& attributes = json["attributes"];
+      GltfPrimitive    primitive;
+      const uint64_t   mode = json["mode"].AsUint(kModeTriangles);
+      if (mode != kModeTriangles || !attributes.Has("POSITION")) {
+        error = fmt::format("{} : primitive {} of mesh {} is not a triangle list", file, p, m);
+        return false;
+      }
+      if (!read_accessor(attributes["POSITION"], primitive.position) ||
+          (attributes.Has("NORMAL") && !read_accessor(attributes["NORMAL"], primitive.normal)) ||
+          (attributes.Has("TANGENT") && !read_accessor(attributes["TANGENT"], primitive.tangent)) ||
+          (attributes.Has("TEXCOORD_0") &&
+           !read_accessor(attributes["TEXCOORD_0"], primitive.texcoord)) ||
+          (json.Has("indices") && !read_accessor(json["indices"], primitive.indices))) {
+        return false;
+      }
+      if (json.Has("material")) {
+        uint32_t material = 0;
+        if (!ReadIndex(json["material"], root["materials"].Size(), material)) {
+          error = fmt::format("{} : primitive {} of mesh {} has no material", file, p, m);
+          return false;
+        }
+        primitive.material = static_cast<int32_t>(material);
+      }
+
+      // the attribute types the specification allows without extensions
+      const uint32_t vertex_count = primitive.position.count;
+      const auto     same_count   = [&](const GltfAccessor& accessor) {
+        return !accessor.IsValid() || accessor.count == vertex_count;
+      };
+      const auto& texcoord       = primitive.texcoord;
+      const bool  texcoord_valid = !texcoord.IsValid() ||
+                                  (texcoord.component_count == 2 &&
+                                   (texcoord.component_type == GltfComponentType::kFloat ||
+                                    (texcoord.normalized &&
+                                     (texcoord.component_type == GltfComponentType::kUnsignedByte ||
+                                      texcoord.component_type ==
+                                          GltfComponentType::kUnsignedShort))));
+      const auto& indices       = primitive.indices;
+      const bool  indices_valid = !indices.IsValid() ||
+                                 (indices.component_count == 1 && !indices.normalized &&
+                                  (indices.component_type == GltfComponentType::kUnsignedByte ||
+                                   indices.component_type == GltfComponentType::kUnsignedShort ||
+                                   indices.component_type == GltfComponentType::kUnsignedInt));
+      if (!IsFloatAttribute(primitive.position, 3) ||
+          (primitive.normal.IsValid() && !IsFloatAttribute(primitive.normal, 3)) ||
+          (primitive.tangent.IsValid() && !IsFloatAttribute(primitive.tangent, 4)) ||
+          !texcoord_valid || !indices_valid || !same_count(primitive.normal) ||
+          !same_count(primitive.tangent) || !same_count(texcoord)) {
+        error = fmt::format("{} : primitive {} of mesh {} has unsupported attributes", file, p, m);
+        return false;
+      }
+      const uint32_t corner_count = indices.IsValid() ? indices.count : vertex_count;
+      if (corner_count % 3 != 0) {
+        error = fmt::format("{} : primitive {} of mesh {} has a partial triangle", file, p, m);
+        return false;
+      }
+
+      // an index past the vertices would read outside the pool range on the gpu
+      if (indices.IsValid()) {
+        uint32_t largest = 0;
+        switch (indices.component_type) {
+          case GltfComponentType::kUnsignedByte:
+            largest = LargestIndex<uint8_t>(indices);
+            break;
+          case GltfComponentType::kUnsignedShort:
+            largest = LargestIndex<uint16_t>(indices);
+            break;
+          default:
+            largest = LargestIndex<uint32_t>(indices);
+            break;
+        }
+        if (largest >= vertex_count) {
+          error = fmt::format("{} : primitive {} of mesh {} indexes past its vertices", file, p, m);
+          return false;
+        }
+      }
+      mesh.primitives.push_back(primitive);
+    }
+    meshes_.push_back(std::move(mesh));
+  }
+
+  const JsonValue& images = root["images"];
+  for (size_t i = 0; i < images.Size(); i++) {
+    const JsonValue& json = images[i];
+    GltfImage        image;
+    uint32_t         v = 0;
+    if (json.Has("uri")) {
+      const std::string& uri = json["uri"].AsString();
+      if (uri.compare(0, 5, "data:") == 0) {
+        error = fmt::format("{} : image {} is a data uri, pack the asset as glb", file, i);
+        return false;
+      }
+      image.file = ResolveUri(directory, uri);
+    } else if (ReadIndex(json["bufferView"], buffer_views_.size(), v)) {
+      const BufferView& view = buffer_views_[v];
+      image.data             = buffers_[view.buffer].data + view.offset;
+      image.size             = view.size;
+    } else {
+      error = fmt::format("{} : image {} has neither uri nor buffer view", file, i);
+      return false;
+    }
+    images_.push_back(std::move(image));
+  }
+
+  const JsonValue& materials = root["materials"];
+  const JsonValue& textures  = root["textures"];
+  for (size_t m = 0; m < materials.Size(); m++) {
+    const JsonValue& json = materials[m];
+    const JsonValue& pbr  = json["pbrMetallicRoughness"];
+    GltfMaterial     material;
+    material.name = json["name"].AsString();
+    for (int c = 0; c < 4; c++) {
+      material.base_color_factor[c] =
+          static_cast<float>(pbr["baseColorFactor"][c].AsNumber(1.0));
+    }
+    if (pbr.Has("baseColorTexture")) {
+      uint32_t texture = 0;
+      uint32_t image   = 0;
+      if (!ReadIndex(pbr["baseColorTexture"]["index"], textures.Size(), texture) ||
+          !ReadIndex(textures[texture]["source"], images_.size(), image)) {
+        error = fmt::format("{} : base color texture of material {} has no image", file, m);
+        return false;
+      }
+      material.base_color_image = static_cast<int32_t>(image);
+    }
+    materials_.push_back(std::move(material));
+  }
+  return true;
+}
+
+void SplitGltfReference(const std::string& reference, std::string& file, uint32_t& index) {
+  const size_t hash = reference.rfind('#');
+  index             = 0;
+  file              = reference;
+  if (hash == std::string::npos) {
+    return;
+  }
+  const std::string suffix = reference.substr(hash + 1);
+  if (suffix.empty() || suffix.find_first_not_of("0123456789") != std::string::npos) {
+    return;
+  }
+  file  = reference.substr(0, hash);
+  index = static_cast<uint32_t>(std::stoul(suffix));
+}
+
+bool IsGltfFile(const std::string& reference) {
+  std::string file;
+  uint32_t    index = 0;
+  SplitGltfReference(reference, file, index);
+  const auto extension = std::filesystem::path(file).extension();
+  return extension == ".glb" || extension == ".gltf";
+}
+
+bool MapGltfMesh(const GltfDocument& document, const GltfMesh& mesh, RenderMeshData& mesh_data) {
+  if (mesh.primitives.size() != 1) {
+    return false;
+  }
+  const GltfPrimitive& primitive = mesh.primitives[0];
+  const GltfAccessor*  streams[] = {
+      &primitive.position, &primitive.normal, &primitive.tangent, &primitive.texcoord};
+  if (!IsFloatAttribute(primitive.position, 3) || !IsFloatAttribute(primitive.normal, 3) ||
+      !IsFloatAttribute(primitive.tangent, 4) || !IsFloatAttribute(primitive.texcoord, 2) ||
+      !primitive.indices.IsValid() ||
+      primitive.indices.component_type == GltfComponentType::kUnsignedByte) {
+    return false;
+  }
+  // the index buffer is copied as one block
+  const auto& indices = primitive.indices;
+  if (indices.stride != indices.ElementSize()) {
+    return false;
+  }
+  for (const auto* stream : streams) {
+    if (stream->buffer != indices.buffer) {
+      return false;
+    }
+  }
+
+  mesh_data                     = RenderMeshData{};
+  mesh_data.cooked_file         = document.GetBufferFile(indices.buffer);
+  mesh_data.cooked_vertex_count = primitive.position.count;
+  mesh_data.cooked_index_count  = indices.count;
+  mesh_data.cooked_indices      = indices.data;
+  mesh_data.index_type          = indices.component_type == GltfComponentType::kUnsignedShort
+                                      ? VK_INDEX_TYPE_UINT16
+                                      : VK_INDEX_TYPE_UINT32;
+
+  // interleaved exactly like VulkanVertexData, the vertices are one block as well
+  const uint32_t offsets[] = {
+      offsetof(VulkanVertexData, position),
+      offsetof(VulkanVertexData, normal),
+      offsetof(VulkanVertexData, tangent),
+      offsetof(VulkanVertexData, texcoord)};
+  bool interleaved = true;
+  for (int s = 0; s < 4; s++) {
+    interleaved = interleaved && streams[s]->stride == sizeof(VulkanVertexData) &&
+                  streams[s]->data == primitive.position.data + offsets[s];
+  }
+  if (interleaved) {
+    mesh_data.cooked_vertices = primitive.position.data;
+  } else {
+    for (int s = 0; s < 4; s++) {
+      MeshAttributeStream stream;
+      stream.data   = streams[s]->data;
+      stream.stride = streams[s]->stride;
+      stream.offset = offsets[s];
+      stream.size   = streams[s]->ElementSize();
+      mesh_data.cooked_streams.push_back(stream);
+    }
+  }
+  mesh_data.bounds = MeshBounds::FromPositions(
+      primitive.position.data, primitive.position.count, primitive.position.stride);
+  return true;
+}
+
+GltfGatherResult GatherGltfMesh(
+    const GltfMesh& mesh, std::vector<VulkanVertexData>& vertices, std::vector<uint32_t>& indices) {
+  GltfGatherResult result;
+  size_t           vertex_total = 0;
+  size_t           corner_total = 0;
+  for (const auto& primitive : mesh.primitives) {
+    const size_t corner_count =
+        primitive.indices.IsValid() ? primitive.indices.count : primitive.position.count;
+    vertex_total += primitive.normal.IsValid() ? primitive.position.count : corner_count;
+    corner_total += corner_count;
+  }
+  vertices.clear();
+  indices.clear();
+  vertices.reserve(vertex_total);
+  indices.reserve(corner_total);
+
+  for (const auto& primitive : mesh.primitives) {
+    const auto read_vertex = [&](uint32_t i) {
+      VulkanVertexData vertex{};
+      std::memcpy(
+          &vertex.position,
+          primitive.position.data + static_cast<size_t>(i) * primitive.position.stride,
+          sizeof(vertex.position));
+      if (primitive.normal.IsValid()) {
+        std::memcpy(
+            &vertex.normal,
+            primitive.normal.data + static_cast<size_t>(i) * primitive.normal.stride,
+            sizeof(vertex.normal));
+      }
+      if (primitive.tangent.IsValid()) {
+        std::memcpy(
+            &vertex.tangent,
+            primitive.tangent.data + static_cast<size_t>(i) * primitive.tangent.stride,
+            sizeof(vertex.tangent));
+      }
+      if (primitive.texcoord.IsValid()) {
+        const char* element =
+            primitive.texcoord.data + static_cast<size_t>(i) * primitive.texcoord.stride;
+        vertex.texcoord = UvType(
+            ReadTexcoordComponent(primitive.texcoord, element, 0),
+            ReadTexcoordComponent(primitive.texcoord, element, 1));
+      } else {
+        vertex.texcoord = UvType(0.5f, 0.5f);
+      }
+      return vertex;
+    };
+    const uint32_t corner_count =
+        primitive.indices.IsValid() ? primitive.indices.count : primitive.position.count;
+    const auto corner_index = [&](uint32_t c) {
+      return primitive.indices.IsValid() ? ReadIndexValue(primitive.indices, c) : c;
+    };
+    result.complete = result.complete && primitive.normal.IsValid() && primitive.tangent.IsValid();
+
+    const auto base = static_cast<uint32_t>(vertices.size());
+    if (primitive.normal.IsValid()) {
+      for (uint32_t i = 0; i < primitive.position.count; i++) {
+        vertices.push_back(read_vertex(i));
+      }
+      for (uint32_t c = 0; c < corner_count; c++) {
+        indices.push_back(base + corner_index(c));
+      }
+      continue;
+    }
+    for (uint32_t c = 0; c + 2 < corner_count; c += 3) {
+      VulkanVertexData triangle[3];
+      for (uint32_t k = 0; k < 3; k++) {
+        triangle[k] = read_vertex(corner_index(c + k));
+      }
+      const VertexType edge0  = triangle[1].position - triangle[0].position;
+      const VertexType edge1  = triangle[2].position - triangle[1].position;
+      const VertexType normal = glm::normalize(glm::cross(edge0, edge1));
+      for (uint32_t k = 0; k < 3; k++) {
+        triangle[k].normal = normal;
+        indices.push_back(static_cast<uint32_t>(vertices.size()));
+        vertices.push_back(triangle[k]);
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace vkengine
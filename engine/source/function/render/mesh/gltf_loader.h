@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+#include "glm/glm.hpp"
+
+namespace vkengine {
+
+class MappedFile;
+
+// component types of an accessor, the values of the gltf specification
+enum class GltfComponentType : uint32_t {
+  kByte          = 5120,
+  kUnsignedByte  = 5121,
+  kShort         = 5122,
+  kUnsignedShort = 5123,
+  kUnsignedInt   = 5125,
+  kFloat         = 5126,
+};
+
+// typed range of a buffer, element i starts at data + i * stride inside the mapping of buffer
+struct GltfAccessor {
+  const char*       data            = nullptr;
+  uint32_t          count           = 0;
+  uint32_t          stride          = 0;
+  GltfComponentType component_type  = GltfComponentType::kFloat;
+  uint32_t          component_count = 0;
+  bool              normalized      = false;
+  uint32_t          buffer          = 0;
+
+  bool     IsValid() const { return data != nullptr; }
+  uint32_t ElementSize() const;
+};
+
+// triangle list, attributes the file leaves out are invalid accessors. texcoord is TEXCOORD_0
+struct GltfPrimitive {
+  GltfAccessor position;
+  GltfAccessor normal;
+  GltfAccessor tangent;
+  GltfAccessor texcoord;
+  GltfAccessor indices;
+  int32_t      material = -1;
+};
+
+struct GltfMesh {
+  std::string                name;
+  std::vector<GltfPrimitive> primitives;
+};
+
+// encoded image, an external file or the bytes of a buffer view
+struct GltfImage {
+  std::string file;
+  const char* data = nullptr;
+  size_t      size = 0;
+};
+
+struct GltfMaterial {
+  std::string name;
+  glm::vec4   base_color_factor = glm::vec4(1.0f);
+  // index into the images, -1 without a base color texture
+  int32_t base_color_image = -1;
+};
+
+// gltf 2.0 asset, a binary .glb or a .gltf with external .bin buffers. the buffers are memory
+// mapped and the accessors validated against them but not copied, every index is checked
+// against the vertex count. data uris and sparse accessors are not supported, node transforms
+// are ignored and meshes stay in their own space
+class GltfDocument {
+ public:
+  GltfDocument() {}
+  ~GltfDocument() {}
+
+  // return false and set error if the file can not be read, is malformed or uses a feature that
+  // is not supported
+  bool Open(const std::string& file, std::string& error);
+
+  const std::vector<GltfMesh>&     GetMeshes() const { return meshes_; }
+  const std::vector<GltfMaterial>& GetMaterials() const { return materials_; }
+  const std::vector<GltfImage>&    GetImages() const { return images_; }
+  // mapping of buffer, mesh data reading accessors in place keeps it alive
+  const std::shared_ptr<const MappedFile>& GetBufferFile(uint32_t buffer) const {
+    return buffers_[buffer].file;
+  }
+  // the document and its external buffers, every file the meshes depend on
+  const std::vector<std::string>& GetFiles() const { return files_; }
+
+ private:
+  struct Buffer {
+    std::shared_ptr<const MappedFile> file;
+    const char*                       data = nullptr;
+    size_t                            size = 0;
+  };
+  struct BufferView {
+    uint32_t buffer = 0;
+    size_t   offset = 0;
+    size_t   size   = 0;
+    uint32_t stride = 0;
+  };
+
+  std::vector<Buffer>       buffers_;
+  std::vector<BufferView>   buffer_views_;
+  std::vector<GltfMesh>     meshes_;
+  std::vector<GltfMaterial> materials_;
+  std::vector<GltfImage>    images_;
+  std::vector<std::string>  files_;
+};
+
+// "scene.glb#2" into the file and the index of the mesh or material it names, 0 without suffix
+void SplitGltfReference(const std::string& reference, std::string& file, uint32_t& index);
+// .glb and .gltf files, with or without a reference suffix
+bool IsGltfFile(const std::string& reference);
+
+// point mesh_data at the accessors of mesh, the upload then copies them from the mapping into
+// staging memory. false when mesh is not one indexed primitive with float position, normal,
+// tangent and texcoord in one buffer and 16 or 32 bit indices
+bool MapGltfMesh(const GltfDocument& document, const GltfMesh& mesh, RenderMeshData& mesh_data);
+
+struct GltfGatherResult {
+  // every primitive had its normals and tangents, the vertices need neither welding nor
+  // tangent generation
+  bool complete = true;
+};
+
+// all primitives of mesh merged into one triangle list. texcoords are widened to floats, missing
+// ones are the center of the texture. primitives without normals are unwelded into triangles
+// with their flat normal, missing tangents stay 0
+GltfGatherResult GatherGltfMesh(
+    const GltfMesh& mesh, std::vector<VulkanVertexData>& vertices, std::vector<uint32_t>& indices);
+
+}  // namespace vkengine
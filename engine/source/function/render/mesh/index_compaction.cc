@@ -0,0 +1,24 @@
+#include "function/render/mesh/index_compaction.h"
+
+#include <algorithm>
+
+namespace vkengine {
+
+bool CompactIndices(RenderMeshData& mesh_data) {
+  if (mesh_data.cooked_file || mesh_data.index_type == VK_INDEX_TYPE_UINT16 ||
+      mesh_data.GetVertexCount() > kMaxShortIndexVertexCount) {
+    return false;
+  }
+  const auto& indices = mesh_data.index_buffer;
+  if (!indices.empty() && *std::max_element(indices.begin(), indices.end()) > UINT16_MAX) {
+    return false;
+  }
+
+  mesh_data.short_index_buffer.assign(indices.begin(), indices.end());
+  mesh_data.index_type = VK_INDEX_TYPE_UINT16;
+  mesh_data.index_buffer.clear();
+  mesh_data.index_buffer.shrink_to_fit();
+  return true;
+}
+
+}  // namespace vkengine
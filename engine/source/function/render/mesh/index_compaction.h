@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// 16 bit indices address vertices [0, 65535]
+static constexpr uint32_t kMaxShortIndexVertexCount = 1 << 16;
+
+// switch mesh_data to VK_INDEX_TYPE_UINT16 when every index fits, return whether it did
+bool CompactIndices(RenderMeshData& mesh_data);
+
+}  // namespace vkengine
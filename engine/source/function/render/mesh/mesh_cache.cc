@@ -0,0 +1,476 @@
+#include "function/render/mesh/mesh_cache.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "core/utils/hash.h"
+#include "core/utils/mapped_file.h"
+#include "core/utils/temporary_path.h"
+#include "fmt/format.h"
+
+namespace vkengine {
+
+namespace {
+constexpr char     kMagic[4]      = {'V', 'K', 'M', 'C'};
+constexpr char     kChunkMagic[4] = {'V', 'K', 'M', 'S'};
+constexpr uint64_t kBlobAlignment = 16;
+constexpr size_t   kHashBlockSize = 1 << 20;
+
+struct CookedAttribute {
+  uint32_t location = 0;
+  uint32_t format   = 0;
+  uint32_t offset   = 0;
+};
+
+struct CookedMeshHeader {
+  char     magic[4]          = {};
+  uint32_t cooker_version    = 0;
+  uint64_t source_hash       = 0;
+  uint64_t source_size       = 0;
+  int64_t  source_write_time = 0;
+  uint32_t vertex_stride     = 0;
+  uint32_t attribute_count = 0;
+  uint32_t vertex_count    = 0;
+  uint32_t index_count     = 0;
+  uint32_t vertex_format   = 0;
+  uint32_t index_type      = 0;
+  uint64_t vertex_offset   = 0;
+  uint64_t index_offset    = 0;
+  float    box_min[3]      = {};
+  float    box_max[3]      = {};
+  float    sphere[4]       = {};
+  float    quantization[6] = {};
+  uint32_t optimize_flags  = 0;
+  uint32_t lod_count       = 0;
+  MeshLod  lods[kMaxMeshLods];
+  // MeshletData, empty for meshes without clusters
+  uint32_t meshlet_count           = 0;
+  uint32_t meshlet_vertex_count    = 0;
+  uint32_t meshlet_triangle_count  = 0;
+  uint32_t _padding_1              = 0;
+  uint64_t meshlet_offset          = 0;
+  uint64_t meshlet_vertex_offset   = 0;
+  uint64_t meshlet_triangle_offset = 0;
+
+  CookedAttribute attributes[MeshCache::kMaxAttributes];
+};
+
+struct ChunkListHeader {
+  char     magic[4]          = {};
+  uint32_t cooker_version    = 0;
+  uint64_t source_hash       = 0;
+  uint64_t source_size       = 0;
+  int64_t  source_write_time = 0;
+  uint32_t chunk_count       = 0;
+  uint32_t _padding_1        = 0;
+};
+
+struct CookedChunk {
+  uint32_t triangle_count = 0;
+  float    box_min[3]     = {};
+  float    box_max[3]     = {};
+  float    sphere[4]      = {};
+};
+
+std::string ChunkListPath(const std::string& entry_path) {
+  return std::filesystem::path(entry_path).replace_extension(".vkchunks").string();
+}
+
+uint64_t AlignUp(uint64_t value) { return (value + kBlobAlignment - 1) & ~(kBlobAlignment - 1); }
+
+bool BlobFits(uint64_t offset, uint64_t bytes, uint64_t file_size) {
+  return offset % kBlobAlignment == 0 && offset + bytes <= file_size;
+}
+
+template <typename T>
+void CopyBlob(const MappedFile& file, uint64_t offset, uint32_t count, std::vector<T>& result) {
+  result.resize(count);
+  std::memcpy(result.data(), file.Data() + offset, sizeof(T) * count);
+}
+
+// true when the entry of header was cooked from the files of key. a matching stamp takes the hash
+// the entry recorded without reading the files, anything else hashes them and sets restamp when
+// only the stamp is out of date
+template <typename Header>
+bool SameSource(const Header& header, MeshSourceKey& key, bool& restamp) {
+  restamp = false;
+  if (key.SameStamp(header.source_size, header.source_write_time)) {
+    key.SetHash(header.source_hash);
+    return true;
+  }
+  uint64_t hash = 0;
+  if (!key.Hash(hash) || hash != header.source_hash) {
+    return false;
+  }
+  restamp = true;
+  return true;
+}
+
+template <typename Header>
+void StampHeader(const MeshSourceKey& key, uint64_t hash, Header& header) {
+  header.source_hash       = hash;
+  header.source_size       = key.Size();
+  header.source_write_time = key.WriteTime();
+}
+
+// writes the stamp of key into the entry at path in place. best effort, an entry that keeps its
+// old stamp only costs a hash of the sources on its next load
+template <typename Header>
+void Restamp(const std::string& path, const MeshSourceKey& key) {
+  const int64_t stamp[2] = {static_cast<int64_t>(key.Size()), key.WriteTime()};
+  std::fstream  file(path, std::ios::binary | std::ios::in | std::ios::out);
+  file.seekp(offsetof(Header, source_size));
+  file.write(reinterpret_cast<const char*>(stamp), sizeof(stamp));
+}
+
+// the layout the running build expects, an entry with another one is stale
+void CurrentLayout(VertexFormat vertex_format, CookedMeshHeader& header) {
+  const auto attributes  = GetVertexAttributeDescriptions(vertex_format);
+  header.vertex_format   = static_cast<uint32_t>(vertex_format);
+  header.vertex_stride   = GetVertexStride(vertex_format);
+  header.attribute_count = static_cast<uint32_t>(attributes.size());
+  for (size_t i = 0; i < attributes.size() && i < MeshCache::kMaxAttributes; i++) {
+    header.attributes[i].location = attributes[i].location;
+    header.attributes[i].format   = static_cast<uint32_t>(attributes[i].format);
+    header.attributes[i].offset   = attributes[i].offset;
+  }
+}
+}  // namespace
+
+bool MeshSourceKey::Stat(std::vector<std::string> files, uint64_t seed) {
+  files_ = std::move(files);
+  seed_  = seed;
+  size_  = 0;
+  // file clock ticks may count from an epoch after the files, e.g. 2174 in libstdc++
+  write_time_ = std::numeric_limits<int64_t>::min();
+  hashed_     = false;
+  stated_     = false;
+  for (const auto& file : files_) {
+    std::error_code error;
+    const auto      size       = std::filesystem::file_size(file, error);
+    const auto      write_time = std::filesystem::last_write_time(file, error);
+    if (error) {
+      return false;
+    }
+    size_ += size;
+    write_time_ = std::max<int64_t>(write_time_, write_time.time_since_epoch().count());
+  }
+  stated_ = true;
+  return true;
+}
+
+bool MeshSourceKey::Hash(uint64_t& hash) {
+  if (!hashed_) {
+    // files with equal contents at other positions of the list make another hash
+    uint64_t result = seed_;
+    for (const auto& file : files_) {
+      uint64_t file_hash = 0;
+      if (!MeshCache::HashSource(file, file_hash)) {
+        return false;
+      }
+      result = HashBytes(&file_hash, sizeof(file_hash), result);
+    }
+    hash_   = result;
+    hashed_ = true;
+  }
+  hash = hash_;
+  return true;
+}
+
+bool MeshCache::HashSource(const std::string& source_file, uint64_t& source_hash) {
+  MappedFile source;
+  if (!source.Open(source_file)) {
+    return false;
+  }
+  // chained per block hashes, the whole file is never hashed as one call
+  source_hash = source.Size();
+  for (size_t offset = 0; offset < source.Size(); offset += kHashBlockSize) {
+    const size_t size = std::min(kHashBlockSize, source.Size() - offset);
+    source_hash       = HashBytes(source.Data() + offset, size, source_hash);
+  }
+  return true;
+}
+
+std::string MeshCache::EntryPath(const RenderMeshSource& source) const {
+  const auto     path = std::filesystem::path(source.mesh_file);
+  const uint64_t key  = HashBytes(source.mesh_file.data(), source.mesh_file.size());
+  return (std::filesystem::path(directory_) /
+          fmt::format(
+              "{}-{:016x}-{}-{:x}-{}.vkmesh",
+              path.stem().string(),
+              key,
+              static_cast<uint32_t>(source.vertex_format),
+              source.optimize_flags,
+              source.lod_count))
+      .string();
+}
+
+RenderMeshSource MeshCache::ChunkSource(const RenderMeshSource& source, uint32_t chunk) {
+  RenderMeshSource ret = source;
+  ret.mesh_file        = fmt::format("{}#{}", source.mesh_file, chunk);
+  return ret;
+}
+
+bool MeshCache::LoadChunks(
+    const RenderMeshSource&       source,
+    MeshSourceKey&                key,
+    std::vector<MeshStreamChunk>& chunks) const {
+  const std::string path = ChunkListPath(EntryPath(source));
+  std::ifstream     in(path, std::ios::binary);
+  ChunkListHeader   header;
+  bool              restamp = false;
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!in || std::memcmp(header.magic, kChunkMagic, sizeof(kChunkMagic)) != 0 ||
+      header.cooker_version != kMeshCookerVersion || !SameSource(header, key, restamp)) {
+    return false;
+  }
+  std::vector<CookedChunk> cooked(header.chunk_count);
+  in.read(reinterpret_cast<char*>(cooked.data()), sizeof(CookedChunk) * cooked.size());
+  if (!in) {
+    return false;
+  }
+
+  chunks.resize(cooked.size());
+  for (uint32_t i = 0; i < header.chunk_count; i++) {
+    const auto& entry           = cooked[i];
+    auto&       chunk           = chunks[i];
+    chunk.source                = ChunkSource(source, i);
+    chunk.source_hash           = header.source_hash;
+    chunk.triangle_count        = entry.triangle_count;
+    chunk.bounds.box.min_corner = {entry.box_min[0], entry.box_min[1], entry.box_min[2]};
+    chunk.bounds.box.max_corner = {entry.box_max[0], entry.box_max[1], entry.box_max[2]};
+    chunk.bounds.sphere.center  = {entry.sphere[0], entry.sphere[1], entry.sphere[2]};
+    chunk.bounds.sphere.radius  = entry.sphere[3];
+    std::error_code error;
+    if (!std::filesystem::exists(EntryPath(chunk.source), error)) {
+      return false;
+    }
+  }
+  if (restamp) {
+    in.close();
+    Restamp<ChunkListHeader>(path, key);
+  }
+  return true;
+}
+
+bool MeshCache::StoreChunks(
+    const RenderMeshSource&             source,
+    MeshSourceKey&                      key,
+    const std::vector<MeshStreamChunk>& chunks) const {
+  uint64_t source_hash = 0;
+  if (!key.Hash(source_hash)) {
+    return false;
+  }
+  // zeroed with the padding, the header is written to disk as it is in memory
+  ChunkListHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kChunkMagic, sizeof(kChunkMagic));
+  StampHeader(key, source_hash, header);
+  header.cooker_version = kMeshCookerVersion;
+  header.chunk_count    = static_cast<uint32_t>(chunks.size());
+  std::vector<CookedChunk> cooked(chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    const auto& bounds       = chunks[i].bounds;
+    cooked[i].triangle_count = chunks[i].triangle_count;
+    for (int k = 0; k < 3; k++) {
+      cooked[i].box_min[k] = bounds.box.min_corner[k];
+      cooked[i].box_max[k] = bounds.box.max_corner[k];
+      cooked[i].sphere[k]  = bounds.sphere.center[k];
+    }
+    cooked[i].sphere[3] = bounds.sphere.radius;
+  }
+
+  const std::string path      = ChunkListPath(EntryPath(source));
+  const std::string temporary = ThreadTemporaryPath(path);
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(cooked.data()), sizeof(CookedChunk) * cooked.size());
+    if (!out) {
+      return false;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  return !error;
+}
+
+bool MeshCache::Load(
+    const RenderMeshSource& source, MeshSourceKey& key, RenderMeshData& mesh_data) const {
+  const auto        vertex_format = source.vertex_format;
+  const std::string path          = EntryPath(source);
+  auto              file          = std::make_shared<MappedFile>();
+  if (!file->Open(path) || file->Size() < sizeof(CookedMeshHeader)) {
+    return false;
+  }
+
+  CookedMeshHeader header;
+  std::memcpy(&header, file->Data(), sizeof(header));
+  CookedMeshHeader expected;
+  CurrentLayout(vertex_format, expected);
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.cooker_version != kMeshCookerVersion ||
+      header.optimize_flags != source.optimize_flags ||
+      header.vertex_format != expected.vertex_format ||
+      header.vertex_stride != expected.vertex_stride ||
+      (header.index_type != VK_INDEX_TYPE_UINT16 && header.index_type != VK_INDEX_TYPE_UINT32) ||
+      header.attribute_count != expected.attribute_count ||
+      std::memcmp(header.attributes, expected.attributes, sizeof(header.attributes)) != 0) {
+    return false;
+  }
+  // last, the layout checks above never need the sources
+  bool restamp = false;
+  if (!SameSource(header, key, restamp)) {
+    return false;
+  }
+  const uint64_t vertex_bytes = uint64_t(header.vertex_count) * header.vertex_stride;
+  const uint64_t index_bytes =
+      uint64_t(header.index_count) * GetIndexSize(static_cast<VkIndexType>(header.index_type));
+  const uint64_t meshlet_bytes          = sizeof(Meshlet) * header.meshlet_count;
+  const uint64_t meshlet_vertex_bytes   = sizeof(uint32_t) * header.meshlet_vertex_count;
+  const uint64_t meshlet_triangle_bytes = sizeof(uint32_t) * header.meshlet_triangle_count;
+  if (header.lod_count > kMaxMeshLods ||
+      !BlobFits(header.vertex_offset, vertex_bytes, file->Size()) ||
+      !BlobFits(header.index_offset, index_bytes, file->Size()) ||
+      !BlobFits(header.meshlet_offset, meshlet_bytes, file->Size()) ||
+      !BlobFits(header.meshlet_vertex_offset, meshlet_vertex_bytes, file->Size()) ||
+      !BlobFits(header.meshlet_triangle_offset, meshlet_triangle_bytes, file->Size())) {
+    return false;
+  }
+  for (uint32_t l = 0; l < header.lod_count; l++) {
+    if (uint64_t(header.lods[l].first_index) + header.lods[l].index_count > header.index_count) {
+      return false;
+    }
+  }
+
+  // small next to the vertices, copied out of the mapping so the culler reads plain vectors
+  MeshletData meshlets;
+  CopyBlob(*file, header.meshlet_offset, header.meshlet_count, meshlets.meshlets);
+  CopyBlob(*file, header.meshlet_vertex_offset, header.meshlet_vertex_count, meshlets.vertices);
+  CopyBlob(
+      *file, header.meshlet_triangle_offset, header.meshlet_triangle_count, meshlets.triangles);
+  for (const auto& meshlet : meshlets.meshlets) {
+    if (meshlet.vertex_count > kMeshletMaxVertices ||
+        meshlet.triangle_count > kMeshletMaxTriangles ||
+        uint64_t(meshlet.vertex_offset) + meshlet.vertex_count > meshlets.vertices.size() ||
+        uint64_t(meshlet.triangle_offset) + meshlet.triangle_count > meshlets.triangles.size()) {
+      return false;
+    }
+  }
+
+  mesh_data.vertex_buffer.clear();
+  mesh_data.packed_vertex_buffer.clear();
+  mesh_data.index_buffer.clear();
+  mesh_data.short_index_buffer.clear();
+  mesh_data.vertex_format = vertex_format;
+  mesh_data.index_type    = static_cast<VkIndexType>(header.index_type);
+  mesh_data.lods.assign(header.lods, header.lods + header.lod_count);
+  mesh_data.meshlets = std::move(meshlets);
+  for (int i = 0; i < 3; i++) {
+    mesh_data.quantization.offset[i] = header.quantization[i];
+    mesh_data.quantization.scale[i]  = header.quantization[3 + i];
+  }
+  mesh_data.bounds.box.min_corner = {header.box_min[0], header.box_min[1], header.box_min[2]};
+  mesh_data.bounds.box.max_corner = {header.box_max[0], header.box_max[1], header.box_max[2]};
+  mesh_data.bounds.sphere.center  = {header.sphere[0], header.sphere[1], header.sphere[2]};
+  mesh_data.bounds.sphere.radius  = header.sphere[3];
+  mesh_data.cooked_vertices     = file->Data() + header.vertex_offset;
+  mesh_data.cooked_indices      = file->Data() + header.index_offset;
+  mesh_data.cooked_vertex_count = header.vertex_count;
+  mesh_data.cooked_index_count  = header.index_count;
+  mesh_data.cooked_file         = std::move(file);
+  if (restamp) {
+    Restamp<CookedMeshHeader>(path, key);
+  }
+  return true;
+}
+
+bool MeshCache::Store(
+    const RenderMeshSource& source, MeshSourceKey& key, const RenderMeshData& mesh_data) const {
+  uint64_t source_hash = 0;
+  if (!key.Hash(source_hash)) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    return false;
+  }
+
+  // zeroed with the padding, the header is written to disk as it is in memory
+  CookedMeshHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  CurrentLayout(mesh_data.vertex_format, header);
+  StampHeader(key, source_hash, header);
+  header.cooker_version = kMeshCookerVersion;
+  header.optimize_flags = source.optimize_flags;
+  header.vertex_count   = mesh_data.GetVertexCount();
+  header.index_count    = mesh_data.GetIndexCount();
+  header.index_type     = static_cast<uint32_t>(mesh_data.index_type);
+  header.vertex_offset  = AlignUp(sizeof(CookedMeshHeader));
+  // BuildMeshLods never makes more than kMaxMeshLods levels
+  header.lod_count = static_cast<uint32_t>(mesh_data.lods.size());
+  std::copy(mesh_data.lods.begin(), mesh_data.lods.end(), header.lods);
+
+  const uint64_t vertex_bytes = uint64_t(header.vertex_count) * header.vertex_stride;
+  const uint64_t index_bytes  = uint64_t(header.index_count) * GetIndexSize(mesh_data.index_type);
+  header.index_offset         = AlignUp(header.vertex_offset + vertex_bytes);
+
+  const auto&    meshlets               = mesh_data.meshlets;
+  const uint64_t meshlet_bytes          = meshlets.meshlets.size() * sizeof(Meshlet);
+  const uint64_t meshlet_vertex_bytes   = meshlets.vertices.size() * sizeof(uint32_t);
+  const uint64_t meshlet_triangle_bytes = meshlets.triangles.size() * sizeof(uint32_t);
+  header.meshlet_count                  = static_cast<uint32_t>(meshlets.meshlets.size());
+  header.meshlet_vertex_count           = static_cast<uint32_t>(meshlets.vertices.size());
+  header.meshlet_triangle_count         = static_cast<uint32_t>(meshlets.triangles.size());
+  header.meshlet_offset                 = AlignUp(header.index_offset + index_bytes);
+  header.meshlet_vertex_offset          = AlignUp(header.meshlet_offset + meshlet_bytes);
+  header.meshlet_triangle_offset =
+      AlignUp(header.meshlet_vertex_offset + meshlet_vertex_bytes);
+  const auto& bounds = mesh_data.bounds;
+  for (int i = 0; i < 3; i++) {
+    header.box_min[i] = bounds.box.min_corner[i];
+    header.box_max[i] = bounds.box.max_corner[i];
+    header.sphere[i]  = bounds.sphere.center[i];
+  }
+  header.sphere[3] = bounds.sphere.radius;
+  for (int i = 0; i < 3; i++) {
+    header.quantization[i]     = mesh_data.quantization.offset[i];
+    header.quantization[3 + i] = mesh_data.quantization.scale[i];
+  }
+
+  const std::string path      = EntryPath(source);
+  const std::string temporary = ThreadTemporaryPath(path);
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    const char padding[kBlobAlignment] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(padding, header.vertex_offset - sizeof(header));
+    out.write(reinterpret_cast<const char*>(mesh_data.GetVertexData()), vertex_bytes);
+    out.write(padding, header.index_offset - header.vertex_offset - vertex_bytes);
+    out.write(reinterpret_cast<const char*>(mesh_data.GetIndexData()), index_bytes);
+    out.write(padding, header.meshlet_offset - header.index_offset - index_bytes);
+    out.write(reinterpret_cast<const char*>(meshlets.meshlets.data()), meshlet_bytes);
+    out.write(padding, header.meshlet_vertex_offset - header.meshlet_offset - meshlet_bytes);
+    out.write(reinterpret_cast<const char*>(meshlets.vertices.data()), meshlet_vertex_bytes);
+    out.write(
+        padding,
+        header.meshlet_triangle_offset - header.meshlet_vertex_offset - meshlet_vertex_bytes);
+    out.write(reinterpret_cast<const char*>(meshlets.triangles.data()), meshlet_triangle_bytes);
+    if (!out) {
+      return false;
+    }
+  }
+  std::filesystem::rename(temporary, path, error);
+  return !error;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// bump whenever the cooked layout or the import (welding, tangents) changes, old entries are
+// then rebuilt on their next load
+static constexpr uint32_t kMeshCookerVersion = 8;
+
+static const char kMeshCacheDirectory[] = "./asset/cache";
+
+// the files a cache entry is cooked from. their total size and latest write time are read up
+// front, their contents are only hashed when an entry was stamped with another size or time, so
+// a warm load never reads the sources
+class MeshSourceKey {
+ public:
+  MeshSourceKey() {}
+  // a key of known hash and no files, e.g. the one a chunk list recorded
+  explicit MeshSourceKey(uint64_t hash) : hash_(hash), hashed_(true) {}
+
+  // return false if one of the files is missing. seed goes into the hash, for entries that
+  // depend on more than the files
+  bool Stat(std::vector<std::string> files, uint64_t seed = 0);
+
+  uint64_t Size() const { return size_; }
+  int64_t  WriteTime() const { return write_time_; }
+  bool     SameStamp(uint64_t size, int64_t write_time) const {
+    return stated_ && size == size_ && write_time == write_time_;
+  }
+
+  // hashes the files on the first call, return false if one of them can not be read
+  bool Hash(uint64_t& hash);
+  // the hash an entry with the same stamp recorded
+  void SetHash(uint64_t hash) {
+    hash_   = hash;
+    hashed_ = true;
+  }
+
+ private:
+  std::vector<std::string> files_;
+  uint64_t                 seed_       = 0;
+  uint64_t                 size_       = 0;
+  int64_t                  write_time_ = 0;
+  uint64_t                 hash_       = 0;
+  bool                     stated_     = false;
+  bool                     hashed_     = false;
+};
+
+// binary cooked meshes, one entry per source path, vertex format, optimize flags and lod count,
+// rewritten when the source changes. an entry that only lost its stamp, e.g. to a touch of the
+// source, keeps its blobs and gets the new stamp
+//   header | vertex attributes | vertex blob | index blob (16 or 32 bit) |
+//   meshlets | meshlet vertices | meshlet triangles
+// blobs start 16 byte aligned so a read only mapping of the entry can feed the staging upload
+class MeshCache {
+ public:
+  static constexpr uint32_t kMaxAttributes = 8;
+
+  explicit MeshCache(std::string directory) : directory_(std::move(directory)) {}
+  ~MeshCache() {}
+
+  // hash of the whole source file, the cache key together with kMeshCookerVersion
+  static bool HashSource(const std::string& source_file, uint64_t& source_hash);
+
+  // return false when there is no entry, or it was cooked from other content, by another
+  // cooker version or for another vertex layout. on success mesh_data points into the mapping
+  bool Load(const RenderMeshSource& source, MeshSourceKey& key, RenderMeshData& mesh_data) const;
+  // write to a temporary file and rename, a crash never leaves a half written entry behind
+  bool Store(
+      const RenderMeshSource& source, MeshSourceKey& key, const RenderMeshData& mesh_data) const;
+
+  // chunk list of a streamed import of source, next to its entry. false when there is none for
+  // key or one of the chunk entries is gone. the chunks carry the hash of key
+  bool LoadChunks(
+      const RenderMeshSource&       source,
+      MeshSourceKey&                key,
+      std::vector<MeshStreamChunk>& chunks) const;
+  bool StoreChunks(
+      const RenderMeshSource&             source,
+      MeshSourceKey&                      key,
+      const std::vector<MeshStreamChunk>& chunks) const;
+
+  std::string EntryPath(const RenderMeshSource& source) const;
+  // source of chunk of a streamed import, an entry of its own
+  static RenderMeshSource ChunkSource(const RenderMeshSource& source, uint32_t chunk);
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,311 @@
+#include "function/render/mesh/mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vkengine {
+
+namespace {
+constexpr uint32_t kNoVertex = UINT32_MAX;
+
+// fifo cache as time stamps, a vertex is cached while fewer than cache_size misses followed its
+// own. Reset empties the cache without touching the stamps
+class CacheSimulator {
+ public:
+  CacheSimulator(size_t vertex_count, uint32_t cache_size)
+      : cache_time_(vertex_count, 0), cache_size_(cache_size), time_(cache_size + 1) {}
+
+  // true on a miss
+  bool Touch(uint32_t vertex) {
+    if (time_ - cache_time_[vertex] > cache_size_) {
+      cache_time_[vertex] = time_++;
+      return true;
+    }
+    return false;
+  }
+  // misses since the vertex entered the cache
+  uint64_t Age(uint32_t vertex) const { return time_ - cache_time_[vertex]; }
+  void     Reset() { time_ += cache_size_ + 1; }
+
+ private:
+  std::vector<uint64_t> cache_time_;
+  uint64_t              cache_size_;
+  uint64_t              time_;
+};
+
+glm::vec3 LoadPosition(const void* positions, size_t stride, uint32_t vertex) {
+  float value[3];
+  std::memcpy(value, static_cast<const unsigned char*>(positions) + vertex * stride, sizeof(value));
+  return glm::vec3(value[0], value[1], value[2]);
+}
+
+size_t CountMisses(CacheSimulator& cache, const uint32_t* indices, size_t index_count) {
+  size_t misses = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    misses += cache.Touch(indices[i]) ? 1 : 0;
+  }
+  return misses;
+}
+
+// next vertex with live triangles, from the dead end stack first and the input order after
+uint32_t SkipDeadEnd(
+    std::vector<uint32_t>&       dead_end,
+    const std::vector<uint32_t>& live,
+    size_t&                      cursor) {
+  while (!dead_end.empty()) {
+    const uint32_t vertex = dead_end.back();
+    dead_end.pop_back();
+    if (live[vertex] > 0) {
+      return vertex;
+    }
+  }
+  for (; cursor < live.size(); cursor++) {
+    if (live[cursor] > 0) {
+      return static_cast<uint32_t>(cursor);
+    }
+  }
+  return kNoVertex;
+}
+}  // namespace
+
+TriangleAdjacency::TriangleAdjacency(
+    const uint32_t* indices, size_t index_count, size_t vertex_count)
+    : offsets(vertex_count + 1, 0), triangles(index_count) {
+  for (size_t i = 0; i < index_count; i++) {
+    offsets[indices[i] + 1]++;
+  }
+  for (size_t v = 0; v < vertex_count; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < index_count; i++) {
+    triangles[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+}
+
+VertexCacheStatistics AnalyzeVertexCache(
+    const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size) {
+  VertexCacheStatistics statistics;
+  CacheSimulator        cache(vertex_count, cache_size);
+  std::vector<bool>     referenced(vertex_count, false);
+  size_t                referenced_count = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    if (cache.Touch(indices[i])) {
+      statistics.transformed_count++;
+    }
+    if (!referenced[indices[i]]) {
+      referenced[indices[i]] = true;
+      referenced_count++;
+    }
+  }
+  if (index_count >= 3) {
+    statistics.acmr = float(statistics.transformed_count) / float(index_count / 3);
+  }
+  if (referenced_count > 0) {
+    statistics.atvr = float(statistics.transformed_count) / float(referenced_count);
+  }
+  return statistics;
+}
+
+void OptimizeVertexCache(
+    uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size) {
+  const size_t      triangle_count = index_count / 3;
+  TriangleAdjacency adjacency(indices, triangle_count * 3, vertex_count);
+
+  std::vector<uint32_t> live(vertex_count);
+  for (size_t v = 0; v < vertex_count; v++) {
+    live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+  }
+  std::vector<bool>     emitted(triangle_count, false);
+  std::vector<uint32_t> dead_end;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> output;
+  output.reserve(triangle_count * 3);
+  CacheSimulator cache(vertex_count, cache_size);
+  size_t         cursor = 0;
+
+  uint32_t fanning = SkipDeadEnd(dead_end, live, cursor);
+  while (fanning != kNoVertex) {
+    // emit every remaining triangle around the fanning vertex
+    candidates.clear();
+    for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++) {
+      const uint32_t triangle = adjacency.triangles[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (int c = 0; c < 3; c++) {
+        const uint32_t vertex = indices[triangle * 3 + c];
+        output.push_back(vertex);
+        dead_end.push_back(vertex);
+        candidates.push_back(vertex);
+        live[vertex]--;
+        cache.Touch(vertex);
+      }
+      emitted[triangle] = true;
+    }
+
+    // the next fan is around the oldest candidate that stays cached while its fan is emitted
+    uint32_t next          = kNoVertex;
+    int64_t  best_priority = -1;
+    for (uint32_t vertex : candidates) {
+      if (live[vertex] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (cache.Age(vertex) + 2 * live[vertex] <= cache_size) {
+        priority = static_cast<int64_t>(cache.Age(vertex));
+      }
+      if (priority > best_priority) {
+        best_priority = priority;
+        next          = vertex;
+      }
+    }
+    fanning = next != kNoVertex ? next : SkipDeadEnd(dead_end, live, cursor);
+  }
+  std::copy(output.begin(), output.end(), indices);
+}
+
+size_t OptimizeOverdraw(
+    uint32_t*   indices,
+    size_t      index_count,
+    const void* positions,
+    size_t      vertex_count,
+    size_t      stride,
+    uint32_t    cache_size,
+    float       threshold) {
+  index_count -= index_count % 3;
+  if (index_count == 0) {
+    return 0;
+  }
+
+  // a triangle missing on all three vertices starts a disjoint patch, those are the hard
+  // boundaries. each patch is split further once its ACMR, restarted from an empty cache, is
+  // within threshold of the whole patch, so every piece stays cache friendly wherever the sort
+  // moves it
+  std::vector<uint32_t> hard;
+  CacheSimulator        cache(vertex_count, cache_size);
+  for (uint32_t i = 0; i < index_count; i += 3) {
+    if (CountMisses(cache, indices + i, 3) == 3 || i == 0) {
+      hard.push_back(i);
+    }
+  }
+  hard.push_back(static_cast<uint32_t>(index_count));
+
+  std::vector<uint32_t> split;
+  for (size_t c = 0; c + 1 < hard.size(); c++) {
+    cache.Reset();
+    const float patch_acmr =
+        float(CountMisses(cache, indices + hard[c], hard[c + 1] - hard[c])) /
+        float((hard[c + 1] - hard[c]) / 3);
+
+    uint32_t begin  = hard[c];
+    size_t   misses = 0;
+    split.push_back(begin);
+    cache.Reset();
+    for (uint32_t i = hard[c]; i < hard[c + 1]; i += 3) {
+      misses += CountMisses(cache, indices + i, 3);
+      const uint32_t end = i + 3;
+      if (end < hard[c + 1] && misses <= threshold * patch_acmr * ((end - begin) / 3)) {
+        split.push_back(end);
+        begin  = end;
+        misses = 0;
+        cache.Reset();
+      }
+    }
+  }
+  split.push_back(static_cast<uint32_t>(index_count));
+
+  // area weighted centroid and normal of every cluster
+  const size_t           cluster_count = split.size() - 1;
+  std::vector<glm::vec3> centroid(cluster_count, glm::vec3(0.0f));
+  std::vector<glm::vec3> normal(cluster_count, glm::vec3(0.0f));
+  std::vector<float>     area(cluster_count, 0.0f);
+  glm::vec3              mesh_centroid(0.0f);
+  float                  mesh_area = 0.0f;
+  for (size_t c = 0; c < cluster_count; c++) {
+    for (uint32_t i = split[c]; i < split[c + 1]; i += 3) {
+      const glm::vec3 p0 = LoadPosition(positions, stride, indices[i]);
+      const glm::vec3 p1 = LoadPosition(positions, stride, indices[i + 1]);
+      const glm::vec3 p2 = LoadPosition(positions, stride, indices[i + 2]);
+      const glm::vec3 n  = glm::cross(p1 - p0, p2 - p0);
+      const float     a  = glm::length(n);
+      centroid[c] += (p0 + p1 + p2) * (a / 3.0f);
+      normal[c] += n;
+      area[c] += a;
+    }
+    mesh_centroid += centroid[c];
+    mesh_area += area[c];
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid = mesh_centroid * (1.0f / mesh_area);
+  }
+
+  std::vector<float>    sort_key(cluster_count, 0.0f);
+  std::vector<uint32_t> order(cluster_count);
+  for (size_t c = 0; c < cluster_count; c++) {
+    order[c] = static_cast<uint32_t>(c);
+    if (area[c] > 0.0f) {
+      sort_key[c] = glm::dot(centroid[c] * (1.0f / area[c]) - mesh_centroid, normal[c]) / area[c];
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&sort_key](uint32_t a, uint32_t b) {
+    return sort_key[a] > sort_key[b];
+  });
+
+  std::vector<uint32_t> output;
+  output.reserve(index_count);
+  for (uint32_t c : order) {
+    output.insert(output.end(), indices + split[c], indices + split[c + 1]);
+  }
+  std::copy(output.begin(), output.end(), indices);
+  return cluster_count;
+}
+
+size_t OptimizeVertexFetchRemap(
+    uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint32_t>& remap) {
+  remap.assign(vertex_count, kNoVertex);
+  uint32_t next = 0;
+  for (size_t i = 0; i < index_count; i++) {
+    uint32_t& mapped = remap[indices[i]];
+    if (mapped == kNoVertex) {
+      mapped = next++;
+    }
+    indices[i] = mapped;
+  }
+  return next;
+}
+
+MeshOptimizeStatistics OptimizeMeshData(RenderMeshData& mesh_data, uint32_t optimize_flags) {
+  MeshOptimizeStatistics statistics;
+  if (mesh_data.cooked_file || mesh_data.vertex_format != VertexFormat::kFull ||
+      mesh_data.index_type != VK_INDEX_TYPE_UINT32 || mesh_data.index_buffer.size() % 3 != 0) {
+    return statistics;
+  }
+  auto&        indices      = mesh_data.index_buffer;
+  auto&        vertices     = mesh_data.vertex_buffer;
+  const size_t index_count  = indices.size();
+  const size_t vertex_count = vertices.size();
+
+  statistics.before = AnalyzeVertexCache(indices.data(), index_count, vertex_count);
+  if (optimize_flags & kMeshOptimizeVertexCache) {
+    OptimizeVertexCache(indices.data(), index_count, vertex_count);
+  }
+  if (optimize_flags & kMeshOptimizeOverdraw) {
+    statistics.cluster_count = OptimizeOverdraw(
+        indices.data(),
+        index_count,
+        vertices.empty() ? nullptr : &vertices[0].position,
+        vertex_count,
+        sizeof(VulkanVertexData));
+  }
+  if (optimize_flags & kMeshOptimizeVertexFetch) {
+    std::vector<uint32_t> remap;
+    const size_t          used =
+        OptimizeVertexFetchRemap(indices.data(), index_count, vertex_count, remap);
+    vertices = RemapVertices(vertices, remap, used);
+  }
+  statistics.after = AnalyzeVertexCache(indices.data(), index_count, vertices.size());
+  return statistics;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// post-transform cache size the orderings are tuned for and the statistics simulate
+static constexpr uint32_t kVertexCacheSize = 16;
+
+// a cluster is split once its ACMR from an empty cache is within this factor of its patch
+static constexpr float kOverdrawClusterThreshold = 1.05f;
+
+// fifo post-transform cache simulation
+struct VertexCacheStatistics {
+  size_t transformed_count = 0;
+  // transformed vertices per triangle, 3 without any reuse, about 0.5 at best on a closed mesh
+  float acmr = 0.0f;
+  // transformed vertices per referenced vertex, 1 at best
+  float atvr = 0.0f;
+};
+
+struct MeshOptimizeStatistics {
+  VertexCacheStatistics before;
+  VertexCacheStatistics after;
+  // overdraw clusters, 0 when that stage did not run
+  size_t cluster_count = 0;
+};
+
+// vertex to triangle adjacency, the triangles of v are triangles[offsets[v], offsets[v + 1])
+struct TriangleAdjacency {
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> triangles;
+
+  TriangleAdjacency(const uint32_t* indices, size_t index_count, size_t vertex_count);
+};
+
+VertexCacheStatistics AnalyzeVertexCache(
+    const uint32_t* indices,
+    size_t          index_count,
+    size_t          vertex_count,
+    uint32_t        cache_size = kVertexCacheSize);
+
+// Tipsify (Sander et al. 2007), reorders the triangles in place
+void OptimizeVertexCache(
+    uint32_t* indices,
+    size_t    index_count,
+    size_t    vertex_count,
+    uint32_t  cache_size = kVertexCacheSize);
+
+// splits a cache optimized order into clusters that stay cache friendly on their own, then sorts
+// them outside in, so clusters facing away from the mesh center draw first and occlude more of
+// the rest. positions are three floats stride bytes apart, returns the number of clusters
+size_t OptimizeOverdraw(
+    uint32_t*   indices,
+    size_t      index_count,
+    const void* positions,
+    size_t      vertex_count,
+    size_t      stride,
+    uint32_t    cache_size = kVertexCacheSize,
+    float       threshold  = kOverdrawClusterThreshold);
+
+// renumber the vertices in order of first use, remap[old] is the new index or UINT32_MAX for a
+// vertex no triangle references. rewrites indices and returns the new vertex count
+size_t OptimizeVertexFetchRemap(
+    uint32_t* indices, size_t index_count, size_t vertex_count, std::vector<uint32_t>& remap);
+
+template <typename Vertex>
+std::vector<Vertex> RemapVertices(
+    const std::vector<Vertex>& vertices, const std::vector<uint32_t>& remap, size_t count) {
+  std::vector<Vertex> result(count);
+  for (size_t i = 0; i < vertices.size(); i++) {
+    if (remap[i] != UINT32_MAX) {
+      result[remap[i]] = vertices[i];
+    }
+  }
+  return result;
+}
+
+// run the stages of optimize_flags on a welded kFull mesh with 32 bit indices
+MeshOptimizeStatistics OptimizeMeshData(RenderMeshData& mesh_data, uint32_t optimize_flags);
+
+}  // namespace vkengine
@@ -0,0 +1,418 @@
+#include "function/render/mesh/mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+#include "function/render/mesh/mesh_optimizer.h"
+
+namespace vkengine {
+
+namespace {
+// a level has to drop at least this share of the indices of the level before
+constexpr float kMinLodShrink = 0.1f;
+// border planes outweigh the faces so open edges keep their silhouette
+constexpr double kBorderWeight = 10.0;
+// a collapse is rejected when a moved face turns by more than about 80 degrees
+constexpr float kMinNormalDot = 0.2f;
+constexpr int   kMaxPasses    = 64;
+
+constexpr uint32_t kNoVertex = UINT32_MAX;
+
+enum class VertexKind : uint8_t { kManifold, kBorder, kLocked };
+
+// sum of weighted squared distances to a set of planes, the symmetric 4x4 matrix stored as its
+// upper triangle
+struct Quadric {
+  double a2 = 0, ab = 0, ac = 0, ad = 0;
+  double b2 = 0, bc = 0, bd = 0;
+  double c2 = 0, cd = 0;
+  double d2 = 0;
+  double weight = 0;
+
+  void AddPlane(const glm::vec3& normal, float distance, double plane_weight) {
+    const double a = normal.x, b = normal.y, c = normal.z, d = distance;
+    a2 += plane_weight * a * a;
+    ab += plane_weight * a * b;
+    ac += plane_weight * a * c;
+    ad += plane_weight * a * d;
+    b2 += plane_weight * b * b;
+    bc += plane_weight * b * c;
+    bd += plane_weight * b * d;
+    c2 += plane_weight * c * c;
+    cd += plane_weight * c * d;
+    d2 += plane_weight * d * d;
+    weight += plane_weight;
+  }
+
+  void Add(const Quadric& other) {
+    a2 += other.a2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    b2 += other.b2;
+    bc += other.bc;
+    bd += other.bd;
+    c2 += other.c2;
+    cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+  }
+
+  double Evaluate(const glm::vec3& p) const {
+    const double x = p.x, y = p.y, z = p.z;
+    return a2 * x * x + b2 * y * y + c2 * z * z + 2 * (ab * x * y + ac * x * z + bc * y * z) +
+           2 * (ad * x + bd * y + cd * z) + d2;
+  }
+};
+
+struct Collapse {
+  uint32_t from = 0;
+  uint32_t to   = 0;
+  float    error = 0.0f;
+};
+
+glm::vec3 LoadPosition(const void* positions, size_t stride, uint32_t vertex) {
+  float value[3];
+  std::memcpy(value, static_cast<const unsigned char*>(positions) + vertex * stride, sizeof(value));
+  return glm::vec3(value[0], value[1], value[2]);
+}
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) { return (uint64_t(a) << 32) | b; }
+
+bool ContainsEdge(const std::vector<uint64_t>& sorted_edges, uint32_t a, uint32_t b) {
+  return std::binary_search(sorted_edges.begin(), sorted_edges.end(), EdgeKey(a, b));
+}
+
+// object space distance of moving the surface around from onto to
+float CollapseError(const Quadric& from, const Quadric& to, const glm::vec3& position) {
+  Quadric sum = from;
+  sum.Add(to);
+  if (sum.weight <= 0.0) {
+    return 0.0f;
+  }
+  return static_cast<float>(std::sqrt(std::max(sum.Evaluate(position) / sum.weight, 0.0)));
+}
+}  // namespace
+
+float SimplifyMesh(
+    std::vector<uint32_t>&     destination,
+    const uint32_t*            indices,
+    size_t                     index_count,
+    const void*                positions,
+    size_t                     vertex_count,
+    size_t                     stride,
+    const MeshSimplifyOptions& options) {
+  destination.assign(indices, indices + index_count - index_count % 3);
+  if (destination.size() <= options.target_index_count || vertex_count == 0) {
+    return 0.0f;
+  }
+
+  std::vector<glm::vec3> position(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    position[v] = LoadPosition(positions, stride, v);
+  }
+
+  // vertices at the same position share one id. several vertices at one id are the wedges of a
+  // uv or normal seam, linked in a ring through next_wedge and always collapsed together
+  std::vector<uint32_t> order(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    order[v] = v;
+  }
+  const auto position_less = [&position](uint32_t a, uint32_t b) {
+    return std::tie(position[a].x, position[a].y, position[a].z) <
+           std::tie(position[b].x, position[b].y, position[b].z);
+  };
+  std::sort(order.begin(), order.end(), position_less);
+  std::vector<uint32_t>   position_id(vertex_count);
+  std::vector<uint32_t>   next_wedge(vertex_count);
+  std::vector<VertexKind> kind;
+  for (size_t i = 0, first = 0; i < vertex_count; i++) {
+    if (i == 0 || position_less(order[i - 1], order[i])) {
+      kind.push_back(VertexKind::kManifold);
+      first = i;
+    }
+    position_id[order[i]] = static_cast<uint32_t>(kind.size() - 1);
+    const bool last       = i + 1 == vertex_count || position_less(order[i], order[i + 1]);
+    next_wedge[order[i]]  = last ? order[first] : order[i + 1];
+  }
+
+  // half edges between position ids. an edge without its twin is on a border, one used twice
+  // in the same direction is non-manifold and locks both ends
+  std::vector<uint64_t> half_edges;
+  half_edges.reserve(destination.size());
+  for (size_t i = 0; i < destination.size(); i += 3) {
+    for (int k = 0; k < 3; k++) {
+      const uint32_t a = position_id[destination[i + k]];
+      const uint32_t b = position_id[destination[i + (k + 1) % 3]];
+      half_edges.push_back(EdgeKey(a, b));
+    }
+  }
+  std::sort(half_edges.begin(), half_edges.end());
+  std::vector<uint64_t> border_edges;
+  for (size_t e = 0; e < half_edges.size(); e++) {
+    const uint32_t a = static_cast<uint32_t>(half_edges[e] >> 32);
+    const uint32_t b = static_cast<uint32_t>(half_edges[e]);
+    if (e + 1 < half_edges.size() && half_edges[e + 1] == half_edges[e]) {
+      kind[a] = VertexKind::kLocked;
+      kind[b] = VertexKind::kLocked;
+    } else if (!ContainsEdge(half_edges, b, a)) {
+      border_edges.push_back(EdgeKey(a, b));
+      border_edges.push_back(EdgeKey(b, a));
+      for (uint32_t end : {a, b}) {
+        if (kind[end] == VertexKind::kManifold) {
+          kind[end] = VertexKind::kBorder;
+        }
+      }
+    }
+  }
+  std::sort(border_edges.begin(), border_edges.end());
+
+  // area weighted face planes, plus planes through every border edge perpendicular to its face
+  std::vector<Quadric> quadric(kind.size());
+  for (size_t i = 0; i < destination.size(); i += 3) {
+    const glm::vec3 p[3] = {
+        position[destination[i]], position[destination[i + 1]], position[destination[i + 2]]};
+    const glm::vec3 cross  = glm::cross(p[1] - p[0], p[2] - p[0]);
+    const float     length = glm::length(cross);
+    if (length == 0.0f) {
+      continue;
+    }
+    const glm::vec3 normal = cross * (1.0f / length);
+    for (int k = 0; k < 3; k++) {
+      quadric[position_id[destination[i + k]]].AddPlane(
+          normal, -glm::dot(normal, p[0]), length * 0.5);
+    }
+    for (int k = 0; k < 3; k++) {
+      const uint32_t a = position_id[destination[i + k]];
+      const uint32_t b = position_id[destination[i + (k + 1) % 3]];
+      if (!ContainsEdge(border_edges, a, b)) {
+        continue;
+      }
+      const glm::vec3 edge        = p[(k + 1) % 3] - p[k];
+      const glm::vec3 edge_normal = glm::cross(edge, normal);
+      const float     edge_length = glm::length(edge_normal);
+      if (edge_length == 0.0f) {
+        continue;
+      }
+      const glm::vec3 plane = edge_normal * (1.0f / edge_length);
+      const double    w     = kBorderWeight * glm::dot(edge, edge);
+      quadric[a].AddPlane(plane, -glm::dot(plane, p[k]), w);
+      quadric[b].AddPlane(plane, -glm::dot(plane, p[k]), w);
+    }
+  }
+
+  // passes of independent collapses, cheapest first. every collapse locks the ring it changed so
+  // the flip test of the next one sees current geometry
+  float                 result_error = 0.0f;
+  std::vector<Collapse> collapses;
+  std::vector<uint32_t> remap(vertex_count);
+  std::vector<uint32_t> wedge_target(vertex_count);
+  std::vector<bool>     touched(kind.size());
+  std::vector<uint32_t> triangle_offsets;
+  std::vector<uint32_t> triangles;
+  for (int pass = 0; pass < kMaxPasses && destination.size() > options.target_index_count;
+       pass++) {
+    const size_t triangle_count = destination.size() / 3;
+
+    // vertex to triangle adjacency of the current level
+    triangle_offsets.assign(vertex_count + 1, 0);
+    for (uint32_t vertex : destination) {
+      triangle_offsets[vertex + 1]++;
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+      triangle_offsets[v + 1] += triangle_offsets[v];
+    }
+    triangles.resize(destination.size());
+    {
+      std::vector<uint32_t> cursor(triangle_offsets.begin(), triangle_offsets.end() - 1);
+      for (size_t i = 0; i < destination.size(); i++) {
+        triangles[cursor[destination[i]]++] = static_cast<uint32_t>(i / 3);
+      }
+    }
+
+    // every wedge of from moves onto the one wedge of to it shares a face with. a wedge without
+    // such a face, or with several, would take attributes from another side of a seam
+    const auto map_wedges = [&](uint32_t from, uint32_t to_id, std::vector<uint32_t>& target) {
+      uint32_t wedge = from;
+      do {
+        uint32_t mapped = kNoVertex;
+        for (uint32_t t = triangle_offsets[wedge]; t < triangle_offsets[wedge + 1]; t++) {
+          for (int k = 0; k < 3; k++) {
+            const uint32_t vertex = destination[triangles[t] * 3 + k];
+            if (position_id[vertex] != to_id) {
+              continue;
+            }
+            if (mapped != kNoVertex && mapped != vertex) {
+              return false;
+            }
+            mapped = vertex;
+          }
+        }
+        if (mapped == kNoVertex && triangle_offsets[wedge] != triangle_offsets[wedge + 1]) {
+          return false;
+        }
+        target[wedge] = mapped == kNoVertex ? wedge : mapped;
+        wedge         = next_wedge[wedge];
+      } while (wedge != from);
+      return true;
+    };
+    // a face around from that survives the collapse must not turn over
+    const auto flips_face = [&](uint32_t from, uint32_t to_id, const std::vector<uint32_t>& moved) {
+      uint32_t wedge = from;
+      do {
+        for (uint32_t t = triangle_offsets[wedge]; t < triangle_offsets[wedge + 1]; t++) {
+          const uint32_t* face = &destination[triangles[t] * 3];
+          if (position_id[face[0]] == to_id || position_id[face[1]] == to_id ||
+              position_id[face[2]] == to_id) {
+            continue;
+          }
+          glm::vec3 p[3];
+          glm::vec3 q[3];
+          for (int k = 0; k < 3; k++) {
+            p[k] = position[face[k]];
+            q[k] = face[k] == wedge ? position[moved[wedge]] : p[k];
+          }
+          const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+          const glm::vec3 after  = glm::cross(q[1] - q[0], q[2] - q[0]);
+          if (glm::dot(before, after) <=
+              kMinNormalDot * glm::length(before) * glm::length(after)) {
+            return true;
+          }
+        }
+        wedge = next_wedge[wedge];
+      } while (wedge != from);
+      return false;
+    };
+
+    collapses.clear();
+    for (size_t i = 0; i < destination.size(); i += 3) {
+      // both directions of every edge
+      for (int k = 0; k < 6; k++) {
+        const uint32_t from    = destination[i + k % 3];
+        const uint32_t to      = destination[i + (k + 1 + k / 3) % 3];
+        const uint32_t from_id = position_id[from];
+        const uint32_t to_id   = position_id[to];
+        if (kind[from_id] == VertexKind::kLocked || from_id == to_id) {
+          continue;
+        }
+        if (kind[from_id] == VertexKind::kBorder && !ContainsEdge(border_edges, from_id, to_id)) {
+          continue;
+        }
+        const float error = CollapseError(quadric[from_id], quadric[to_id], position[to]);
+        if (error <= options.max_error) {
+          collapses.push_back({from, to, error});
+        }
+      }
+    }
+    if (collapses.empty()) {
+      break;
+    }
+    std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+      return std::tie(lhs.error, lhs.from, lhs.to) < std::tie(rhs.error, rhs.from, rhs.to);
+    });
+
+    // a collapse removes two triangles, one on a border
+    const size_t triangle_goal = triangle_count - options.target_index_count / 3;
+    size_t       removed       = 0;
+    for (uint32_t v = 0; v < vertex_count; v++) {
+      remap[v] = v;
+    }
+    std::fill(touched.begin(), touched.end(), false);
+    for (const auto& collapse : collapses) {
+      if (removed >= triangle_goal) {
+        break;
+      }
+      const uint32_t from_id = position_id[collapse.from];
+      const uint32_t to_id   = position_id[collapse.to];
+      if (touched[from_id] || touched[to_id]) {
+        continue;
+      }
+      if (!map_wedges(collapse.from, to_id, wedge_target) ||
+          flips_face(collapse.from, to_id, wedge_target)) {
+        continue;
+      }
+
+      uint32_t wedge = collapse.from;
+      do {
+        remap[wedge] = wedge_target[wedge];
+        for (uint32_t t = triangle_offsets[wedge]; t < triangle_offsets[wedge + 1]; t++) {
+          for (int k = 0; k < 3; k++) {
+            touched[position_id[destination[triangles[t] * 3 + k]]] = true;
+          }
+        }
+        wedge = next_wedge[wedge];
+      } while (wedge != collapse.from);
+      quadric[to_id].Add(quadric[from_id]);
+      result_error = std::max(result_error, collapse.error);
+      removed += kind[from_id] == VertexKind::kBorder ? 1 : 2;
+    }
+    if (removed == 0) {
+      break;
+    }
+
+    // apply the pass, faces that lost an edge are dropped
+    size_t write = 0;
+    for (size_t i = 0; i < destination.size(); i += 3) {
+      const uint32_t a = remap[destination[i]];
+      const uint32_t b = remap[destination[i + 1]];
+      const uint32_t c = remap[destination[i + 2]];
+      if (position_id[a] == position_id[b] || position_id[b] == position_id[c] ||
+          position_id[c] == position_id[a]) {
+        continue;
+      }
+      destination[write++] = a;
+      destination[write++] = b;
+      destination[write++] = c;
+    }
+    destination.resize(write);
+  }
+  return result_error;
+}
+
+void BuildMeshLods(RenderMeshData& mesh_data, const MeshLodOptions& options) {
+  mesh_data.lods.clear();
+  if (mesh_data.cooked_file || mesh_data.vertex_format != VertexFormat::kFull ||
+      mesh_data.index_type != VK_INDEX_TYPE_UINT32) {
+    return;
+  }
+  const auto   base_count = static_cast<uint32_t>(mesh_data.index_buffer.size());
+  const auto&  vertices   = mesh_data.vertex_buffer;
+  const float  max_error  = options.max_relative_error * mesh_data.bounds.sphere.radius;
+  const size_t lod_count  = std::min(options.lod_count, kMaxMeshLods);
+  mesh_data.lods.push_back({0, base_count, 0.0f});
+
+  std::vector<uint32_t> previous(mesh_data.index_buffer);
+  std::vector<uint32_t> level;
+  float                 error  = 0.0f;
+  float                 target = static_cast<float>(base_count);
+  for (size_t l = 1; l < lod_count && !vertices.empty(); l++) {
+    target *= options.reduction;
+    MeshSimplifyOptions simplify;
+    simplify.target_index_count = static_cast<size_t>(target) / 3 * 3;
+    simplify.max_error          = max_error - error;
+    const float level_error     = SimplifyMesh(
+        level,
+        previous.data(),
+        previous.size(),
+        &vertices[0].position,
+        vertices.size(),
+        sizeof(VulkanVertexData),
+        simplify);
+    if (level.empty() || level.size() > previous.size() * (1.0f - kMinLodShrink)) {
+      break;
+    }
+    OptimizeVertexCache(level.data(), level.size(), vertices.size());
+
+    // levels build on each other, the errors add up
+    error += level_error;
+    mesh_data.lods.push_back({static_cast<uint32_t>(mesh_data.index_buffer.size()),
+                              static_cast<uint32_t>(level.size()),
+                              error});
+    mesh_data.index_buffer.insert(mesh_data.index_buffer.end(), level.begin(), level.end());
+    previous.swap(level);
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+struct MeshSimplifyOptions {
+  // stop once the result has at most this many indices
+  size_t target_index_count = 0;
+  // object space, no collapse moves the surface further
+  float max_error = FLT_MAX;
+};
+
+struct MeshLodOptions {
+  // levels including the base mesh, at most kMaxMeshLods
+  uint32_t lod_count = 4;
+  // index count of every level relative to the one before
+  float reduction = 0.5f;
+  // error limit of the coarsest level relative to the bounding sphere radius
+  float max_relative_error = 0.05f;
+};
+
+// quadric error metric edge collapse (Garland and Heckbert 1997) onto existing vertices, so the
+// result indexes the same vertex buffer. vertices sharing a position (uv or normal seams) move
+// together and only along the seam, open borders only collapse along the border. positions are
+// three floats stride bytes apart. returns the object space error of the worst collapse
+float SimplifyMesh(
+    std::vector<uint32_t>&     destination,
+    const uint32_t*            indices,
+    size_t                     index_count,
+    const void*                positions,
+    size_t                     vertex_count,
+    size_t                     stride,
+    const MeshSimplifyOptions& options);
+
+// append the coarser levels of a welded kFull mesh with 32 bit indices to its index buffer and
+// fill lods. every level is simplified from the one before and cache optimized, the chain ends
+// early when a level stops shrinking or would exceed the error limit
+void BuildMeshLods(RenderMeshData& mesh_data, const MeshLodOptions& options);
+
+}  // namespace vkengine
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core/utils/hash.h"
+
+namespace vkengine {
+
+struct MeshWeldOptions {
+  // > 0 snaps positions to a grid of this size before comparing. vertices closer than epsilon
+  // but on different sides of a cell border stay apart
+  float position_epsilon = 0.0f;
+  // byte offset of the three float position inside the vertex
+  size_t position_offset = 0;
+};
+
+struct MeshWeldStatistics {
+  size_t   corner_count   = 0;
+  size_t   unique_count   = 0;
+  size_t   probe_count    = 0;
+  size_t   table_capacity = 0;
+  uint32_t rehash_count   = 0;
+};
+
+// merges bitwise identical vertices into an index buffer. vertices are hashed and compared as raw
+// bytes, so every attribute takes part and the vertex type must not contain padding. the table
+// is flat open addressing with linear probing, each slot holds the vertex index and the high
+// hash bits, so most mismatches are rejected without touching the vertex array
+template <typename Vertex>
+class MeshWelder {
+  static_assert(std::is_trivially_copyable_v<Vertex>, "vertex must be compared as bytes");
+
+ public:
+  // corner_count is 3 * face count. a closed triangle mesh has about half a vertex per face, the
+  // table starts at twice that and grows past 70% load when seams split more vertices
+  explicit MeshWelder(size_t corner_count, const MeshWeldOptions& options = {})
+      : options_(options) {
+    const size_t expected = corner_count / 6 + 1;
+    vertices_.reserve(expected);
+    Rehash(expected * 2);
+  }
+
+  // index of the vertex in GetVertices, appended when no equal vertex exists
+  uint32_t Weld(const Vertex& input) {
+    Vertex vertex = input;
+    if (options_.position_epsilon > 0.0f) {
+      Snap(vertex);
+    }
+
+    statistics_.corner_count++;
+    const uint64_t hash = HashBytes(&vertex, sizeof(Vertex));
+    const uint32_t tag  = static_cast<uint32_t>(hash >> 32);
+    for (size_t slot = hash & mask_;; slot = (slot + 1) & mask_) {
+      statistics_.probe_count++;
+      Slot& current = slots_[slot];
+      if (current.index == kEmpty) {
+        current.index = static_cast<uint32_t>(vertices_.size());
+        current.tag   = tag;
+        vertices_.push_back(vertex);
+        statistics_.unique_count = vertices_.size();
+        if (vertices_.size() * 10 > slots_.size() * 7) {
+          Rehash(slots_.size());
+        }
+        return static_cast<uint32_t>(vertices_.size() - 1);
+      }
+      if (current.tag == tag &&
+          std::memcmp(&vertices_[current.index], &vertex, sizeof(Vertex)) == 0) {
+        return current.index;
+      }
+    }
+  }
+
+  const std::vector<Vertex>& GetVertices() const { return vertices_; }
+  std::vector<Vertex>        TakeVertices() { return std::move(vertices_); }
+
+  const MeshWeldStatistics& GetStatistics() const { return statistics_; }
+
+ private:
+  static constexpr uint32_t kEmpty = UINT32_MAX;
+
+  struct Slot {
+    uint32_t index = kEmpty;
+    uint32_t tag   = 0;
+  };
+
+  void Snap(Vertex& vertex) const {
+    float position[3];
+    auto* bytes = reinterpret_cast<unsigned char*>(&vertex) + options_.position_offset;
+    std::memcpy(position, bytes, sizeof(position));
+    for (float& value : position) {
+      // + 0.0f turns -0 into 0, both must land in the same cell
+      value = std::round(value / options_.position_epsilon) * options_.position_epsilon + 0.0f;
+    }
+    std::memcpy(bytes, position, sizeof(position));
+  }
+
+  // at least min_capacity slots, power of two
+  void Rehash(size_t min_capacity) {
+    size_t capacity = 16;
+    while (capacity < min_capacity) {
+      capacity <<= 1;
+    }
+    if (capacity == slots_.size()) {
+      capacity <<= 1;
+    }
+    if (!slots_.empty()) {
+      statistics_.rehash_count++;
+    }
+
+    slots_.assign(capacity, Slot{});
+    mask_                      = capacity - 1;
+    statistics_.table_capacity = capacity;
+    for (uint32_t i = 0; i < vertices_.size(); i++) {
+      const uint64_t hash = HashBytes(&vertices_[i], sizeof(Vertex));
+      size_t         slot = hash & mask_;
+      while (slots_[slot].index != kEmpty) {
+        slot = (slot + 1) & mask_;
+      }
+      slots_[slot].index = i;
+      slots_[slot].tag   = static_cast<uint32_t>(hash >> 32);
+    }
+  }
+
+  MeshWeldOptions     options_;
+  MeshWeldStatistics  statistics_;
+  std::vector<Slot>   slots_;
+  size_t              mask_ = 0;
+  std::vector<Vertex> vertices_;
+};
+
+}  // namespace vkengine
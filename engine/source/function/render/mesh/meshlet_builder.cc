@@ -0,0 +1,325 @@
+
+
+#include "function/render/mesh/meshlet_builder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+#include "function/render/mesh/mesh_optimizer.h"
+
+namespace vkengine {
+
+namespace {
+constexpr uint8_t  kNotInMeshlet = 0xff;
+constexpr uint32_t kNoTriangle   = UINT32_MAX;
+// a triangle facing away from the cone axis counts as this much further from the cluster
+constexpr float kConeWeight = 0.5f;
+// cones wider than this can not reject anything, their triangles face too many ways
+constexpr float kMinConeDot = 0.1f;
+
+glm::vec3 LoadPosition(const void* positions, size_t stride, uint32_t vertex) {
+  float value[3];
+  std::memcpy(value, static_cast<const unsigned char*>(positions) + vertex * stride, sizeof(value));
+  return glm::vec3(value[0], value[1], value[2]);
+}
+
+uint32_t LocalIndex(uint32_t triangle, int corner) { return (triangle >> (corner * 8)) & 0xff; }
+
+// sphere around the box of the vertices, cone over the triangle normals with the apex behind
+// every triangle plane
+void ComputeMeshletBounds(
+    const MeshletData& data, const void* positions, size_t stride, Meshlet& meshlet) {
+  AxisAlignedBox box;
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+    box.Merge(LoadPosition(positions, stride, data.vertices[meshlet.vertex_offset + i]));
+  }
+  const glm::vec3 center = box.Center();
+  float           radius = 0.0f;
+  for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+    const glm::vec3 p = LoadPosition(positions, stride, data.vertices[meshlet.vertex_offset + i]);
+    radius            = std::max(radius, glm::length(p - center));
+  }
+  meshlet.bounding_sphere = glm::vec4(center, radius);
+
+  glm::vec3 corners[kMeshletMaxTriangles][3];
+  glm::vec3 normals[kMeshletMaxTriangles];
+  glm::vec3 axis(0.0f);
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+    const uint32_t triangle = data.triangles[meshlet.triangle_offset + t];
+    for (int c = 0; c < 3; c++) {
+      corners[t][c] = LoadPosition(
+          positions,
+          stride,
+          data.vertices[meshlet.vertex_offset + LocalIndex(triangle, c)]);
+    }
+    const glm::vec3 edge1  = corners[t][1] - corners[t][0];
+    const glm::vec3 edge2  = corners[t][2] - corners[t][0];
+    const glm::vec3 normal = glm::cross(edge1, edge2);
+    const float     length = glm::length(normal);
+    normals[t]             = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    axis += normals[t];
+  }
+  meshlet.cone_apex = glm::vec4(center, 0.0f);
+  meshlet.cone_axis = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  const float axis_length = glm::length(axis);
+  if (axis_length <= 0.0f) {
+    return;
+  }
+  axis /= axis_length;
+
+  // degenerate triangles have no facing and do not widen the cone
+  float min_dot = 1.0f;
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+    if (normals[t] != glm::vec3(0.0f)) {
+      min_dot = std::min(min_dot, glm::dot(normals[t], axis));
+    }
+  }
+  if (min_dot <= kMinConeDot) {
+    return;
+  }
+  // the apex moves back along the axis until it is behind the plane of every triangle
+  float apex_distance = 0.0f;
+  for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+    const float facing = glm::dot(normals[t], axis);
+    if (facing > 0.0f) {
+      apex_distance =
+          std::max(apex_distance, glm::dot(center - corners[t][0], normals[t]) / facing);
+    }
+  }
+  meshlet.cone_apex = glm::vec4(center - axis * apex_distance, 0.0f);
+  meshlet.cone_axis = glm::vec4(axis, std::sqrt(1.0f - min_dot * min_dot));
+}
+}  // namespace
+
+size_t BuildMeshlets(
+    MeshletData&    meshlets,
+    const uint32_t* indices,
+    size_t          index_count,
+    const void*     positions,
+    size_t          vertex_count,
+    size_t          stride) {
+  meshlets.meshlets.clear();
+  meshlets.vertices.clear();
+  meshlets.triangles.clear();
+  const size_t triangle_count = index_count / 3;
+  if (triangle_count == 0) {
+    return 0;
+  }
+
+  // clusters grow over shared positions, so uv and normal seams do not cut them apart
+  std::vector<glm::vec3> position(vertex_count);
+  std::vector<uint32_t>  order(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    position[v] = LoadPosition(positions, stride, v);
+    order[v]    = v;
+  }
+  const auto position_less = [&position](uint32_t a, uint32_t b) {
+    return std::tie(position[a].x, position[a].y, position[a].z) <
+           std::tie(position[b].x, position[b].y, position[b].z);
+  };
+  std::sort(order.begin(), order.end(), position_less);
+  std::vector<uint32_t> position_id(vertex_count);
+  uint32_t              position_count = 0;
+  for (size_t i = 0; i < vertex_count; i++) {
+    if (i > 0 && position_less(order[i - 1], order[i])) {
+      position_count++;
+    }
+    position_id[order[i]] = position_count;
+  }
+  position_count++;
+  std::vector<uint32_t> position_indices(triangle_count * 3);
+  for (size_t i = 0; i < position_indices.size(); i++) {
+    position_indices[i] = position_id[indices[i]];
+  }
+
+  TriangleAdjacency adjacency(position_indices.data(), position_indices.size(), position_count);
+  std::vector<uint32_t> live(position_count);
+  for (size_t p = 0; p < position_count; p++) {
+    live[p] = adjacency.offsets[p + 1] - adjacency.offsets[p];
+  }
+  std::vector<glm::vec3> normals(triangle_count);
+  std::vector<glm::vec3> centroids(triangle_count);
+  for (size_t t = 0; t < triangle_count; t++) {
+    const glm::vec3 p0     = position[indices[t * 3]];
+    const glm::vec3 p1     = position[indices[t * 3 + 1]];
+    const glm::vec3 p2     = position[indices[t * 3 + 2]];
+    const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const float     length = glm::length(normal);
+    normals[t]             = length > 0.0f ? normal / length : glm::vec3(0.0f);
+    centroids[t]           = (p0 + p1 + p2) * (1.0f / 3.0f);
+  }
+  std::vector<bool>    emitted(triangle_count, false);
+  std::vector<uint8_t> local(vertex_count, kNotInMeshlet);
+  Meshlet              meshlet;
+  glm::vec3            normal_sum(0.0f);
+  glm::vec3            centroid_sum(0.0f);
+  size_t               cursor        = 0;
+  uint32_t             last_triangle = kNoTriangle;
+
+  const auto finish_meshlet = [&]() {
+    for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+      local[meshlets.vertices[meshlet.vertex_offset + i]] = kNotInMeshlet;
+    }
+    ComputeMeshletBounds(meshlets, positions, stride, meshlet);
+    meshlets.meshlets.push_back(meshlet);
+    meshlet                 = Meshlet{};
+    meshlet.vertex_offset   = static_cast<uint32_t>(meshlets.vertices.size());
+    meshlet.triangle_offset = static_cast<uint32_t>(meshlets.triangles.size());
+    normal_sum              = glm::vec3(0.0f);
+    centroid_sum            = glm::vec3(0.0f);
+  };
+  // the live triangle around the last meshlet with the fewest live neighbours, growing from the
+  // most enclosed spot leaves fewer isolated holes behind. the input order once that is done
+  const auto seed_triangle = [&]() {
+    uint32_t seed       = kNoTriangle;
+    uint32_t seed_score = UINT32_MAX;
+    if (!meshlets.meshlets.empty()) {
+      const auto& previous = meshlets.meshlets.back();
+      for (uint32_t i = 0; i < previous.vertex_count; i++) {
+        const uint32_t position = position_id[meshlets.vertices[previous.vertex_offset + i]];
+        if (live[position] == 0) {
+          continue;
+        }
+        for (uint32_t a = adjacency.offsets[position]; a < adjacency.offsets[position + 1]; a++) {
+          const uint32_t  triangle = adjacency.triangles[a];
+          const uint32_t* corner   = position_indices.data() + triangle * 3;
+          const uint32_t  score    = live[corner[0]] + live[corner[1]] + live[corner[2]];
+          if (!emitted[triangle] && score < seed_score) {
+            seed_score = score;
+            seed       = triangle;
+          }
+        }
+      }
+    }
+    if (seed == kNoTriangle) {
+      while (emitted[cursor]) {
+        cursor++;
+      }
+      seed = static_cast<uint32_t>(cursor);
+    }
+    return seed;
+  };
+  // vertices of the triangle not yet in the meshlet, repeated corners count once
+  const auto new_vertices = [&](uint32_t triangle) {
+    const uint32_t* corner = indices + triangle * 3;
+    return uint32_t(local[corner[0]] == kNotInMeshlet) +
+           uint32_t(local[corner[1]] == kNotInMeshlet && corner[1] != corner[0]) +
+           uint32_t(
+               local[corner[2]] == kNotInMeshlet && corner[2] != corner[0] &&
+               corner[2] != corner[1]);
+  };
+
+  // candidates of the current step, the live triangle adding the fewest vertices and among those
+  // the one closest to the cluster center and best aligned with its cone
+  glm::vec3  axis(0.0f);
+  glm::vec3  center(0.0f);
+  uint32_t   best       = kNoTriangle;
+  uint32_t   best_extra = UINT32_MAX;
+  float      best_score = FLT_MAX;
+  const auto consider   = [&](uint32_t position) {
+    if (live[position] == 0) {
+      return;
+    }
+    for (uint32_t a = adjacency.offsets[position]; a < adjacency.offsets[position + 1]; a++) {
+      const uint32_t triangle = adjacency.triangles[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      const uint32_t extra = new_vertices(triangle);
+      if (meshlet.vertex_count + extra > kMeshletMaxVertices || extra > best_extra) {
+        continue;
+      }
+      // squared distance times the squared cone factor, which orders like their product
+      const glm::vec3 offset = centroids[triangle] - center;
+      const float     bend   = 1.0f + kConeWeight * (1.0f - glm::dot(normals[triangle], axis));
+      const float     score  = glm::dot(offset, offset) * bend * bend;
+      if (extra < best_extra || score < best_score) {
+        best_extra = extra;
+        best_score = score;
+        best       = triangle;
+      }
+    }
+  };
+  const auto reset_candidates = [&]() {
+    best       = kNoTriangle;
+    best_extra = UINT32_MAX;
+    best_score = FLT_MAX;
+  };
+
+  for (size_t added = 0; added < triangle_count; added++) {
+    if (meshlet.triangle_count == kMeshletMaxTriangles) {
+      finish_meshlet();
+    }
+
+    const float sum_length = glm::length(normal_sum);
+    axis   = sum_length > 0.0f ? normal_sum / sum_length : glm::vec3(0.0f);
+    center = centroid_sum * (1.0f / float(std::max(meshlet.triangle_count, 1u)));
+    reset_candidates();
+    // around the last triangle first, the whole meshlet is only searched when nothing there adds
+    // at most one vertex. that is most of the time and keeps the step cost flat
+    if (meshlet.triangle_count > 0) {
+      for (int c = 0; c < 3; c++) {
+        consider(position_indices[last_triangle * 3 + c]);
+      }
+    }
+    if (best_extra > 1) {
+      reset_candidates();
+      for (uint32_t i = 0; i < meshlet.vertex_count; i++) {
+        consider(position_id[meshlets.vertices[meshlet.vertex_offset + i]]);
+      }
+    }
+
+    // nothing adjacent fits, the meshlet is finished rather than stretched over a distant part
+    // of the mesh and the next one starts next to it
+    if (best == kNoTriangle) {
+      if (meshlet.triangle_count > 0) {
+        finish_meshlet();
+      }
+      best = seed_triangle();
+    }
+
+    uint32_t packed = 0;
+    for (int c = 0; c < 3; c++) {
+      const uint32_t vertex = indices[best * 3 + c];
+      if (local[vertex] == kNotInMeshlet) {
+        local[vertex] = static_cast<uint8_t>(meshlet.vertex_count++);
+        meshlets.vertices.push_back(vertex);
+      }
+      packed |= uint32_t(local[vertex]) << (c * 8);
+      live[position_id[vertex]]--;
+    }
+    meshlets.triangles.push_back(packed);
+    meshlet.triangle_count++;
+    emitted[best] = true;
+    last_triangle = best;
+    normal_sum += normals[best];
+    centroid_sum += centroids[best];
+  }
+  if (meshlet.triangle_count > 0) {
+    finish_meshlet();
+  }
+  return meshlets.meshlets.size();
+}
+
+size_t BuildMeshletData(RenderMeshData& mesh_data) {
+  if (mesh_data.cooked_file || mesh_data.vertex_format != VertexFormat::kFull ||
+      mesh_data.index_type != VK_INDEX_TYPE_UINT32) {
+    return 0;
+  }
+  const auto&  vertices    = mesh_data.vertex_buffer;
+  const auto   first_index = mesh_data.lods.empty() ? 0 : mesh_data.lods[0].first_index;
+  const size_t index_count = mesh_data.lods.empty() ? mesh_data.index_buffer.size()
+                                                    : mesh_data.lods[0].index_count;
+  return BuildMeshlets(
+      mesh_data.meshlets,
+      mesh_data.index_buffer.data() + first_index,
+      index_count,
+      vertices.empty() ? nullptr : &vertices[0].position,
+      vertices.size(),
+      sizeof(VulkanVertexData));
+}
+
+}  // namespace vkengine
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// sparser meshes are cheaper to cull as a whole than cluster by cluster
+static constexpr uint32_t kMinMeshletTriangleCount = 1 << 12;
+
+// greedy clustering into meshlets of at most kMeshletMaxVertices vertices and
+// kMeshletMaxTriangles triangles. a cluster grows by the adjacent triangle adding the fewest
+// vertices and bending its normal cone the least, so bounds and cones stay tight. triangles are
+// visited from the input order when nothing adjacent fits, which keeps the clusters of a cache
+// optimized mesh coherent. positions are three floats stride bytes apart, returns the count
+size_t BuildMeshlets(
+    MeshletData&    meshlets,
+    const uint32_t* indices,
+    size_t          index_count,
+    const void*     positions,
+    size_t          vertex_count,
+    size_t          stride);
+
+// cluster lods[0] of a welded kFull mesh with 32 bit indices
+size_t BuildMeshletData(RenderMeshData& mesh_data);
+
+}  // namespace vkengine
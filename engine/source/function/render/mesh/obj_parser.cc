@@ -0,0 +1,404 @@
+#include "function/render/mesh/obj_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#include "core/utils/mapped_file.h"
+#include "core/utils/thread_pool.h"
+#include "fmt/format.h"
+
+namespace vkengine {
+
+namespace {
+
+// bit of ObjRelative::components per ObjIndex member
+constexpr uint8_t kRelativePosition = 1;
+constexpr uint8_t kRelativeTexcoord = 2;
+constexpr uint8_t kRelativeNormal   = 4;
+
+// corner with a negative index, stored relative to the chunk until its offsets are known
+struct ObjRelative {
+  uint32_t corner;
+  uint8_t  components;
+};
+
+struct ObjFaceCorner {
+  ObjIndex index;
+  uint8_t  relative = 0;
+};
+
+struct ObjChunk {
+  const char* begin = nullptr;
+  const char* end   = nullptr;
+
+  std::vector<glm::vec3>   positions;
+  std::vector<glm::vec3>   normals;
+  std::vector<glm::vec2>   texcoords;
+  std::vector<ObjIndex>    corners;
+  std::vector<ObjRelative> relatives;
+
+  // offsets of the chunk in the merged arrays
+  size_t position_offset = 0;
+  size_t normal_offset   = 0;
+  size_t texcoord_offset = 0;
+  size_t corner_offset   = 0;
+
+  std::string error;
+};
+
+constexpr double kPowersOf10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool IsBlank(char c) { return c == ' ' || c == '\t'; }
+
+inline void SkipBlank(const char*& cursor, const char* end) {
+  while (cursor < end && IsBlank(*cursor)) {
+    cursor++;
+  }
+}
+
+inline bool ParseInt(const char*& cursor, const char* end, int64_t& value) {
+  bool negative = false;
+  if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+    negative = *cursor++ == '-';
+  }
+  if (cursor >= end || !IsDigit(*cursor)) {
+    return false;
+  }
+  int64_t result = 0;
+  while (cursor < end && IsDigit(*cursor)) {
+    result = result * 10 + (*cursor++ - '0');
+  }
+  value = negative ? -result : result;
+  return true;
+}
+
+// obj indices are 1 based, negative ones count back from the last attribute read so far
+inline bool ResolveIndex(
+    int64_t raw, size_t local_count, int32_t& index, uint8_t bit, uint8_t& relative) {
+  if (raw > 0) {
+    index = static_cast<int32_t>(raw - 1);
+    return true;
+  }
+  if (raw < 0) {
+    index = static_cast<int32_t>(static_cast<int64_t>(local_count) + raw);
+    relative |= bit;
+    return true;
+  }
+  return false;
+}
+
+// face is scratch space reused across lines
+bool ParseFace(
+    const char*& cursor, const char* end, ObjChunk& chunk, std::vector<ObjFaceCorner>& face) {
+  face.clear();
+  while (true) {
+    SkipBlank(cursor, end);
+    if (cursor >= end || *cursor == '\n' || *cursor == '\r' || *cursor == '#') {
+      break;
+    }
+    ObjIndex index;
+    uint8_t  relative = 0;
+    int64_t  raw      = 0;
+    if (!ParseInt(cursor, end, raw) ||
+        !ResolveIndex(raw, chunk.positions.size(), index.position, kRelativePosition, relative)) {
+      return false;
+    }
+    if (cursor < end && *cursor == '/') {
+      cursor++;
+      // v//vn has no texcoord
+      if (cursor < end && *cursor != '/') {
+        if (!ParseInt(cursor, end, raw) ||
+            !ResolveIndex(
+                raw, chunk.texcoords.size(), index.texcoord, kRelativeTexcoord, relative)) {
+          return false;
+        }
+      }
+      if (cursor < end && *cursor == '/') {
+        cursor++;
+        if (!ParseInt(cursor, end, raw) ||
+            !ResolveIndex(raw, chunk.normals.size(), index.normal, kRelativeNormal, relative)) {
+          return false;
+        }
+      }
+    }
+    face.push_back({index, relative});
+  }
+  if (face.size() < 3) {
+    return false;
+  }
+
+  for (size_t i = 1; i + 1 < face.size(); i++) {
+    for (const size_t corner : {size_t(0), i, i + 1}) {
+      if (face[corner].relative) {
+        chunk.relatives.push_back(
+            {static_cast<uint32_t>(chunk.corners.size()), face[corner].relative});
+      }
+      chunk.corners.push_back(face[corner].index);
+    }
+  }
+  return true;
+}
+
+template <int N>
+bool ParseVector(const char*& cursor, const char* end, float (&values)[N]) {
+  for (int i = 0; i < N; i++) {
+    if (!ObjParser::ParseFloat(cursor, end, values[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ParseChunk(ObjChunk& chunk) {
+  // a rough guess from the byte count saves most reallocations
+  const size_t estimate = static_cast<size_t>(chunk.end - chunk.begin) / 40;
+  chunk.positions.reserve(estimate / 2);
+  chunk.corners.reserve(estimate);
+
+  std::vector<ObjFaceCorner> face;
+  const char*                cursor = chunk.begin;
+  const char*                end    = chunk.end;
+  while (cursor < end) {
+    const char* line = cursor;
+    SkipBlank(cursor, end);
+    bool ok = true;
+    if (end - cursor >= 2 && cursor[0] == 'v' && IsBlank(cursor[1])) {
+      float xyz[3];
+      cursor += 2;
+      if ((ok = ParseVector(cursor, end, xyz))) {
+        chunk.positions.emplace_back(xyz[0], xyz[1], xyz[2]);
+      }
+    } else if (end - cursor >= 3 && cursor[0] == 'v' && cursor[1] == 'n' && IsBlank(cursor[2])) {
+      float xyz[3];
+      cursor += 3;
+      if ((ok = ParseVector(cursor, end, xyz))) {
+        chunk.normals.emplace_back(xyz[0], xyz[1], xyz[2]);
+      }
+    } else if (end - cursor >= 3 && cursor[0] == 'v' && cursor[1] == 't' && IsBlank(cursor[2])) {
+      // an optional w is skipped with the rest of the line
+      float uv[2];
+      cursor += 3;
+      if ((ok = ParseVector(cursor, end, uv))) {
+        chunk.texcoords.emplace_back(uv[0], uv[1]);
+      }
+    } else if (end - cursor >= 2 && cursor[0] == 'f' && IsBlank(cursor[1])) {
+      cursor += 2;
+      ok = ParseFace(cursor, end, chunk, face);
+    }
+    if (!ok) {
+      const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+      chunk.error          = fmt::format(
+          "malformed line \"{}\"", std::string(line, line_end ? line_end - line : end - line));
+      return;
+    }
+
+    const char* next = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+    cursor           = next ? next + 1 : end;
+  }
+}
+
+}  // namespace
+
+bool ObjParser::ParseFloat(const char*& cursor, const char* end, float& value) {
+  SkipBlank(cursor, end);
+  bool negative = false;
+  if (cursor < end && (*cursor == '-' || *cursor == '+')) {
+    negative = *cursor++ == '-';
+  }
+
+  // 19 decimal digits always fit in 64 bits, further digits only move the exponent
+  constexpr uint64_t kMantissaLimit = 1000000000000000000ull;
+  uint64_t           mantissa       = 0;
+  int32_t            exponent       = 0;
+  bool               any_digit      = false;
+  while (cursor < end && IsDigit(*cursor)) {
+    if (mantissa < kMantissaLimit) {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+    } else {
+      exponent++;
+    }
+    any_digit = true;
+    cursor++;
+  }
+  if (cursor < end && *cursor == '.') {
+    cursor++;
+    while (cursor < end && IsDigit(*cursor)) {
+      if (mantissa < kMantissaLimit) {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*cursor - '0');
+        exponent--;
+      }
+      any_digit = true;
+      cursor++;
+    }
+  }
+  if (!any_digit) {
+    return false;
+  }
+  if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+    int64_t power = 0;
+    cursor++;
+    if (!ParseInt(cursor, end, power)) {
+      return false;
+    }
+    exponent += static_cast<int32_t>(std::clamp<int64_t>(power, -400, 400));
+  }
+
+  // exact powers of ten keep the result within one rounding of the decimal value
+  double result = static_cast<double>(mantissa);
+  if (exponent < 0 && exponent >= -22) {
+    result /= kPowersOf10[-exponent];
+  } else if (exponent > 0 && exponent <= 22) {
+    result *= kPowersOf10[exponent];
+  } else if (exponent != 0) {
+    result *= std::pow(10.0, exponent);
+  }
+  value = static_cast<float>(negative ? -result : result);
+  return true;
+}
+
+bool ObjParser::Parse(const std::string& file, ObjMeshData& mesh, std::string& error) {
+  MappedFile mapped;
+  if (!mapped.Open(file)) {
+    error = fmt::format("can not open {}", file);
+    return false;
+  }
+  return ParseBuffer(mapped.Data(), mapped.Size(), mesh, error);
+}
+
+bool ObjParser::ParseBuffer(const char* data, size_t size, ObjMeshData& mesh, std::string& error) {
+  return ParseWindow(data, size, ObjWindow{}, mesh, error);
+}
+
+bool ObjParser::ParseWindow(
+    const char*      data,
+    size_t           size,
+    const ObjWindow& window,
+    ObjMeshData&     mesh,
+    std::string&     error) {
+  using Clock = std::chrono::steady_clock;
+
+  const auto start  = Clock::now();
+  statistics_       = ObjParseStatistics{};
+  statistics_.bytes = size;
+
+  // cut at the first newline after every target boundary, so each chunk holds whole lines
+  const uint32_t workers = pool_ ? pool_->ThreadCount() + 1 : 1;
+  const size_t   chunk_count =
+      std::max<size_t>(1, std::min<size_t>(workers * 4, size / kMinChunkSize));
+
+  std::vector<ObjChunk> chunks(chunk_count);
+  const char*           cursor = data;
+  for (size_t i = 0; i < chunk_count; i++) {
+    const char* target = data + size * (i + 1) / chunk_count;
+    const char* end    = data + size;
+    if (i + 1 < chunk_count && target > cursor) {
+      const char* newline = static_cast<const char*>(std::memchr(target, '\n', end - target));
+      end                 = newline ? newline + 1 : end;
+    }
+    chunks[i].begin = cursor;
+    chunks[i].end   = std::max(cursor, end);
+    cursor          = chunks[i].end;
+  }
+
+  const auto run = [this](uint32_t count, const std::function<void(uint32_t)>& task) {
+    if (pool_) {
+      pool_->ParallelFor(count, task);
+    } else {
+      for (uint32_t i = 0; i < count; i++) {
+        task(i);
+      }
+    }
+  };
+  run(static_cast<uint32_t>(chunk_count), [&chunks](uint32_t i) { ParseChunk(chunks[i]); });
+  const auto parsed = Clock::now();
+
+  // prefix sums give every chunk its place in the merged arrays
+  size_t position_count = 0;
+  size_t normal_count   = 0;
+  size_t texcoord_count = 0;
+  size_t corner_count   = 0;
+  for (auto& chunk : chunks) {
+    if (!chunk.error.empty()) {
+      error = chunk.error;
+      return false;
+    }
+    chunk.position_offset = position_count;
+    chunk.normal_offset   = normal_count;
+    chunk.texcoord_offset = texcoord_count;
+    chunk.corner_offset   = corner_count;
+    position_count += chunk.positions.size();
+    normal_count += chunk.normals.size();
+    texcoord_count += chunk.texcoords.size();
+    corner_count += chunk.corners.size();
+  }
+  mesh.positions.resize(position_count);
+  mesh.normals.resize(normal_count);
+  mesh.texcoords.resize(texcoord_count);
+  mesh.corners.resize(corner_count);
+  const size_t position_limit =
+      window.position_total ? window.position_total : window.position_offset + position_count;
+  const size_t normal_limit =
+      window.normal_total ? window.normal_total : window.normal_offset + normal_count;
+  const size_t texcoord_limit =
+      window.texcoord_total ? window.texcoord_total : window.texcoord_offset + texcoord_count;
+
+  std::vector<char> out_of_range(chunk_count, 0);
+  run(static_cast<uint32_t>(chunk_count), [&](uint32_t i) {
+    auto& chunk = chunks[i];
+    std::copy(
+        chunk.positions.begin(),
+        chunk.positions.end(),
+        mesh.positions.begin() + chunk.position_offset);
+    std::copy(
+        chunk.normals.begin(), chunk.normals.end(), mesh.normals.begin() + chunk.normal_offset);
+    std::copy(
+        chunk.texcoords.begin(),
+        chunk.texcoords.end(),
+        mesh.texcoords.begin() + chunk.texcoord_offset);
+
+    auto* corners = mesh.corners.data() + chunk.corner_offset;
+    std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+    for (const auto& relative : chunk.relatives) {
+      auto& corner = corners[relative.corner];
+      if (relative.components & kRelativePosition) {
+        corner.position += static_cast<int32_t>(window.position_offset + chunk.position_offset);
+      }
+      if (relative.components & kRelativeTexcoord) {
+        corner.texcoord += static_cast<int32_t>(window.texcoord_offset + chunk.texcoord_offset);
+      }
+      if (relative.components & kRelativeNormal) {
+        corner.normal += static_cast<int32_t>(window.normal_offset + chunk.normal_offset);
+      }
+    }
+    for (size_t c = 0; c < chunk.corners.size(); c++) {
+      const auto& corner = corners[c];
+      if (corner.position < 0 || static_cast<size_t>(corner.position) >= position_limit ||
+          corner.texcoord >= static_cast<int64_t>(texcoord_limit) ||
+          corner.normal >= static_cast<int64_t>(normal_limit) || corner.texcoord < -1 ||
+          corner.normal < -1) {
+        out_of_range[i] = 1;
+        return;
+      }
+    }
+    // chunk memory is released early, the merged arrays can be as large as the chunks
+    chunk = ObjChunk{};
+  });
+  if (std::find(out_of_range.begin(), out_of_range.end(), 1) != out_of_range.end()) {
+    error = "face index out of range";
+    return false;
+  }
+
+  const auto merged       = Clock::now();
+  statistics_.chunk_count = static_cast<uint32_t>(chunk_count);
+  statistics_.parse_ms    = std::chrono::duration<double, std::milli>(parsed - start).count();
+  statistics_.merge_ms    = std::chrono::duration<double, std::milli>(merged - parsed).count();
+  return true;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+namespace vkengine {
+
+class ThreadPool;
+
+// attribute indices of one triangle corner, 0 based, -1 when the face omits the attribute
+struct ObjIndex {
+  int32_t position = -1;
+  int32_t texcoord = -1;
+  int32_t normal   = -1;
+};
+
+struct ObjMeshData {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texcoords;
+  // three corners per triangle, polygons are fan triangulated
+  std::vector<ObjIndex> corners;
+};
+
+// a line aligned window of a file too large to parse at once. relative indices of its faces
+// count back from the attributes in front of the window, faces may reference attributes up to
+// the totals of the whole file, 0 limits them to the attributes read up to the end of the window
+struct ObjWindow {
+  size_t position_offset = 0;
+  size_t normal_offset   = 0;
+  size_t texcoord_offset = 0;
+  size_t position_total  = 0;
+  size_t normal_total    = 0;
+  size_t texcoord_total  = 0;
+};
+
+struct ObjParseStatistics {
+  size_t   bytes       = 0;
+  uint32_t chunk_count = 0;
+  double   parse_ms    = 0.0;
+  double   merge_ms    = 0.0;
+};
+
+// v, vt, vn and f records of a wavefront obj, everything else (groups, materials, smoothing) is
+// skipped. the file is memory mapped and cut into line aligned chunks that are parsed in
+// parallel, the per chunk attribute arrays are then concatenated at their prefix sum offsets
+class ObjParser {
+ public:
+  // chunks smaller than this are not worth a task
+  static constexpr size_t kMinChunkSize = 1 << 20;
+
+  // single threaded without a pool
+  explicit ObjParser(ThreadPool* pool = nullptr) : pool_(pool) {}
+  ~ObjParser() {}
+
+  // return false and set error if the file can not be read or is malformed
+  bool Parse(const std::string& file, ObjMeshData& mesh, std::string& error);
+  bool ParseBuffer(const char* data, size_t size, ObjMeshData& mesh, std::string& error);
+  // mesh receives the attributes of the window only, the corners index the whole file
+  bool ParseWindow(
+      const char*      data,
+      size_t           size,
+      const ObjWindow& window,
+      ObjMeshData&     mesh,
+      std::string&     error);
+
+  const ObjParseStatistics& GetStatistics() const { return statistics_; }
+
+  // decimal float with optional sign, fraction and exponent, cursor ends after the number
+  static bool ParseFloat(const char*& cursor, const char* end, float& value);
+
+ private:
+  ThreadPool*        pool_ = nullptr;
+  ObjParseStatistics statistics_;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,524 @@
+#include "function/render/mesh/obj_streamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "core/utils/hash.h"
+#include "core/utils/mapped_file.h"
+#include "fmt/format.h"
+
+namespace vkengine {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// the window text gets this share of the budget. parsing it holds up to kParseFactor times as
+// much, the shortest face records "f 1 2 3" turn into four times their size in corners, kept
+// twice while merging. the triangle buckets get what is left next to the parse and the grid
+constexpr size_t kWindowShare   = 24;
+constexpr size_t kParseFactor   = 10;
+constexpr size_t kMinWindowSize = 1 << 16;
+// smallest allocation of a bucket, in corners
+constexpr size_t kMinBucketCorners = 3 * 64;
+// buckets are planned for this share of the chunk size, the estimate from the positions is rough
+// and a bucket over the largest chunk is cut into octants
+constexpr double kBucketFill = 0.75;
+// octant cuts of one bucket before the rest is cut in file order
+constexpr uint32_t kMaxSplitDepth = 16;
+// the first pass does not check indices, the attributes behind a window are not known yet
+constexpr size_t kUncheckedTotal = size_t(1) << 32;
+constexpr size_t kTriangleBytes  = sizeof(VulkanVertexData) * 3;
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+template <typename T>
+size_t CapacityBytes(const std::vector<T>& values) {
+  return sizeof(T) * values.capacity();
+}
+
+size_t MeshBytes(const ObjMeshData& mesh) {
+  return CapacityBytes(mesh.positions) + CapacityBytes(mesh.normals) +
+         CapacityBytes(mesh.texcoords) + CapacityBytes(mesh.corners);
+}
+
+template <typename T>
+bool WriteValues(std::ofstream& out, const std::vector<T>& values) {
+  out.write(reinterpret_cast<const char*>(values.data()), sizeof(T) * values.size());
+  return static_cast<bool>(out);
+}
+
+bool ReadTriangles(
+    const std::string& file, size_t first, size_t count, std::vector<VulkanVertexData>& corners) {
+  std::ifstream in(file, std::ios::binary);
+  corners.resize(count * 3);
+  in.seekg(static_cast<std::streamoff>(first * kTriangleBytes));
+  in.read(
+      reinterpret_cast<char*>(corners.data()),
+      static_cast<std::streamsize>(kTriangleBytes * count));
+  return static_cast<bool>(in);
+}
+
+glm::vec3 Centroid(const VulkanVertexData* triangle) {
+  return (triangle[0].position + triangle[1].position + triangle[2].position) / 3.0f;
+}
+
+// line aligned windows of about window_size bytes, a line longer than that widens its window
+class WindowReader {
+ public:
+  bool Open(const std::string& file, size_t window_size) {
+    stream_.open(file, std::ios::binary);
+    buffer_.resize(window_size);
+    return static_cast<bool>(stream_);
+  }
+
+  // false at the end of the file
+  bool Next() {
+    // the partial line behind the last window starts this one
+    const size_t carry = used_ - length_;
+    std::memmove(buffer_.data(), buffer_.data() + length_, carry);
+    used_   = carry;
+    length_ = 0;
+    while (true) {
+      stream_.read(buffer_.data() + used_, static_cast<std::streamsize>(buffer_.size() - used_));
+      used_ += static_cast<size_t>(stream_.gcount());
+      if (used_ < buffer_.size()) {
+        length_ = used_;
+        return length_ > 0;
+      }
+      for (size_t i = used_; i > 0; i--) {
+        if (buffer_[i - 1] == '\n') {
+          length_ = i;
+          return true;
+        }
+      }
+      buffer_.resize(buffer_.size() * 2);
+    }
+  }
+
+  const char* Data() const { return buffer_.data(); }
+  size_t      Size() const { return length_; }
+  size_t      Bytes() const { return CapacityBytes(buffer_); }
+
+ private:
+  std::ifstream     stream_;
+  std::vector<char> buffer_;
+  size_t            used_   = 0;
+  size_t            length_ = 0;
+};
+
+// 64^3 cells over the bounds of the positions, numbered along a morton curve so that runs of
+// consecutive cells stay spatially compact
+class MortonGrid {
+ public:
+  static constexpr uint32_t kBits      = 6;
+  static constexpr uint32_t kCellCount = 1 << (3 * kBits);
+
+  explicit MortonGrid(const AxisAlignedBox& box) : origin_(box.min_corner) {
+    for (int i = 0; i < 3; i++) {
+      const float size = box.max_corner[i] - box.min_corner[i];
+      scale_[i]        = size > 0.0f ? float(1 << kBits) / size : 0.0f;
+    }
+  }
+
+  uint32_t Cell(const glm::vec3& point) const {
+    constexpr float kMaxCoordinate = float((1 << kBits) - 1);
+    uint32_t        cell           = 0;
+    for (int i = 0; i < 3; i++) {
+      // nan lands in cell 0
+      const float coordinate = (point[i] - origin_[i]) * scale_[i];
+      const auto  c =
+          static_cast<uint32_t>(coordinate >= 0.0f ? std::min(coordinate, kMaxCoordinate) : 0.0f);
+      for (uint32_t b = 0; b < kBits; b++) {
+        cell |= ((c >> b) & 1u) << (3 * b + i);
+      }
+    }
+    return cell;
+  }
+
+ private:
+  glm::vec3 origin_;
+  float     scale_[3] = {};
+};
+
+// triangles per bucket in memory, appended to one scratch file per bucket whenever all buckets
+// together outgrow budget. the centroid bounds of every bucket are kept for cutting it later
+class TriangleBuckets {
+ public:
+  TriangleBuckets(std::vector<std::string> files, size_t budget)
+      : files_(std::move(files)),
+        buckets_(files_.size()),
+        counts_(files_.size(), 0),
+        boxes_(files_.size()),
+        budget_(budget) {}
+
+  bool Append(uint32_t bucket, const VulkanVertexData* triangle) {
+    auto& values = buckets_[bucket];
+    // grown here rather than by insert, so the growth is known before it is allocated
+    if (values.size() + 3 > values.capacity()) {
+      if (bytes_ + sizeof(VulkanVertexData) * Grown(values) > budget_ && !Flush()) {
+        return false;
+      }
+      const size_t growth = Grown(values);
+      values.reserve(values.capacity() + growth);
+      bytes_ += sizeof(VulkanVertexData) * growth;
+      peak_bytes_ = std::max(peak_bytes_, bytes_);
+    }
+    values.insert(values.end(), triangle, triangle + 3);
+    counts_[bucket]++;
+    boxes_[bucket].Merge(Centroid(triangle));
+    return true;
+  }
+
+  // write and release every bucket
+  bool Flush() {
+    for (size_t b = 0; b < buckets_.size(); b++) {
+      if (buckets_[b].empty()) {
+        continue;
+      }
+      std::ofstream out(files_[b], std::ios::binary | std::ios::app);
+      if (!WriteValues(out, buckets_[b])) {
+        return false;
+      }
+      std::vector<VulkanVertexData>().swap(buckets_[b]);
+    }
+    bytes_ = 0;
+    flush_count_++;
+    return true;
+  }
+
+  const std::string&    GetFile(size_t bucket) const { return files_[bucket]; }
+  size_t                GetCount(size_t bucket) const { return counts_[bucket]; }
+  const AxisAlignedBox& GetBox(size_t bucket) const { return boxes_[bucket]; }
+  size_t                GetPeakBytes() const { return peak_bytes_; }
+  uint32_t              GetFlushCount() const { return flush_count_; }
+
+ private:
+  // corners a full bucket grows by
+  static size_t Grown(const std::vector<VulkanVertexData>& values) {
+    return std::max(kMinBucketCorners, values.capacity());
+  }
+
+  std::vector<std::string>                   files_;
+  std::vector<std::vector<VulkanVertexData>> buckets_;
+  std::vector<size_t>                        counts_;
+  std::vector<AxisAlignedBox>                boxes_;
+  size_t                                     budget_      = 0;
+  size_t                                     bytes_       = 0;
+  size_t                                     peak_bytes_  = 0;
+  uint32_t                                   flush_count_ = 0;
+};
+
+// a bucket on disk waiting for the consumer
+struct BucketFile {
+  std::string    file;
+  size_t         triangle_count = 0;
+  AxisAlignedBox box;
+  uint32_t       depth = 0;
+};
+
+// removes the scratch directory with everything left in it
+struct ScratchDirectory {
+  std::filesystem::path path;
+
+  ~ScratchDirectory() {
+    std::error_code error;
+    std::filesystem::remove_all(path, error);
+  }
+};
+}  // namespace
+
+void ExpandObjTriangle(
+    const ObjIndex*   corners,
+    const glm::vec3*  positions,
+    const glm::vec3*  normals,
+    const glm::vec2*  texcoords,
+    VulkanVertexData* vertices) {
+  bool with_normal   = true;
+  bool with_texcoord = true;
+  for (int c = 0; c < 3; c++) {
+    vertices[c]          = VulkanVertexData{};
+    vertices[c].position = positions[corners[c].position];
+    if (corners[c].normal >= 0) {
+      vertices[c].normal = normals[corners[c].normal];
+    } else {
+      with_normal = false;
+    }
+    if (corners[c].texcoord >= 0) {
+      vertices[c].texcoord = texcoords[corners[c].texcoord];
+    } else {
+      with_texcoord = false;
+    }
+  }
+
+  if (!with_normal) {
+    const VertexType v0     = vertices[1].position - vertices[0].position;
+    const VertexType v1     = vertices[2].position - vertices[1].position;
+    const VertexType normal = glm::normalize(glm::cross(v0, v1));
+    for (int c = 0; c < 3; c++) {
+      vertices[c].normal = normal;
+    }
+  }
+  if (!with_texcoord) {
+    for (int c = 0; c < 3; c++) {
+      vertices[c].texcoord = UvType(0.5f, 0.5f);
+    }
+  }
+}
+
+bool ObjStreamer::Stream(
+    const std::string&      file,
+    const ObjStreamOptions& options,
+    const ChunkConsumer&    consume,
+    std::string&            error) {
+  statistics_ = ObjStreamStatistics{};
+  const auto track = [this](size_t bytes) {
+    statistics_.peak_memory = std::max(statistics_.peak_memory, bytes);
+  };
+
+  const size_t budget      = options.memory_budget;
+  const size_t window_size = std::max(kMinWindowSize, budget / kWindowShare);
+  const size_t grid_bytes  = sizeof(uint32_t) * MortonGrid::kCellCount;
+
+  // the consumer may never get more, buckets over it are cut
+  const size_t max_chunk_triangles = budget / (kTriangleBytes + options.cook_bytes_per_triangle);
+  const size_t chunk_triangles     = std::min<size_t>(
+      options.chunk_triangle_count, static_cast<size_t>(max_chunk_triangles * kBucketFill));
+  if (chunk_triangles == 0 || budget <= window_size * kParseFactor + grid_bytes) {
+    error = fmt::format("memory budget of {} bytes is too small", budget);
+    return false;
+  }
+  const size_t bucket_budget = budget - window_size * kParseFactor - grid_bytes;
+
+  const uint64_t   key = HashBytes(file.data(), file.size());
+  ScratchDirectory scratch;
+  scratch.path =
+      std::filesystem::path(options.scratch_directory) /
+      fmt::format("{}-{:016x}.stream", std::filesystem::path(file).stem().string(), key);
+  std::error_code filesystem_error;
+  std::filesystem::remove_all(scratch.path, filesystem_error);
+  std::filesystem::create_directories(scratch.path, filesystem_error);
+  if (filesystem_error) {
+    error = fmt::format("can not create {}", scratch.path.string());
+    return false;
+  }
+  const std::string position_file = (scratch.path / "positions").string();
+  const std::string normal_file   = (scratch.path / "normals").string();
+  const std::string texcoord_file = (scratch.path / "texcoords").string();
+
+  ObjParser   parser(pool_);
+  ObjMeshData window_mesh;
+  ObjWindow   window;
+
+  // 1. attributes to the scratch files, bounds and triangle count
+  auto           start = Clock::now();
+  AxisAlignedBox box;
+  {
+    WindowReader  reader;
+    std::ofstream positions(position_file, std::ios::binary | std::ios::trunc);
+    std::ofstream normals(normal_file, std::ios::binary | std::ios::trunc);
+    std::ofstream texcoords(texcoord_file, std::ios::binary | std::ios::trunc);
+    if (!reader.Open(file, window_size)) {
+      error = fmt::format("can not open {}", file);
+      return false;
+    }
+    window.position_total = kUncheckedTotal;
+    window.normal_total   = kUncheckedTotal;
+    window.texcoord_total = kUncheckedTotal;
+    while (reader.Next()) {
+      // windows of vertices and windows of faces must not keep the capacity of each other
+      window_mesh = ObjMeshData{};
+      if (!parser.ParseWindow(reader.Data(), reader.Size(), window, window_mesh, error)) {
+        return false;
+      }
+      track(reader.Bytes() + 2 * MeshBytes(window_mesh));
+      if (!WriteValues(positions, window_mesh.positions) ||
+          !WriteValues(normals, window_mesh.normals) ||
+          !WriteValues(texcoords, window_mesh.texcoords)) {
+        error = fmt::format("can not write {}", scratch.path.string());
+        return false;
+      }
+      for (const auto& position : window_mesh.positions) {
+        box.Merge(position);
+      }
+      window.position_offset += window_mesh.positions.size();
+      window.normal_offset += window_mesh.normals.size();
+      window.texcoord_offset += window_mesh.texcoords.size();
+      statistics_.bytes += reader.Size();
+      statistics_.triangle_count += window_mesh.corners.size() / 3;
+      statistics_.window_count++;
+    }
+  }
+  // corners index the attributes with 32 bit signed integers
+  if (window.position_offset >= kUncheckedTotal / 2 ||
+      window.normal_offset >= kUncheckedTotal / 2 ||
+      window.texcoord_offset >= kUncheckedTotal / 2) {
+    error = fmt::format("{} has more attributes than 32 bit indices can address", file);
+    return false;
+  }
+  statistics_.position_count = window.position_offset;
+  statistics_.attribute_ms   = ElapsedMs(start);
+
+  // runs of morton cells become buckets of about chunk_triangles triangles, estimated from the
+  // positions in each cell
+  start = Clock::now();
+  MappedFile positions;
+  MappedFile normals;
+  MappedFile texcoords;
+  if (!positions.Open(position_file) || !normals.Open(normal_file) ||
+      !texcoords.Open(texcoord_file)) {
+    error = fmt::format("can not map {}", scratch.path.string());
+    return false;
+  }
+  const auto* position_data = reinterpret_cast<const glm::vec3*>(positions.Data());
+  const auto* normal_data   = reinterpret_cast<const glm::vec3*>(normals.Data());
+  const auto* texcoord_data = reinterpret_cast<const glm::vec2*>(texcoords.Data());
+
+  const MortonGrid      grid(box);
+  std::vector<uint32_t> cell_buckets(MortonGrid::kCellCount, 0);
+  for (size_t i = 0; i < statistics_.position_count; i++) {
+    cell_buckets[grid.Cell(position_data[i])]++;
+  }
+  const double triangles_per_position =
+      statistics_.position_count ? double(statistics_.triangle_count) / statistics_.position_count
+                                 : 0.0;
+  uint32_t bucket_count = 0;
+  double   filled       = 0.0;
+  for (auto& cell : cell_buckets) {
+    const double estimate = cell * triangles_per_position;
+    if (bucket_count == 0 || (filled > 0.0 && filled + estimate > chunk_triangles)) {
+      bucket_count++;
+      filled = 0.0;
+    }
+    filled += estimate;
+    cell = bucket_count - 1;
+  }
+  statistics_.bucket_count = bucket_count;
+
+  // 2. triangles to the bucket of their centroid
+  std::vector<std::string> bucket_files(bucket_count);
+  for (uint32_t b = 0; b < bucket_count; b++) {
+    bucket_files[b] = (scratch.path / fmt::format("bucket-{}", b)).string();
+  }
+  TriangleBuckets buckets(std::move(bucket_files), bucket_budget);
+  {
+    WindowReader reader;
+    if (!reader.Open(file, window_size)) {
+      error = fmt::format("can not open {}", file);
+      return false;
+    }
+    window                  = ObjWindow{};
+    window.position_total   = statistics_.position_count;
+    window.normal_total     = normals.Size() / sizeof(glm::vec3);
+    window.texcoord_total   = texcoords.Size() / sizeof(glm::vec2);
+    while (reader.Next()) {
+      // windows of vertices and windows of faces must not keep the capacity of each other
+      window_mesh = ObjMeshData{};
+      if (!parser.ParseWindow(reader.Data(), reader.Size(), window, window_mesh, error)) {
+        return false;
+      }
+      track(reader.Bytes() + 2 * MeshBytes(window_mesh) + grid_bytes + buckets.GetPeakBytes());
+      VulkanVertexData triangle[3];
+      for (size_t c = 0; c + 2 < window_mesh.corners.size(); c += 3) {
+        ExpandObjTriangle(
+            &window_mesh.corners[c], position_data, normal_data, texcoord_data, triangle);
+        if (!buckets.Append(cell_buckets[grid.Cell(Centroid(triangle))], triangle)) {
+          error = fmt::format("can not write {}", scratch.path.string());
+          return false;
+        }
+      }
+      window.position_offset += window_mesh.positions.size();
+      window.normal_offset += window_mesh.normals.size();
+      window.texcoord_offset += window_mesh.texcoords.size();
+    }
+    if (!buckets.Flush()) {
+      error = fmt::format("can not write {}", scratch.path.string());
+      return false;
+    }
+  }
+  window_mesh = ObjMeshData{};
+  std::vector<uint32_t>().swap(cell_buckets);
+  statistics_.flush_count = buckets.GetFlushCount();
+  statistics_.bucket_ms   = ElapsedMs(start);
+
+  // 3. buckets to the consumer in order, the children of a cut bucket take its place
+  start = Clock::now();
+  std::vector<BucketFile> pending;
+  for (uint32_t b = bucket_count; b-- > 0;) {
+    if (buckets.GetCount(b) > 0) {
+      pending.push_back({buckets.GetFile(b), buckets.GetCount(b), buckets.GetBox(b), 0});
+    }
+  }
+  const size_t read_triangles = std::max<size_t>(1, window_size / kTriangleBytes);
+  std::vector<VulkanVertexData> corners;
+  while (!pending.empty()) {
+    const BucketFile bucket = std::move(pending.back());
+    pending.pop_back();
+
+    // a bucket of equal centroids can not be cut in space, it is cut in file order
+    const bool point = bucket.box.Extent() == glm::vec3(0.0f);
+    if (bucket.triangle_count <= max_chunk_triangles || bucket.depth >= kMaxSplitDepth ||
+        point) {
+      for (size_t first = 0; first < bucket.triangle_count; first += max_chunk_triangles) {
+        const size_t count = std::min(max_chunk_triangles, bucket.triangle_count - first);
+        if (!ReadTriangles(bucket.file, first, count, corners)) {
+          error = fmt::format("can not read {}", bucket.file);
+          return false;
+        }
+        track(CapacityBytes(corners));
+        consume(statistics_.chunk_count++, corners);
+      }
+      std::vector<VulkanVertexData>().swap(corners);
+    } else {
+      std::vector<std::string> child_files(8);
+      for (uint32_t child = 0; child < 8; child++) {
+        child_files[child] = fmt::format("{}-{}", bucket.file, child);
+      }
+      const glm::vec3 center = bucket.box.Center();
+      TriangleBuckets children(std::move(child_files), bucket_budget);
+      for (size_t first = 0; first < bucket.triangle_count; first += read_triangles) {
+        const size_t count = std::min(read_triangles, bucket.triangle_count - first);
+        if (!ReadTriangles(bucket.file, first, count, corners)) {
+          error = fmt::format("can not read {}", bucket.file);
+          return false;
+        }
+        for (size_t t = 0; t < count; t++) {
+          const glm::vec3 centroid = Centroid(&corners[t * 3]);
+          const uint32_t  child    = (centroid.x > center.x ? 1 : 0) |
+                                 (centroid.y > center.y ? 2 : 0) |
+                                 (centroid.z > center.z ? 4 : 0);
+          if (!children.Append(child, &corners[t * 3])) {
+            error = fmt::format("can not write {}", scratch.path.string());
+            return false;
+          }
+        }
+        track(CapacityBytes(corners) + children.GetPeakBytes());
+      }
+      std::vector<VulkanVertexData>().swap(corners);
+      if (!children.Flush()) {
+        error = fmt::format("can not write {}", scratch.path.string());
+        return false;
+      }
+      for (uint32_t child = 8; child-- > 0;) {
+        if (children.GetCount(child) > 0) {
+          pending.push_back(
+              {children.GetFile(child),
+               children.GetCount(child),
+               children.GetBox(child),
+               bucket.depth + 1});
+        }
+      }
+      statistics_.flush_count += children.GetFlushCount();
+      statistics_.split_count++;
+    }
+    std::filesystem::remove(bucket.file, filesystem_error);
+  }
+  statistics_.chunk_ms = ElapsedMs(start);
+  return true;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "function/render/mesh/mesh_cache.h"
+#include "function/render/mesh/obj_parser.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+struct ObjStreamOptions {
+  // ceiling of the heap memory held at once: the text window with its parsed records, the
+  // triangle buckets and the chunk handed to the consumer together with its cooking. the
+  // attribute scratch files are mapped read only, their pages are file backed and dropped by
+  // the os under pressure
+  size_t memory_budget = size_t(1) << 30;
+  // triangles a grid cell is sized for, lowered when a chunk that large does not fit the budget
+  uint32_t chunk_triangle_count = 1 << 18;
+  // heap bytes the consumer needs per chunk triangle on top of the corners it is given
+  size_t cook_bytes_per_triangle = 1024;
+  // scratch files live in a subdirectory removed when the import ends. not the temp directory,
+  // that is often in memory
+  std::string scratch_directory = kMeshCacheDirectory;
+};
+
+struct ObjStreamStatistics {
+  size_t   bytes          = 0;
+  uint32_t window_count   = 0;
+  size_t   position_count = 0;
+  size_t   triangle_count = 0;
+  uint32_t bucket_count   = 0;
+  uint32_t chunk_count    = 0;
+  // buckets over the budget cut again into octants
+  uint32_t split_count = 0;
+  // writes of the triangle buckets to their scratch files
+  uint32_t flush_count = 0;
+  // heap bytes of the streamer itself, the consumer is not counted
+  size_t peak_memory  = 0;
+  double attribute_ms = 0.0;
+  double bucket_ms    = 0.0;
+  // including the consumer
+  double chunk_ms = 0.0;
+};
+
+// out of core import of wavefront obj files larger than memory, in three passes over bounded
+// windows of the file:
+//   1. parse every window, append its attributes to scratch files and count the triangles
+//   2. cut a morton curve over the bounds into runs holding about a chunk of positions each,
+//      parse the windows again and append every triangle to the bucket of the run holding its
+//      centroid. the buckets are written to one scratch file each whenever they outgrow their
+//      share of the budget
+//   3. hand every bucket to the consumer, buckets too large for the budget are cut into octants
+//      of their centroid bounds first
+// chunks are numbered in curve order and cut by the budget only, so the result does not depend
+// on the pool
+class ObjStreamer {
+ public:
+  // three corners per triangle of one chunk, tangents are left 0. the consumer may take them
+  using ChunkConsumer =
+      std::function<void(uint32_t chunk, std::vector<VulkanVertexData>& corners)>;
+
+  // single threaded without a pool
+  explicit ObjStreamer(ThreadPool* pool = nullptr) : pool_(pool) {}
+  ~ObjStreamer() {}
+
+  // return false and set error if the file can not be read, is malformed or the scratch files
+  // can not be written
+  bool Stream(
+      const std::string&      file,
+      const ObjStreamOptions& options,
+      const ChunkConsumer&    consume,
+      std::string&            error);
+
+  const ObjStreamStatistics& GetStatistics() const { return statistics_; }
+
+ private:
+  ThreadPool*         pool_ = nullptr;
+  ObjStreamStatistics statistics_;
+};
+
+// the three corners of the triangle at corners as vertices without tangents. a face without
+// normals gets its flat normal, one without texcoords the center of the texture
+void ExpandObjTriangle(
+    const ObjIndex*   corners,
+    const glm::vec3*  positions,
+    const glm::vec3*  normals,
+    const glm::vec2*  texcoords,
+    VulkanVertexData* vertices);
+
+}  // namespace vkengine
@@ -0,0 +1,195 @@
+#include "function/render/mesh/tangent_generator.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+
+#include "core/utils/thread_pool.h"
+#include "function/render/mesh/mesh_optimizer.h"
+
+namespace vkengine {
+
+namespace {
+// faces or vertices per task, fixed so the split of the work does not depend on the pool
+constexpr size_t kChunkSize = 1 << 14;
+// squared length below which a projected or accumulated tangent has no direction
+constexpr float    kMinTangentLength2 = 1e-20f;
+constexpr uint32_t kNotSplit          = UINT32_MAX;
+
+void RunChunks(ThreadPool* pool, size_t count, const std::function<void(size_t, size_t)>& task) {
+  const auto chunk_count = static_cast<uint32_t>((count + kChunkSize - 1) / kChunkSize);
+  const auto run_chunk   = [&](uint32_t chunk) {
+    const size_t begin = chunk * kChunkSize;
+    task(begin, std::min(count, begin + kChunkSize));
+  };
+  if (pool) {
+    pool->ParallelFor(chunk_count, run_chunk);
+  } else {
+    for (uint32_t chunk = 0; chunk < chunk_count; chunk++) {
+      run_chunk(chunk);
+    }
+  }
+}
+
+// unit tangent in the plane of normal, any direction of that plane when sum has none in it
+glm::vec3 Orthogonalize(const glm::vec3& sum, const glm::vec3& normal) {
+  const glm::vec3 tangent = sum - normal * glm::dot(normal, sum);
+  const float     length2 = glm::dot(tangent, tangent);
+  if (length2 > kMinTangentLength2) {
+    return tangent / std::sqrt(length2);
+  }
+  const glm::vec3 axis = std::fabs(normal.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+  return glm::normalize(axis - normal * glm::dot(normal, axis));
+}
+}  // namespace
+
+TangentStatistics GenerateTangents(
+    std::vector<VulkanVertexData>& vertices, std::vector<uint32_t>& indices, ThreadPool* pool) {
+  const size_t vertex_count = vertices.size();
+  const size_t face_count   = indices.size() / 3;
+
+  TangentStatistics statistics;
+  statistics.vertex_count = vertex_count;
+  if (face_count == 0) {
+    return statistics;
+  }
+
+  // structure of arrays, the face loop gathers single floats and the corner results are
+  // written as contiguous streams
+  std::vector<float> px(vertex_count), py(vertex_count), pz(vertex_count);
+  std::vector<float> nx(vertex_count), ny(vertex_count), nz(vertex_count);
+  std::vector<float> u(vertex_count), v(vertex_count);
+  RunChunks(pool, vertex_count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const auto& vertex = vertices[i];
+      px[i]              = vertex.position.x;
+      py[i]              = vertex.position.y;
+      pz[i]              = vertex.position.z;
+      nx[i]              = vertex.normal.x;
+      ny[i]              = vertex.normal.y;
+      nz[i]              = vertex.normal.z;
+      u[i]               = vertex.texcoord.x;
+      v[i]               = vertex.texcoord.y;
+    }
+  });
+
+  // per corner the face tangent in the plane of the corner normal, scaled by the corner angle.
+  // face_sign is the handedness, 0 for faces without uv area
+  std::vector<float>  tx(indices.size()), ty(indices.size()), tz(indices.size());
+  std::vector<int8_t> face_sign(face_count);
+  RunChunks(pool, face_count, [&](size_t begin, size_t end) {
+    for (size_t f = begin; f < end; f++) {
+      const uint32_t* corner = &indices[f * 3];
+      glm::vec3       p[3];
+      for (int c = 0; c < 3; c++) {
+        p[c] = glm::vec3(px[corner[c]], py[corner[c]], pz[corner[c]]);
+      }
+      const float du1  = u[corner[1]] - u[corner[0]];
+      const float dv1  = v[corner[1]] - v[corner[0]];
+      const float du2  = u[corner[2]] - u[corner[0]];
+      const float dv2  = v[corner[2]] - v[corner[0]];
+      const float area = du1 * dv2 - du2 * dv1;
+      if (!(std::fabs(area) > FLT_MIN)) {
+        face_sign[f] = 0;
+        continue;
+      }
+      face_sign[f] = area > 0.0f ? 1 : -1;
+
+      // dP/du up to the positive factor 1 / |area|
+      const glm::vec3 edge1 = p[1] - p[0];
+      const glm::vec3 edge2 = p[2] - p[0];
+      const glm::vec3 face_tangent =
+          (edge1 * dv2 - edge2 * dv1) * static_cast<float>(face_sign[f]);
+      for (int c = 0; c < 3; c++) {
+        const size_t    i = f * 3 + c;
+        const glm::vec3 normal(nx[corner[c]], ny[corner[c]], nz[corner[c]]);
+        glm::vec3       tangent = face_tangent - normal * glm::dot(normal, face_tangent);
+        glm::vec3       a       = p[(c + 1) % 3] - p[c];
+        glm::vec3       b       = p[(c + 2) % 3] - p[c];
+        a -= normal * glm::dot(normal, a);
+        b -= normal * glm::dot(normal, b);
+
+        const float tangent_length2 = glm::dot(tangent, tangent);
+        const float edge_length2    = glm::dot(a, a) * glm::dot(b, b);
+        float       weight          = 0.0f;
+        if (tangent_length2 > kMinTangentLength2 && edge_length2 > 0.0f) {
+          const float cosine = glm::dot(a, b) / std::sqrt(edge_length2);
+          weight = std::acos(std::clamp(cosine, -1.0f, 1.0f)) / std::sqrt(tangent_length2);
+        }
+        tangent *= weight;
+        tx[i] = tangent.x;
+        ty[i] = tangent.y;
+        tz[i] = tangent.z;
+      }
+    }
+  });
+
+  // every vertex sums its corners per handedness in adjacency order. a vertex takes the side
+  // with more faces, ties keep the right handed one, the other side is split off below
+  const TriangleAdjacency adjacency(indices.data(), indices.size(), vertex_count);
+  std::vector<glm::vec3>  minority(vertex_count);
+  std::vector<int8_t>     vertex_sign(vertex_count);
+  std::vector<uint8_t>    mixed(vertex_count);
+  RunChunks(pool, vertex_count, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      glm::vec3 sums[2]   = {glm::vec3(0.0f), glm::vec3(0.0f)};
+      uint32_t  counts[2] = {0, 0};
+      for (uint32_t k = adjacency.offsets[i]; k < adjacency.offsets[i + 1]; k++) {
+        const uint32_t f = adjacency.triangles[k];
+        // a face listing the vertex twice is adjacent twice in a row
+        if (face_sign[f] == 0 || (k > adjacency.offsets[i] && adjacency.triangles[k - 1] == f)) {
+          continue;
+        }
+        const int side = face_sign[f] > 0 ? 0 : 1;
+        for (uint32_t c = f * 3; c < f * 3 + 3; c++) {
+          if (indices[c] == i) {
+            sums[side] += glm::vec3(tx[c], ty[c], tz[c]);
+          }
+        }
+        counts[side]++;
+      }
+      const int major  = counts[1] > counts[0] ? 1 : 0;
+      auto&     vertex = vertices[i];
+      vertex_sign[i]   = major == 0 ? 1 : -1;
+      vertex.tangent   = glm::vec4(
+          Orthogonalize(sums[major], vertex.normal), static_cast<float>(vertex_sign[i]));
+      mixed[i]         = counts[0] > 0 && counts[1] > 0;
+      if (mixed[i]) {
+        minority[i] = Orthogonalize(sums[1 - major], vertex.normal);
+      }
+    }
+  });
+
+  // in vertex order, so the new indices do not depend on the pool either
+  std::vector<uint32_t> split(vertex_count, kNotSplit);
+  for (size_t i = 0; i < vertex_count; i++) {
+    if (!mixed[i]) {
+      continue;
+    }
+    split[i]       = static_cast<uint32_t>(vertices.size());
+    auto vertex    = vertices[i];
+    vertex.tangent = glm::vec4(minority[i], -vertex.tangent.w);
+    vertices.push_back(vertex);
+    statistics.split_count++;
+  }
+  for (size_t f = 0; f < face_count; f++) {
+    statistics.degenerate_count += face_sign[f] == 0;
+  }
+  if (statistics.split_count > 0) {
+    RunChunks(pool, face_count, [&](size_t begin, size_t end) {
+      for (size_t f = begin; f < end; f++) {
+        for (size_t c = f * 3; c < f * 3 + 3; c++) {
+          const uint32_t i = indices[c];
+          if (split[i] != kNotSplit && face_sign[f] != 0 && face_sign[f] != vertex_sign[i]) {
+            indices[c] = split[i];
+          }
+        }
+      }
+    });
+  }
+  statistics.vertex_count = vertices.size();
+  return statistics;
+}
+
+}  // namespace vkengine
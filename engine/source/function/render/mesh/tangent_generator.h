@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+struct TangentStatistics {
+  size_t vertex_count = 0;
+  // vertices shared by faces of both handedness, duplicated so each side keeps its own frame
+  size_t split_count = 0;
+  // faces without uv area, they do not contribute and their vertices may fall back to any
+  // tangent perpendicular to the normal
+  size_t degenerate_count = 0;
+};
+
+// per vertex tangent frames in the spirit of MikkTSpace, run on a welded mesh whose tangents
+// are not part of the weld. every face tangent is the direction of increasing u, it is
+// projected into the tangent plane of each corner normal and accumulated weighted by the
+// corner angle, then orthogonalized against the normal. tangent.w is the handedness of the
+// bitangent, cross(normal, tangent) * w, taken from the sign of the uv area. vertices shared by
+// mirrored faces are split and the indices of the minority side are remapped.
+// faces and vertices are processed in fixed size chunks on pool (serially when null), every
+// sum runs in adjacency order, so the result is bit identical for any thread count
+TangentStatistics GenerateTangents(
+    std::vector<VulkanVertexData>& vertices, std::vector<uint32_t>& indices, ThreadPool* pool);
+
+}  // namespace vkengine
@@ -0,0 +1,206 @@
+#include "function/render/mesh/vertex_packing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vkengine {
+
+namespace {
+constexpr float kUnorm16 = 65535.0f;
+constexpr float kSnorm16 = 32767.0f;
+
+float SignNotZero(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+int16_t ToSnorm16(float value) {
+  return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * kSnorm16));
+}
+
+float FromSnorm16(int16_t value) { return std::max(value / kSnorm16, -1.0f); }
+
+float AngleDegrees(const glm::vec3& a, const glm::vec3& b) {
+  const float length = std::sqrt(glm::dot(a, a) * glm::dot(b, b));
+  if (length == 0.0f) {
+    return 0.0f;
+  }
+  return std::acos(std::clamp(glm::dot(a, b) / length, -1.0f, 1.0f)) * 57.2957795f;
+}
+}  // namespace
+
+uint16_t FloatToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const uint32_t sign     = (bits >> 16) & 0x8000u;
+  const uint32_t exponent = (bits >> 23) & 0xffu;
+  uint32_t       mantissa = bits & 0x7fffffu;
+
+  if (exponent == 0xffu) {
+    // inf stays inf, nan keeps a mantissa bit
+    return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+  }
+  const int32_t half_exponent = static_cast<int32_t>(exponent) - 127 + 15;
+  if (half_exponent >= 31) {
+    return static_cast<uint16_t>(sign | 0x7c00u);
+  }
+  if (half_exponent <= 0) {
+    // subnormal half or zero, shift the implicit bit in and round
+    if (half_exponent < -10) {
+      return static_cast<uint16_t>(sign);
+    }
+    mantissa |= 0x800000u;
+    const uint32_t shift     = static_cast<uint32_t>(14 - half_exponent);
+    uint32_t       half      = mantissa >> shift;
+    const uint32_t remainder = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway   = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+      half++;
+    }
+    return static_cast<uint16_t>(sign | half);
+  }
+
+  uint32_t       half      = (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+  const uint32_t remainder = mantissa & 0x1fffu;
+  // a carry out of the mantissa bumps the exponent, up to inf, which is the right result
+  if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+    half++;
+  }
+  return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+  const uint32_t sign     = (value & 0x8000u) << 16;
+  const uint32_t exponent = (value >> 10) & 0x1fu;
+  const uint32_t mantissa = value & 0x3ffu;
+
+  uint32_t bits;
+  if (exponent == 0x1fu) {
+    bits = sign | 0x7f800000u | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+  } else {
+    // subnormal half, exact in float
+    const float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+    return sign ? -magnitude : magnitude;
+  }
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+void EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2]) {
+  const float l1 = std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z);
+  if (l1 == 0.0f) {
+    encoded[0] = 0;
+    encoded[1] = 0;
+    return;
+  }
+  float x = direction.x / l1;
+  float y = direction.y / l1;
+  if (direction.z < 0.0f) {
+    // fold the lower hemisphere over the diagonals
+    const float folded_x = (1.0f - std::fabs(y)) * SignNotZero(x);
+    const float folded_y = (1.0f - std::fabs(x)) * SignNotZero(y);
+    x                    = folded_x;
+    y                    = folded_y;
+  }
+  encoded[0] = ToSnorm16(x);
+  encoded[1] = ToSnorm16(y);
+}
+
+glm::vec3 DecodeOctahedral(const int16_t encoded[2]) {
+  glm::vec3 direction(FromSnorm16(encoded[0]), FromSnorm16(encoded[1]), 0.0f);
+  direction.z = 1.0f - std::fabs(direction.x) - std::fabs(direction.y);
+  // the folded lower hemisphere is moved back along the diagonals
+  const float t = std::max(-direction.z, 0.0f);
+  direction.x += direction.x >= 0.0f ? -t : t;
+  direction.y += direction.y >= 0.0f ? -t : t;
+  return glm::normalize(direction);
+}
+
+VertexQuantization ComputeQuantization(const AxisAlignedBox& box) {
+  VertexQuantization quantization;
+  if (box.IsEmpty()) {
+    return quantization;
+  }
+  quantization.offset = box.min_corner;
+  quantization.scale  = box.max_corner - box.min_corner;
+  return quantization;
+}
+
+void PackVertex(
+    const VulkanVertexData&   vertex,
+    const VertexQuantization& quantization,
+    VulkanPackedVertexData&   packed) {
+  for (int i = 0; i < 3; i++) {
+    const float scale = quantization.scale[i];
+    const float unorm = scale > 0.0f ? (vertex.position[i] - quantization.offset[i]) / scale : 0.0f;
+    packed.position[i] =
+        static_cast<uint16_t>(std::lround(std::clamp(unorm, 0.0f, 1.0f) * kUnorm16));
+  }
+  packed.position[3] = static_cast<uint16_t>(vertex.tangent.w < 0.0f ? 0.0f : kUnorm16);
+  EncodeOctahedral(vertex.normal, packed.normal);
+  EncodeOctahedral(glm::vec3(vertex.tangent), packed.tangent);
+  packed.texcoord[0] = FloatToHalf(vertex.texcoord[0]);
+  packed.texcoord[1] = FloatToHalf(vertex.texcoord[1]);
+}
+
+VulkanVertexData UnpackVertex(
+    const VulkanPackedVertexData& packed, const VertexQuantization& quantization) {
+  VulkanVertexData vertex{};
+  for (int i = 0; i < 3; i++) {
+    vertex.position[i] =
+        quantization.offset[i] + packed.position[i] / kUnorm16 * quantization.scale[i];
+  }
+  const float handedness = packed.position[3] == 0 ? -1.0f : 1.0f;
+  vertex.normal          = DecodeOctahedral(packed.normal);
+  vertex.tangent         = glm::vec4(DecodeOctahedral(packed.tangent), handedness);
+  vertex.texcoord[0]     = HalfToFloat(packed.texcoord[0]);
+  vertex.texcoord[1]     = HalfToFloat(packed.texcoord[1]);
+  return vertex;
+}
+
+void PackMeshData(RenderMeshData& mesh_data) {
+  if (mesh_data.vertex_format == VertexFormat::kPacked) {
+    return;
+  }
+  const auto* vertices = static_cast<const VulkanVertexData*>(mesh_data.GetVertexData());
+  const auto  count    = mesh_data.GetVertexCount();
+
+  mesh_data.quantization = ComputeQuantization(mesh_data.bounds.box);
+  mesh_data.packed_vertex_buffer.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    PackVertex(vertices[i], mesh_data.quantization, mesh_data.packed_vertex_buffer[i]);
+  }
+  mesh_data.vertex_format = VertexFormat::kPacked;
+  mesh_data.vertex_buffer.clear();
+  mesh_data.vertex_buffer.shrink_to_fit();
+}
+
+VertexPackingError MeasurePackingError(
+    const VulkanVertexData*       vertices,
+    const VulkanPackedVertexData* packed,
+    size_t                        count,
+    const VertexQuantization&     quantization) {
+  VertexPackingError error;
+  for (size_t i = 0; i < count; i++) {
+    const auto& source  = vertices[i];
+    const auto  decoded = UnpackVertex(packed[i], quantization);
+    for (int c = 0; c < 3; c++) {
+      const float difference = std::fabs(source.position[c] - decoded.position[c]);
+      error.position         = std::max(error.position, difference);
+    }
+    for (int c = 0; c < 2; c++) {
+      const float difference = std::fabs(source.texcoord[c] - decoded.texcoord[c]);
+      error.texcoord         = std::max(error.texcoord, difference);
+    }
+    error.normal_degrees =
+        std::max(error.normal_degrees, AngleDegrees(source.normal, decoded.normal));
+    // the handedness in w is stored exactly
+    const float tangent_degrees =
+        AngleDegrees(glm::vec3(source.tangent), glm::vec3(decoded.tangent));
+    error.tangent_degrees = std::max(error.tangent_degrees, tangent_degrees);
+  }
+  return error;
+}
+
+}  // namespace vkengine
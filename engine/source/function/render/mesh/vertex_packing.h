@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// largest difference between the source vertices and their packed decode
+struct VertexPackingError {
+  // object space units
+  float position        = 0.0f;
+  float normal_degrees  = 0.0f;
+  float tangent_degrees = 0.0f;
+  float texcoord        = 0.0f;
+};
+
+// ieee half, round to nearest even, overflow to inf
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t value);
+
+// unit vector to the octahedron unfolded on [-1, 1]^2, as snorm16
+void      EncodeOctahedral(const glm::vec3& direction, int16_t encoded[2]);
+glm::vec3 DecodeOctahedral(const int16_t encoded[2]);
+
+// positions are quantized over the box, a flat axis gets scale 0
+VertexQuantization ComputeQuantization(const AxisAlignedBox& box);
+
+void PackVertex(
+    const VulkanVertexData&   vertex,
+    const VertexQuantization& quantization,
+    VulkanPackedVertexData&   packed);
+VulkanVertexData UnpackVertex(
+    const VulkanPackedVertexData& packed, const VertexQuantization& quantization);
+
+// move mesh_data from kFull to kPacked, the bounds stay those of the full precision positions
+void PackMeshData(RenderMeshData& mesh_data);
+
+VertexPackingError MeasurePackingError(
+    const VulkanVertexData*       vertices,
+    const VulkanPackedVertexData* packed,
+    size_t                        count,
+    const VertexQuantization&     quantization);
+
+}  // namespace vkengine
@@ -0,0 +1,327 @@
+#include "function/render/pipeline/cluster_culling_pass.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+
+#include "core/exception/assert_exception.h"
+#include "function/render/pipeline/shaderloader.h"
+#include "function/render/rhi/vulkanrhi.h"
+#include "function/render/scene/render_resource.h"
+#include "function/render/scene/render_scene.h"
+
+namespace vkengine {
+
+namespace {
+// tested, frustum culled, back face culled
+constexpr uint32_t kCounterCount = 3;
+}  // namespace
+
+bool ClusterCullingPass::Init(std::shared_ptr<VulkanRhi> rhi, std::shared_ptr<RenderScene> scene) {
+  rhi_   = rhi;
+  scene_ = scene;
+  if (!rhi_->device_capabilities_.draw_indirect_first_instance ||
+      !std::filesystem::exists(kCullShaderFile)) {
+    return false;
+  }
+
+  std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    // meshlets, meshlet vertices, meshlet triangles, draw data, draw commands, indices, counters
+    bindings[i].binding         = i;
+    bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+  ASSERT_EXECPTION(
+      vkCreateDescriptorSetLayout(rhi_->logic_device_, &layoutInfo, nullptr, &descriptor_layout_) !=
+      VK_SUCCESS)
+      .SetErrorMessage("failed to create cluster culling descriptor layout!")
+      .Throw();
+
+  VkPushConstantRange pushConstant{};
+  pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstant.offset     = 0;
+  pushConstant.size       = sizeof(CullConstants);
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount         = 1;
+  pipelineLayoutInfo.pSetLayouts            = &descriptor_layout_;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+  ASSERT_EXECPTION(
+      vkCreatePipelineLayout(
+          rhi_->logic_device_, &pipelineLayoutInfo, nullptr, &pipeline_layout_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create cluster culling pipeline layout!")
+      .Throw();
+
+  Shader shader(rhi_->logic_device_);
+  shader.Load(kCullShaderFile);
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shader.GetShader();
+  pipelineInfo.stage.pName  = "main";
+  pipelineInfo.layout       = pipeline_layout_;
+  ASSERT_EXECPTION(
+      vkCreateComputePipelines(
+          rhi_->logic_device_, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_) !=
+      VK_SUCCESS)
+      .SetErrorMessage("failed to create cluster culling pipeline!")
+      .Throw();
+
+  frames_.resize(VulkanRhi::kMaxFramesInFight);
+  return true;
+}
+
+void ClusterCullingPass::Destroy() {
+  if (pipeline_ == VK_NULL_HANDLE) {
+    return;
+  }
+  for (auto& frame : frames_) {
+    DestroyFrameBuffers(frame);
+  }
+  frames_.clear();
+  vkDestroyPipeline(rhi_->logic_device_, pipeline_, nullptr);
+  vkDestroyPipelineLayout(rhi_->logic_device_, pipeline_layout_, nullptr);
+  vkDestroyDescriptorSetLayout(rhi_->logic_device_, descriptor_layout_, nullptr);
+  pipeline_ = VK_NULL_HANDLE;
+}
+
+void ClusterCullingPass::DestroyFrameBuffers(FrameBuffers& frame) {
+  if (frame.draw_buffer != VK_NULL_HANDLE) {
+    rhi_->DestroyBuffer(frame.draw_data_buffer, frame.draw_data_memory);
+    rhi_->DestroyBuffer(frame.draw_buffer, frame.draw_memory);
+    rhi_->DestroyBuffer(frame.index_buffer, frame.index_memory);
+    rhi_->DestroyBuffer(frame.counter_buffer, frame.counter_memory);
+  }
+  frame.draw_capacity    = 0;
+  frame.index_capacity   = 0;
+  frame.counters_written = false;
+}
+
+void ClusterCullingPass::ReserveFrameBuffers(
+    FrameBuffers& frame, uint32_t draw_count, uint32_t index_count) {
+  if (draw_count <= frame.draw_capacity && index_count <= frame.index_capacity) {
+    return;
+  }
+  uint32_t draw_capacity = std::max(frame.draw_capacity, 64u);
+  while (draw_capacity < draw_count) {
+    draw_capacity *= 2;
+  }
+  uint32_t index_capacity = std::max(frame.index_capacity, 1u << 16);
+  while (index_capacity < index_count) {
+    index_capacity *= 2;
+  }
+
+  // the frame fence has been waited on, the gpu no longer uses the old buffers
+  DestroyFrameBuffers(frame);
+  rhi_->CreateBuffer(
+      sizeof(VkClusterDrawData) * static_cast<VkDeviceSize>(draw_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.draw_data_buffer,
+      frame.draw_data_memory);
+  // written on the host with a zero index count, the shader adds the surviving indices
+  rhi_->CreateBuffer(
+      sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(draw_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.draw_buffer,
+      frame.draw_memory);
+  rhi_->CreateBuffer(
+      sizeof(uint32_t) * static_cast<VkDeviceSize>(index_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      frame.index_buffer,
+      frame.index_memory);
+  rhi_->CreateBuffer(
+      sizeof(uint32_t) * kCounterCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.counter_buffer,
+      frame.counter_memory);
+  frame.draw_capacity  = draw_capacity;
+  frame.index_capacity = index_capacity;
+}
+
+void ClusterCullingPass::RecordCulling(VkCommandBuffer command_buffer) {
+  const auto  resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  const auto& draws    = scene_->GetClusterDraws();
+  auto&       frame    = frames_[rhi_->current_frame_];
+
+  // the fence of the slot has been waited on, the counters hold the last frame it recorded
+  if (frame.counters_written) {
+    const auto* counters = static_cast<const uint32_t*>(frame.counter_memory.mapped);
+
+    statistics_.clusters.tested          = counters[0];
+    statistics_.clusters.frustum_culled  = counters[1];
+    statistics_.clusters.backface_culled = counters[2];
+  }
+  statistics_.draw_count    = static_cast<uint32_t>(draws.size());
+  statistics_.meshlet_count = 0;
+  if (draws.empty()) {
+    frame.counters_written = false;
+    return;
+  }
+
+  // every instance may keep all of its triangles
+  draw_data_.resize(draws.size());
+  uint32_t index_count = 0;
+  for (uint32_t i = 0; i < draws.size(); i++) {
+    const auto* mesh = resource->FindMesh(draws[i].mesh_asset_id);
+    auto&       data = draw_data_[i];
+    std::copy(draws[i].view.planes.begin(), draws[i].view.planes.end(), data.planes);
+    data.camera_position =
+        glm::vec4(draws[i].view.camera_position, draws[i].view.backface ? 1.0f : 0.0f);
+    data.first_index = index_count;
+    index_count += static_cast<uint32_t>(mesh->meshlets->triangles.size()) * 3;
+  }
+  ReserveFrameBuffers(frame, statistics_.draw_count, index_count);
+  memcpy(
+      frame.draw_data_memory.mapped, draw_data_.data(), sizeof(VkClusterDrawData) * draws.size());
+  auto* commands = static_cast<VkDrawIndexedIndirectCommand*>(frame.draw_memory.mapped);
+  for (uint32_t i = 0; i < draws.size(); i++) {
+    const auto* mesh          = resource->FindMesh(draws[i].mesh_asset_id);
+    commands[i].indexCount    = 0;
+    commands[i].instanceCount = 1;
+    commands[i].firstIndex    = draw_data_[i].first_index;
+    commands[i].vertexOffset  = static_cast<int32_t>(mesh->vertex_offset);
+    commands[i].firstInstance = draws[i].instance;
+  }
+  memset(frame.counter_memory.mapped, 0, sizeof(uint32_t) * kCounterCount);
+  frame.counters_written = true;
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+  for (const auto& batch : scene_->GetBatches()) {
+    if (!batch.clustered) {
+      continue;
+    }
+    const auto* mesh     = resource->FindMesh(batch.mesh_asset_id);
+    const auto& meshlets = *mesh->meshlets;
+
+    // the arrays of the meshlet buffer are bound as three ranges
+    VkDescriptorSet set =
+        rhi_->descriptor_allocator_.AllocateTransient(rhi_->current_frame_, descriptor_layout_);
+    std::array<VkDescriptorBufferInfo, 7> bufferInfos{};
+    bufferInfos[0] = {mesh->meshlet_buffer, 0, sizeof(Meshlet) * meshlets.meshlets.size()};
+    bufferInfos[1] = {
+        mesh->meshlet_buffer,
+        mesh->meshlet_vertex_offset,
+        sizeof(uint32_t) * meshlets.vertices.size()};
+    bufferInfos[2] = {
+        mesh->meshlet_buffer,
+        mesh->meshlet_triangle_offset,
+        sizeof(uint32_t) * meshlets.triangles.size()};
+    bufferInfos[3] = {frame.draw_data_buffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[4] = {frame.draw_buffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[5] = {frame.index_buffer, 0, VK_WHOLE_SIZE};
+    bufferInfos[6] = {frame.counter_buffer, 0, VK_WHOLE_SIZE};
+    std::array<VkWriteDescriptorSet, 7> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+      writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet          = set;
+      writes[i].dstBinding      = i;
+      writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].descriptorCount = 1;
+      writes[i].pBufferInfo     = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(
+        rhi_->logic_device_, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    CullConstants constants{};
+    constants.first_draw    = batch.first_cluster_draw;
+    constants.meshlet_count = static_cast<uint32_t>(meshlets.meshlets.size());
+    vkCmdBindDescriptorSets(
+        command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(
+        command_buffer,
+        pipeline_layout_,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(CullConstants),
+        &constants);
+    // x walks the meshlets, y the instances of the batch
+    vkCmdDispatch(command_buffer, constants.meshlet_count, batch.instance_count, 1);
+    statistics_.meshlet_count += constants.meshlet_count * batch.instance_count;
+  }
+
+  // draws by the indirect stage, indices by the input assembly, counters by the host a few
+  // frames later
+  VkMemoryBarrier drawBarrier{};
+  drawBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  drawBarrier.dstAccessMask =
+      VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+          VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      1,
+      &drawBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+void ClusterCullingPass::RecordDraws(
+    VkCommandBuffer command_buffer, VkPipelineLayout layout, VertexFormat vertex_format) {
+  if (statistics_.draw_count == 0) {
+    return;
+  }
+  const auto& frame    = frames_[rhi_->current_frame_];
+  const auto  resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  const auto& pool     = resource->GetGeometryPool();
+  const auto& caps     = rhi_->device_capabilities_;
+
+  constexpr uint32_t kStride = sizeof(VkDrawIndexedIndirectCommand);
+
+  VkDescriptorSet bound_material_set = VK_NULL_HANDLE;
+  for (const auto& batch : scene_->GetBatches()) {
+    const auto* mesh = resource->FindMesh(batch.mesh_asset_id);
+    if (!batch.clustered || mesh->vertex_format != vertex_format) {
+      continue;
+    }
+    if (!caps.bindless) {
+      const auto* material = resource->FindMaterial(batch.material_asset_id);
+      if (material && material->material_descriptor_set != bound_material_set) {
+        bound_material_set = material->material_descriptor_set;
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            layout,
+            1,
+            1,
+            &bound_material_set,
+            0,
+            nullptr);
+      }
+    }
+    const VkDeviceSize vertex_offset = 0;
+    const VkBuffer     vertex_buffer = pool.VertexBuffer(mesh->page);
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, &vertex_offset);
+    vkCmdBindIndexBuffer(command_buffer, frame.index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    // the draws of the instances of a batch are adjacent
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(batch.first_cluster_draw) * kStride;
+    if (caps.multi_draw_indirect) {
+      vkCmdDrawIndexedIndirect(
+          command_buffer, frame.draw_buffer, offset, batch.instance_count, kStride);
+    } else {
+      for (uint32_t i = 0; i < batch.instance_count; i++) {
+        vkCmdDrawIndexedIndirect(command_buffer, frame.draw_buffer, offset + i * kStride, 1, 0);
+      }
+    }
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "forward.h"
+#include "function/render/scene/cluster_culler.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+struct ClusterCullingStatistics {
+  uint32_t draw_count    = 0;
+  uint32_t meshlet_count = 0;
+  // counted by the shader, read back when the frame slot is reused so they lag
+  // VulkanRhi::kMaxFramesInFight frames behind draw_count
+  ClusterCullStatistics clusters;
+};
+
+// gpu side of the cluster culling of RenderScene: one workgroup per meshlet and clustered
+// instance tests the bounding sphere against the frustum and the normal cone against the
+// camera, then appends the triangles of a surviving meshlet to the index range of its instance.
+// every instance is drawn with one indirect command whose index count the shader accumulates
+class ClusterCullingPass {
+ public:
+  static constexpr const char* kCullShaderFile = "./shaders/007/cluster_cull.comp";
+  // one thread per meshlet vertex, each writes at most two triangles
+  static constexpr uint32_t kWorkgroupSize = kMeshletMaxVertices;
+
+  ClusterCullingPass() {}
+  ~ClusterCullingPass() {}
+
+  // return false if the device or the shader does not support the gpu path
+  bool Init(std::shared_ptr<VulkanRhi> rhi, std::shared_ptr<RenderScene> scene);
+  void Destroy();
+
+  // write the draw buffers and record one dispatch per clustered batch, must be outside a
+  // render pass and after RenderScene::UpdatePerFrameBuffer
+  void RecordCulling(VkCommandBuffer command_buffer);
+  // inside the mesh pass with the instance buffer of the scene bound like for
+  // RenderScene::RecordBatchedDraws, in the per set material path the material set is bound at
+  // set 1 of layout. draws the meshes of vertex_format
+  void RecordDraws(
+      VkCommandBuffer  command_buffer,
+      VkPipelineLayout layout,
+      VertexFormat     vertex_format = VertexFormat::kFull);
+
+  const ClusterCullingStatistics& GetStatistics() const { return statistics_; }
+
+ private:
+  struct FrameBuffers {
+    VkBuffer         draw_data_buffer = VK_NULL_HANDLE;
+    VulkanAllocation draw_data_memory;
+    VkBuffer         draw_buffer = VK_NULL_HANDLE;
+    VulkanAllocation draw_memory;
+    VkBuffer         index_buffer = VK_NULL_HANDLE;
+    VulkanAllocation index_memory;
+    VkBuffer         counter_buffer = VK_NULL_HANDLE;
+    VulkanAllocation counter_memory;
+    uint32_t         draw_capacity  = 0;
+    uint32_t         index_capacity = 0;
+    // nothing to read back before the first dispatch of the slot
+    bool counters_written = false;
+  };
+  struct CullConstants {
+    uint32_t first_draw;
+    uint32_t meshlet_count;
+    uint32_t _padding_1[2];
+  };
+
+  std::shared_ptr<VulkanRhi>   rhi_;
+  std::shared_ptr<RenderScene> scene_;
+
+  VkDescriptorSetLayout descriptor_layout_ = VK_NULL_HANDLE;
+  VkPipelineLayout      pipeline_layout_   = VK_NULL_HANDLE;
+  VkPipeline            pipeline_          = VK_NULL_HANDLE;
+
+  std::vector<FrameBuffers>      frames_;
+  std::vector<VkClusterDrawData> draw_data_;
+  ClusterCullingStatistics       statistics_;
+
+  void ReserveFrameBuffers(FrameBuffers& frame, uint32_t draw_count, uint32_t index_count);
+  void DestroyFrameBuffers(FrameBuffers& frame);
+};
+
+}  // namespace vkengine
@@ -0,0 +1,316 @@
+#include "function/render/pipeline/gpu_culling_pass.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+
+#include "core/exception/assert_exception.h"
+#include "function/render/pipeline/shaderloader.h"
+#include "function/render/rhi/vulkanrhi.h"
+#include "function/render/scene/bounding_volume.h"
+#include "function/render/scene/render_resource.h"
+#include "function/render/scene/render_scene.h"
+
+namespace vkengine {
+
+bool GpuCullingPass::Init(std::shared_ptr<VulkanRhi> rhi, std::shared_ptr<RenderScene> scene) {
+  rhi_   = rhi;
+  scene_ = scene;
+  if (!rhi_->device_capabilities_.draw_indirect_first_instance ||
+      !std::filesystem::exists(kCullShaderFile)) {
+    return false;
+  }
+
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    // objects, draw commands, per page draw counts
+    bindings[i].binding         = i;
+    bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+  ASSERT_EXECPTION(
+      vkCreateDescriptorSetLayout(rhi_->logic_device_, &layoutInfo, nullptr, &descriptor_layout_) !=
+      VK_SUCCESS)
+      .SetErrorMessage("failed to create culling descriptor layout!")
+      .Throw();
+
+  VkPushConstantRange pushConstant{};
+  pushConstant.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstant.offset     = 0;
+  pushConstant.size       = sizeof(CullConstants);
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount         = 1;
+  pipelineLayoutInfo.pSetLayouts            = &descriptor_layout_;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges    = &pushConstant;
+  ASSERT_EXECPTION(
+      vkCreatePipelineLayout(
+          rhi_->logic_device_, &pipelineLayoutInfo, nullptr, &pipeline_layout_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create culling pipeline layout!")
+      .Throw();
+
+  Shader shader(rhi_->logic_device_);
+  shader.Load(kCullShaderFile);
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = shader.GetShader();
+  pipelineInfo.stage.pName  = "main";
+  pipelineInfo.layout       = pipeline_layout_;
+  ASSERT_EXECPTION(
+      vkCreateComputePipelines(
+          rhi_->logic_device_, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline_) !=
+      VK_SUCCESS)
+      .SetErrorMessage("failed to create culling pipeline!")
+      .Throw();
+
+  frames_.resize(VulkanRhi::kMaxFramesInFight);
+  statistics_.draw_indirect_count = rhi_->device_capabilities_.draw_indirect_count;
+  return true;
+}
+
+void GpuCullingPass::Destroy() {
+  if (pipeline_ == VK_NULL_HANDLE) {
+    return;
+  }
+  for (auto& frame : frames_) {
+    DestroyFrameBuffers(frame);
+  }
+  frames_.clear();
+  vkDestroyPipeline(rhi_->logic_device_, pipeline_, nullptr);
+  vkDestroyPipelineLayout(rhi_->logic_device_, pipeline_layout_, nullptr);
+  vkDestroyDescriptorSetLayout(rhi_->logic_device_, descriptor_layout_, nullptr);
+  pipeline_ = VK_NULL_HANDLE;
+}
+
+void GpuCullingPass::DestroyFrameBuffers(FrameBuffers& frame) {
+  if (frame.object_buffer != VK_NULL_HANDLE) {
+    rhi_->DestroyBuffer(frame.object_buffer, frame.object_memory);
+    rhi_->DestroyBuffer(frame.draw_buffer, frame.draw_memory);
+    rhi_->DestroyBuffer(frame.count_buffer, frame.count_memory);
+  }
+  frame.object_capacity = 0;
+  frame.page_capacity   = 0;
+}
+
+void GpuCullingPass::ReserveFrameBuffers(
+    FrameBuffers& frame, uint32_t object_count, uint32_t page_count) {
+  if (object_count <= frame.object_capacity && page_count <= frame.page_capacity) {
+    return;
+  }
+  uint32_t object_capacity = std::max(frame.object_capacity, 1024u);
+  while (object_capacity < object_count) {
+    object_capacity *= 2;
+  }
+  const uint32_t page_capacity = std::max({frame.page_capacity, page_count, 4u});
+
+  // the frame fence has been waited on, the gpu no longer uses the old buffers
+  DestroyFrameBuffers(frame);
+  rhi_->CreateBuffer(
+      sizeof(VkCullObjectData) * static_cast<VkDeviceSize>(object_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.object_buffer,
+      frame.object_memory);
+  rhi_->CreateBuffer(
+      sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(object_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      frame.draw_buffer,
+      frame.draw_memory);
+  rhi_->CreateBuffer(
+      sizeof(uint32_t) * static_cast<VkDeviceSize>(page_capacity),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      frame.count_buffer,
+      frame.count_memory);
+  frame.object_capacity = object_capacity;
+  frame.page_capacity   = page_capacity;
+}
+
+void GpuCullingPass::BuildObjects() {
+  const auto resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  objects_.clear();
+  for (uint32_t i = 0; i < scene_->render_entities.size(); i++) {
+    const auto& entity = scene_->render_entities[i];
+    const auto* mesh   = resource->FindMesh(entity.mesh_asset_id);
+    if (!mesh) {
+      continue;
+    }
+    // the level of detail is picked on the cpu together with the batched path
+    const uint32_t lod_index = scene_->GetEntityLod(i);
+    // the base level of a mesh with meshlets is a clustered batch, ClusterCullingPass draws it
+    if (mesh->meshlets && lod_index == 0 && scene_->IsGpuClusterCulling()) {
+      continue;
+    }
+    const auto& lod      = mesh->lods[std::min<size_t>(lod_index, mesh->lods.size() - 1)];
+    const auto* material = resource->FindMaterial(entity.material_asset_id);
+
+    VkCullObjectData object{};
+    object.model_matrix      = entity.model_matrix;
+    object.bounding_sphere   = glm::vec4(mesh->bounds.sphere.center, mesh->bounds.sphere.radius);
+    object.base_color_factor = entity.base_color_factor;
+    object.position_offset   = glm::vec4(mesh->quantization.offset, 0.0f);
+    object.position_scale    = glm::vec4(mesh->quantization.scale, 0.0f);
+    object.index_count       = lod.index_count;
+    object.first_index       = lod.first_index;
+    object.vertex_offset     = static_cast<int32_t>(mesh->vertex_offset);
+    object.material_id       = material ? material->material_id : 0;
+    object.page              = mesh->page;
+    objects_.push_back(object);
+  }
+
+  // every page owns a contiguous range of draw slots
+  std::stable_sort(
+      objects_.begin(), objects_.end(), [](const VkCullObjectData& a, const VkCullObjectData& b) {
+        return a.page < b.page;
+      });
+  page_ranges_.clear();
+  for (uint32_t i = 0; i < objects_.size(); i++) {
+    if (page_ranges_.empty() || page_ranges_.back().page != objects_[i].page) {
+      page_ranges_.push_back({objects_[i].page, i, 0});
+    }
+    page_ranges_.back().object_count++;
+    objects_[i].draw_base  = page_ranges_.back().first_object;
+    objects_[i].count_slot = static_cast<uint32_t>(page_ranges_.size() - 1);
+  }
+}
+
+VkBuffer GpuCullingPass::GetObjectBuffer() const {
+  return frames_.empty() ? VK_NULL_HANDLE : frames_[rhi_->current_frame_].object_buffer;
+}
+
+void GpuCullingPass::RecordCulling(VkCommandBuffer command_buffer, const glm::mat4& proj_view) {
+  BuildObjects();
+  const auto object_count = static_cast<uint32_t>(objects_.size());
+  const auto page_count   = static_cast<uint32_t>(page_ranges_.size());
+
+  statistics_.object_count = object_count;
+  statistics_.page_count   = page_count;
+  if (object_count == 0) {
+    return;
+  }
+
+  auto& frame = frames_[rhi_->current_frame_];
+  ReserveFrameBuffers(frame, object_count, page_count);
+  memcpy(frame.object_memory.mapped, objects_.data(), sizeof(VkCullObjectData) * object_count);
+  vkCmdFillBuffer(command_buffer, frame.count_buffer, 0, VK_WHOLE_SIZE, 0);
+
+  VkMemoryBarrier clearBarrier{};
+  clearBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      1,
+      &clearBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  VkDescriptorSet set =
+      rhi_->descriptor_allocator_.AllocateTransient(rhi_->current_frame_, descriptor_layout_);
+  std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+  bufferInfos[0] = {frame.object_buffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[1] = {frame.draw_buffer, 0, VK_WHOLE_SIZE};
+  bufferInfos[2] = {frame.count_buffer, 0, VK_WHOLE_SIZE};
+  std::array<VkWriteDescriptorSet, 3> writes{};
+  for (uint32_t i = 0; i < writes.size(); i++) {
+    writes[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet          = set;
+    writes[i].dstBinding      = i;
+    writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[i].descriptorCount = 1;
+    writes[i].pBufferInfo     = &bufferInfos[i];
+  }
+  vkUpdateDescriptorSets(
+      rhi_->logic_device_, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  CullConstants constants{};
+  const auto    frustum = Frustum::FromMatrix(proj_view);
+  std::copy(frustum.planes.begin(), frustum.planes.end(), constants.planes);
+  constants.object_count = object_count;
+  constants.compact      = statistics_.draw_indirect_count ? 1 : 0;
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+  vkCmdBindDescriptorSets(
+      command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_layout_, 0, 1, &set, 0, nullptr);
+  vkCmdPushConstants(
+      command_buffer,
+      pipeline_layout_,
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      sizeof(CullConstants),
+      &constants);
+  vkCmdDispatch(command_buffer, (object_count + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+
+  // draw commands and counts are read by the indirect stage, objects by the vertex shader
+  VkMemoryBarrier drawBarrier{};
+  drawBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+      0,
+      1,
+      &drawBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+void GpuCullingPass::RecordDraws(VkCommandBuffer command_buffer, VertexFormat vertex_format) {
+  if (objects_.empty()) {
+    return;
+  }
+  const auto& frame    = frames_[rhi_->current_frame_];
+  const auto  resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  const auto& pool     = resource->GetGeometryPool();
+  const auto& caps     = rhi_->device_capabilities_;
+
+  constexpr uint32_t kStride = sizeof(VkDrawIndexedIndirectCommand);
+
+  for (uint32_t i = 0; i < page_ranges_.size(); i++) {
+    const auto& range = page_ranges_[i];
+    if (pool.PageFormat(range.page) != vertex_format) {
+      continue;
+    }
+    const VkDeviceSize offset = static_cast<VkDeviceSize>(range.first_object) * kStride;
+    pool.Bind(command_buffer, range.page);
+    if (caps.draw_indirect_count) {
+      vkCmdDrawIndexedIndirectCount(
+          command_buffer,
+          frame.draw_buffer,
+          offset,
+          frame.count_buffer,
+          sizeof(uint32_t) * static_cast<VkDeviceSize>(i),
+          range.object_count,
+          kStride);
+    } else if (caps.multi_draw_indirect) {
+      vkCmdDrawIndexedIndirect(
+          command_buffer, frame.draw_buffer, offset, range.object_count, kStride);
+    } else {
+      for (uint32_t j = 0; j < range.object_count; j++) {
+        vkCmdDrawIndexedIndirect(command_buffer, frame.draw_buffer, offset + j * kStride, 1, 0);
+      }
+    }
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "forward.h"
+#include "function/render/scene/render_type.h"
+#include "glm/glm.hpp"
+
+namespace vkengine {
+
+struct GpuCullingStatistics {
+  uint32_t object_count = 0;
+  uint32_t page_count   = 0;
+  // false when the draws fall back to vkCmdDrawIndexedIndirect with culled slots zeroed
+  bool draw_indirect_count = false;
+};
+
+// gpu driven path: a compute shader frustum culls every entity and writes one
+// VkDrawIndexedIndirectCommand per survivor, compacted per geometry pool page with an
+// atomic counter. without drawIndirectCount every entity keeps its slot and culled ones
+// get instanceCount 0. entities of clustered batches are left to ClusterCullingPass
+class GpuCullingPass {
+ public:
+  static constexpr const char* kCullShaderFile = "./shaders/007/cull.comp";
+  static constexpr uint32_t    kWorkgroupSize  = 64;
+
+  GpuCullingPass() {}
+  ~GpuCullingPass() {}
+
+  // return false if the device or the shader does not support the gpu driven path
+  bool Init(std::shared_ptr<VulkanRhi> rhi, std::shared_ptr<RenderScene> scene);
+  void Destroy();
+
+  // write the object buffer and record the culling dispatch, must be outside a render pass
+  void RecordCulling(VkCommandBuffer command_buffer, const glm::mat4& proj_view);
+  // inside the mesh pass, the object buffer is the instance data of the vertex shader.
+  // draws the pages of vertex_format, the caller binds the pipeline of that format
+  void RecordDraws(
+      VkCommandBuffer command_buffer, VertexFormat vertex_format = VertexFormat::kFull);
+
+  VkBuffer                    GetObjectBuffer() const;
+  const GpuCullingStatistics& GetStatistics() const { return statistics_; }
+
+ private:
+  struct FrameBuffers {
+    VkBuffer         object_buffer = VK_NULL_HANDLE;
+    VulkanAllocation object_memory;
+    VkBuffer         draw_buffer = VK_NULL_HANDLE;
+    VulkanAllocation draw_memory;
+    VkBuffer         count_buffer = VK_NULL_HANDLE;
+    VulkanAllocation count_memory;
+    uint32_t         object_capacity = 0;
+    uint32_t         page_capacity   = 0;
+  };
+  struct PageRange {
+    uint32_t page;
+    uint32_t first_object;
+    uint32_t object_count;
+  };
+  struct CullConstants {
+    glm::vec4 planes[6];
+    uint32_t  object_count;
+    uint32_t  compact;
+    uint32_t  _padding_1[2];
+  };
+
+  std::shared_ptr<VulkanRhi>   rhi_;
+  std::shared_ptr<RenderScene> scene_;
+
+  VkDescriptorSetLayout descriptor_layout_ = VK_NULL_HANDLE;
+  VkPipelineLayout      pipeline_layout_   = VK_NULL_HANDLE;
+  VkPipeline            pipeline_          = VK_NULL_HANDLE;
+
+  std::vector<FrameBuffers>     frames_;
+  std::vector<VkCullObjectData> objects_;
+  std::vector<PageRange>        page_ranges_;
+  GpuCullingStatistics          statistics_;
+
+  void ReserveFrameBuffers(FrameBuffers& frame, uint32_t object_count, uint32_t page_count);
+  void DestroyFrameBuffers(FrameBuffers& frame);
+  void BuildObjects();
+};
+
+}  // namespace vkengine
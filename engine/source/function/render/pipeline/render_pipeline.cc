@@ -2,11 +2,29 @@
 
 #include "core/exception/assert_exception.h"
 #include "function/render/rhi/vulkanrhi.h"
+#include "function/render/scene/render_scene.h"
+#include "macro.h"
 namespace vkengine {
 
 void RenderPipeline::Init(const RenderPipelineInitInfo& init_info) {
   render_resource = init_info.render_resource;
   render_rhi      = init_info.render_rhi;
+  render_scene    = init_info.render_scene;
+
+  gpu_culling_enabled_ =
+      init_info.gpu_culling && render_scene && gpu_culling_.Init(render_rhi, render_scene);
+  LogInfo(
+      "gpu culling {}, draw indirect count {}, multi draw indirect {}",
+      gpu_culling_enabled_ ? "enabled" : "disabled",
+      render_rhi->device_capabilities_.draw_indirect_count,
+      render_rhi->device_capabilities_.multi_draw_indirect);
+
+  cluster_culling_enabled_ = init_info.gpu_cluster_culling && render_scene &&
+                             cluster_culling_.Init(render_rhi, render_scene);
+  if (cluster_culling_enabled_) {
+    render_scene->SetGpuClusterCulling(true);
+  }
+  LogInfo("cluster culling on the {}", cluster_culling_enabled_ ? "gpu" : "cpu");
 }
 
 void RenderPipeline::PreparePassData() {}
@@ -17,6 +35,16 @@ void RenderPipeline::Draw() {
     return;
   }
 
+  if (gpu_culling_enabled_) {
+    const auto& per_frame =
+        render_scene->storage_buffer_object->ubo[render_rhi->current_frame_].per_frame_ubo;
+    gpu_culling_.RecordCulling(
+        render_rhi->command_buffer_[render_rhi->current_frame_], per_frame.proj_view_matrix);
+  }
+  if (cluster_culling_enabled_) {
+    cluster_culling_.RecordCulling(render_rhi->command_buffer_[render_rhi->current_frame_]);
+  }
+
   render_rhi->SubmitRendering([this]() { PassUpdateAfterRecreateSwapchain(); });
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "function/render/pipeline/cluster_culling_pass.h"
+#include "function/render/pipeline/gpu_culling_pass.h"
 #include "function/render/pipeline/render_pipeline_base.h"
 
 namespace vkengine {
@@ -9,7 +11,10 @@ class RenderPipeline : public RenderPipelineBase {
   /* data */
  public:
   RenderPipeline() {}
-  virtual ~RenderPipeline() {}
+  virtual ~RenderPipeline() {
+    cluster_culling_.Destroy();
+    gpu_culling_.Destroy();
+  }
 
   virtual void Init(const RenderPipelineInitInfo& init_info) override;
 
@@ -18,7 +23,24 @@ class RenderPipeline : public RenderPipelineBase {
 
   void PassUpdateAfterRecreateSwapchain();
 
+  const GpuCullingPass& GetGpuCullingPass() const { return gpu_culling_; }
+  bool                  IsGpuCullingEnabled() const { return gpu_culling_enabled_; }
+
+  const ClusterCullingPass& GetClusterCullingPass() const { return cluster_culling_; }
+  bool IsClusterCullingEnabled() const { return cluster_culling_enabled_; }
+
  private:
+  std::shared_ptr<RenderScene> render_scene;
+
+  // off without RenderPipelineInitInfo::gpu_culling, or when the device can not drive draws from
+  // the gpu. RenderScene::RecordBatchedDraws draws the entities then
+  GpuCullingPass gpu_culling_;
+  bool           gpu_culling_enabled_ = false;
+  // off without RenderPipelineInitInfo::gpu_cluster_culling, RenderScene culls the clusters on
+  // the cpu then
+  ClusterCullingPass cluster_culling_;
+  bool               cluster_culling_enabled_ = false;
+
   void SetupDescriptorSetLayout();
 };
 }  // namespace vkengine
@@ -11,6 +11,13 @@ namespace vkengine {
 struct RenderPipelineInitInfo {
   std::shared_ptr<RenderResourceBase> render_resource;
   std::shared_ptr<VulkanRhi>          render_rhi;
+  std::shared_ptr<RenderScene>        render_scene;
+  // frustum cull the entities in a compute pass. its draws are only read by a mesh pass, keep it
+  // off while the pipeline records none
+  bool gpu_culling = false;
+  // cull the clusters of meshlet meshes in a compute pass instead of on the cpu, off for the same
+  // reason
+  bool gpu_cluster_culling = false;
 };
 
 struct FrameBufferAttachment {
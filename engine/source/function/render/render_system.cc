@@ -1,12 +1,29 @@
 #include "function/render/render_system.h"
 
+#include <chrono>
+
 #include "function/render/camera/camera_base.h"
 #include "function/render/pipeline/render_pipeline.h"
 #include "function/render/rhi/vulkanrhi.h"
 #include "function/render/scene/render_resource.h"
 #include "function/render/scene/render_scene.h"
+#include "macro.h"
 
 namespace vkengine {
+RenderSystem::~RenderSystem() {
+  // the loads reference the resource, let the ones still running on the pool finish
+  for (const auto& pending : pending_meshes_) {
+    pending.data.wait();
+  }
+  for (const auto& pending : pending_materials_) {
+    pending.data.wait();
+  }
+  // the members below destroy their device objects, the frames in flight must be done with them
+  if (rhi_) {
+    vkDeviceWaitIdle(rhi_->logic_device_);
+  }
+}
+
 void RenderSystem::Init(const RenderInitInfo& info) {
   rhi_ = std::make_shared<VulkanRhi>();
   RHIInitInfo rhiinfo;
@@ -30,33 +47,207 @@ void RenderSystem::Init(const RenderInitInfo& info) {
   // scene_->ambient_light = {}
 
   pipeline_ = std::make_shared<RenderPipeline>();
+  RenderPipelineInitInfo pipelineinfo;
+  pipelineinfo.render_resource = scene_->resource_;
+  pipelineinfo.render_rhi      = rhi_;
+  pipelineinfo.render_scene    = scene_;
+  pipeline_->Init(pipelineinfo);
 
   ProcessSwapData();
 }
 
 void RenderSystem::Tick() {
+  // the per frame buffers below are rewritten, the gpu must be done with this frame slot
+  rhi_->WaitForFence();
+  UploadReadyAssets();
   scene_->UpdatePerFrameBuffer();
   pipeline_->Draw();
+
+  if (++frame_count_ % kStatisticsInterval == 0) {
+    const auto& stats = scene_->GetFrameStatistics();
+    LogInfo(
+        "frame {}: {} entities, {} visible ({} culling), {} draws before batching, {} after, "
+        "{} triangles ({} at full detail)",
+        frame_count_,
+        stats.entity_count,
+        stats.visible_count,
+        FrustumCuller::KernelName(scene_->GetCullKernel()),
+        stats.draws_before_batching,
+        stats.draws_after_batching,
+        stats.triangles_submitted,
+        stats.triangles_full_detail);
+
+    // the gpu counters trail the frame by the frames in flight
+    const bool            gpu_clusters = pipeline_->IsClusterCullingEnabled();
+    ClusterCullStatistics clusters;
+    clusters.tested          = stats.clusters_tested;
+    clusters.frustum_culled  = stats.clusters_frustum_culled;
+    clusters.backface_culled = stats.clusters_backface_culled;
+    if (gpu_clusters) {
+      clusters = pipeline_->GetClusterCullingPass().GetStatistics().clusters;
+    }
+    if (clusters.tested > 0) {
+      LogInfo(
+          "frame {}: {} clusters tested on the {}, {} outside the frustum, {} back facing",
+          frame_count_,
+          clusters.tested,
+          gpu_clusters ? "gpu" : "cpu",
+          clusters.frustum_culled,
+          clusters.backface_culled);
+    }
+  }
 }
 
 void RenderSystem::ProcessSwapData() {
   // TODO: append logic move to scene
+  stream_start_ = std::chrono::steady_clock::now();
+  const auto resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  resource->CreatePlaceholderMaterial(rhi_, pipeline_->descriptor_per_material.descriptor_layout);
+
+  // the loads run on the worker pool, the entity is drawn as its assets become resident
   RenderEntity render_entity;
-  render_entity.mesh_asset_id = 1;
+  render_entity.mesh_asset_id     = 1;
+  render_entity.material_asset_id = 1;
 
   RenderMeshSource mesh_source;
   mesh_source.mesh_file = "./asset/viking_room.obj";
-  RenderResource::BoudingBox box;
-  auto                       mesh_data = scene_->resource_->LoadMesh(mesh_source, box);
-  scene_->resource_->UploadGameObjectRenderResource(
-      rhi_, render_entity, mesh_data, pipeline_->descriptor_per_mesh.descriptor_layout);
+  pending_meshes_.push_back({render_entity.mesh_asset_id, resource->LoadMeshAsync(mesh_source)});
 
   RenderMaterialSource material_source;
   material_source.base_color_file = "./asset/viking_room.png";
-  auto material_data              = scene_->resource_->LoadMaterial(material_source);
-  scene_->resource_->UploadGameObjectRenderResource(
-      rhi_, render_entity, material_data, pipeline_->descriptor_per_material.descriptor_layout);
+  pending_materials_.push_back(
+      {render_entity.material_asset_id, resource->LoadMaterialAsync(material_source)});
 
   scene_->render_entities.push_back(render_entity);
 }
+
+void RenderSystem::UploadReadyAssets() {
+  if (pending_meshes_.empty() && pending_materials_.empty()) {
+    return;
+  }
+
+  // uploads recorded here are flushed by this frame's submit, which waits for them
+  const auto is_ready = [](const auto& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  };
+  size_t upload_bytes = 0;
+  size_t uploads      = 0;
+
+  for (auto it = pending_meshes_.begin(); it != pending_meshes_.end();) {
+    if (!is_ready(it->data)) {
+      ++it;
+      continue;
+    }
+    if (uploads > 0 && upload_bytes >= kUploadBytesPerFrame) {
+      break;
+    }
+    RenderEntity render_entity;
+    render_entity.mesh_asset_id = it->mesh_asset_id;
+    try {
+      const auto& mesh_data = it->data.get().static_mesh_data;
+      upload_bytes += static_cast<size_t>(mesh_data.GetVertexCount()) *
+                          GetVertexStride(mesh_data.vertex_format) +
+                      static_cast<size_t>(mesh_data.GetIndexCount()) *
+                          GetIndexSize(mesh_data.index_type);
+      scene_->resource_->UploadGameObjectRenderResource(
+          rhi_, render_entity, it->data.get(), pipeline_->descriptor_per_mesh.descriptor_layout);
+    } catch (const std::exception& e) {
+      // the entities of the mesh stay hidden
+      LogError("failed to load mesh {}: {}", it->mesh_asset_id, e.what());
+    }
+    uploads++;
+    it = pending_meshes_.erase(it);
+  }
+
+  for (auto it = pending_materials_.begin(); it != pending_materials_.end();) {
+    if (!is_ready(it->data)) {
+      ++it;
+      continue;
+    }
+    if (uploads > 0 && upload_bytes >= kUploadBytesPerFrame) {
+      break;
+    }
+    RenderEntity render_entity;
+    render_entity.material_asset_id = it->material_asset_id;
+    try {
+      const auto& material_data = it->data.get();
+      if (material_data.base_color_texture) {
+        // an estimate of 4 byte texels, the budget only spreads the uploads over frames
+        upload_bytes += static_cast<size_t>(material_data.base_color_texture->width) *
+                        material_data.base_color_texture->height * 4;
+      }
+      render_entity.base_color_factor = material_data.base_color_factor;
+      scene_->resource_->UploadGameObjectRenderResource(
+          rhi_,
+          render_entity,
+          material_data,
+          pipeline_->descriptor_per_material.descriptor_layout);
+      for (auto& entity : scene_->render_entities) {
+        if (entity.material_asset_id == it->material_asset_id) {
+          entity.base_color_factor = material_data.base_color_factor;
+        }
+      }
+    } catch (const std::exception& e) {
+      // the entities of the material keep the placeholder
+      LogError("failed to load material {}: {}", it->material_asset_id, e.what());
+    }
+    uploads++;
+    it = pending_materials_.erase(it);
+  }
+
+  if (pending_meshes_.empty() && pending_materials_.empty()) {
+    LogInfo(
+        "assets streamed in {} ms after the first frame was requested",
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stream_start_)
+            .count());
+    LogResourceStatistics();
+  }
+}
+
+void RenderSystem::LogResourceStatistics() {
+  const auto& stats = rhi_->GetUploadStatistics();
+  LogInfo(
+      "uploaded {} bytes in {} copies, {} batches, {} stalls",
+      stats.bytes,
+      stats.copies,
+      stats.batches,
+      stats.stalls);
+
+  const auto memory = rhi_->GetMemoryStatistics();
+  LogInfo(
+      "device memory {} used / {} reserved bytes, {} allocations in {} device allocations ({} "
+      "dedicated), fragmentation {}",
+      memory.used_bytes,
+      memory.reserved_bytes,
+      memory.allocation_count,
+      memory.device_allocation_count,
+      memory.dedicated_allocation_count,
+      memory.fragmentation);
+
+  const auto resource = std::static_pointer_cast<RenderResource>(scene_->resource_);
+  const auto geometry = resource->GetGeometryPool().GetStatistics();
+  LogInfo(
+      "geometry pool {} meshes in {} pages, vertices {} / {}, indices {} / {}, {} free ranges",
+      geometry.mesh_count,
+      geometry.page_count,
+      geometry.vertex_used,
+      geometry.vertex_capacity,
+      geometry.index_used,
+      geometry.index_capacity,
+      geometry.free_range_count);
+
+  const auto descriptors = rhi_->descriptor_allocator_.GetStatistics(rhi_->current_frame_);
+  LogInfo(
+      "descriptor sets {} allocated from {} pools, {} frame resets in total",
+      descriptors.sets_allocated,
+      descriptors.pools_in_use,
+      descriptors.total_frame_resets);
+
+  if (rhi_->device_capabilities_.bindless) {
+    const auto& materials = resource->GetBindlessMaterialTable();
+    LogInfo("bindless materials {} / {}", materials.MaterialCount(), materials.Capacity());
+  } else {
+    LogInfo("bindless materials unsupported, using per material descriptor sets");
+  }
+}
 }  // namespace vkengine
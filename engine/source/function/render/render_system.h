@@ -1,8 +1,12 @@
 #pragma once
 
+#include <chrono>
+#include <future>
 #include <memory>
+#include <vector>
 
 #include "forward.h"
+#include "function/render/scene/render_type.h"
 
 namespace vkengine {
 
@@ -13,7 +17,7 @@ struct RenderInitInfo {
 class RenderSystem {
  public:
   RenderSystem() {}
-  ~RenderSystem() {}
+  ~RenderSystem();
 
   void Init(const RenderInitInfo&);
 
@@ -24,9 +28,33 @@ class RenderSystem {
   std::shared_ptr<Camera>             camera_;
   std::shared_ptr<RenderResourceBase> resource_;
   std::shared_ptr<RenderScene>        scene_;
-  std::shared_ptr<RenderPipelineBase> pipeline_;
+  std::shared_ptr<RenderPipeline>     pipeline_;
+
+  // frame statistics are logged once every kStatisticsInterval frames
+  static constexpr uint64_t kStatisticsInterval = 600;
+  uint64_t                  frame_count_        = 0;
+
+  // assets loading on the worker pool, uploaded by the frame that finds them ready. entities
+  // are drawn from the first frame, without their mesh until it is resident and with the
+  // placeholder material until theirs is
+  struct PendingMesh {
+    size_t                          mesh_asset_id = 0;
+    std::shared_future<RenderMesh> data;
+  };
+  struct PendingMaterial {
+    size_t                             material_asset_id = 0;
+    std::shared_future<RenderMaterial> data;
+  };
+  std::vector<PendingMesh>              pending_meshes_;
+  std::vector<PendingMaterial>          pending_materials_;
+  std::chrono::steady_clock::time_point stream_start_;
+
+  // staging bytes the ready assets may upload in one frame, at least one asset goes every frame
+  static constexpr size_t kUploadBytesPerFrame = 64 << 20;
 
   void ProcessSwapData();
+  void UploadReadyAssets();
+  void LogResourceStatistics();
 };
 
 }  // namespace vkengine
@@ -0,0 +1,153 @@
+#include "function/render/rhi/descriptor_allocator.h"
+
+#include <algorithm>
+#include <array>
+
+#include "core/exception/assert_exception.h"
+
+namespace vkengine {
+
+namespace {
+// descriptors per set for every type, a pool of n sets holds n * ratio of each
+struct PoolSizeRatio {
+  VkDescriptorType type;
+  float            ratio;
+};
+constexpr std::array<PoolSizeRatio, 6> kPoolSizeRatios = {{
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+    {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1.0f},
+    {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+    {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+}};
+}  // namespace
+
+void DescriptorAllocator::Init(VkDevice logic_device, uint32_t frame_count) {
+  logic_device_ = logic_device;
+  transient_.resize(frame_count);
+}
+
+void DescriptorAllocator::Destroy() {
+  const auto destroy_chain = [this](PoolChain& chain) {
+    for (auto pool : chain.pools) {
+      vkDestroyDescriptorPool(logic_device_, pool, nullptr);
+    }
+    for (auto pool : chain.free_pools) {
+      vkDestroyDescriptorPool(logic_device_, pool, nullptr);
+    }
+    chain = PoolChain{};
+  };
+  destroy_chain(persistent_);
+  for (auto& chain : transient_) {
+    destroy_chain(chain);
+  }
+  transient_.clear();
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t max_sets) {
+  std::array<VkDescriptorPoolSize, kPoolSizeRatios.size()> poolSizes{};
+  for (size_t i = 0; i < kPoolSizeRatios.size(); i++) {
+    poolSizes[i].type            = kPoolSizeRatios[i].type;
+    poolSizes[i].descriptorCount = static_cast<uint32_t>(kPoolSizeRatios[i].ratio * max_sets);
+  }
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.maxSets       = max_sets;
+
+  VkDescriptorPool pool = VK_NULL_HANDLE;
+  ASSERT_EXECPTION(vkCreateDescriptorPool(logic_device_, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+      .SetErrorMessage("failed to CreateDescriptorPool!")
+      .Throw();
+  return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::GrowChain(PoolChain& chain) {
+  VkDescriptorPool pool = VK_NULL_HANDLE;
+  if (!chain.free_pools.empty()) {
+    pool = chain.free_pools.back();
+    chain.free_pools.pop_back();
+  } else {
+    pool = CreatePool(chain.next_pool_sets);
+    // the chain already needed sets_allocated sets, the next pool holds at least as many
+    chain.next_pool_sets =
+        std::min(std::max(chain.next_pool_sets * 2, chain.sets_allocated), kMaxPoolSets);
+  }
+  chain.pools.push_back(pool);
+  return pool;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(PoolChain& chain, VkDescriptorSetLayout layout) {
+  VkDescriptorPool pool = chain.pools.empty() ? GrowChain(chain) : chain.pools.back();
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool     = pool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts        = &layout;
+
+  VkDescriptorSet set    = VK_NULL_HANDLE;
+  VkResult        result = vkAllocateDescriptorSets(logic_device_, &allocInfo, &set);
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    allocInfo.descriptorPool = GrowChain(chain);
+    result                   = vkAllocateDescriptorSets(logic_device_, &allocInfo, &set);
+  }
+  ASSERT_EXECPTION(result != VK_SUCCESS)
+      .SetErrorMessage("failed to allocate descriptor set!")
+      .Throw();
+
+  chain.sets_allocated++;
+  sets_allocated_++;
+  return set;
+}
+
+VkDescriptorSet DescriptorAllocator::AllocatePersistent(VkDescriptorSetLayout layout) {
+  return Allocate(persistent_, layout);
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(
+    uint32_t frame, VkDescriptorSetLayout layout) {
+  return Allocate(transient_[frame], layout);
+}
+
+void DescriptorAllocator::ResetFrame(uint32_t frame) {
+  auto& chain = transient_[frame];
+  if (chain.pools.size() > 1) {
+    // the frame outgrew its pool, replace the chain with a single pool sized for the peak
+    for (auto pool : chain.pools) {
+      vkDestroyDescriptorPool(logic_device_, pool, nullptr);
+    }
+    for (auto pool : chain.free_pools) {
+      vkDestroyDescriptorPool(logic_device_, pool, nullptr);
+    }
+    chain.pools.clear();
+    chain.free_pools.clear();
+    chain.next_pool_sets = std::min(std::max(chain.sets_allocated, kInitialPoolSets), kMaxPoolSets);
+  } else {
+    for (auto pool : chain.pools) {
+      vkResetDescriptorPool(logic_device_, pool, 0);
+      chain.free_pools.push_back(pool);
+    }
+    chain.pools.clear();
+  }
+  chain.sets_allocated = 0;
+  total_frame_resets_++;
+}
+
+DescriptorAllocatorStatistics DescriptorAllocator::GetStatistics(uint32_t frame) const {
+  DescriptorAllocatorStatistics stats;
+  stats.sets_allocated     = sets_allocated_;
+  stats.total_frame_resets = total_frame_resets_;
+  stats.pools_in_use       = static_cast<uint32_t>(persistent_.pools.size());
+  for (const auto& chain : transient_) {
+    stats.pools_in_use += static_cast<uint32_t>(chain.pools.size());
+  }
+  if (frame < transient_.size()) {
+    stats.transient_sets_this_frame = transient_[frame].sets_allocated;
+  }
+  return stats;
+}
+
+}  // namespace vkengine
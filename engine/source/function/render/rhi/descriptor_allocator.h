@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace vkengine {
+
+struct DescriptorAllocatorStatistics {
+  uint64_t sets_allocated = 0;
+  uint32_t pools_in_use   = 0;
+  // since Init, over all frame slots
+  uint64_t total_frame_resets = 0;
+  // transient sets handed out since the last reset of the current frame
+  uint32_t transient_sets_this_frame = 0;
+};
+
+// hands out descriptor sets from chains of descriptor pools. when a pool runs out a new one
+// is chained, sized from the number of sets the chain needed so far.
+// persistent sets (materials) live until Destroy, transient sets live until their frame
+// slot is reset, which recycles every pool of the frame at once
+class DescriptorAllocator {
+ public:
+  static constexpr uint32_t kInitialPoolSets = 64;
+  static constexpr uint32_t kMaxPoolSets     = 4096;
+
+  DescriptorAllocator() {}
+  ~DescriptorAllocator() {}
+
+  void Init(VkDevice logic_device, uint32_t frame_count);
+  void Destroy();
+
+  VkDescriptorSet AllocatePersistent(VkDescriptorSetLayout layout);
+  VkDescriptorSet AllocateTransient(uint32_t frame, VkDescriptorSetLayout layout);
+  // the gpu must be done with every set of the frame
+  void ResetFrame(uint32_t frame);
+
+  DescriptorAllocatorStatistics GetStatistics(uint32_t frame) const;
+
+ private:
+  struct PoolChain {
+    // pools that are full or in use, the last one is allocated from
+    std::vector<VkDescriptorPool> pools;
+    // reset pools ready to be reused
+    std::vector<VkDescriptorPool> free_pools;
+    uint32_t                      next_pool_sets = kInitialPoolSets;
+    // sets allocated since the last reset, the observed usage
+    uint32_t sets_allocated = 0;
+  };
+
+  VkDevice               logic_device_ = VK_NULL_HANDLE;
+  PoolChain              persistent_;
+  std::vector<PoolChain> transient_;
+  uint64_t               sets_allocated_     = 0;
+  uint64_t               total_frame_resets_ = 0;
+
+  VkDescriptorPool CreatePool(uint32_t max_sets);
+  VkDescriptorPool GrowChain(PoolChain& chain);
+  VkDescriptorSet  Allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+};
+
+}  // namespace vkengine
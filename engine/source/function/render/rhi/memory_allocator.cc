@@ -0,0 +1,279 @@
+#include "function/render/rhi/memory_allocator.h"
+
+#include <algorithm>
+
+#include "core/exception/assert_exception.h"
+
+namespace vkengine {
+
+namespace {
+uint8_t OrderOf(VkDeviceSize size) {
+  uint8_t order = 0;
+  while ((VkDeviceSize(1) << order) < size) {
+    order++;
+  }
+  return order;
+}
+}  // namespace
+
+BuddyBlock::BuddyBlock(uint8_t max_order)
+    : max_order_(max_order), free_bytes_(VkDeviceSize(1) << max_order) {
+  free_lists_.resize(max_order_ - kMinOrder + 1);
+  FreeList(max_order_).insert(0);
+}
+
+bool BuddyBlock::Allocate(
+    VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint8_t& order) {
+  uint8_t need = std::max(OrderOf(std::max(size, alignment)), kMinOrder);
+  if (need > max_order_) {
+    return false;
+  }
+  uint8_t found = need;
+  while (found <= max_order_ && FreeList(found).empty()) {
+    found++;
+  }
+  if (found > max_order_) {
+    return false;
+  }
+
+  auto& list = FreeList(found);
+  offset     = *list.begin();
+  list.erase(list.begin());
+  // split down, the upper half of every split goes back to the free list
+  while (found > need) {
+    found--;
+    FreeList(found).insert(offset + (VkDeviceSize(1) << found));
+  }
+  order = need;
+  free_bytes_ -= VkDeviceSize(1) << need;
+  return true;
+}
+
+void BuddyBlock::Free(VkDeviceSize offset, uint8_t order) {
+  free_bytes_ += VkDeviceSize(1) << order;
+  while (order < max_order_) {
+    const VkDeviceSize buddy = offset ^ (VkDeviceSize(1) << order);
+    auto&              list  = FreeList(order);
+    const auto         it    = list.find(buddy);
+    if (it == list.end()) {
+      break;
+    }
+    list.erase(it);
+    offset = std::min(offset, buddy);
+    order++;
+  }
+  FreeList(order).insert(offset);
+}
+
+VkDeviceSize BuddyBlock::LargestFreeRange() const {
+  for (uint8_t order = max_order_; order >= kMinOrder; order--) {
+    if (!FreeList(order).empty()) {
+      return VkDeviceSize(1) << order;
+    }
+  }
+  return 0;
+}
+
+void VulkanMemoryAllocator::Init(VkPhysicalDevice physical_device, VkDevice logic_device) {
+  logic_device_ = logic_device;
+  vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties_);
+
+  for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+    const VkDeviceSize heap_size =
+        memory_properties_.memoryHeaps[memory_properties_.memoryTypes[i].heapIndex].size;
+    // small heaps (e.g. 256MB host visible device local) get proportionally smaller blocks
+    VkDeviceSize block_size = kDefaultBlockSize;
+    while (block_size > heap_size / 8 && block_size > (VkDeviceSize(1) << 20)) {
+      block_size >>= 1;
+    }
+    for (auto& pool : pools_[i]) {
+      pool.block_order = OrderOf(block_size);
+    }
+  }
+}
+
+void VulkanMemoryAllocator::Destroy() {
+  for (auto& type_pools : pools_) {
+    for (auto& pool : type_pools) {
+      for (auto& block : pool.blocks) {
+        if (block.memory != VK_NULL_HANDLE) {
+          vkFreeMemory(logic_device_, block.memory, nullptr);
+        }
+      }
+      pool.blocks.clear();
+    }
+  }
+}
+
+bool VulkanMemoryAllocator::IsHostVisible(uint32_t memory_type) const {
+  return memory_properties_.memoryTypes[memory_type].propertyFlags &
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+uint32_t VulkanMemoryAllocator::FindMemoryType(
+    uint32_t type_bits, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < memory_properties_.memoryTypeCount; i++) {
+    if (type_bits & (1 << i) &&
+        (memory_properties_.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  ASSERT_EXECPTION(true).SetErrorMessage("failed to find suitable memory type!").Throw();
+  return 0;
+}
+
+VkDeviceMemory VulkanMemoryAllocator::AllocateDeviceMemory(
+    VkDeviceSize size, uint32_t memory_type, void** mapped) {
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize  = size;
+  allocInfo.memoryTypeIndex = memory_type;
+
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  ASSERT_EXECPTION(vkAllocateMemory(logic_device_, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+      .SetErrorMessage("failed to allocate device memory!")
+      .Throw();
+
+  *mapped = nullptr;
+  if (IsHostVisible(memory_type)) {
+    vkMapMemory(logic_device_, memory, 0, VK_WHOLE_SIZE, 0, mapped);
+  }
+  return memory;
+}
+
+VulkanAllocation VulkanMemoryAllocator::Allocate(
+    const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags       properties,
+    bool                        linear,
+    bool                        dedicated) {
+  VulkanAllocation allocation;
+  allocation.memory_type = FindMemoryType(requirements.memoryTypeBits, properties);
+  allocation.size        = requirements.size;
+  allocation.linear      = linear;
+
+  auto&              pool       = pools_[allocation.memory_type][linear ? 1 : 0];
+  const VkDeviceSize block_size = VkDeviceSize(1) << pool.block_order;
+  // anything taking a large share of a block is cheaper to give its own memory
+  if (dedicated || requirements.size > block_size / 2) {
+    void* mapped      = nullptr;
+    allocation.memory = AllocateDeviceMemory(requirements.size, allocation.memory_type, &mapped);
+    allocation.mapped = mapped;
+    allocation.offset      = 0;
+    allocation.block_index = -1;
+    dedicated_bytes_ += requirements.size;
+    dedicated_allocation_count_++;
+    used_bytes_ += requirements.size;
+    allocation_count_++;
+    return allocation;
+  }
+
+  int32_t      block_index = -1;
+  VkDeviceSize offset      = 0;
+  uint8_t      order       = 0;
+  for (size_t i = 0; i < pool.blocks.size(); i++) {
+    auto& block = pool.blocks[i];
+    if (block.memory != VK_NULL_HANDLE &&
+        block.buddy->Allocate(requirements.size, requirements.alignment, offset, order)) {
+      block_index = static_cast<int32_t>(i);
+      break;
+    }
+  }
+  if (block_index < 0) {
+    Block block;
+    void* mapped = nullptr;
+    block.memory = AllocateDeviceMemory(block_size, allocation.memory_type, &mapped);
+    block.mapped = static_cast<uint8_t*>(mapped);
+    block.buddy  = std::make_unique<BuddyBlock>(pool.block_order);
+    if (!block.buddy->Allocate(requirements.size, requirements.alignment, offset, order)) {
+      // the size rounded up to its alignment does not fit even an empty block
+      vkFreeMemory(logic_device_, block.memory, nullptr);
+      ASSERT_EXECPTION(true).SetErrorMessage("failed to suballocate from a new block!").Throw();
+    }
+
+    const auto empty_slot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](auto& b) {
+      return b.memory == VK_NULL_HANDLE;
+    });
+    if (empty_slot != pool.blocks.end()) {
+      *empty_slot = std::move(block);
+      block_index = static_cast<int32_t>(empty_slot - pool.blocks.begin());
+    } else {
+      pool.blocks.emplace_back(std::move(block));
+      block_index = static_cast<int32_t>(pool.blocks.size() - 1);
+    }
+  }
+
+  const auto& block      = pool.blocks[block_index];
+  allocation.memory      = block.memory;
+  allocation.offset      = offset;
+  allocation.order       = order;
+  allocation.block_index = block_index;
+  allocation.mapped      = block.mapped ? block.mapped + offset : nullptr;
+  used_bytes_ += requirements.size;
+  allocation_count_++;
+  return allocation;
+}
+
+void VulkanMemoryAllocator::Free(VulkanAllocation& allocation) {
+  if (allocation.memory == VK_NULL_HANDLE) {
+    return;
+  }
+  used_bytes_ -= allocation.size;
+  allocation_count_--;
+
+  if (allocation.block_index < 0) {
+    vkFreeMemory(logic_device_, allocation.memory, nullptr);
+    dedicated_bytes_ -= allocation.size;
+    dedicated_allocation_count_--;
+  } else {
+    auto& pool  = pools_[allocation.memory_type][allocation.linear ? 1 : 0];
+    auto& block = pool.blocks[allocation.block_index];
+    block.buddy->Free(allocation.offset, allocation.order);
+
+    // keep one empty block around per pool so alloc/free cycles do not thrash the driver
+    if (block.buddy->Empty()) {
+      const auto other_empty =
+          std::count_if(pool.blocks.begin(), pool.blocks.end(), [&block](const Block& b) {
+            return &b != &block && b.memory != VK_NULL_HANDLE && b.buddy->Empty();
+          });
+      if (other_empty > 0) {
+        vkFreeMemory(logic_device_, block.memory, nullptr);
+        block.memory = VK_NULL_HANDLE;
+        block.mapped = nullptr;
+        block.buddy.reset();
+      }
+    }
+  }
+  allocation = VulkanAllocation{};
+}
+
+MemoryAllocatorStatistics VulkanMemoryAllocator::GetStatistics() const {
+  MemoryAllocatorStatistics stats;
+  stats.used_bytes                 = used_bytes_;
+  stats.reserved_bytes             = dedicated_bytes_;
+  stats.allocation_count           = allocation_count_;
+  stats.dedicated_allocation_count = dedicated_allocation_count_;
+  stats.device_allocation_count    = dedicated_allocation_count_;
+
+  VkDeviceSize free_bytes    = 0;
+  VkDeviceSize largest_range = 0;
+  for (const auto& type_pools : pools_) {
+    for (const auto& pool : type_pools) {
+      for (const auto& block : pool.blocks) {
+        if (block.memory == VK_NULL_HANDLE) {
+          continue;
+        }
+        stats.reserved_bytes += block.buddy->Size();
+        stats.device_allocation_count++;
+        free_bytes += block.buddy->FreeBytes();
+        largest_range = std::max(largest_range, block.buddy->LargestFreeRange());
+      }
+    }
+  }
+  if (free_bytes > 0) {
+    stats.fragmentation =
+        1.0f - static_cast<float>(largest_range) / static_cast<float>(free_bytes);
+  }
+  return stats;
+}
+
+}  // namespace vkengine
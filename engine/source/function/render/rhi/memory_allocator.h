@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace vkengine {
+
+struct VulkanAllocation {
+  VkDeviceMemory memory = VK_NULL_HANDLE;
+  VkDeviceSize   offset = 0;
+  VkDeviceSize   size   = 0;
+  // persistently mapped pointer for host visible memory, nullptr otherwise
+  void* mapped = nullptr;
+
+  uint32_t memory_type = 0;
+  // index of the owning block in its pool, -1 for dedicated allocations
+  int32_t block_index = -1;
+  uint8_t order       = 0;
+  bool    linear      = true;
+};
+
+struct MemoryAllocatorStatistics {
+  VkDeviceSize reserved_bytes = 0;
+  VkDeviceSize used_bytes     = 0;
+  // live vkAllocateMemory handles, blocks and dedicated allocations
+  uint32_t device_allocation_count    = 0;
+  uint32_t allocation_count           = 0;
+  uint32_t dedicated_allocation_count = 0;
+  // 1 - largest free range / total free bytes, 0 means no fragmentation
+  float fragmentation = 0.0f;
+};
+
+// power of two buddy suballocator over one VkDeviceMemory block. every node offset is a
+// multiple of its size, so any alignment up to the node size comes for free
+class BuddyBlock {
+ public:
+  static constexpr uint8_t kMinOrder = 8;  // 256 bytes
+
+  BuddyBlock(uint8_t max_order);
+
+  // return false if no node of the needed order is free
+  bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint8_t& order);
+  void Free(VkDeviceSize offset, uint8_t order);
+
+  bool         Empty() const { return free_bytes_ == Size(); }
+  VkDeviceSize Size() const { return VkDeviceSize(1) << max_order_; }
+  VkDeviceSize FreeBytes() const { return free_bytes_; }
+  VkDeviceSize LargestFreeRange() const;
+
+ private:
+  uint8_t      max_order_;
+  VkDeviceSize free_bytes_;
+  // free node offsets for every order in [kMinOrder, max_order_]
+  std::vector<std::set<VkDeviceSize>> free_lists_;
+
+  std::set<VkDeviceSize>& FreeList(uint8_t order) { return free_lists_[order - kMinOrder]; }
+  const std::set<VkDeviceSize>& FreeList(uint8_t order) const {
+    return free_lists_[order - kMinOrder];
+  }
+};
+
+// block based device memory allocator, one pool of large blocks per memory type.
+// linear (buffers) and optimal (images) resources live in separate blocks so that
+// bufferImageGranularity never has to be considered between neighbours
+class VulkanMemoryAllocator {
+ public:
+  static constexpr VkDeviceSize kDefaultBlockSize = 64 * 1024 * 1024;
+  // images at least this large always get a dedicated allocation
+  static constexpr VkDeviceSize kDedicatedImageSize = 16 * 1024 * 1024;
+
+  VulkanMemoryAllocator() {}
+  ~VulkanMemoryAllocator() {}
+
+  void Init(VkPhysicalDevice physical_device, VkDevice logic_device);
+  void Destroy();
+
+  VulkanAllocation Allocate(
+      const VkMemoryRequirements& requirements,
+      VkMemoryPropertyFlags       properties,
+      bool                        linear,
+      bool                        dedicated = false);
+  void Free(VulkanAllocation& allocation);
+
+  MemoryAllocatorStatistics GetStatistics() const;
+
+ private:
+  struct Block {
+    VkDeviceMemory              memory = VK_NULL_HANDLE;
+    uint8_t*                    mapped = nullptr;
+    std::unique_ptr<BuddyBlock> buddy;
+  };
+  struct Pool {
+    // slots are reused, a released block leaves an empty slot behind
+    std::vector<Block> blocks;
+    uint8_t            block_order = 0;
+  };
+
+  VkDevice                         logic_device_ = VK_NULL_HANDLE;
+  VkPhysicalDeviceMemoryProperties memory_properties_{};
+  // [memory type][linear]
+  std::array<std::array<Pool, 2>, VK_MAX_MEMORY_TYPES> pools_;
+
+  VkDeviceSize used_bytes_                 = 0;
+  VkDeviceSize dedicated_bytes_            = 0;
+  uint32_t     allocation_count_           = 0;
+  uint32_t     dedicated_allocation_count_ = 0;
+
+  uint32_t       FindMemoryType(uint32_t type_bits, VkMemoryPropertyFlags properties) const;
+  VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memory_type, void** mapped);
+  bool           IsHostVisible(uint32_t memory_type) const;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,95 @@
+#include "function/render/rhi/staging_ring_buffer.h"
+
+#include <algorithm>
+
+#include "core/exception/assert_exception.h"
+#include "function/render/rhi/vulkanutils.h"
+
+namespace vkengine {
+
+void StagingRingBuffer::Init(
+    VkPhysicalDevice physical_device, VkDevice logic_device, VkDeviceSize capacity) {
+  logic_device_ = logic_device;
+  capacity_     = capacity;
+
+  VkBufferCreateInfo bufferInfo{};
+  bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  bufferInfo.size        = capacity_;
+  bufferInfo.usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  ASSERT_EXECPTION(vkCreateBuffer(logic_device_, &bufferInfo, nullptr, &buffer_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create staging ring buffer!")
+      .Throw();
+
+  VkMemoryRequirements memRequirements;
+  vkGetBufferMemoryRequirements(logic_device_, buffer_, &memRequirements);
+
+  VkMemoryAllocateInfo allocInfo{};
+  allocInfo.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  allocInfo.allocationSize  = memRequirements.size;
+  allocInfo.memoryTypeIndex = FindMemoryType(
+      physical_device,
+      memRequirements.memoryTypeBits,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  ASSERT_EXECPTION(vkAllocateMemory(logic_device_, &allocInfo, nullptr, &memory_) != VK_SUCCESS)
+      .SetErrorMessage("failed to allocate staging ring memory!")
+      .Throw();
+  vkBindBufferMemory(logic_device_, buffer_, memory_, 0);
+
+  void* data = nullptr;
+  vkMapMemory(logic_device_, memory_, 0, VK_WHOLE_SIZE, 0, &data);
+  mapped_ = static_cast<uint8_t*>(data);
+  head_   = 0;
+  tail_   = 0;
+}
+
+void StagingRingBuffer::Destroy() {
+  if (buffer_ == VK_NULL_HANDLE) {
+    return;
+  }
+  vkUnmapMemory(logic_device_, memory_);
+  vkDestroyBuffer(logic_device_, buffer_, nullptr);
+  vkFreeMemory(logic_device_, memory_, nullptr);
+  buffer_ = VK_NULL_HANDLE;
+  memory_ = VK_NULL_HANDLE;
+  mapped_ = nullptr;
+}
+
+bool StagingRingBuffer::Allocate(
+    VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation) {
+  if (size > capacity_) {
+    return false;
+  }
+  alignment = std::max<VkDeviceSize>(alignment, 1);
+
+  uint64_t     position = head_;
+  VkDeviceSize offset   = position % capacity_;
+  VkDeviceSize aligned  = (offset + alignment - 1) / alignment * alignment;
+  if (aligned + size > capacity_) {
+    // not enough room before the end, skip the tail and start over at offset 0
+    position += capacity_ - offset;
+    aligned = 0;
+  } else {
+    position += aligned - offset;
+  }
+  if (position + size - tail_ > capacity_) {
+    return false;
+  }
+
+  allocation.buffer = buffer_;
+  allocation.offset = aligned;
+  allocation.size   = size;
+  allocation.mapped = mapped_ + aligned;
+  head_             = position + size;
+  return true;
+}
+
+void StagingRingBuffer::Retire(uint64_t position) {
+  if (position > tail_) {
+    tail_ = std::min(position, head_);
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vulkan/vulkan.h"
+
+namespace vkengine {
+
+struct StagingAllocation {
+  VkBuffer     buffer = VK_NULL_HANDLE;
+  VkDeviceSize offset = 0;
+  VkDeviceSize size   = 0;
+  void*        mapped = nullptr;
+};
+
+// persistently mapped host visible buffer used as a ring for upload data.
+// positions are monotonically increasing, the physical offset is position % capacity,
+// space is handed back with Retire once the gpu has consumed it
+class StagingRingBuffer {
+ public:
+  StagingRingBuffer() {}
+  ~StagingRingBuffer() {}
+
+  void Init(VkPhysicalDevice physical_device, VkDevice logic_device, VkDeviceSize capacity);
+  void Destroy();
+
+  // return false if there is not enough free space, caller should retire some batches first
+  bool Allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation);
+  // release all space allocated before position
+  void Retire(uint64_t position);
+
+  uint64_t     Head() const { return head_; }
+  VkDeviceSize Capacity() const { return capacity_; }
+  VkDeviceSize Used() const { return static_cast<VkDeviceSize>(head_ - tail_); }
+
+ private:
+  VkDevice       logic_device_ = VK_NULL_HANDLE;
+  VkBuffer       buffer_       = VK_NULL_HANDLE;
+  VkDeviceMemory memory_       = VK_NULL_HANDLE;
+  uint8_t*       mapped_       = nullptr;
+  VkDeviceSize   capacity_     = 0;
+
+  uint64_t head_ = 0;
+  uint64_t tail_ = 0;
+};
+
+}  // namespace vkengine
@@ -1,5 +1,6 @@
 #include "function/render/rhi/vulkanrhi.h"
 
+#include <algorithm>
 #include <array>
 #include <set>
 
@@ -10,6 +11,54 @@
 
 namespace vkengine {
 
+namespace {
+
+// stages of the graphics submit that wait on the upload timeline. the acquire barriers of the
+// uploads start at the same stages, so they chain with the wait and are ordered after the
+// release on the transfer queue
+constexpr VkPipelineStageFlags kUploadWaitStages =
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+// VK_FORMAT_UNDEFINED for formats the rhi can not create images of
+VkFormat GetVulkanImageFormat(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::R8G8B8_UNORM:
+      return VK_FORMAT_R8G8B8_UNORM;
+    case PixelFormat::R8G8B8_SRGB:
+      return VK_FORMAT_R8G8B8_SRGB;
+    case PixelFormat::R8G8B8A8_UNORM:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+    case PixelFormat::R8G8B8A8_SRGB:
+      return VK_FORMAT_R8G8B8A8_SRGB;
+    case PixelFormat::R32G32_FLOAT:
+      return VK_FORMAT_R32G32_SFLOAT;
+    case PixelFormat::R32G32B32_FLOAT:
+      return VK_FORMAT_R32G32B32_SFLOAT;
+    case PixelFormat::R32G32B32A32_FLOAT:
+      return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case PixelFormat::BC1_RGBA_UNORM:
+      return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case PixelFormat::BC1_RGBA_SRGB:
+      return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case PixelFormat::BC3_UNORM:
+      return VK_FORMAT_BC3_UNORM_BLOCK;
+    case PixelFormat::BC3_SRGB:
+      return VK_FORMAT_BC3_SRGB_BLOCK;
+    case PixelFormat::BC5_UNORM:
+      return VK_FORMAT_BC5_UNORM_BLOCK;
+    case PixelFormat::BC7_UNORM:
+      return VK_FORMAT_BC7_UNORM_BLOCK;
+    case PixelFormat::BC7_SRGB:
+      return VK_FORMAT_BC7_SRGB_BLOCK;
+    default:
+      return VK_FORMAT_UNDEFINED;
+  }
+}
+
+}  // namespace
+
 void VulkanRhi::Init(const RHIInitInfo& info) {
   window_ = info.window_system->GetWindow();
 
@@ -19,7 +68,8 @@ void VulkanRhi::Init(const RHIInitInfo& info) {
   PickPhysicalDevice();
   CreateLogicalDevice();
   CreateCommandPool();
-  CreateDescriptorPool();
+  CreateUploadResources();
+  descriptor_allocator_.Init(logic_device_, kMaxFramesInFight);
   CreateSyncObjects();
   CreateSwapChain();
 
@@ -37,7 +87,7 @@ void VulkanRhi::CreateInstance() {
   app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   app_info.pEngineName        = "No Engine";
   app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-  app_info.apiVersion         = VK_API_VERSION_1_0;
+  app_info.apiVersion         = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo create_info{};
   create_info.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -111,7 +161,9 @@ void VulkanRhi::CreateLogicalDevice() {
   queue_family_ = QueueFamilyIndices::FindQueueFamilies(physical_device_, surface_);
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t>                   uniqueQueueFamilies = {
-                        queue_family_.graphics_family.value(), queue_family_.present_family.value()};
+                        queue_family_.graphics_family.value(),
+                        queue_family_.present_family.value(),
+                        queue_family_.transfer_family.value()};
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -125,8 +177,58 @@ void VulkanRhi::CreateLogicalDevice() {
 
   VkPhysicalDeviceFeatures deviceFeatures{};
   // TODO: more features here
+  VkPhysicalDeviceVulkan12Features supported12{};
+  supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supported{};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supported.pNext = &supported12;
+  vkGetPhysicalDeviceFeatures2(physical_device_, &supported);
+
+  VkPhysicalDeviceVulkan12Features vulkan12Features{};
+  vulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  vulkan12Features.timelineSemaphore = VK_TRUE;
+
+  device_capabilities_.draw_indirect_first_instance = supported.features.drawIndirectFirstInstance;
+  device_capabilities_.multi_draw_indirect          = supported.features.multiDrawIndirect;
+  device_capabilities_.draw_indirect_count          = supported12.drawIndirectCount;
+  device_capabilities_.texture_compression_bc       = supported.features.textureCompressionBC;
+  deviceFeatures.drawIndirectFirstInstance          = supported.features.drawIndirectFirstInstance;
+  deviceFeatures.multiDrawIndirect                  = supported.features.multiDrawIndirect;
+  deviceFeatures.textureCompressionBC               = supported.features.textureCompressionBC;
+  vulkan12Features.drawIndirectCount                = supported12.drawIndirectCount;
+
+  // descriptor indexing is core in 1.2 but every piece of it is optional
+  device_capabilities_.bindless =
+      supported12.runtimeDescriptorArray && supported12.descriptorBindingPartiallyBound &&
+      supported12.descriptorBindingVariableDescriptorCount &&
+      supported12.shaderSampledImageArrayNonUniformIndexing &&
+      supported12.descriptorBindingSampledImageUpdateAfterBind &&
+      supported12.descriptorBindingStorageBufferUpdateAfterBind;
+  if (device_capabilities_.bindless) {
+    vulkan12Features.runtimeDescriptorArray                        = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound               = VK_TRUE;
+    vulkan12Features.descriptorBindingVariableDescriptorCount      = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing     = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind  = VK_TRUE;
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(physical_device_, &properties);
+    // a combined image sampler counts against both the sampler and the sampled image limits
+    device_capabilities_.max_bindless_textures = std::min(
+        {properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+         properties12.maxDescriptorSetUpdateAfterBindSamplers,
+         properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         properties12.maxPerStageDescriptorUpdateAfterBindSamplers});
+  }
+
   VkDeviceCreateInfo createInfo{};
   createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext                   = &vulkan12Features;
   createInfo.pQueueCreateInfos       = queueCreateInfos.data();
   createInfo.queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pEnabledFeatures        = &deviceFeatures;
@@ -147,6 +249,9 @@ void VulkanRhi::CreateLogicalDevice() {
 
   vkGetDeviceQueue(logic_device_, queue_family_.graphics_family.value(), 0, &graph_queue_);
   vkGetDeviceQueue(logic_device_, queue_family_.present_family.value(), 0, &present_queue_);
+  vkGetDeviceQueue(logic_device_, queue_family_.transfer_family.value(), 0, &transfer_queue_);
+
+  memory_allocator_.Init(physical_device_, logic_device_);
 }
 
 void VulkanRhi::CreateCommandPool() {
@@ -162,41 +267,26 @@ void VulkanRhi::CreateCommandPool() {
 
   command_pools_.resize(kMaxFramesInFight);
   command_buffer_.resize(kMaxFramesInFight);
+  acquire_command_buffer_.resize(kMaxFramesInFight);
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandBufferCount = kMaxFramesInFight;
+  allocInfo.commandBufferCount = 1;
   for (size_t i = 0; i < kMaxFramesInFight; i++) {
     ASSERT_EXECPTION(
         vkCreateCommandPool(logic_device_, &poolInfo, nullptr, &command_pools_[i]) != VK_SUCCESS)
         .SetErrorMessage("failed to create command_pool_")
         .Throw();
     allocInfo.commandPool = command_pools_[i];
-    if (vkAllocateCommandBuffers(logic_device_, &allocInfo, command_buffer_.data()) != VK_SUCCESS) {
+    if (vkAllocateCommandBuffers(logic_device_, &allocInfo, &command_buffer_[i]) != VK_SUCCESS ||
+        vkAllocateCommandBuffers(logic_device_, &allocInfo, &acquire_command_buffer_[i]) !=
+            VK_SUCCESS) {
       throw std::runtime_error("failed to allocate command buffers!");
     }
   }
 }
 
-void VulkanRhi::CreateDescriptorPool() {
-  std::array<VkDescriptorPoolSize, 2> poolSizes{};
-  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-  poolSizes[0].descriptorCount = static_cast<uint32_t>(kMaxFramesInFight);
-  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[1].descriptorCount = static_cast<uint32_t>(kMaxFramesInFight);
-  VkDescriptorPoolCreateInfo poolInfo{};
-  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-  poolInfo.pPoolSizes    = poolSizes.data();
-  poolInfo.maxSets       = static_cast<uint32_t>(kMaxFramesInFight);
-
-  ASSERT_EXECPTION(
-      vkCreateDescriptorPool(logic_device_, &poolInfo, nullptr, &descriptor_pool_) != VK_SUCCESS)
-      .SetErrorMessage("failed to CreateDescriptorPool!")
-      .Throw();
-}
-
 void VulkanRhi::CreateSyncObjects() {
   VkSemaphoreCreateInfo semaphoreInfo{};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -343,11 +433,14 @@ void VulkanRhi::CleanSwapChain() {
   for (size_t i = 0; i < depth_images_.size(); i++) {
     vkDestroyImageView(logic_device_, depth_image_views_[i], nullptr);
     vkDestroyImage(logic_device_, depth_images_[i], nullptr);
-    vkFreeMemory(logic_device_, depth_images_memory_[i], nullptr);
+    memory_allocator_.Free(depth_images_memory_[i]);
   }
 }
 
 void VulkanRhi::CleanUp() {
+  vkDeviceWaitIdle(logic_device_);
+  CleanUploadResources();
+
   for (auto sampler : mipmap_sampler_map) {
     vkDestroySampler(logic_device_, sampler.second, nullptr);
   }
@@ -358,12 +451,13 @@ void VulkanRhi::CleanUp() {
     vkDestroyCommandPool(logic_device_, command_pools_[i], nullptr);
   }
 
-  vkDestroyDescriptorPool(logic_device_, descriptor_pool_, nullptr);
+  descriptor_allocator_.Destroy();
 
   vkDestroyCommandPool(logic_device_, command_pool_, nullptr);
 
   CleanSwapChain();
 
+  memory_allocator_.Destroy();
   vkDestroyDevice(logic_device_, nullptr);
   layer_.reset();
   vkDestroySurfaceKHR(instance_, surface_, nullptr);
@@ -429,6 +523,7 @@ bool VulkanRhi::PrepareBeforePass(std::function<void()> passUpdateAfterRecreateS
 
   vkResetFences(logic_device_, 1, &in_flight_fence_[current_frame_]);
   ResetCommandPool();
+  descriptor_allocator_.ResetFrame(current_frame_);
   // vkResetCommandBuffer(command_buffer_[current_frame_], /*VkCommandBufferResetFlagBits*/ 0);
 
   VkCommandBufferBeginInfo beginInfo{};
@@ -443,19 +538,49 @@ bool VulkanRhi::PrepareBeforePass(std::function<void()> passUpdateAfterRecreateS
 }
 
 void VulkanRhi::SubmitRendering(std::function<void()> passUpdateAfterRecreateSwapchain) {
-  VkSubmitInfo submitInfo{};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  // uploads recorded during this frame go to the transfer queue before the frame itself
+  const uint64_t upload_value = FlushUploads();
+  ASSERT_EXECPTION(vkEndCommandBuffer(command_buffer_[current_frame_]) != VK_SUCCESS)
+      .SetErrorMessage("failed to record command buffer!")
+      .Throw();
 
-  VkSemaphore          waitSemaphores[] = {image_available_semaphore_[current_frame_]};
-  VkPipelineStageFlags waitStages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount         = 1;
-  submitInfo.pWaitSemaphores            = waitSemaphores;
-  submitInfo.pWaitDstStageMask          = waitStages;
+  std::vector<VkCommandBuffer> commandBuffers;
+  if (RecordPendingAcquires(acquire_command_buffer_[current_frame_])) {
+    commandBuffers.push_back(acquire_command_buffer_[current_frame_]);
+  }
+  commandBuffers.push_back(command_buffer_[current_frame_]);
+
+  // only wait on the upload timeline when something was submitted since the last frame
+  std::vector<VkSemaphore>          waitSemaphores = {image_available_semaphore_[current_frame_]};
+  std::vector<VkPipelineStageFlags> waitStages = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  std::vector<uint64_t>             waitValues = {0};
+  if (upload_value > graphics_wait_value_) {
+    waitSemaphores.push_back(upload_timeline_);
+    waitStages.push_back(kUploadWaitStages);
+    waitValues.push_back(upload_value);
+    graphics_wait_value_ = upload_value;
+  }
 
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers    = &command_buffer_[current_frame_];
+  VkSemaphore signalSemaphores[] = {render_finished_semaphore_[current_frame_]};
+  uint64_t    signalValues[]     = {0};
+
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+  timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+  timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+  timelineInfo.signalSemaphoreValueCount = 1;
+  timelineInfo.pSignalSemaphoreValues    = signalValues;
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.pNext              = &timelineInfo;
+  submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+  submitInfo.pWaitSemaphores    = waitSemaphores.data();
+  submitInfo.pWaitDstStageMask  = waitStages.data();
+
+  submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+  submitInfo.pCommandBuffers    = commandBuffers.data();
 
-  VkSemaphore signalSemaphores[]  = {render_finished_semaphore_[current_frame_]};
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores    = signalSemaphores;
 
@@ -530,13 +655,12 @@ VkSampler VulkanRhi::GetOrCreateMipmapSampler(uint32_t width, uint32_t height) {
 }
 
 void VulkanRhi::TransitionImageLayout(
-    VkImage       image,
-    VkFormat      format,
-    VkImageLayout oldLayout,
-    VkImageLayout newLayout,
-    uint32_t      mipleavel) {
-  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
+    VkCommandBuffer commandBuffer,
+    VkImage         image,
+    VkFormat        format,
+    VkImageLayout   oldLayout,
+    VkImageLayout   newLayout,
+    uint32_t        mipleavel) {
   VkImageMemoryBarrier barrier{};
   barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.oldLayout           = oldLayout;
@@ -590,29 +714,39 @@ void VulkanRhi::TransitionImageLayout(
   }
   vkCmdPipelineBarrier(
       commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-  EndSingleTimeCommands(commandBuffer);
 }
 
-void VulkanRhi::CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-  VkCommandBuffer   commandBuffer = BeginSingleTimeCommands();
-  VkBufferImageCopy region{};
-  region.bufferOffset      = 0;
-  region.bufferRowLength   = 0;
-  region.bufferImageHeight = 0;
-
-  region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-  region.imageSubresource.mipLevel       = 0;
-  region.imageSubresource.baseArrayLayer = 0;
-  region.imageSubresource.layerCount     = 1;
-
-  region.imageOffset = {0, 0, 0};
-  region.imageExtent = {width, height, 1};
+void VulkanRhi::CopyBufferToImage(
+    VkCommandBuffer                  commandBuffer,
+    VkBuffer                         buffer,
+    const std::vector<VkDeviceSize>& level_offsets,
+    VkImage                          image,
+    uint32_t                         width,
+    uint32_t                         height) {
+  std::vector<VkBufferImageCopy> regions(level_offsets.size());
+  for (uint32_t level = 0; level < regions.size(); level++) {
+    VkBufferImageCopy& region = regions[level];
+    region.bufferOffset       = level_offsets[level];
+    region.bufferRowLength    = 0;
+    region.bufferImageHeight  = 0;
+
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+
+    // the last blocks of a compressed level may reach over its edge, the extent does not
+    region.imageOffset = {0, 0, 0};
+    region.imageExtent = {std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+  }
 
   vkCmdCopyBufferToImage(
-      commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-  EndSingleTimeCommands(commandBuffer);
+      commandBuffer,
+      buffer,
+      image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(regions.size()),
+      regions.data());
 }
 
 VkImageView VulkanRhi::CreateImageView(
@@ -637,9 +771,11 @@ VkImageView VulkanRhi::CreateImageView(
 }
 
 void VulkanRhi::GenerateMipmaps(
-    VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
-  VkCommandBuffer commandBuffer = BeginSingleTimeCommands();
-
+    VkCommandBuffer commandBuffer,
+    VkImage         image,
+    int32_t         texWidth,
+    int32_t         texHeight,
+    uint32_t        mipLevels) {
   VkImageMemoryBarrier barrier{};
   barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   barrier.image                           = image;
@@ -732,8 +868,6 @@ void VulkanRhi::GenerateMipmaps(
       nullptr,
       1,
       &barrier);
-
-  EndSingleTimeCommands(commandBuffer);
 }
 
 void VulkanRhi::CreateImage(
@@ -745,7 +879,7 @@ void VulkanRhi::CreateImage(
     VkImageUsageFlags     usage,
     VkMemoryPropertyFlags properties,
     VkImage&              image,
-    VkDeviceMemory&       imageMemory) {
+    VulkanAllocation&     imageMemory) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType     = VK_IMAGE_TYPE_2D;
@@ -767,82 +901,88 @@ void VulkanRhi::CreateImage(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(logic_device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      FindMemoryType(physical_device_, memRequirements.memoryTypeBits, properties);
+  imageMemory = memory_allocator_.Allocate(
+      memRequirements,
+      properties,
+      tiling == VK_IMAGE_TILING_LINEAR,
+      memRequirements.size >= VulkanMemoryAllocator::kDedicatedImageSize);
 
-  ASSERT_EXECPTION(vkAllocateMemory(logic_device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-      .SetErrorMessage("failed to create image memory!")
-      .Throw();
+  vkBindImageMemory(logic_device_, image, imageMemory.memory, imageMemory.offset);
+}
+
+bool VulkanRhi::CanGenerateMipmaps(PixelFormat format) const {
+  const VkFormat vulkan_format = GetVulkanImageFormat(format);
+  return !IsBlockCompressed(format) && vulkan_format != VK_FORMAT_UNDEFINED &&
+         SupportsLinearBlit(vulkan_format);
+}
+
+bool VulkanRhi::SupportsLinearBlit(VkFormat format) const {
+  constexpr VkFormatFeatureFlags kRequired = VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                                             VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                             VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
 
-  vkBindImageMemory(logic_device_, image, imageMemory, 0);
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(physical_device_, format, &properties);
+  return (properties.optimalTilingFeatures & kRequired) == kRequired;
 }
 
 void VulkanRhi::CreateGlobalImage(
-    VkImage&        image,
-    VkImageView&    image_view,
-    VkDeviceMemory& image_memory,
-    uint32_t        texture_image_width,
-    uint32_t        texture_image_height,
-    void*           texture_image_pixels,
-    PixelFormat     texture_image_format,
-    uint32_t        miplevels) {
+    VkImage&          image,
+    VkImageView&      image_view,
+    VulkanAllocation& image_memory,
+    uint32_t          texture_image_width,
+    uint32_t          texture_image_height,
+    void*             texture_image_pixels,
+    PixelFormat       texture_image_format,
+    uint32_t          miplevels,
+    uint32_t          pixel_levels) {
   miplevels = (miplevels != 0)
                   ? miplevels
                   : static_cast<uint32_t>(
                         floor(std::log2(std::max(texture_image_width, texture_image_height))) + 1);
 
-  // staging buffer for cpu load data
-  VkBuffer       stagingBuffer;
-  VkDeviceMemory stagingBufferMemory;
-  VkDeviceSize   buffersize;
-  VkFormat       vulkan_image_format;
-  switch (texture_image_format) {
-    case PixelFormat::R8G8B8_UNORM:
-      buffersize          = texture_image_width * texture_image_height * 3;
-      vulkan_image_format = VK_FORMAT_R8G8B8_UNORM;
-      break;
-    case PixelFormat::R8G8B8_SRGB:
-      buffersize          = texture_image_width * texture_image_height * 3;
-      vulkan_image_format = VK_FORMAT_R8G8B8_SRGB;
-      break;
-    case PixelFormat::R8G8B8A8_UNORM:
-      buffersize          = texture_image_width * texture_image_height * 4;
-      vulkan_image_format = VK_FORMAT_R8G8B8A8_UNORM;
-      break;
-    case PixelFormat::R8G8B8A8_SRGB:
-      buffersize          = texture_image_width * texture_image_height * 4;
-      vulkan_image_format = VK_FORMAT_R8G8B8A8_SRGB;
-      break;
-    case PixelFormat::R32G32_FLOAT:
-      buffersize          = texture_image_width * texture_image_height * 4 * 2;
-      vulkan_image_format = VK_FORMAT_R32G32_SFLOAT;
-      break;
-    case PixelFormat::R32G32B32_FLOAT:
-      buffersize          = texture_image_width * texture_image_height * 4 * 3;
-      vulkan_image_format = VK_FORMAT_R32G32B32_SFLOAT;
-      break;
-    case PixelFormat::R32G32B32A32_FLOAT:
-      buffersize          = texture_image_width * texture_image_height * 4 * 4;
-      vulkan_image_format = VK_FORMAT_R32G32B32A32_SFLOAT;
-      break;
-    default:
-      throw std::runtime_error("invalid texture_byte_size");
-      break;
+  const VkDeviceSize texel_size          = GetTexelBlockSize(texture_image_format);
+  const VkFormat     vulkan_image_format = GetVulkanImageFormat(texture_image_format);
+  if (vulkan_image_format == VK_FORMAT_UNDEFINED) {
+    throw std::runtime_error("invalid texture_byte_size");
+  }
+
+  // the caller filters the levels of formats that can not be blitted, see CanGenerateMipmaps
+  ASSERT_EXECPTION(
+      pixel_levels <= 1 && miplevels > 1 && !IsBlockCompressed(texture_image_format) &&
+      !SupportsLinearBlit(vulkan_image_format))
+      .SetErrorMessage("texture format can not be blitted into mips, pass all of its levels!")
+      .Throw();
+  // blits can not write block compressed images, their levels come from the cooker
+  const bool generate_mips = pixel_levels <= 1 && !IsBlockCompressed(texture_image_format);
+  if (!generate_mips) {
+    miplevels = std::max(pixel_levels, 1u);
+  }
+
+  // bufferOffset of a copy must be a multiple of both the texel (block) size and 4, every level
+  // starts at such an offset of the staging memory
+  const VkDeviceSize        alignment  = texel_size * 4;
+  const uint32_t            levels     = generate_mips ? 1 : miplevels;
+  std::vector<VkDeviceSize> level_offsets(levels);
+  std::vector<size_t>       level_sizes(levels);
+  VkDeviceSize              buffersize = 0;
+  for (uint32_t level = 0; level < levels; level++) {
+    const size_t size = GetMipLevelSize(
+        texture_image_format, texture_image_width, texture_image_height, level);
+
+    buffersize           = (buffersize + alignment - 1) / alignment * alignment;
+    level_offsets[level] = buffersize;
+    level_sizes[level]   = size;
+    buffersize += size;
   }
-  CreateBuffer(
-      buffersize,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      stagingBuffer,
-      stagingBufferMemory);
-  void* data;
 
-  vkMapMemory(logic_device_, stagingBufferMemory, 0, buffersize, 0, &data);
-  memcpy(data, texture_image_pixels, (size_t)buffersize);
-  vkUnmapMemory(logic_device_, stagingBufferMemory);
+  const auto  staging = AllocateStaging(buffersize, alignment);
+  const auto* pixels  = static_cast<const char*>(texture_image_pixels);
+  for (uint32_t level = 0; level < levels; level++) {
+    memcpy(static_cast<char*>(staging.mapped) + level_offsets[level], pixels, level_sizes[level]);
+    pixels += level_sizes[level];
+    level_offsets[level] += staging.offset;
+  }
 
   CreateImage(
       texture_image_width,
@@ -856,28 +996,46 @@ void VulkanRhi::CreateGlobalImage(
       image,
       image_memory);
 
+  VkCommandBuffer command_buffer = GetUploadCommandBuffer();
   TransitionImageLayout(
+      command_buffer,
       image,
       vulkan_image_format,
       VK_IMAGE_LAYOUT_UNDEFINED,
       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
       miplevels);
+  // a single copy with a region per level
   CopyBufferToImage(
-      stagingBuffer,
+      command_buffer,
+      staging.buffer,
+      level_offsets,
       image,
       static_cast<uint32_t>(texture_image_width),
       static_cast<uint32_t>(texture_image_height));
-  TransitionImageLayout(
-      image,
-      VK_FORMAT_R8G8B8A8_SRGB,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-      miplevels);
-
-  vkDestroyBuffer(logic_device_, stagingBuffer, nullptr);
-  vkFreeMemory(logic_device_, stagingBufferMemory, nullptr);
+  if (queue_family_.HasDedicatedTransfer()) {
+    // blits need a graphics queue, mips are generated after the acquire of the next frame
+    ReleaseImage(command_buffer, image, miplevels);
+    upload_batches_[upload_batch_index_].images.push_back(
+        {image,
+         static_cast<int32_t>(texture_image_width),
+         static_cast<int32_t>(texture_image_height),
+         miplevels,
+         generate_mips});
+  } else if (generate_mips) {
+    // leaves every level in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    GenerateMipmaps(command_buffer, image, texture_image_width, texture_image_height, miplevels);
+  } else {
+    TransitionImageLayout(
+        command_buffer,
+        image,
+        vulkan_image_format,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        miplevels);
+  }
+  upload_statistics_.bytes += buffersize;
+  upload_statistics_.copies++;
 
-  GenerateMipmaps(image, texture_image_width, texture_image_height, miplevels);
   image_view = CreateImageView(image, vulkan_image_format, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
 }
 
@@ -886,7 +1044,7 @@ void VulkanRhi::CreateBuffer(
     VkBufferUsageFlags    usage,
     VkMemoryPropertyFlags properties,
     VkBuffer&             buffer,
-    VkDeviceMemory&       bufferMemory) {
+    VulkanAllocation&     bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size        = size;
@@ -900,17 +1058,23 @@ void VulkanRhi::CreateBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(logic_device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType          = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex =
-      FindMemoryType(physical_device_, memRequirements.memoryTypeBits, properties);
+  bufferMemory = memory_allocator_.Allocate(memRequirements, properties, true);
+  vkBindBufferMemory(logic_device_, buffer, bufferMemory.memory, bufferMemory.offset);
+}
 
-  ASSERT_EXECPTION(
-      vkAllocateMemory(logic_device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-      .SetErrorMessage("failed to create vertex buffer memory!")
-      .Throw();
-  vkBindBufferMemory(logic_device_, buffer, bufferMemory, 0);
+void VulkanRhi::DestroyBuffer(VkBuffer& buffer, VulkanAllocation& bufferMemory) {
+  vkDestroyBuffer(logic_device_, buffer, nullptr);
+  memory_allocator_.Free(bufferMemory);
+  buffer = VK_NULL_HANDLE;
+}
+
+void VulkanRhi::DestroyImage(
+    VkImage& image, VkImageView& image_view, VulkanAllocation& image_memory) {
+  vkDestroyImageView(logic_device_, image_view, nullptr);
+  vkDestroyImage(logic_device_, image, nullptr);
+  memory_allocator_.Free(image_memory);
+  image      = VK_NULL_HANDLE;
+  image_view = VK_NULL_HANDLE;
 }
 
 void VulkanRhi::CopyBuffer(
@@ -926,4 +1090,367 @@ void VulkanRhi::CopyBuffer(
   EndSingleTimeCommands(commandBuffer);
 }
 
-}  // namespace vkengine
\ No newline at end of file
+void VulkanRhi::CreateUploadResources() {
+  staging_ring_.Init(physical_device_, logic_device_, kStagingRingSize);
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = queue_family_.transfer_family.value();
+  ASSERT_EXECPTION(
+      vkCreateCommandPool(logic_device_, &poolInfo, nullptr, &upload_command_pool_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create upload_command_pool_")
+      .Throw();
+
+  VkSemaphoreTypeCreateInfo timelineInfo{};
+  timelineInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+  timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+  timelineInfo.initialValue  = 0;
+  VkSemaphoreCreateInfo semaphoreInfo{};
+  semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  semaphoreInfo.pNext = &timelineInfo;
+  ASSERT_EXECPTION(
+      vkCreateSemaphore(logic_device_, &semaphoreInfo, nullptr, &upload_timeline_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create upload_timeline_!")
+      .Throw();
+  upload_timeline_value_ = 0;
+  graphics_wait_value_   = 0;
+
+  upload_batches_.resize(kUploadBatchCount);
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool        = upload_command_pool_;
+  allocInfo.commandBufferCount = 1;
+  for (auto& batch : upload_batches_) {
+    ASSERT_EXECPTION(
+        vkAllocateCommandBuffers(logic_device_, &allocInfo, &batch.command_buffer) != VK_SUCCESS)
+        .SetErrorMessage("failed to allocate upload command buffer!")
+        .Throw();
+  }
+}
+
+void VulkanRhi::CleanUploadResources() {
+  for (auto& batch : upload_batches_) {
+    if (batch.submitted) {
+      RetireUploadBatch(batch);
+    }
+    for (auto& staging : batch.dedicated_staging) {
+      DestroyBuffer(staging.first, staging.second);
+    }
+  }
+  upload_batches_.clear();
+  pending_buffer_acquires_.clear();
+  pending_image_acquires_.clear();
+  vkDestroySemaphore(logic_device_, upload_timeline_, nullptr);
+  vkDestroyCommandPool(logic_device_, upload_command_pool_, nullptr);
+  upload_timeline_     = VK_NULL_HANDLE;
+  upload_command_pool_ = VK_NULL_HANDLE;
+  staging_ring_.Destroy();
+}
+
+VkCommandBuffer VulkanRhi::GetUploadCommandBuffer() {
+  auto& batch = upload_batches_[upload_batch_index_];
+  if (upload_recording_) {
+    return batch.command_buffer;
+  }
+  if (batch.submitted) {
+    RetireUploadBatch(batch);
+  }
+  vkResetCommandBuffer(batch.command_buffer, 0);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(batch.command_buffer, &beginInfo);
+
+  upload_recording_ = true;
+  return batch.command_buffer;
+}
+
+StagingAllocation VulkanRhi::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment) {
+  StagingAllocation allocation;
+  if (size > staging_ring_.Capacity()) {
+    GetUploadCommandBuffer();
+    VulkanAllocation memory;
+    CreateBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        allocation.buffer,
+        memory);
+    allocation.mapped = memory.mapped;
+    allocation.size   = size;
+    upload_batches_[upload_batch_index_].dedicated_staging.emplace_back(allocation.buffer, memory);
+    return allocation;
+  }
+
+  GetUploadCommandBuffer();
+  while (!staging_ring_.Allocate(size, alignment, allocation)) {
+    // the ring is full, hand the pending copies to the gpu and reclaim the oldest batch
+    upload_statistics_.stalls++;
+    FlushUploads();
+    RetireOldestUploadBatch();
+    GetUploadCommandBuffer();
+  }
+  return allocation;
+}
+
+void VulkanRhi::UploadBuffer(
+    VkBuffer dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset) {
+  UploadBuffer(
+      dst,
+      size,
+      [&](void* mapped) { memcpy(mapped, data, static_cast<size_t>(size)); },
+      dst_offset);
+}
+
+void VulkanRhi::UploadBuffer(
+    VkBuffer                           dst,
+    VkDeviceSize                       size,
+    const std::function<void(void*)>& write,
+    VkDeviceSize                       dst_offset) {
+  const auto staging = AllocateStaging(size, 16);
+  write(staging.mapped);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.srcOffset = staging.offset;
+  copyRegion.dstOffset = dst_offset;
+  copyRegion.size      = size;
+  vkCmdCopyBuffer(GetUploadCommandBuffer(), staging.buffer, dst, 1, &copyRegion);
+  upload_batches_[upload_batch_index_].buffers.push_back(dst);
+
+  upload_statistics_.bytes += size;
+  upload_statistics_.copies++;
+}
+
+uint64_t VulkanRhi::FlushUploads(bool wait) {
+  if (upload_recording_) {
+    auto& batch = upload_batches_[upload_batch_index_];
+
+    if (queue_family_.HasDedicatedTransfer()) {
+      ReleaseBuffers(batch);
+      pending_image_acquires_.insert(
+          pending_image_acquires_.end(), batch.images.begin(), batch.images.end());
+    } else {
+      // make every copy of the batch visible to the consumers of vertex, index and uniform data
+      VkMemoryBarrier barrier{};
+      barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                              VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+      vkCmdPipelineBarrier(
+          batch.command_buffer,
+          VK_PIPELINE_STAGE_TRANSFER_BIT,
+          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+          0,
+          1,
+          &barrier,
+          0,
+          nullptr,
+          0,
+          nullptr);
+    }
+    batch.buffers.clear();
+    batch.images.clear();
+    vkEndCommandBuffer(batch.command_buffer);
+
+    batch.timeline_value = ++upload_timeline_value_;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues    = &batch.timeline_value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = 1;
+    submitInfo.pCommandBuffers      = &batch.command_buffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores    = &upload_timeline_;
+
+    ASSERT_EXECPTION(vkQueueSubmit(transfer_queue_, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        .SetErrorMessage("failed to submit upload command buffer!")
+        .Throw();
+
+    batch.ring_position = staging_ring_.Head();
+    batch.submitted     = true;
+    upload_recording_   = false;
+    upload_batch_index_ = (upload_batch_index_ + 1) % kUploadBatchCount;
+    upload_statistics_.batches++;
+  }
+
+  if (wait) {
+    while (RetireOldestUploadBatch()) {
+    }
+  }
+  return upload_timeline_value_;
+}
+
+bool VulkanRhi::IsUploadComplete(uint64_t timeline_value) const {
+  uint64_t value = 0;
+  vkGetSemaphoreCounterValue(logic_device_, upload_timeline_, &value);
+  return value >= timeline_value;
+}
+
+void VulkanRhi::ReleaseBuffers(UploadBatch& batch) {
+  std::sort(batch.buffers.begin(), batch.buffers.end());
+  batch.buffers.erase(std::unique(batch.buffers.begin(), batch.buffers.end()), batch.buffers.end());
+  if (batch.buffers.empty()) {
+    return;
+  }
+
+  std::vector<VkBufferMemoryBarrier> barriers(batch.buffers.size());
+  for (size_t i = 0; i < batch.buffers.size(); i++) {
+    auto& barrier               = barriers[i];
+    barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask       = 0;
+    barrier.srcQueueFamilyIndex = queue_family_.transfer_family.value();
+    barrier.dstQueueFamilyIndex = queue_family_.graphics_family.value();
+    barrier.buffer              = batch.buffers[i];
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+  }
+  // the release half, dst stage is ignored on the transfer queue
+  vkCmdPipelineBarrier(
+      batch.command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(barriers.size()),
+      barriers.data(),
+      0,
+      nullptr);
+
+  // the acquire half is recorded on the graphics queue by the next frame
+  for (auto& barrier : barriers) {
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                            VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    pending_buffer_acquires_.push_back(barrier);
+  }
+}
+
+void VulkanRhi::ReleaseImage(VkCommandBuffer command_buffer, VkImage image, uint32_t miplevels) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask                   = 0;
+  barrier.oldLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex             = queue_family_.transfer_family.value();
+  barrier.dstQueueFamilyIndex             = queue_family_.graphics_family.value();
+  barrier.image                           = image;
+  barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel   = 0;
+  barrier.subresourceRange.levelCount     = miplevels;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount     = 1;
+  vkCmdPipelineBarrier(
+      command_buffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+}
+
+bool VulkanRhi::RecordPendingAcquires(VkCommandBuffer command_buffer) {
+  if (pending_buffer_acquires_.empty() && pending_image_acquires_.empty()) {
+    return false;
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(command_buffer, &beginInfo);
+
+  std::vector<VkImageMemoryBarrier> image_barriers;
+  for (const auto& pending : pending_image_acquires_) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask                   = 0;
+    barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex             = queue_family_.transfer_family.value();
+    barrier.dstQueueFamilyIndex             = queue_family_.graphics_family.value();
+    barrier.image                           = pending.image;
+    barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel   = 0;
+    barrier.subresourceRange.levelCount     = pending.miplevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount     = 1;
+    image_barriers.push_back(barrier);
+  }
+  vkCmdPipelineBarrier(
+      command_buffer,
+      kUploadWaitStages,
+      kUploadWaitStages,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(pending_buffer_acquires_.size()),
+      pending_buffer_acquires_.data(),
+      static_cast<uint32_t>(image_barriers.size()),
+      image_barriers.data());
+
+  // leaves every level in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+  for (const auto& pending : pending_image_acquires_) {
+    if (pending.generate_mips) {
+      GenerateMipmaps(
+          command_buffer, pending.image, pending.width, pending.height, pending.miplevels);
+    } else {
+      TransitionImageLayout(
+          command_buffer,
+          pending.image,
+          VK_FORMAT_UNDEFINED,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          pending.miplevels);
+    }
+  }
+  vkEndCommandBuffer(command_buffer);
+
+  pending_buffer_acquires_.clear();
+  pending_image_acquires_.clear();
+  return true;
+}
+
+void VulkanRhi::RetireUploadBatch(UploadBatch& batch) {
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores    = &upload_timeline_;
+  waitInfo.pValues        = &batch.timeline_value;
+  vkWaitSemaphores(logic_device_, &waitInfo, UINT64_MAX);
+  staging_ring_.Retire(batch.ring_position);
+  for (auto& staging : batch.dedicated_staging) {
+    DestroyBuffer(staging.first, staging.second);
+  }
+  batch.dedicated_staging.clear();
+  batch.submitted = false;
+}
+
+bool VulkanRhi::RetireOldestUploadBatch() {
+  // batches are submitted round robin, so the oldest one follows the batch being recorded
+  for (int i = 0; i < kUploadBatchCount; i++) {
+    auto& batch = upload_batches_[(upload_batch_index_ + i) % kUploadBatchCount];
+    if (batch.submitted) {
+      RetireUploadBatch(batch);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace vkengine
@@ -7,6 +7,9 @@
 #include <vector>
 
 #include "forward.h"
+#include "function/render/rhi/descriptor_allocator.h"
+#include "function/render/rhi/memory_allocator.h"
+#include "function/render/rhi/staging_ring_buffer.h"
 #include "function/render/rhi/validationlayer.h"
 #include "function/render/rhi/vulkanutils.h"
 #include "function/render/scene/render_type.h"
@@ -20,6 +23,29 @@ struct RHIInitInfo {
   std::shared_ptr<WindowSystem> window_system;
 };
 
+struct UploadStatistics {
+  uint64_t bytes   = 0;
+  uint64_t copies  = 0;
+  uint64_t batches = 0;
+  // times an upload had to wait for the gpu because the staging ring was full
+  uint64_t stalls = 0;
+};
+
+// optional device features, filled when the logical device is created
+struct DeviceCapabilities {
+  // descriptor indexing with update after bind for sampled images and storage buffers
+  bool     bindless              = false;
+  uint32_t max_bindless_textures = 0;
+  // indirect draws with firstInstance != 0, required by the gpu driven path
+  bool draw_indirect_first_instance = false;
+  // drawCount > 1 for vkCmdDrawIndexedIndirect
+  bool multi_draw_indirect = false;
+  bool draw_indirect_count = false;
+  // BC1 to BC7 sampled images. without it RenderResource drops block compressed textures and
+  // their materials are drawn grey
+  bool texture_compression_bc = false;
+};
+
 class VulkanRhi {
  public:
   VulkanRhi() {}
@@ -39,48 +65,114 @@ class VulkanRhi {
 
   void WaitForFence();
   void ResetCommandPool();
-  // return true if recreate swap chain
+  // the caller waits for the frame slot with WaitForFence first, before it rewrites per frame
+  // buffers. return true if recreate swap chain
   bool PrepareBeforePass(std::function<void()> passUpdateAfterRecreateSwapchain);
   void SubmitRendering(std::function<void()> passUpdateAfterRecreateSwapchain);
 
   VkSampler GetOrCreateMipmapSampler(uint32_t width, uint32_t height);
 
+  // texture_image_pixels holds pixel_levels levels largest first, tightly packed. a single level
+  // of a format that is not block compressed gets the other levels by blits, which throws when
+  // CanGenerateMipmaps is false for it. otherwise the image has exactly the given levels. all
+  // levels go up in one copy
   void CreateGlobalImage(
-      VkImage&        image,
-      VkImageView&    image_view,
-      VkDeviceMemory& image_memory,
-      uint32_t        texture_image_width,
-      uint32_t        texture_image_height,
-      void*           texture_image_pixels,
-      PixelFormat     texture_image_format,
-      uint32_t        miplevels = 0);
+      VkImage&          image,
+      VkImageView&      image_view,
+      VulkanAllocation& image_memory,
+      uint32_t          texture_image_width,
+      uint32_t          texture_image_height,
+      void*             texture_image_pixels,
+      PixelFormat       texture_image_format,
+      uint32_t          miplevels    = 0,
+      uint32_t          pixel_levels = 1);
+  // CreateGlobalImage can blit the mips of a single level of format with a linear filter
+  bool CanGenerateMipmaps(PixelFormat format) const;
+  void DestroyImage(VkImage& image, VkImageView& image_view, VulkanAllocation& image_memory);
 
+  // host visible memory is persistently mapped, see VulkanAllocation::mapped
   void CreateBuffer(
       VkDeviceSize          size,
       VkBufferUsageFlags    usage,
       VkMemoryPropertyFlags properties,
       VkBuffer&             buffer,
-      VkDeviceMemory&       bufferMemory);
+      VulkanAllocation&     bufferMemory);
+  void DestroyBuffer(VkBuffer& buffer, VulkanAllocation& bufferMemory);
   void CopyBuffer(
       VkBuffer     src,
       VkBuffer     dst,
       VkDeviceSize size,
       VkDeviceSize srcOffset = 0,
       VkDeviceSize dstOffset = 0);
-  void CopyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+
+  // copy data to dst through the staging ring, the copy is recorded into the current upload
+  // batch and executed with the next FlushUploads
+  void UploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+  // same, write fills the size bytes of staging memory itself. data assembled on the fly lands
+  // in the staging ring without a copy in between
+  void UploadBuffer(
+      VkBuffer                           dst,
+      VkDeviceSize                       size,
+      const std::function<void(void*)>& write,
+      VkDeviceSize                       dst_offset = 0);
+  // submit the pending upload batch on the transfer queue, return the timeline value it signals.
+  // block until all uploads finish if wait is true
+  uint64_t FlushUploads(bool wait = false);
+  // true once the upload batch that signals timeline value has finished on the gpu
+  bool IsUploadComplete(uint64_t timeline_value) const;
+  // timeline value signaled by the batch currently being recorded
+  uint64_t PendingUploadValue() const { return upload_timeline_value_ + 1; }
+
+  const UploadStatistics&   GetUploadStatistics() const { return upload_statistics_; }
+  MemoryAllocatorStatistics GetMemoryStatistics() const {
+    return memory_allocator_.GetStatistics();
+  }
 
  private:
+  // image released by the transfer queue, acquired and mipmapped on the graphics queue
+  struct PendingImageAcquire {
+    VkImage  image;
+    int32_t  width;
+    int32_t  height;
+    uint32_t miplevels;
+    // false when every level was uploaded, the acquire only makes it readable
+    bool generate_mips;
+  };
+  struct UploadBatch {
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    // value of upload_timeline_ signaled when the batch completes
+    uint64_t timeline_value = 0;
+    // staging ring head when the batch was submitted
+    uint64_t ring_position = 0;
+    bool     submitted     = false;
+    // buffers written by the batch, released to the graphics family on submit
+    std::vector<VkBuffer>            buffers;
+    std::vector<PendingImageAcquire> images;
+    // uploads larger than the ring get their own staging buffer
+    std::vector<std::pair<VkBuffer, VulkanAllocation>> dedicated_staging;
+  };
+
   void CreateInstance();
   void CreateDebugLayer();
   void CreateSurface();
   void PickPhysicalDevice();
   void CreateLogicalDevice();
   void CreateCommandPool();
-  void CreateDescriptorPool();
   // void CreateDescriptorSets();
   void CreateSyncObjects();
   void CreateSwapChain();
   void CreateDepthResources();
+  void CreateUploadResources();
+  void CleanUploadResources();
+
+  VkCommandBuffer   GetUploadCommandBuffer();
+  StagingAllocation AllocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+  void              RetireUploadBatch(UploadBatch& batch);
+  bool              RetireOldestUploadBatch();
+  // queue family ownership transfer from the transfer to the graphics family
+  void ReleaseBuffers(UploadBatch& batch);
+  void ReleaseImage(VkCommandBuffer command_buffer, VkImage image, uint32_t miplevels);
+  bool RecordPendingAcquires(VkCommandBuffer command_buffer);
 
   void CreateImage(
       uint32_t              width,
@@ -91,19 +183,35 @@ class VulkanRhi {
       VkImageUsageFlags     usage,
       VkMemoryPropertyFlags properties,
       VkImage&              image,
-      VkDeviceMemory&       imageMemory);
+      VulkanAllocation&     imageMemory);
   VkImageView CreateImageView(
       VkImage            image,
       VkFormat           format,
       VkImageAspectFlags aspect_flags,
       const uint32_t     mipleavel = 1);
-  void GenerateMipmaps(VkImage image, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+  // blits from and to the format with a linear filter, what GenerateMipmaps needs
+  bool SupportsLinearBlit(VkFormat format) const;
+  void GenerateMipmaps(
+      VkCommandBuffer command_buffer,
+      VkImage         image,
+      int32_t         texWidth,
+      int32_t         texHeight,
+      uint32_t        mipLevels);
+  // one region per level, level i starts at level_offsets[i] of buffer
+  void CopyBufferToImage(
+      VkCommandBuffer                  command_buffer,
+      VkBuffer                         buffer,
+      const std::vector<VkDeviceSize>& level_offsets,
+      VkImage                          image,
+      uint32_t                         width,
+      uint32_t                         height);
   void TransitionImageLayout(
-      VkImage       image,
-      VkFormat      format,
-      VkImageLayout old_layout,
-      VkImageLayout new_layout,
-      uint32_t      mipleavel);
+      VkCommandBuffer command_buffer,
+      VkImage         image,
+      VkFormat        format,
+      VkImageLayout   old_layout,
+      VkImageLayout   new_layout,
+      uint32_t        mipleavel);
 
  public:
   GLFWwindow*      window_;
@@ -112,6 +220,7 @@ class VulkanRhi {
   VkDevice         logic_device_    = VK_NULL_HANDLE;
   VkQueue          graph_queue_     = VK_NULL_HANDLE;
   VkQueue          present_queue_   = VK_NULL_HANDLE;
+  VkQueue          transfer_queue_  = VK_NULL_HANDLE;
   VkSurfaceKHR     surface_         = VK_NULL_HANDLE;
 
   VkSwapchainKHR             swap_chain_;
@@ -121,9 +230,9 @@ class VulkanRhi {
   std::vector<VkImageView>   swap_chain_image_views_;
   std::vector<VkFramebuffer> swap_chain_framebuffer_;
 
-  std::vector<VkImage>        depth_images_;
-  std::vector<VkImageView>    depth_image_views_;
-  std::vector<VkDeviceMemory> depth_images_memory_;
+  std::vector<VkImage>          depth_images_;
+  std::vector<VkImageView>      depth_image_views_;
+  std::vector<VulkanAllocation> depth_images_memory_;
 
   bool     frame_size_change_             = false;
   int      current_frame_                 = 0;
@@ -133,12 +242,15 @@ class VulkanRhi {
   VkCommandPool                command_pool_;
   std::vector<VkCommandPool>   command_pools_;
   std::vector<VkCommandBuffer> command_buffer_;
+  // per frame, acquires uploaded resources on the graphics queue ahead of command_buffer_
+  std::vector<VkCommandBuffer> acquire_command_buffer_;
   std::vector<VkSemaphore>     image_available_semaphore_;
   std::vector<VkSemaphore>     render_finished_semaphore_;
   std::vector<VkFence>         in_flight_fence_;
 
-  VkDescriptorPool descriptor_pool_;
-  // VkDescriptorSet will be clear when descriptor_pool_ destroy
+  // persistent sets for long lived resources, transient sets are recycled every frame
+  DescriptorAllocator descriptor_allocator_;
+  // VkDescriptorSet will be clear when descriptor_allocator_ destroy
   // std::vector<VkDescriptorSet> descriptor_sets_;
 
   //   std::vector<VkBuffer>       uniform_buffers_;
@@ -150,9 +262,28 @@ class VulkanRhi {
 
   std::shared_ptr<ValidationLayer> layer_;
   QueueFamilyIndices               queue_family_;
+  DeviceCapabilities               device_capabilities_;
   SwapChainSupportDetails          swap_chain_support_;
 
-  static constexpr int kMaxFramesInFight = 2;
+  static constexpr int          kMaxFramesInFight = 2;
+  static constexpr int          kUploadBatchCount = 4;
+  static constexpr VkDeviceSize kStagingRingSize  = 64 * 1024 * 1024;
+
+  VulkanMemoryAllocator    memory_allocator_;
+  StagingRingBuffer        staging_ring_;
+  VkCommandPool            upload_command_pool_ = VK_NULL_HANDLE;
+  std::vector<UploadBatch> upload_batches_;
+  int                      upload_batch_index_ = 0;
+  bool                     upload_recording_   = false;
+  UploadStatistics         upload_statistics_;
+  // signaled by upload batches, the graphics submit of a frame waits on the latest value
+  VkSemaphore upload_timeline_       = VK_NULL_HANDLE;
+  uint64_t    upload_timeline_value_ = 0;
+  // highest timeline value a graphics submit already waited on
+  uint64_t graphics_wait_value_ = 0;
+
+  std::vector<VkBufferMemoryBarrier> pending_buffer_acquires_;
+  std::vector<PendingImageAcquire>   pending_image_acquires_;
 
   std::unordered_map<uint32_t, VkSampler> mipmap_sampler_map;
   VkSampler                               nearest_sampler;
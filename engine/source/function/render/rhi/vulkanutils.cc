@@ -29,6 +29,23 @@ QueueFamilyIndices QueueFamilyIndices::FindQueueFamilies(
     }
     i++;
   }
+
+  // prefer a transfer only family (dma engine), then any non graphics family with transfer
+  uint32_t best_flags = ~0u;
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    const auto flags = queueFamilies[family].queueFlags;
+    if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) {
+      continue;
+    }
+    const uint32_t extra = flags & VK_QUEUE_COMPUTE_BIT;
+    if (extra < best_flags) {
+      best_flags              = extra;
+      indices.transfer_family = family;
+    }
+  }
+  if (!indices.transfer_family.has_value()) {
+    indices.transfer_family = indices.graphics_family;
+  }
   return indices;
 }
 
@@ -96,6 +113,20 @@ bool IsDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
   vkGetPhysicalDeviceProperties(device, &deviceProperties);
   vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
+  // uploads are tracked with timeline semaphores
+  if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+  VkPhysicalDeviceVulkan12Features features12{};
+  features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &features12;
+  vkGetPhysicalDeviceFeatures2(device, &features2);
+  if (!features12.timelineSemaphore) {
+    return false;
+  }
+
   const auto indices = QueueFamilyIndices::FindQueueFamilies(device, surface);
   // deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
   bool extensionsSupported = CheckDeviceExtensionSupport(device);
@@ -11,6 +11,10 @@ namespace vkengine {
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphics_family;
   std::optional<uint32_t> present_family;
+  // dedicated transfer family if the device has one, graphics family otherwise
+  std::optional<uint32_t> transfer_family;
+
+  bool HasDedicatedTransfer() const { return transfer_family != graphics_family; }
 
   bool isComplete() const { return graphics_family.has_value() && present_family.has_value(); }
   static QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
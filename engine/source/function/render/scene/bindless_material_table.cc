@@ -0,0 +1,144 @@
+#include "function/render/scene/bindless_material_table.h"
+
+#include <algorithm>
+#include <array>
+
+#include "core/exception/assert_exception.h"
+#include "function/render/rhi/vulkanrhi.h"
+
+namespace vkengine {
+
+void BindlessMaterialTable::Init(std::shared_ptr<VulkanRhi> rhi) {
+  rhi_            = rhi;
+  capacity_       = std::min(kMaxMaterials, rhi_->device_capabilities_.max_bindless_textures);
+  material_count_ = 0;
+
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  // (set = 1, binding = 0) material records
+  bindings[0].binding         = 0;
+  bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags      = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  // (set = 1, binding = 1) base color textures, must stay the last binding
+  bindings[1].binding         = 1;
+  bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[1].descriptorCount = capacity_;
+  bindings[1].stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+  std::array<VkDescriptorBindingFlags, 2> bindingFlags = {
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+          VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT};
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount  = static_cast<uint32_t>(bindingFlags.size());
+  bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.pNext        = &bindingFlagsInfo;
+  layoutInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings    = bindings.data();
+  ASSERT_EXECPTION(
+      vkCreateDescriptorSetLayout(rhi_->logic_device_, &layoutInfo, nullptr, &layout_) !=
+      VK_SUCCESS)
+      .SetErrorMessage("failed to create bindless material layout!")
+      .Throw();
+
+  std::array<VkDescriptorPoolSize, 2> poolSizes{};
+  poolSizes[0].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  poolSizes[0].descriptorCount = 1;
+  poolSizes[1].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  poolSizes[1].descriptorCount = capacity_;
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags         = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes    = poolSizes.data();
+  poolInfo.maxSets       = 1;
+  ASSERT_EXECPTION(
+      vkCreateDescriptorPool(rhi_->logic_device_, &poolInfo, nullptr, &pool_) != VK_SUCCESS)
+      .SetErrorMessage("failed to create bindless descriptor pool!")
+      .Throw();
+
+  VkDescriptorSetVariableDescriptorCountAllocateInfo countInfo{};
+  countInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+  countInfo.descriptorSetCount = 1;
+  countInfo.pDescriptorCounts  = &capacity_;
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.pNext              = &countInfo;
+  allocInfo.descriptorPool     = pool_;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts        = &layout_;
+  ASSERT_EXECPTION(vkAllocateDescriptorSets(rhi_->logic_device_, &allocInfo, &set_) != VK_SUCCESS)
+      .SetErrorMessage("failed to allocate bindless descriptor set!")
+      .Throw();
+
+  rhi_->CreateBuffer(
+      sizeof(VkPerMaterialUbo) * capacity_,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      material_buffer_,
+      material_memory_);
+
+  VkDescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = material_buffer_;
+  bufferInfo.offset = 0;
+  bufferInfo.range  = VK_WHOLE_SIZE;
+  VkWriteDescriptorSet write{};
+  write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet          = set_;
+  write.dstBinding      = 0;
+  write.dstArrayElement = 0;
+  write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.descriptorCount = 1;
+  write.pBufferInfo     = &bufferInfo;
+  vkUpdateDescriptorSets(rhi_->logic_device_, 1, &write, 0, nullptr);
+}
+
+void BindlessMaterialTable::Destroy() {
+  rhi_->DestroyBuffer(material_buffer_, material_memory_);
+  vkDestroyDescriptorPool(rhi_->logic_device_, pool_, nullptr);
+  vkDestroyDescriptorSetLayout(rhi_->logic_device_, layout_, nullptr);
+  pool_   = VK_NULL_HANDLE;
+  layout_ = VK_NULL_HANDLE;
+  set_    = VK_NULL_HANDLE;
+  rhi_.reset();
+}
+
+uint32_t BindlessMaterialTable::AddMaterial(
+    const VkPerMaterialUbo& material, VkImageView base_color, VkSampler sampler) {
+  ASSERT_EXECPTION(material_count_ >= capacity_)
+      .SetErrorMessage("bindless material table is full!")
+      .Throw();
+  const uint32_t material_id = material_count_++;
+
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  imageInfo.imageView   = base_color;
+  imageInfo.sampler     = sampler;
+  VkWriteDescriptorSet write{};
+  write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet          = set_;
+  write.dstBinding      = 1;
+  write.dstArrayElement = material_id;
+  write.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.descriptorCount = 1;
+  write.pImageInfo      = &imageInfo;
+  vkUpdateDescriptorSets(rhi_->logic_device_, 1, &write, 0, nullptr);
+
+  UpdateMaterial(material_id, material);
+  return material_id;
+}
+
+void BindlessMaterialTable::UpdateMaterial(uint32_t material_id, const VkPerMaterialUbo& material) {
+  rhi_->UploadBuffer(
+      material_buffer_,
+      &material,
+      sizeof(VkPerMaterialUbo),
+      sizeof(VkPerMaterialUbo) * static_cast<VkDeviceSize>(material_id));
+}
+
+}  // namespace vkengine
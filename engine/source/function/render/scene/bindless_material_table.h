@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "forward.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// every material in one descriptor set: a storage buffer of VkPerMaterialUbo records
+// (binding 0) and a partially bound array of base color textures (binding 1).
+// both are indexed by the material id, so drawing any material needs no set rebind.
+// only used when DeviceCapabilities::bindless is set, see shader/005. other devices bind a set
+// per material and draw with shader_per_material.frag
+class BindlessMaterialTable {
+ public:
+  static constexpr uint32_t kMaxMaterials = 16384;
+
+  BindlessMaterialTable() {}
+  ~BindlessMaterialTable() {}
+
+  void Init(std::shared_ptr<VulkanRhi> rhi);
+  void Destroy();
+  bool IsInitialized() const { return rhi_ != nullptr; }
+
+  // return the material id, the slot is written with update after bind so the set may be
+  // bound in command buffers that are still pending
+  uint32_t AddMaterial(const VkPerMaterialUbo& material, VkImageView base_color, VkSampler sampler);
+  void     UpdateMaterial(uint32_t material_id, const VkPerMaterialUbo& material);
+
+  VkDescriptorSetLayout Layout() const { return layout_; }
+  VkDescriptorSet       Set() const { return set_; }
+  uint32_t              MaterialCount() const { return material_count_; }
+  uint32_t              Capacity() const { return capacity_; }
+
+ private:
+  std::shared_ptr<VulkanRhi> rhi_;
+
+  VkDescriptorPool      pool_   = VK_NULL_HANDLE;
+  VkDescriptorSetLayout layout_ = VK_NULL_HANDLE;
+  VkDescriptorSet       set_    = VK_NULL_HANDLE;
+
+  VkBuffer         material_buffer_ = VK_NULL_HANDLE;
+  VulkanAllocation material_memory_;
+
+  uint32_t capacity_       = 0;
+  uint32_t material_count_ = 0;
+};
+
+}  // namespace vkengine
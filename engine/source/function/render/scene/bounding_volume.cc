@@ -0,0 +1,139 @@
+#include "function/render/scene/bounding_volume.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace vkengine {
+
+AxisAlignedBox AxisAlignedBox::Transform(const glm::mat4& matrix) const {
+  if (IsEmpty()) {
+    return *this;
+  }
+  const glm::vec3 center = glm::vec3(matrix * glm::vec4(Center(), 1.0f));
+  const glm::vec3 extent = Extent();
+  glm::vec3       world_extent(0.0f);
+  for (int column = 0; column < 3; column++) {
+    world_extent += glm::abs(glm::vec3(matrix[column])) * extent[column];
+  }
+
+  AxisAlignedBox ret;
+  ret.min_corner = center - world_extent;
+  ret.max_corner = center + world_extent;
+  return ret;
+}
+
+bool AxisAlignedBox::IntersectRay(
+    const glm::vec3& origin,
+    const glm::vec3& inverse_direction,
+    float            max_distance,
+    float&           distance) const {
+  const glm::vec3 t0    = (min_corner - origin) * inverse_direction;
+  const glm::vec3 t1    = (max_corner - origin) * inverse_direction;
+  const glm::vec3 t_min = glm::min(t0, t1);
+  const glm::vec3 t_max = glm::max(t0, t1);
+  const float     enter = std::max({t_min.x, t_min.y, t_min.z, 0.0f});
+  const float     exit  = std::min({t_max.x, t_max.y, t_max.z, max_distance});
+  if (enter > exit) {
+    return false;
+  }
+  distance = enter;
+  return true;
+}
+
+BoundingSphere BoundingSphere::Transform(const glm::mat4& matrix) const {
+  const float scale = std::max(
+      {glm::length(glm::vec3(matrix[0])),
+       glm::length(glm::vec3(matrix[1])),
+       glm::length(glm::vec3(matrix[2]))});
+
+  BoundingSphere ret;
+  ret.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+  ret.radius = radius * scale;
+  return ret;
+}
+
+MeshBounds MeshBounds::FromPositions(const void* positions, size_t count, size_t stride) {
+  const auto* bytes    = static_cast<const unsigned char*>(positions);
+  const auto  position = [bytes, stride](size_t i) {
+    glm::vec3 ret;
+    std::memcpy(&ret, bytes + i * stride, sizeof(glm::vec3));
+    return ret;
+  };
+
+  MeshBounds ret;
+  for (size_t i = 0; i < count; i++) {
+    ret.box.Merge(position(i));
+  }
+  if (count == 0) {
+    return ret;
+  }
+
+  // the box center is not the minimal sphere but is cheap and close for typical meshes
+  ret.sphere.center = ret.box.Center();
+  float radius2     = 0.0f;
+  for (size_t i = 0; i < count; i++) {
+    const glm::vec3 offset = position(i) - ret.sphere.center;
+    radius2                = std::max(radius2, glm::dot(offset, offset));
+  }
+  ret.sphere.radius = std::sqrt(radius2);
+  return ret;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4& proj_view) {
+  const auto row = [&proj_view](int i) {
+    return glm::vec4(proj_view[0][i], proj_view[1][i], proj_view[2][i], proj_view[3][i]);
+  };
+
+  Frustum ret;
+  ret.planes = {
+      row(3) + row(0),
+      row(3) - row(0),
+      row(3) + row(1),
+      row(3) - row(1),
+      row(3) + row(2),
+      row(3) - row(2)};
+  for (auto& plane : ret.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return ret;
+}
+
+bool Frustum::Intersects(const AxisAlignedBox& box) const {
+  const glm::vec3 center = box.Center();
+  const glm::vec3 extent = box.Extent();
+  for (const auto& plane : planes) {
+    const glm::vec3 normal = glm::vec3(plane);
+    if (glm::dot(normal, center) + plane.w + glm::dot(glm::abs(normal), extent) < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Frustum::Containment Frustum::Classify(const AxisAlignedBox& box) const {
+  const glm::vec3 center = box.Center();
+  const glm::vec3 extent = box.Extent();
+  bool            inside = true;
+  for (const auto& plane : planes) {
+    const glm::vec3 normal   = glm::vec3(plane);
+    const float     distance = glm::dot(normal, center) + plane.w;
+    const float     radius   = glm::dot(glm::abs(normal), extent);
+    if (distance + radius < 0.0f) {
+      return Containment::kOutside;
+    }
+    inside = inside && distance - radius >= 0.0f;
+  }
+  return inside ? Containment::kInside : Containment::kIntersecting;
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const {
+  for (const auto& plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace vkengine
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "glm/glm.hpp"
+
+namespace vkengine {
+
+struct AxisAlignedBox {
+  // an empty box has min > max, merging anything into it gives that thing
+  glm::vec3 min_corner{std::numeric_limits<float>::max()};
+  glm::vec3 max_corner{std::numeric_limits<float>::lowest()};
+
+  bool      IsEmpty() const { return glm::any(glm::greaterThan(min_corner, max_corner)); }
+  glm::vec3 Center() const { return (min_corner + max_corner) * 0.5f; }
+  // half size
+  glm::vec3 Extent() const { return (max_corner - min_corner) * 0.5f; }
+
+  void Merge(const glm::vec3& point) {
+    min_corner = glm::min(min_corner, point);
+    max_corner = glm::max(max_corner, point);
+  }
+  void Merge(const AxisAlignedBox& box) {
+    min_corner = glm::min(min_corner, box.min_corner);
+    max_corner = glm::max(max_corner, box.max_corner);
+  }
+
+  bool Contains(const AxisAlignedBox& box) const {
+    return glm::all(glm::lessThanEqual(min_corner, box.min_corner)) &&
+           glm::all(glm::greaterThanEqual(max_corner, box.max_corner));
+  }
+  float SurfaceArea() const {
+    const glm::vec3 size = max_corner - min_corner;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+  }
+  // squared distance from point to the box, 0 inside
+  float DistanceSquared(const glm::vec3& point) const {
+    const glm::vec3 offset = glm::max(glm::max(min_corner - point, point - max_corner), 0.0f);
+    return glm::dot(offset, offset);
+  }
+  // slab test, inverse_direction is 1 / direction. on hit distance is where the ray enters
+  bool IntersectRay(
+      const glm::vec3& origin,
+      const glm::vec3& inverse_direction,
+      float            max_distance,
+      float&           distance) const;
+
+  // smallest box enclosing the transformed box (Arvo), exact for the corners of this box
+  AxisAlignedBox Transform(const glm::mat4& matrix) const;
+};
+
+struct BoundingSphere {
+  glm::vec3 center{0.0f};
+  float     radius = 0.0f;
+
+  // the radius is scaled by the largest axis scale of matrix
+  BoundingSphere Transform(const glm::mat4& matrix) const;
+};
+
+// object space bounds of a mesh, the sphere is centered on the box
+struct MeshBounds {
+  AxisAlignedBox box;
+  BoundingSphere sphere;
+
+  // positions are read with a byte stride, e.g. offsetof(VulkanVertexData, position)
+  static MeshBounds FromPositions(const void* positions, size_t count, size_t stride);
+};
+
+// planes with xyz the normal pointing inside and w the distance, a point p is inside a plane
+// when dot(xyz, p) + w >= 0
+struct Frustum {
+  // result of Classify
+  enum class Containment : uint8_t { kOutside, kIntersecting, kInside };
+
+  std::array<glm::vec4, 6> planes;
+
+  // left, right, bottom, top, near, far of proj * view. the near plane uses -w <= z, which is
+  // conservative for both the vulkan and the opengl depth range
+  static Frustum FromMatrix(const glm::mat4& proj_view);
+
+  bool Intersects(const AxisAlignedBox& box) const;
+  bool Intersects(const BoundingSphere& sphere) const;
+  // kInside when the box is inside every plane, lets hierarchies skip the test of whole subtrees
+  Containment Classify(const AxisAlignedBox& box) const;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,75 @@
+#include "function/render/scene/cluster_culler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace vkengine {
+
+namespace {
+// relative difference of the axis scales still treated as uniform
+constexpr float kUniformScaleTolerance = 1e-3f;
+}  // namespace
+
+ClusterCullView ClusterCullView::FromInstance(
+    const Frustum& frustum, const glm::vec3& camera_position, const glm::mat4& model_matrix) {
+  ClusterCullView view;
+  // a world plane p holds dot(p, M x) for object points x, which is the plane transpose(M) p
+  const glm::mat4 transposed = glm::transpose(model_matrix);
+  for (size_t i = 0; i < frustum.planes.size(); i++) {
+    const glm::vec4 plane  = transposed * frustum.planes[i];
+    const float     length = glm::length(glm::vec3(plane));
+    view.planes[i]         = length > 0.0f ? plane / length : plane;
+  }
+  view.camera_position = glm::vec3(glm::inverse(model_matrix) * glm::vec4(camera_position, 1.0f));
+
+  const glm::vec3 scale(
+      glm::length(glm::vec3(model_matrix[0])),
+      glm::length(glm::vec3(model_matrix[1])),
+      glm::length(glm::vec3(model_matrix[2])));
+  const float min_scale = std::min({scale.x, scale.y, scale.z});
+  const float max_scale = std::max({scale.x, scale.y, scale.z});
+  view.backface         = min_scale > 0.0f &&
+                  max_scale - min_scale <= kUniformScaleTolerance * max_scale &&
+                  glm::determinant(glm::mat3(model_matrix)) > 0.0f;
+  return view;
+}
+
+void CullClusters(
+    const MeshletData&     meshlets,
+    const ClusterCullView& view,
+    std::vector<uint32_t>& indices,
+    ClusterCullStatistics& statistics) {
+  for (const auto& meshlet : meshlets.meshlets) {
+    statistics.tested++;
+    const glm::vec3 center(meshlet.bounding_sphere);
+    const float     radius  = meshlet.bounding_sphere.w;
+    bool            outside = false;
+    for (const auto& plane : view.planes) {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+        outside = true;
+        break;
+      }
+    }
+    if (outside) {
+      statistics.frustum_culled++;
+      continue;
+    }
+    // a camera on the apex has no direction, normalize gives nan and the cluster is kept
+    if (view.backface &&
+        glm::dot(glm::normalize(glm::vec3(meshlet.cone_apex) - view.camera_position),
+                 glm::vec3(meshlet.cone_axis)) >= meshlet.cone_axis.w) {
+      statistics.backface_culled++;
+      continue;
+    }
+
+    const uint32_t* vertices = meshlets.vertices.data() + meshlet.vertex_offset;
+    for (uint32_t t = 0; t < meshlet.triangle_count; t++) {
+      const uint32_t triangle = meshlets.triangles[meshlet.triangle_offset + t];
+      indices.push_back(vertices[triangle & 0xff]);
+      indices.push_back(vertices[(triangle >> 8) & 0xff]);
+      indices.push_back(vertices[(triangle >> 16) & 0xff]);
+    }
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/bounding_volume.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+struct ClusterCullStatistics {
+  uint32_t tested          = 0;
+  uint32_t frustum_culled  = 0;
+  uint32_t backface_culled = 0;
+};
+
+// frustum and camera moved into the object space of one instance, so clusters are tested without
+// transforming their bounds. the planes are renormalized there, which keeps the sphere test exact
+// under any affine transform
+struct ClusterCullView {
+  std::array<glm::vec4, 6> planes;
+  glm::vec3                camera_position{0.0f};
+  // normal cones only survive rotation, uniform scale and translation, mirrored or non uniformly
+  // scaled instances skip the back face test
+  bool backface = false;
+
+  static ClusterCullView FromInstance(
+      const Frustum& frustum, const glm::vec3& camera_position, const glm::mat4& model_matrix);
+};
+
+// append the indices of every cluster of meshlets that is inside the frustum and not back facing,
+// the indices address the mesh vertices like the index buffer of the mesh does
+void CullClusters(
+    const MeshletData&     meshlets,
+    const ClusterCullView& view,
+    std::vector<uint32_t>& indices,
+    ClusterCullStatistics& statistics);
+
+}  // namespace vkengine
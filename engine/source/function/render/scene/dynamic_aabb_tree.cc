@@ -0,0 +1,315 @@
+#include "function/render/scene/dynamic_aabb_tree.h"
+
+#include <algorithm>
+
+#include "core/exception/assert_exception.h"
+
+namespace vkengine {
+
+namespace {
+AxisAlignedBox Union(const AxisAlignedBox& a, const AxisAlignedBox& b) {
+  AxisAlignedBox ret = a;
+  ret.Merge(b);
+  return ret;
+}
+}  // namespace
+
+AxisAlignedBox DynamicAabbTree::Fatten(const AxisAlignedBox& box) {
+  const glm::vec3 margin = (box.max_corner - box.min_corner) * kFatRatio + glm::vec3(kFatMargin);
+
+  AxisAlignedBox ret;
+  ret.min_corner = box.min_corner - margin;
+  ret.max_corner = box.max_corner + margin;
+  return ret;
+}
+
+int32_t DynamicAabbTree::AllocateNode() {
+  if (free_list_ == kNullNode) {
+    nodes_.emplace_back();
+    return static_cast<int32_t>(nodes_.size()) - 1;
+  }
+  const int32_t node = free_list_;
+  free_list_         = nodes_[node].parent;
+  free_count_--;
+  nodes_[node] = Node{};
+  return node;
+}
+
+void DynamicAabbTree::FreeNode(int32_t node) {
+  nodes_[node].parent = free_list_;
+  nodes_[node].height = -1;
+  free_list_          = node;
+  free_count_++;
+}
+
+void DynamicAabbTree::Clear() {
+  nodes_.clear();
+  root_       = kNullNode;
+  free_list_  = kNullNode;
+  free_count_ = 0;
+  leaf_count_ = 0;
+}
+
+int32_t DynamicAabbTree::Insert(const AxisAlignedBox& box, uint32_t user_data) {
+  const int32_t leaf     = AllocateNode();
+  nodes_[leaf].box       = Fatten(box);
+  nodes_[leaf].height    = 0;
+  nodes_[leaf].user_data = user_data;
+  InsertLeaf(leaf);
+  leaf_count_++;
+  return leaf;
+}
+
+void DynamicAabbTree::Remove(int32_t proxy) {
+  ASSERT_EXECPTION(proxy < 0 || proxy >= static_cast<int32_t>(nodes_.size()) ||
+                   !nodes_[proxy].IsLeaf() || nodes_[proxy].height != 0)
+      .SetErrorMessage("remove an invalid proxy from the aabb tree!")
+      .Throw();
+  RemoveLeaf(proxy);
+  FreeNode(proxy);
+  leaf_count_--;
+}
+
+bool DynamicAabbTree::Move(int32_t proxy, const AxisAlignedBox& box) {
+  if (nodes_[proxy].box.Contains(box)) {
+    return false;
+  }
+  RemoveLeaf(proxy);
+  nodes_[proxy].box = Fatten(box);
+  InsertLeaf(proxy);
+  return true;
+}
+
+void DynamicAabbTree::InsertLeaf(int32_t leaf) {
+  if (root_ == kNullNode) {
+    root_               = leaf;
+    nodes_[leaf].parent = kNullNode;
+    return;
+  }
+
+  // descend while pushing the leaf further down is cheaper than pairing it here
+  const AxisAlignedBox leaf_box = nodes_[leaf].box;
+  int32_t              index    = root_;
+  while (!nodes_[index].IsLeaf()) {
+    const Node& node          = nodes_[index];
+    const float area          = node.box.SurfaceArea();
+    const float combined_area = Union(node.box, leaf_box).SurfaceArea();
+    // cost of a new parent for this node and the leaf
+    const float cost = 2.0f * combined_area;
+    // every ancestor below grows by at least this much
+    const float inheritance = 2.0f * (combined_area - area);
+
+    float child_cost[2];
+    for (int i = 0; i < 2; i++) {
+      const Node& child = nodes_[i == 0 ? node.child1 : node.child2];
+      const float grown = Union(child.box, leaf_box).SurfaceArea();
+      child_cost[i]     = (child.IsLeaf() ? grown : grown - child.box.SurfaceArea()) + inheritance;
+    }
+    if (cost < child_cost[0] && cost < child_cost[1]) {
+      break;
+    }
+    index = child_cost[0] < child_cost[1] ? node.child1 : node.child2;
+  }
+
+  // AllocateNode may reallocate nodes_, no reference is held across it
+  const int32_t sibling    = index;
+  const int32_t old_parent = nodes_[sibling].parent;
+  const int32_t new_parent = AllocateNode();
+
+  nodes_[new_parent].parent = old_parent;
+  nodes_[new_parent].box    = Union(leaf_box, nodes_[sibling].box);
+  nodes_[new_parent].height = nodes_[sibling].height + 1;
+  nodes_[new_parent].child1 = sibling;
+  nodes_[new_parent].child2 = leaf;
+  nodes_[sibling].parent    = new_parent;
+  nodes_[leaf].parent       = new_parent;
+  if (old_parent == kNullNode) {
+    root_ = new_parent;
+  } else if (nodes_[old_parent].child1 == sibling) {
+    nodes_[old_parent].child1 = new_parent;
+  } else {
+    nodes_[old_parent].child2 = new_parent;
+  }
+
+  RefitAncestors(nodes_[leaf].parent);
+}
+
+void DynamicAabbTree::RemoveLeaf(int32_t leaf) {
+  if (leaf == root_) {
+    root_ = kNullNode;
+    return;
+  }
+
+  const int32_t parent       = nodes_[leaf].parent;
+  const int32_t grand_parent = nodes_[parent].parent;
+  const int32_t sibling =
+      nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+  FreeNode(parent);
+  nodes_[sibling].parent = grand_parent;
+  if (grand_parent == kNullNode) {
+    root_ = sibling;
+    return;
+  }
+  if (nodes_[grand_parent].child1 == parent) {
+    nodes_[grand_parent].child1 = sibling;
+  } else {
+    nodes_[grand_parent].child2 = sibling;
+  }
+  RefitAncestors(grand_parent);
+}
+
+void DynamicAabbTree::RefitAncestors(int32_t node) {
+  while (node != kNullNode) {
+    node                = Rotate(node);
+    const Node& left    = nodes_[nodes_[node].child1];
+    const Node& right   = nodes_[nodes_[node].child2];
+    nodes_[node].height = 1 + std::max(left.height, right.height);
+    nodes_[node].box    = Union(left.box, right.box);
+    node                = nodes_[node].parent;
+  }
+}
+
+int32_t DynamicAabbTree::Rotate(int32_t a) {
+  if (nodes_[a].IsLeaf() || nodes_[a].height < 2) {
+    return a;
+  }
+  const int32_t b       = nodes_[a].child1;
+  const int32_t c       = nodes_[a].child2;
+  const int32_t balance = nodes_[c].height - nodes_[b].height;
+  if (balance >= -1 && balance <= 1) {
+    return a;
+  }
+
+  // promote the taller child up, a takes its shorter grandchild
+  const int32_t up      = balance > 1 ? c : b;
+  const int32_t stay    = balance > 1 ? b : c;
+  const int32_t f       = nodes_[up].child1;
+  const int32_t g       = nodes_[up].child2;
+  const int32_t taller  = nodes_[f].height > nodes_[g].height ? f : g;
+  const int32_t shorter = taller == f ? g : f;
+
+  nodes_[up].child1 = a;
+  nodes_[up].child2 = taller;
+  nodes_[up].parent = nodes_[a].parent;
+  nodes_[a].parent  = up;
+  if (nodes_[up].parent == kNullNode) {
+    root_ = up;
+  } else if (nodes_[nodes_[up].parent].child1 == a) {
+    nodes_[nodes_[up].parent].child1 = up;
+  } else {
+    nodes_[nodes_[up].parent].child2 = up;
+  }
+
+  nodes_[a].child1       = stay;
+  nodes_[a].child2       = shorter;
+  nodes_[shorter].parent = a;
+  nodes_[a].box          = Union(nodes_[stay].box, nodes_[shorter].box);
+  nodes_[a].height       = 1 + std::max(nodes_[stay].height, nodes_[shorter].height);
+  nodes_[up].box         = Union(nodes_[a].box, nodes_[taller].box);
+  nodes_[up].height      = 1 + std::max(nodes_[a].height, nodes_[taller].height);
+  return up;
+}
+
+void DynamicAabbTree::CollectLeaves(int32_t node, std::vector<uint32_t>& result) const {
+  std::vector<int32_t> stack = {node};
+  while (!stack.empty()) {
+    const Node& current = nodes_[stack.back()];
+    stack.pop_back();
+    if (current.IsLeaf()) {
+      result.push_back(current.user_data);
+    } else {
+      stack.push_back(current.child1);
+      stack.push_back(current.child2);
+    }
+  }
+}
+
+void DynamicAabbTree::QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const {
+  if (root_ == kNullNode) {
+    return;
+  }
+  std::vector<int32_t> stack = {root_};
+  while (!stack.empty()) {
+    const int32_t index = stack.back();
+    stack.pop_back();
+    const Node& node = nodes_[index];
+
+    const auto containment = frustum.Classify(node.box);
+    if (containment == Frustum::Containment::kOutside) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      result.push_back(node.user_data);
+    } else if (containment == Frustum::Containment::kInside) {
+      CollectLeaves(index, result);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+void DynamicAabbTree::QuerySphere(
+    const BoundingSphere& sphere, std::vector<uint32_t>& result) const {
+  if (root_ == kNullNode) {
+    return;
+  }
+  const float          radius2 = sphere.radius * sphere.radius;
+  std::vector<int32_t> stack   = {root_};
+  while (!stack.empty()) {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+    if (node.box.DistanceSquared(sphere.center) > radius2) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      result.push_back(node.user_data);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+void DynamicAabbTree::QueryRay(
+    const glm::vec3&       origin,
+    const glm::vec3&       direction,
+    float                  max_distance,
+    std::vector<uint32_t>& result) const {
+  if (root_ == kNullNode) {
+    return;
+  }
+  // a zero component gives +-inf, which the slab test handles
+  const glm::vec3      inverse_direction = 1.0f / direction;
+  std::vector<int32_t> stack             = {root_};
+  while (!stack.empty()) {
+    const Node& node = nodes_[stack.back()];
+    stack.pop_back();
+    float distance = 0.0f;
+    if (!node.box.IntersectRay(origin, inverse_direction, max_distance, distance)) {
+      continue;
+    }
+    if (node.IsLeaf()) {
+      result.push_back(node.user_data);
+    } else {
+      stack.push_back(node.child1);
+      stack.push_back(node.child2);
+    }
+  }
+}
+
+float DynamicAabbTree::AreaRatio() const {
+  if (root_ == kNullNode) {
+    return 0.0f;
+  }
+  const float root_area = nodes_[root_].box.SurfaceArea();
+  float       total     = 0.0f;
+  for (const auto& node : nodes_) {
+    if (node.height > 0) {
+      total += node.box.SurfaceArea();
+    }
+  }
+  return root_area > 0.0f ? total / root_area : 0.0f;
+}
+
+}  // namespace vkengine
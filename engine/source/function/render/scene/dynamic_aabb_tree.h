@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/bounding_volume.h"
+
+namespace vkengine {
+
+// incremental bounding volume hierarchy over world space boxes, nodes live in one array and are
+// addressed by index. leaves store a fattened box so small moves do not touch the tree, inserts
+// pick the sibling with the surface area heuristic and AVL style rotations keep it balanced
+class DynamicAabbTree {
+ public:
+  static constexpr int32_t kNullNode = -1;
+  // leaf boxes grow by this fraction of their size plus kFatMargin on every side
+  static constexpr float kFatRatio  = 0.1f;
+  static constexpr float kFatMargin = 0.05f;
+
+  DynamicAabbTree() {}
+  ~DynamicAabbTree() {}
+
+  // return the proxy id of the new leaf
+  int32_t Insert(const AxisAlignedBox& box, uint32_t user_data);
+  void    Remove(int32_t proxy);
+  // return true if the box left the fattened box and the leaf was reinserted
+  bool Move(int32_t proxy, const AxisAlignedBox& box);
+  void Clear();
+
+  uint32_t              GetUserData(int32_t proxy) const { return nodes_[proxy].user_data; }
+  const AxisAlignedBox& GetFatBox(int32_t proxy) const { return nodes_[proxy].box; }
+
+  // the user data of every leaf whose fattened box passes the test is appended to result
+  void QueryFrustum(const Frustum& frustum, std::vector<uint32_t>& result) const;
+  void QuerySphere(const BoundingSphere& sphere, std::vector<uint32_t>& result) const;
+  void QueryRay(
+      const glm::vec3&       origin,
+      const glm::vec3&       direction,
+      float                  max_distance,
+      std::vector<uint32_t>& result) const;
+
+  int32_t  Height() const { return root_ == kNullNode ? 0 : nodes_[root_].height; }
+  uint32_t LeafCount() const { return leaf_count_; }
+  uint32_t NodeCount() const { return static_cast<uint32_t>(nodes_.size()) - free_count_; }
+  // sum of inner node areas over the root area, lower is a better tree
+  float AreaRatio() const;
+
+ private:
+  struct Node {
+    // fattened for leaves
+    AxisAlignedBox box;
+    // next free node while the node is on the free list
+    int32_t  parent    = kNullNode;
+    int32_t  child1    = kNullNode;
+    int32_t  child2    = kNullNode;
+    int32_t  height    = -1;
+    uint32_t user_data = 0;
+
+    bool IsLeaf() const { return child1 == kNullNode; }
+  };
+
+  std::vector<Node> nodes_;
+  int32_t           root_       = kNullNode;
+  int32_t           free_list_  = kNullNode;
+  uint32_t          free_count_ = 0;
+  uint32_t          leaf_count_ = 0;
+
+  int32_t AllocateNode();
+  void    FreeNode(int32_t node);
+  void    InsertLeaf(int32_t leaf);
+  void    RemoveLeaf(int32_t leaf);
+  // refit boxes and heights from node up to the root, rotating where unbalanced
+  void RefitAncestors(int32_t node);
+  // return the index of the node now at the position of node
+  int32_t Rotate(int32_t node);
+  void    CollectLeaves(int32_t node, std::vector<uint32_t>& result) const;
+
+  static AxisAlignedBox Fatten(const AxisAlignedBox& box);
+};
+
+}  // namespace vkengine
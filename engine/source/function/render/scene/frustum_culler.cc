@@ -0,0 +1,239 @@
+#include "function/render/scene/frustum_culler.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VKENGINE_CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(VKENGINE_CULL_X86) && (defined(__GNUC__) || defined(__clang__))
+#define VKENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VKENGINE_TARGET_AVX2
+#endif
+
+namespace vkengine {
+
+FrustumCuller::FrustumCuller() : kernel_(BestKernel()) {}
+
+CullKernel FrustumCuller::BestKernel() {
+#if defined(VKENGINE_CULL_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] >= 7) {
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    // the os must save the ymm registers
+    if (avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+      return CullKernel::kAvx2;
+    }
+  }
+  return CullKernel::kSse;
+#elif defined(VKENGINE_CULL_X86)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? CullKernel::kAvx2 : CullKernel::kSse;
+#else
+  return CullKernel::kScalar;
+#endif
+}
+
+const char* FrustumCuller::KernelName(CullKernel kernel) {
+  switch (kernel) {
+    case CullKernel::kAvx2:
+      return "avx2";
+    case CullKernel::kSse:
+      return "sse";
+    default:
+      return "scalar";
+  }
+}
+
+void FrustumCuller::SetKernel(CullKernel kernel) {
+  const CullKernel best = BestKernel();
+  kernel_               = kernel > best ? best : kernel;
+}
+
+void FrustumCuller::Clear() {
+  count_ = 0;
+  center_x_.clear();
+  center_y_.clear();
+  center_z_.clear();
+  extent_x_.clear();
+  extent_y_.clear();
+  extent_z_.clear();
+}
+
+void FrustumCuller::Reserve(uint32_t count) {
+  const size_t padded = (count + kBlockSize - 1) / kBlockSize * kBlockSize;
+  for (auto* values : {&center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_}) {
+    values->reserve(padded);
+  }
+}
+
+uint32_t FrustumCuller::Add(const AxisAlignedBox& box, const glm::mat4& model_matrix) {
+  return Add(box.Transform(model_matrix));
+}
+
+uint32_t FrustumCuller::Add(const AxisAlignedBox& world_box) {
+  if (count_ % kBlockSize == 0) {
+    for (auto* values : {&center_x_, &center_y_, &center_z_, &extent_x_, &extent_y_, &extent_z_}) {
+      values->resize(count_ + kBlockSize, 0.0f);
+    }
+  }
+  // an empty box gets a negative extent and never passes a plane
+  const glm::vec3 center = world_box.Center();
+  const glm::vec3 extent = world_box.Extent();
+  center_x_[count_]      = center.x;
+  center_y_[count_]      = center.y;
+  center_z_[count_]      = center.z;
+  extent_x_[count_]      = extent.x;
+  extent_y_[count_]      = extent.y;
+  extent_z_[count_]      = extent.z;
+  return count_++;
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  switch (kernel_) {
+    case CullKernel::kAvx2:
+      CullAvx2(frustum, visible);
+      break;
+    case CullKernel::kSse:
+      CullSse(frustum, visible);
+      break;
+    default:
+      CullScalar(frustum, visible);
+      break;
+  }
+}
+
+void FrustumCuller::CullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  for (uint32_t i = 0; i < count_; i++) {
+    bool inside = true;
+    for (const auto& plane : frustum.planes) {
+      const float distance =
+          plane.x * center_x_[i] + plane.y * center_y_[i] + plane.z * center_z_[i] + plane.w;
+      const float radius = std::abs(plane.x) * extent_x_[i] + std::abs(plane.y) * extent_y_[i] +
+                           std::abs(plane.z) * extent_z_[i];
+      if (distance + radius < 0.0f) {
+        inside = false;
+        break;
+      }
+    }
+    if (inside) {
+      visible.push_back(i);
+    }
+  }
+}
+
+#if defined(VKENGINE_CULL_X86)
+
+void FrustumCuller::CullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  constexpr uint32_t kLanes = 4;
+
+  // normal, |normal| and distance of every plane broadcast to all lanes
+  __m128 planes[6][7];
+  for (int p = 0; p < 6; p++) {
+    const auto& plane = frustum.planes[p];
+    planes[p][0]      = _mm_set1_ps(plane.x);
+    planes[p][1]      = _mm_set1_ps(plane.y);
+    planes[p][2]      = _mm_set1_ps(plane.z);
+    planes[p][3]      = _mm_set1_ps(plane.w);
+    planes[p][4]      = _mm_set1_ps(std::abs(plane.x));
+    planes[p][5]      = _mm_set1_ps(std::abs(plane.y));
+    planes[p][6]      = _mm_set1_ps(std::abs(plane.z));
+  }
+  const __m128 zero = _mm_setzero_ps();
+
+  for (uint32_t base = 0; base < count_; base += kLanes) {
+    const __m128 cx = _mm_loadu_ps(center_x_.data() + base);
+    const __m128 cy = _mm_loadu_ps(center_y_.data() + base);
+    const __m128 cz = _mm_loadu_ps(center_z_.data() + base);
+    const __m128 ex = _mm_loadu_ps(extent_x_.data() + base);
+    const __m128 ey = _mm_loadu_ps(extent_y_.data() + base);
+    const __m128 ez = _mm_loadu_ps(extent_z_.data() + base);
+
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(_mm_mul_ps(cx, planes[p][0]), planes[p][3]);
+      distance        = _mm_add_ps(distance, _mm_mul_ps(cy, planes[p][1]));
+      distance        = _mm_add_ps(distance, _mm_mul_ps(cz, planes[p][2]));
+      __m128 radius   = _mm_mul_ps(ex, planes[p][4]);
+      radius          = _mm_add_ps(radius, _mm_mul_ps(ey, planes[p][5]));
+      radius          = _mm_add_ps(radius, _mm_mul_ps(ez, planes[p][6]));
+      outside         = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+    }
+
+    const int inside = ~_mm_movemask_ps(outside) & 0xF;
+    for (uint32_t lane = 0; lane < kLanes; lane++) {
+      if ((inside & (1 << lane)) && base + lane < count_) {
+        visible.push_back(base + lane);
+      }
+    }
+  }
+}
+
+VKENGINE_TARGET_AVX2 void FrustumCuller::CullAvx2(
+    const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  constexpr uint32_t kLanes = 8;
+
+  __m256 planes[6][7];
+  for (int p = 0; p < 6; p++) {
+    const auto& plane = frustum.planes[p];
+    planes[p][0]      = _mm256_set1_ps(plane.x);
+    planes[p][1]      = _mm256_set1_ps(plane.y);
+    planes[p][2]      = _mm256_set1_ps(plane.z);
+    planes[p][3]      = _mm256_set1_ps(plane.w);
+    planes[p][4]      = _mm256_set1_ps(std::abs(plane.x));
+    planes[p][5]      = _mm256_set1_ps(std::abs(plane.y));
+    planes[p][6]      = _mm256_set1_ps(std::abs(plane.z));
+  }
+  const __m256 zero = _mm256_setzero_ps();
+
+  for (uint32_t base = 0; base < count_; base += kLanes) {
+    const __m256 cx = _mm256_loadu_ps(center_x_.data() + base);
+    const __m256 cy = _mm256_loadu_ps(center_y_.data() + base);
+    const __m256 cz = _mm256_loadu_ps(center_z_.data() + base);
+    const __m256 ex = _mm256_loadu_ps(extent_x_.data() + base);
+    const __m256 ey = _mm256_loadu_ps(extent_y_.data() + base);
+    const __m256 ez = _mm256_loadu_ps(extent_z_.data() + base);
+
+    __m256 outside = _mm256_setzero_ps();
+    for (int p = 0; p < 6; p++) {
+      __m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, planes[p][0]), planes[p][3]);
+      distance        = _mm256_add_ps(distance, _mm256_mul_ps(cy, planes[p][1]));
+      distance        = _mm256_add_ps(distance, _mm256_mul_ps(cz, planes[p][2]));
+      __m256 radius   = _mm256_mul_ps(ex, planes[p][4]);
+      radius          = _mm256_add_ps(radius, _mm256_mul_ps(ey, planes[p][5]));
+      radius          = _mm256_add_ps(radius, _mm256_mul_ps(ez, planes[p][6]));
+      outside         = _mm256_or_ps(
+          outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+    }
+
+    const int inside = ~_mm256_movemask_ps(outside) & 0xFF;
+    for (uint32_t lane = 0; lane < kLanes; lane++) {
+      if ((inside & (1 << lane)) && base + lane < count_) {
+        visible.push_back(base + lane);
+      }
+    }
+  }
+}
+
+#else
+
+void FrustumCuller::CullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  CullScalar(frustum, visible);
+}
+
+void FrustumCuller::CullAvx2(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+  CullScalar(frustum, visible);
+}
+
+#endif
+
+}  // namespace vkengine
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "function/render/scene/bounding_volume.h"
+
+namespace vkengine {
+
+enum class CullKernel : uint8_t { kScalar = 0, kSse, kAvx2 };
+
+// world space boxes kept as structure of arrays (center xyz, extent xyz), tested against the six
+// frustum planes 4 (sse) or 8 (avx2) boxes at a time. the kernel is picked once from the cpu
+class FrustumCuller {
+ public:
+  FrustumCuller();
+  ~FrustumCuller() {}
+
+  void     Clear();
+  void     Reserve(uint32_t count);
+  uint32_t Count() const { return count_; }
+
+  // return the index of the box, the object space box is moved to world space with model_matrix
+  uint32_t Add(const AxisAlignedBox& box, const glm::mat4& model_matrix);
+  uint32_t Add(const AxisAlignedBox& world_box);
+
+  // append the index of every box intersecting the frustum to visible, in ascending order
+  void Cull(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+  CullKernel GetKernel() const { return kernel_; }
+  // kernels the cpu does not support fall back to the best supported one
+  void SetKernel(CullKernel kernel);
+
+  static CullKernel BestKernel();
+  static const char* KernelName(CullKernel kernel);
+
+ private:
+  static constexpr uint32_t kBlockSize = 8;
+
+  uint32_t   count_  = 0;
+  CullKernel kernel_ = CullKernel::kScalar;
+
+  // padded to a multiple of kBlockSize, padding boxes are never reported
+  std::vector<float> center_x_;
+  std::vector<float> center_y_;
+  std::vector<float> center_z_;
+  std::vector<float> extent_x_;
+  std::vector<float> extent_y_;
+  std::vector<float> extent_z_;
+
+  void CullScalar(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+  void CullSse(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+  void CullAvx2(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+};
+
+}  // namespace vkengine
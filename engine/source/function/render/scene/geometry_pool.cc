@@ -0,0 +1,207 @@
+#include "function/render/scene/geometry_pool.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "core/exception/assert_exception.h"
+#include "function/render/rhi/vulkanrhi.h"
+
+namespace vkengine {
+
+void RangeAllocator::Init(uint32_t capacity) {
+  capacity_ = capacity;
+  used_     = 0;
+  free_ranges_.clear();
+  if (capacity_ > 0) {
+    free_ranges_.emplace(0, capacity_);
+  }
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t count) {
+  if (count == 0) {
+    return kInvalidOffset;
+  }
+  for (auto it = free_ranges_.begin(); it != free_ranges_.end(); ++it) {
+    if (it->second < count) {
+      continue;
+    }
+    const uint32_t offset = it->first;
+    const uint32_t remain = it->second - count;
+    free_ranges_.erase(it);
+    if (remain > 0) {
+      free_ranges_.emplace(offset + count, remain);
+    }
+    used_ += count;
+    return offset;
+  }
+  return kInvalidOffset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+  used_ -= count;
+
+  auto next = free_ranges_.lower_bound(offset);
+  // merge with the range right before
+  if (next != free_ranges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      count += prev->second;
+      free_ranges_.erase(prev);
+    }
+  }
+  // merge with the range right after
+  if (next != free_ranges_.end() && offset + count == next->first) {
+    count += next->second;
+    free_ranges_.erase(next);
+  }
+  free_ranges_.emplace(offset, count);
+}
+
+uint32_t RangeAllocator::LargestFreeRange() const {
+  uint32_t largest = 0;
+  for (const auto& range : free_ranges_) {
+    largest = std::max(largest, range.second);
+  }
+  return largest;
+}
+
+void GeometryPool::Init(std::shared_ptr<VulkanRhi> rhi) {
+  // no page up front, Allocate creates each page for the first mesh of its format and index type
+  rhi_        = rhi;
+  mesh_count_ = 0;
+}
+
+void GeometryPool::Destroy() {
+  for (auto& page : pages_) {
+    rhi_->DestroyBuffer(page.vertex_buffer, page.vertex_memory);
+    rhi_->DestroyBuffer(page.index_buffer, page.index_memory);
+  }
+  pages_.clear();
+  rhi_.reset();
+}
+
+uint32_t GeometryPool::CreatePage(
+    VertexFormat vertex_format,
+    VkIndexType  index_type,
+    uint32_t     vertex_capacity,
+    uint32_t     index_capacity) {
+  Page page;
+  page.vertex_format = vertex_format;
+  page.index_type    = index_type;
+  rhi_->CreateBuffer(
+      static_cast<VkDeviceSize>(vertex_capacity) * GetVertexStride(vertex_format),
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      page.vertex_buffer,
+      page.vertex_memory);
+  rhi_->CreateBuffer(
+      static_cast<VkDeviceSize>(index_capacity) * GetIndexSize(index_type),
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      page.index_buffer,
+      page.index_memory);
+  page.vertex_ranges.Init(vertex_capacity);
+  page.index_ranges.Init(index_capacity);
+
+  pages_.emplace_back(std::move(page));
+  return static_cast<uint32_t>(pages_.size() - 1);
+}
+
+void GeometryPool::Allocate(
+    VertexFormat                       vertex_format,
+    uint32_t                           vertex_count,
+    const std::function<void(void*)>& write_vertices,
+    VkIndexType                        index_type,
+    uint32_t                           index_count,
+    const std::function<void(void*)>& write_indices,
+    VulkanVertexBuffer&                mesh) {
+  ASSERT_EXECPTION(vertex_count == 0 || index_count == 0)
+      .SetErrorMessage("empty mesh can not be added to the geometry pool")
+      .Throw();
+
+  uint32_t page          = 0;
+  uint32_t vertex_offset = RangeAllocator::kInvalidOffset;
+  uint32_t first_index   = RangeAllocator::kInvalidOffset;
+  for (; page < pages_.size(); page++) {
+    if (pages_[page].vertex_format != vertex_format || pages_[page].index_type != index_type) {
+      continue;
+    }
+    vertex_offset = pages_[page].vertex_ranges.Allocate(vertex_count);
+    if (vertex_offset == RangeAllocator::kInvalidOffset) {
+      continue;
+    }
+    first_index = pages_[page].index_ranges.Allocate(index_count);
+    if (first_index != RangeAllocator::kInvalidOffset) {
+      break;
+    }
+    pages_[page].vertex_ranges.Free(vertex_offset, vertex_count);
+  }
+  if (page == pages_.size()) {
+    // meshes larger than a default page get a page of their own size
+    page = CreatePage(
+        vertex_format,
+        index_type,
+        std::max(vertex_count, kPageVertexCount),
+        std::max(index_count, kPageIndexCount));
+    vertex_offset = pages_[page].vertex_ranges.Allocate(vertex_count);
+    first_index   = pages_[page].index_ranges.Allocate(index_count);
+  }
+
+  mesh.mesh_vertex_count = vertex_count;
+  mesh.mesh_index_count  = index_count;
+  mesh.page              = page;
+  mesh.vertex_offset     = vertex_offset;
+  mesh.first_index       = first_index;
+  mesh.vertex_format     = vertex_format;
+  mesh.index_type        = index_type;
+  mesh_count_++;
+
+  const VkDeviceSize stride = GetVertexStride(vertex_format);
+  rhi_->UploadBuffer(
+      pages_[page].vertex_buffer,
+      static_cast<VkDeviceSize>(vertex_count) * stride,
+      write_vertices,
+      static_cast<VkDeviceSize>(vertex_offset) * stride);
+  rhi_->UploadBuffer(
+      pages_[page].index_buffer,
+      static_cast<VkDeviceSize>(index_count) * GetIndexSize(index_type),
+      write_indices,
+      static_cast<VkDeviceSize>(first_index) * GetIndexSize(index_type));
+}
+
+void GeometryPool::Free(VulkanVertexBuffer& mesh) {
+  auto& page = pages_[mesh.page];
+  page.vertex_ranges.Free(mesh.vertex_offset, mesh.mesh_vertex_count);
+  page.index_ranges.Free(mesh.first_index, mesh.mesh_index_count);
+  mesh_count_--;
+  mesh = VulkanVertexBuffer{};
+}
+
+void GeometryPool::Bind(VkCommandBuffer command_buffer, uint32_t page) const {
+  const VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(command_buffer, 0, 1, &pages_[page].vertex_buffer, &offset);
+  vkCmdBindIndexBuffer(command_buffer, pages_[page].index_buffer, 0, pages_[page].index_type);
+}
+
+GeometryPoolStatistics GeometryPool::GetStatistics() const {
+  GeometryPoolStatistics stats;
+  stats.page_count = PageCount();
+  stats.mesh_count = mesh_count_;
+  for (const auto& page : pages_) {
+    stats.vertex_capacity += page.vertex_ranges.Capacity();
+    stats.vertex_used += page.vertex_ranges.Used();
+    stats.index_capacity += page.index_ranges.Capacity();
+    stats.index_used += page.index_ranges.Used();
+    stats.free_range_count += page.vertex_ranges.FreeRangeCount();
+    stats.free_range_count += page.index_ranges.FreeRangeCount();
+  }
+  return stats;
+}
+
+}  // namespace vkengine
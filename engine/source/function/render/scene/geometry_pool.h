@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "forward.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// first fit free list over [0, capacity), units are elements (vertices or indices).
+// freed ranges are merged with their neighbours so the list stays short
+class RangeAllocator {
+ public:
+  static constexpr uint32_t kInvalidOffset = ~0u;
+
+  void Init(uint32_t capacity);
+
+  // return kInvalidOffset if no free range is large enough
+  uint32_t Allocate(uint32_t count);
+  void     Free(uint32_t offset, uint32_t count);
+
+  uint32_t Capacity() const { return capacity_; }
+  uint32_t Used() const { return used_; }
+  size_t   FreeRangeCount() const { return free_ranges_.size(); }
+  uint32_t LargestFreeRange() const;
+
+ private:
+  // offset -> count
+  std::map<uint32_t, uint32_t> free_ranges_;
+  uint32_t                     capacity_ = 0;
+  uint32_t                     used_     = 0;
+};
+
+struct GeometryPoolStatistics {
+  uint32_t page_count      = 0;
+  uint32_t mesh_count      = 0;
+  uint64_t vertex_capacity = 0;
+  uint64_t vertex_used     = 0;
+  uint64_t index_capacity  = 0;
+  uint64_t index_used      = 0;
+  // free ranges over all pages, grows with fragmentation
+  uint64_t free_range_count = 0;
+};
+
+// suballocates the vertex and index data of every mesh from a few large device local
+// buffers (pages). meshes in the same page are drawn with a single vertex/index bind,
+// a new page is only created when a mesh does not fit in any existing one. a page holds
+// one VertexFormat and one index type, so it is drawn with a single pipeline and index bind.
+// the pool starts without pages, page ids are in creation order
+class GeometryPool {
+ public:
+  static constexpr uint32_t kPageVertexCount = 1 << 20;
+  static constexpr uint32_t kPageIndexCount  = 1 << 22;
+
+  GeometryPool() {}
+  ~GeometryPool() {}
+
+  void Init(std::shared_ptr<VulkanRhi> rhi);
+  void Destroy();
+  bool IsInitialized() const { return rhi_ != nullptr; }
+
+  // reserve ranges for the mesh and upload its data through the staging ring. write_vertices
+  // fills the staging memory with vertex_count vertices of vertex_format, write_indices with
+  // index_count indices of index_type
+  void Allocate(
+      VertexFormat                       vertex_format,
+      uint32_t                           vertex_count,
+      const std::function<void(void*)>& write_vertices,
+      VkIndexType                        index_type,
+      uint32_t                           index_count,
+      const std::function<void(void*)>& write_indices,
+      VulkanVertexBuffer&                mesh);
+  void Free(VulkanVertexBuffer& mesh);
+
+  // bind the vertex and index buffer of page, draws then use the offsets of the mesh
+  void Bind(VkCommandBuffer command_buffer, uint32_t page) const;
+
+  uint32_t               PageCount() const { return static_cast<uint32_t>(pages_.size()); }
+  VkBuffer               VertexBuffer(uint32_t page) const { return pages_[page].vertex_buffer; }
+  VkBuffer               IndexBuffer(uint32_t page) const { return pages_[page].index_buffer; }
+  VertexFormat           PageFormat(uint32_t page) const { return pages_[page].vertex_format; }
+  VkIndexType            PageIndexType(uint32_t page) const { return pages_[page].index_type; }
+  GeometryPoolStatistics GetStatistics() const;
+
+ private:
+  struct Page {
+    VertexFormat     vertex_format = VertexFormat::kFull;
+    VkIndexType      index_type    = VK_INDEX_TYPE_UINT32;
+    VkBuffer         vertex_buffer = VK_NULL_HANDLE;
+    VulkanAllocation vertex_memory;
+    VkBuffer         index_buffer = VK_NULL_HANDLE;
+    VulkanAllocation index_memory;
+    RangeAllocator   vertex_ranges;
+    RangeAllocator   index_ranges;
+  };
+
+  std::shared_ptr<VulkanRhi> rhi_;
+  std::vector<Page>          pages_;
+  uint32_t                   mesh_count_ = 0;
+
+  uint32_t CreatePage(
+      VertexFormat vertex_format,
+      VkIndexType  index_type,
+      uint32_t     vertex_capacity,
+      uint32_t     index_capacity);
+};
+
+}  // namespace vkengine
@@ -1,14 +1,36 @@
 #include "function/render/scene/render_resource.h"
 
+#include <algorithm>
 #include <array>
+#include <cstdlib>
+#include <cstring>
 
 #include "core/exception/assert_exception.h"
 #include "core/utils/ccn_utils.h"
 #include "function/render/rhi/vulkanrhi.h"
 #include "function/render/rhi/vulkanutils.h"
+#include "function/render/texture/mip_generator.h"
+#include "macro.h"
 
 namespace vkengine {
 
+namespace {
+// upper bound of minStorageBufferOffsetAlignment, every array of the meshlet buffer is bound on
+// its own
+constexpr VkDeviceSize kMeshletArrayAlignment = 256;
+
+VkDeviceSize AlignMeshletArray(VkDeviceSize offset) {
+  return (offset + kMeshletArrayAlignment - 1) & ~(kMeshletArrayAlignment - 1);
+}
+}  // namespace
+
+RenderResource::~RenderResource() {
+  if (bindless_material_table_.IsInitialized()) {
+    bindless_material_table_.Destroy();
+  }
+  geometry_pool_.Destroy();
+}
+
 void RenderResource::UploadGameObjectRenderResource(
     std::shared_ptr<VulkanRhi> rhi,
     const RenderEntity&        render_entity,
@@ -25,6 +47,27 @@ void RenderResource::UploadGameObjectRenderResource(
   GetOrCreateVulkanMaterial(rhi, render_entity, material, material_descriptor_set_layout);
 }
 
+const VulkanVertexBuffer* RenderResource::FindMesh(size_t mesh_asset_id) const {
+  const auto it = vulkan_mesh_buffers_.find(mesh_asset_id);
+  return it != vulkan_mesh_buffers_.end() ? &it->second : nullptr;
+}
+
+const VulkanMaterialBuffer* RenderResource::FindMaterial(size_t material_asset_id) const {
+  auto it = vulkan_material_buffers_.find(material_asset_id);
+  if (it == vulkan_material_buffers_.end()) {
+    it = vulkan_material_buffers_.find(kPlaceholderMaterialAssetId);
+  }
+  return it != vulkan_material_buffers_.end() ? &it->second : nullptr;
+}
+
+void RenderResource::CreatePlaceholderMaterial(
+    std::shared_ptr<VulkanRhi> rhi, VkDescriptorSetLayout material_descriptor_set_layout) {
+  RenderEntity entity;
+  entity.material_asset_id = kPlaceholderMaterialAssetId;
+  // without a texture UpdateTextureImageData falls back to its grey image
+  GetOrCreateVulkanMaterial(rhi, entity, RenderMaterial{}, material_descriptor_set_layout);
+}
+
 VulkanVertexBuffer& RenderResource::GetOrCreateVulkanMesh(
     std::shared_ptr<VulkanRhi> rhi,
     const RenderEntity&        entity,
@@ -34,23 +77,8 @@ VulkanVertexBuffer& RenderResource::GetOrCreateVulkanMesh(
   if (it != vulkan_mesh_buffers_.end()) {
     return it->second;
   }
-  uint32_t index_buffer_size =
-      static_cast<uint32_t>(mesh_data.static_mesh_data.index_buffer.size());
-  const uint32_t* index_buffer_data = mesh_data.static_mesh_data.index_buffer.data();
-
-  uint32_t vertex_buffer_size =
-      static_cast<uint32_t>(mesh_data.static_mesh_data.vertex_buffer.size());
-  const auto* vertex_buffer_data = mesh_data.static_mesh_data.vertex_buffer.data();
-
   VulkanVertexBuffer mesh;
-  UpdateMeshData(
-      rhi,
-      index_buffer_size,
-      index_buffer_data,
-      vertex_buffer_size,
-      vertex_buffer_data,
-      mesh_descriptor_set_layout,
-      mesh);
+  UpdateMeshData(rhi, mesh_data.static_mesh_data, mesh_descriptor_set_layout, mesh);
 
   vulkan_mesh_buffers_.emplace(entity.mesh_asset_id, mesh);
   return vulkan_mesh_buffers_[entity.mesh_asset_id];
@@ -66,34 +94,13 @@ VulkanMaterialBuffer& RenderResource::GetOrCreateVulkanMaterial(
     return it->second;
   }
   VulkanMaterialBuffer now_material;
-  {
-    VkDeviceSize buffer_size = sizeof(VkPerMaterialUbo);
-
-    VkBuffer       inefficient_staging_buffer        = VK_NULL_HANDLE;
-    VkDeviceMemory inefficient_staging_buffer_memory = VK_NULL_HANDLE;
-    rhi->CreateBuffer(
-        buffer_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        inefficient_staging_buffer,
-        inefficient_staging_buffer_memory);
-    // VK_BUFFER_USAGE_TRANSFER_SRC_BIT: buffer can be used as source in a
-    // memory transfer operation
-
-    void* staging_buffer_data = nullptr;
-    vkMapMemory(
-        rhi->logic_device_,
-        inefficient_staging_buffer_memory,
-        0,
-        buffer_size,
-        0,
-        &staging_buffer_data);
-
-    VkPerMaterialUbo& material_uniform_buffer_info =
-        (*static_cast<VkPerMaterialUbo*>(staging_buffer_data));
-    material_uniform_buffer_info.base_color_factor = entity.base_color_factor;
+  VkPerMaterialUbo     material_uniform_buffer_info;
+  material_uniform_buffer_info.base_color_factor = entity.base_color_factor;
 
-    vkUnmapMemory(rhi->logic_device_, inefficient_staging_buffer_memory);
+  // bindless materials keep their record in the table instead of an own uniform buffer
+  const bool bindless = rhi->device_capabilities_.bindless;
+  if (!bindless) {
+    VkDeviceSize buffer_size = sizeof(VkPerMaterialUbo);
 
     rhi->CreateBuffer(
         buffer_size,
@@ -102,14 +109,19 @@ VulkanMaterialBuffer& RenderResource::GetOrCreateVulkanMaterial(
         now_material.material_uniform_buffer,
         now_material.material_uniform_memory);
 
-    // use the data from staging buffer
-    rhi->CopyBuffer(inefficient_staging_buffer, now_material.material_uniform_buffer, buffer_size);
-
-    // release staging buffer
-    vkDestroyBuffer(rhi->logic_device_, inefficient_staging_buffer, nullptr);
-    vkFreeMemory(rhi->logic_device_, inefficient_staging_buffer_memory, nullptr);
+    rhi->UploadBuffer(
+        now_material.material_uniform_buffer, &material_uniform_buffer_info, buffer_size);
   }
   UpdateTextureImageData(rhi, now_material, material_data, material_descriptor_set_layout);
+  if (bindless) {
+    if (!bindless_material_table_.IsInitialized()) {
+      bindless_material_table_.Init(rhi);
+    }
+    now_material.material_id = bindless_material_table_.AddMaterial(
+        material_uniform_buffer_info,
+        now_material.base_color_image_view,
+        now_material.base_color_sampler);
+  }
 
   vulkan_material_buffers_.emplace(entity.material_asset_id, now_material);
   return vulkan_material_buffers_[entity.material_asset_id];
@@ -117,111 +129,67 @@ VulkanMaterialBuffer& RenderResource::GetOrCreateVulkanMaterial(
 
 void RenderResource::UpdateMeshData(
     std::shared_ptr<VulkanRhi> rhi,
-    const uint32_t             index_buffer_size,
-    const uint32_t*            index_buffer_data,
-    const uint32_t             vertex_buffer_size,
-    const VulkanVertexData*    vertex_buffer_data,
+    const RenderMeshData&      mesh_data,
     VkDescriptorSetLayout      mesh_descriptor_set_layout,
     VulkanVertexBuffer&        now_mesh) {
-  now_mesh.mesh_vertex_count = vertex_buffer_size;
-  now_mesh.mesh_index_count  = index_buffer_size;
-
-  UpdateVertexBuffer(
-      rhi, index_buffer_size, index_buffer_data, vertex_buffer_size, vertex_buffer_data, now_mesh);
+  if (!geometry_pool_.IsInitialized()) {
+    geometry_pool_.Init(rhi);
+  }
+  // cooked and mapped meshes are written from their mapping straight into staging memory
+  const size_t index_bytes =
+      static_cast<size_t>(mesh_data.GetIndexCount()) * GetIndexSize(mesh_data.index_type);
+  geometry_pool_.Allocate(
+      mesh_data.vertex_format,
+      mesh_data.GetVertexCount(),
+      [&](void* dst) { mesh_data.WriteVertexData(dst); },
+      mesh_data.index_type,
+      mesh_data.GetIndexCount(),
+      [&](void* dst) { std::memcpy(dst, mesh_data.GetIndexData(), index_bytes); },
+      now_mesh);
+
+  now_mesh.quantization = mesh_data.quantization;
+  now_mesh.bounds       = mesh_data.bounds;
+  now_mesh.lods         = mesh_data.lods;
+  if (now_mesh.lods.empty()) {
+    now_mesh.lods.push_back({0, now_mesh.mesh_index_count, 0.0f});
+  }
+  for (auto& lod : now_mesh.lods) {
+    lod.first_index += now_mesh.first_index;
+  }
+  if (!mesh_data.meshlets.Empty()) {
+    UpdateMeshletData(rhi, mesh_data.meshlets, now_mesh);
+  }
   // update descriptor set
   { UnUsedVariable(mesh_descriptor_set_layout); }
-  UpdateIndexBuffer(rhi, index_buffer_size, index_buffer_data, now_mesh);
-}
-void RenderResource::UpdateVertexBuffer(
-    std::shared_ptr<VulkanRhi> rhi,
-    const uint32_t             index_count,
-    const uint32_t*            index_buffer_data,
-    const uint32_t             vertex_count,
-    const VulkanVertexData*    vertex_buffer_data,
-    VulkanVertexBuffer&        now_mesh) {
-  UnUsedVariable(index_count);
-  UnUsedVariable(index_buffer_data);
-  VkDeviceSize vertex_buffer_size = sizeof(VulkanVertexData) * vertex_count;
-
-  // temporary staging buffer
-  VkDeviceSize   inefficient_staging_buffer_size   = vertex_buffer_size;
-  VkBuffer       inefficient_staging_buffer        = VK_NULL_HANDLE;
-  VkDeviceMemory inefficient_staging_buffer_memory = VK_NULL_HANDLE;
-  rhi->CreateBuffer(
-      inefficient_staging_buffer_size,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      inefficient_staging_buffer,
-      inefficient_staging_buffer_memory);
-
-  void* inefficient_staging_buffer_data;
-  vkMapMemory(
-      rhi->logic_device_,
-      inefficient_staging_buffer_memory,
-      0,
-      VK_WHOLE_SIZE,
-      0,
-      &inefficient_staging_buffer_data);
-
-  std::memcpy(inefficient_staging_buffer_data, vertex_buffer_data, vertex_buffer_size);
-
-  vkUnmapMemory(rhi->logic_device_, inefficient_staging_buffer_memory);
-
-  rhi->CreateBuffer(
-      vertex_buffer_size,
-      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-      now_mesh.mesh_vertex_buffer,
-      now_mesh.mesh_vertex_memory);
-
-  // use the data from staging buffer
-  rhi->CopyBuffer(inefficient_staging_buffer, now_mesh.mesh_vertex_buffer, vertex_buffer_size);
-  // release staging buffer
-  vkDestroyBuffer(rhi->logic_device_, inefficient_staging_buffer, nullptr);
-  vkFreeMemory(rhi->logic_device_, inefficient_staging_buffer_memory, nullptr);
 }
 
-void RenderResource::UpdateIndexBuffer(
-    std::shared_ptr<VulkanRhi> rhi,
-    uint32_t                   index_count,
-    uint32_t const*            index_buffer_data,
-    VulkanVertexBuffer&        now_mesh) {
-  // temp staging buffer
-  VkDeviceSize buffer_size = sizeof(uint32_t) * index_count;
-
-  VkBuffer       inefficient_staging_buffer;
-  VkDeviceMemory inefficient_staging_buffer_memory;
-  rhi->CreateBuffer(
-      buffer_size,
-      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-      inefficient_staging_buffer,
-      inefficient_staging_buffer_memory);
-
-  void* staging_buffer_data;
-  vkMapMemory(
-      rhi->logic_device_,
-      inefficient_staging_buffer_memory,
-      0,
-      buffer_size,
-      0,
-      &staging_buffer_data);
-  memcpy(staging_buffer_data, index_buffer_data, (size_t)buffer_size);
-  vkUnmapMemory(rhi->logic_device_, inefficient_staging_buffer_memory);
+void RenderResource::UpdateMeshletData(
+    std::shared_ptr<VulkanRhi> rhi, const MeshletData& meshlets, VulkanVertexBuffer& now_mesh) {
+  const VkDeviceSize meshlet_bytes  = meshlets.meshlets.size() * sizeof(Meshlet);
+  const VkDeviceSize vertex_bytes   = meshlets.vertices.size() * sizeof(uint32_t);
+  const VkDeviceSize triangle_bytes = meshlets.triangles.size() * sizeof(uint32_t);
 
+  now_mesh.meshlets              = std::make_shared<const MeshletData>(meshlets);
+  now_mesh.meshlet_vertex_offset = AlignMeshletArray(meshlet_bytes);
+  now_mesh.meshlet_triangle_offset =
+      AlignMeshletArray(now_mesh.meshlet_vertex_offset + vertex_bytes);
   rhi->CreateBuffer(
-      buffer_size,
-      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      now_mesh.meshlet_triangle_offset + triangle_bytes,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-      now_mesh.mesh_index_buffer,
-      now_mesh.mesh_index_memory);
-
-  // use the data from staging buffer
-  rhi->CopyBuffer(inefficient_staging_buffer, now_mesh.mesh_index_buffer, buffer_size);
-
-  // release temp staging buffer
-  vkDestroyBuffer(rhi->logic_device_, inefficient_staging_buffer, nullptr);
-  vkFreeMemory(rhi->logic_device_, inefficient_staging_buffer_memory, nullptr);
+      now_mesh.meshlet_buffer,
+      now_mesh.meshlet_memory);
+  rhi->UploadBuffer(now_mesh.meshlet_buffer, meshlets.meshlets.data(), meshlet_bytes);
+  rhi->UploadBuffer(
+      now_mesh.meshlet_buffer,
+      meshlets.vertices.data(),
+      vertex_bytes,
+      now_mesh.meshlet_vertex_offset);
+  rhi->UploadBuffer(
+      now_mesh.meshlet_buffer,
+      meshlets.triangles.data(),
+      triangle_bytes,
+      now_mesh.meshlet_triangle_offset);
 }
 
 void RenderResource::UpdateTextureImageData(
@@ -243,7 +211,22 @@ void RenderResource::UpdateTextureImageData(
     }
     return res;
   };
-  auto base_color_image = copytexture(texture_data.base_color_texture, PixelFormat::R8G8B8A8_SRGB);
+  auto base_color_texture = texture_data.base_color_texture;
+  if (base_color_texture && IsBlockCompressed(base_color_texture->format) &&
+      !rhi->device_capabilities_.texture_compression_bc) {
+    LogWarn("the device can not sample block compressed textures, base color left grey");
+    base_color_texture = nullptr;
+  }
+  auto base_color_image = copytexture(base_color_texture, PixelFormat::R8G8B8A8_SRGB);
+  // a single level the rhi can not blit into mips is filtered on the cpu instead
+  std::shared_ptr<RenderMaterialData> cpu_levels;
+  if (base_color_image.mip_levels <= 1 && !IsBlockCompressed(base_color_image.format) &&
+      GetMipLevelCount(base_color_image.width, base_color_image.height) > 1 &&
+      !rhi->CanGenerateMipmaps(base_color_image.format)) {
+    cpu_levels = MipGenerator().Generate(base_color_image, MipFilter::kBox, 0, GThreadPool.get());
+    ASSERT_EXECPTION(!cpu_levels).SetErrorMessage("failed to filter texture mips!").Throw();
+    base_color_image = *cpu_levels;
+  }
   {
     rhi->CreateGlobalImage(
         now_material.base_color_image,
@@ -252,21 +235,22 @@ void RenderResource::UpdateTextureImageData(
         base_color_image.width,
         base_color_image.height,
         base_color_image.pixels,
-        base_color_image.format);
+        base_color_image.format,
+        0,
+        std::max(base_color_image.mip_levels, 1u));
+    now_material.base_color_sampler =
+        rhi->GetOrCreateMipmapSampler(base_color_image.width, base_color_image.height);
+  }
+  if (cpu_levels) {
+    free(cpu_levels->pixels);
+  }
+  if (rhi->device_capabilities_.bindless) {
+    return;
   }
 
   {
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool     = rhi->descriptor_pool_;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts        = &material_descriptor_set_layout;
-
-    ASSERT_EXECPTION(
-        vkAllocateDescriptorSets(
-            rhi->logic_device_, &allocInfo, &now_material.material_descriptor_set) != VK_SUCCESS)
-        .SetErrorMessage("failed to CreateDescriptorSets!")
-        .Throw();
+    now_material.material_descriptor_set =
+        rhi->descriptor_allocator_.AllocatePersistent(material_descriptor_set_layout);
 
     VkDescriptorBufferInfo bufferInfo{};
     bufferInfo.buffer                           = now_material.material_uniform_buffer;
@@ -275,10 +259,9 @@ void RenderResource::UpdateTextureImageData(
     VkDescriptorImageInfo base_color_image_info = {};
     base_color_image_info.imageLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     base_color_image_info.imageView             = now_material.base_color_image_view;
-    base_color_image_info.sampler =
-        rhi->GetOrCreateMipmapSampler(base_color_image.width, base_color_image.height);
+    base_color_image_info.sampler               = now_material.base_color_sampler;
 
-    std::array<VkWriteDescriptorSet, 1> descriptorWrites{};
+    std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
     descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     descriptorWrites[0].pNext           = nullptr;
     descriptorWrites[0].dstSet          = now_material.material_descriptor_set;
@@ -288,6 +271,16 @@ void RenderResource::UpdateTextureImageData(
     descriptorWrites[0].descriptorCount = 1;
     descriptorWrites[0].pBufferInfo     = &bufferInfo;
 
+    // the baseColorTexture of shader_per_material.frag
+    descriptorWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[1].pNext           = nullptr;
+    descriptorWrites[1].dstSet          = now_material.material_descriptor_set;
+    descriptorWrites[1].dstBinding      = 1;
+    descriptorWrites[1].dstArrayElement = 0;
+    descriptorWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrites[1].descriptorCount = 1;
+    descriptorWrites[1].pImageInfo      = &base_color_image_info;
+
     vkUpdateDescriptorSets(
         rhi->logic_device_,
         static_cast<uint32_t>(descriptorWrites.size()),
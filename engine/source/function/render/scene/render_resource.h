@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+
+#include "function/render/scene/bindless_material_table.h"
+#include "function/render/scene/geometry_pool.h"
 #include "function/render/scene/render_resource_base.h"
 #include "function/render/scene/render_type.h"
 
@@ -7,7 +11,9 @@ namespace vkengine {
 class RenderResource : public RenderResourceBase {
  public:
   RenderResource() {}
-  ~RenderResource() {}
+  // destroys the geometry pool and the material table while the device still exists, both hold
+  // the rhi. the gpu must be done with the frames that read them
+  ~RenderResource();
 
   virtual void UploadGameObjectRenderResource(
       std::shared_ptr<VulkanRhi> rhi,
@@ -21,6 +27,19 @@ class RenderResource : public RenderResourceBase {
       const RenderMaterial&      material,
       VkDescriptorSetLayout      material_descriptor_set_layout);
 
+  GeometryPool&          GetGeometryPool() { return geometry_pool_; }
+  BindlessMaterialTable& GetBindlessMaterialTable() { return bindless_material_table_; }
+
+  // material drawn in place of materials that are still loading
+  static constexpr size_t kPlaceholderMaterialAssetId = SIZE_MAX;
+  void CreatePlaceholderMaterial(
+      std::shared_ptr<VulkanRhi> rhi, VkDescriptorSetLayout material_descriptor_set_layout);
+
+  // nullptr if the asset has not been uploaded yet. a material that has not been uploaded
+  // resolves to the placeholder once there is one
+  const VulkanVertexBuffer*   FindMesh(size_t mesh_asset_id) const;
+  const VulkanMaterialBuffer* FindMaterial(size_t material_asset_id) const;
+
  private:
   VulkanVertexBuffer& GetOrCreateVulkanMesh(
       std::shared_ptr<VulkanRhi> rhi,
@@ -35,25 +54,12 @@ class RenderResource : public RenderResourceBase {
 
   void UpdateMeshData(
       std::shared_ptr<VulkanRhi> rhi,
-      const uint32_t             index_count,
-      const uint32_t*            index_buffer_data,
-      const uint32_t             vertex_count,
-      const VulkanVertexData*    vertex_buffer_data,
+      const RenderMeshData&      mesh_data,
       VkDescriptorSetLayout      mesh_descriptor_set_layout,
       VulkanVertexBuffer&        now_mesh);
-
-  void UpdateVertexBuffer(
-      std::shared_ptr<VulkanRhi> rhi,
-      const uint32_t             index_count,
-      const uint32_t*            index_buffer_data,
-      const uint32_t             vertex_count,
-      const VulkanVertexData*    vertex_buffer_data,
-      VulkanVertexBuffer&        now_mesh);
-  void UpdateIndexBuffer(
-      std::shared_ptr<VulkanRhi> rhi,
-      const uint32_t             index_count,
-      const uint32_t*            index_buffer_data,
-      VulkanVertexBuffer&        now_mesh);
+  // keep the clusters for the cpu culler and upload them for the gpu one
+  void UpdateMeshletData(
+      std::shared_ptr<VulkanRhi> rhi, const MeshletData& meshlets, VulkanVertexBuffer& now_mesh);
 
   void UpdateTextureImageData(
       std::shared_ptr<VulkanRhi> rhi,
@@ -61,6 +67,8 @@ class RenderResource : public RenderResourceBase {
       const RenderMaterial&      texture_data,
       VkDescriptorSetLayout      material_descriptor_set_layout);
 
+  GeometryPool                           geometry_pool_;
+  BindlessMaterialTable                  bindless_material_table_;
   std::map<size_t, VulkanVertexBuffer>   vulkan_mesh_buffers_;
   std::map<size_t, VulkanMaterialBuffer> vulkan_material_buffers_;
 };
@@ -1,231 +1,560 @@
 
 #include "function/render/scene/render_resource_base.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include <chrono>
+#include <filesystem>
 
 #include "core/exception/assert_exception.h"
+#include "core/utils/mapped_file.h"
+#include "function/render/mesh/gltf_loader.h"
+#include "function/render/mesh/index_compaction.h"
+#include "function/render/mesh/mesh_optimizer.h"
+#include "function/render/mesh/mesh_simplifier.h"
+#include "function/render/mesh/meshlet_builder.h"
+#include "function/render/mesh/obj_parser.h"
+#include "function/render/mesh/obj_streamer.h"
+#include "function/render/mesh/tangent_generator.h"
+#include "function/render/mesh/vertex_packing.h"
+#include "function/render/texture/ktx2_file.h"
+#include "function/render/texture/texture_cooker.h"
+#include "function/render/texture/texture_decoder.h"
 #include "macro.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-
 namespace vkengine {
 
-RenderResourceBase::BoudingBox& RenderResourceBase::GetCachedBoudingBox(
-    const RenderMeshSource& source) {
-  bounding_box_cache_map.try_emplace(source, BoudingBox{});
-  return bounding_box_cache_map[source];
+RenderResourceBase::BoudingBox RenderResourceBase::GetCachedBoudingBox(
+    const RenderMeshSource& source) const {
+  std::lock_guard<std::mutex> lock(bounding_box_mutex_);
+  const auto                  it = bounding_box_cache_map.find(source);
+  return it == bounding_box_cache_map.end() ? BoudingBox{} : it->second;
+}
+
+void RenderResourceBase::CacheBoudingBox(
+    const RenderMeshSource& source, const BoudingBox& bounding_box) {
+  std::lock_guard<std::mutex> lock(bounding_box_mutex_);
+  bounding_box_cache_map[source] = bounding_box;
 }
 
 RenderMeshData RenderResourceBase::LoadStaticMesh(
     const std::string& mesh_file, BoudingBox& bounding_box) {
   RenderMeshData mesh_data;
 
-  tinyobj::ObjReader       reader;
-  tinyobj::ObjReaderConfig reader_config;
-  reader_config.vertex_color = false;
-  ASSERT_EXECPTION(!reader.ParseFromFile(mesh_file, reader_config))
-      .SetErrorMessage(fmt::format("load mesh {} fail, error : {} ", mesh_file, reader.Error()))
+  ObjMeshData obj;
+  std::string error;
+  ObjParser   parser(GThreadPool.get());
+  ASSERT_EXECPTION(!parser.Parse(mesh_file, obj, error))
+      .SetErrorMessage(fmt::format("load mesh {} fail, error : {} ", mesh_file, error))
       .Throw();
+  const auto& statistics = parser.GetStatistics();
+  LogDebug(
+      "parse {} : {} bytes, {} chunks, parse {:.2f} ms, merge {:.2f} ms",
+      mesh_file,
+      statistics.bytes,
+      statistics.chunk_count,
+      statistics.parse_ms,
+      statistics.merge_ms);
+
+  MeshWelder<VulkanVertexData> welder(obj.corners.size());
+  mesh_data.index_buffer.reserve(obj.corners.size());
+  for (size_t f = 0; f + 2 < obj.corners.size(); f += 3) {
+    VulkanVertexData triangle[3];
+    ExpandObjTriangle(
+        &obj.corners[f], obj.positions.data(), obj.normals.data(), obj.texcoords.data(), triangle);
+    for (const auto& vertex : triangle) {
+      mesh_data.index_buffer.emplace_back(welder.Weld(vertex));
+    }
+  }
+  FinishStaticMesh(mesh_file, welder, mesh_data);
+  bounding_box = mesh_data.bounds;
+  return mesh_data;
+}
+
+void RenderResourceBase::FinishStaticMesh(
+    const std::string&            mesh_file,
+    MeshWelder<VulkanVertexData>& welder,
+    RenderMeshData&               mesh_data) {
+  LogDebug(
+      "weld {} : {} corners, {} vertices, {} probes",
+      mesh_file,
+      welder.GetStatistics().corner_count,
+      welder.GetStatistics().unique_count,
+      welder.GetStatistics().probe_count);
+  mesh_data.vertex_buffer = welder.TakeVertices();
+
+  // welded without tangents, mirrored uvs split the vertices they need to
+  const auto tangent_start      = std::chrono::steady_clock::now();
+  const auto tangent_statistics =
+      GenerateTangents(mesh_data.vertex_buffer, mesh_data.index_buffer, GThreadPool.get());
+  LogDebug(
+      "tangents {} : {} vertices, {} split for mirrored uvs, {} faces without uv area, {:.2f} ms",
+      mesh_file,
+      tangent_statistics.vertex_count,
+      tangent_statistics.split_count,
+      tangent_statistics.degenerate_count,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tangent_start)
+          .count());
+
+  mesh_data.bounds = MeshBounds::FromPositions(
+      mesh_data.vertex_buffer.empty() ? nullptr : &mesh_data.vertex_buffer[0].position,
+      mesh_data.vertex_buffer.size(),
+      sizeof(VulkanVertexData));
+}
 
-  if (!reader.Warning().empty()) {
-    LogWarn("loadMesh {} warning, warning: {}", mesh_file, reader.Warning());
+void RenderResourceBase::CookStaticMesh(const RenderMeshSource& source, RenderMeshData& mesh_data) {
+  if (source.optimize_flags != 0) {
+    OptimizeStaticMesh(source.mesh_file, source.optimize_flags, mesh_data);
+  }
+  if (source.lod_count > 1) {
+    BuildStaticMeshLods(source.mesh_file, source.lod_count, mesh_data);
+  }
+  // before packing and compaction, the builder reads full positions and 32 bit indices
+  if (source.optimize_flags & kMeshOptimizeMeshlets) {
+    BuildStaticMeshlets(source.mesh_file, mesh_data);
   }
+  if (source.vertex_format == VertexFormat::kPacked) {
+    PackStaticMesh(source.mesh_file, mesh_data);
+  }
+  CompactStaticMesh(source.mesh_file, mesh_data);
+}
 
-  auto& attrib = reader.GetAttrib();
-  auto& shapes = reader.GetShapes();
+void RenderResourceBase::OptimizeStaticMesh(
+    const std::string& mesh_file, uint32_t optimize_flags, RenderMeshData& mesh_data) {
+  const auto statistics = OptimizeMeshData(mesh_data, optimize_flags);
+  LogInfo(
+      "optimize {} : acmr {:.3f} -> {:.3f}, atvr {:.3f} -> {:.3f}, {} overdraw clusters",
+      mesh_file,
+      statistics.before.acmr,
+      statistics.after.acmr,
+      statistics.before.atvr,
+      statistics.after.atvr,
+      statistics.cluster_count);
+}
 
-  std::unordered_map<VulkanVertexData, uint32_t, VulkanVertexData::HasHValue> mesh_vertices;
-  for (const auto& shape : shapes) {
-    size_t index_offset = 0;
-    for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-      size_t fv = size_t(shape.mesh.num_face_vertices[f]);
+void RenderResourceBase::BuildStaticMeshLods(
+    const std::string& mesh_file, uint32_t lod_count, RenderMeshData& mesh_data) {
+  MeshLodOptions options;
+  options.lod_count = lod_count;
+  BuildMeshLods(mesh_data, options);
+  for (size_t l = 1; l < mesh_data.lods.size(); l++) {
+    LogInfo(
+        "lod {} of {} : {} -> {} triangles, error {:.3g}",
+        l,
+        mesh_file,
+        mesh_data.lods[0].index_count / 3,
+        mesh_data.lods[l].index_count / 3,
+        mesh_data.lods[l].error);
+  }
+}
 
-      bool with_normal   = true;
-      bool with_texcoord = true;
+void RenderResourceBase::BuildStaticMeshlets(
+    const std::string& mesh_file, RenderMeshData& mesh_data) {
+  const size_t triangle_count =
+      (mesh_data.lods.empty() ? mesh_data.index_buffer.size() : mesh_data.lods[0].index_count) / 3;
+  if (triangle_count < kMinMeshletTriangleCount) {
+    return;
+  }
+  const size_t meshlet_count = BuildMeshletData(mesh_data);
+  if (meshlet_count == 0) {
+    return;
+  }
+  LogInfo(
+      "meshlets {} : {} clusters, {:.1f} vertices {:.1f} triangles per cluster",
+      mesh_file,
+      meshlet_count,
+      double(mesh_data.meshlets.vertices.size()) / meshlet_count,
+      double(mesh_data.meshlets.triangles.size()) / meshlet_count);
+}
 
-      VertexType vertex[3];
-      VertexType normal[3];
-      UvType     uv[3];
+void RenderResourceBase::CompactStaticMesh(
+    const std::string& mesh_file, RenderMeshData& mesh_data) {
+  const size_t long_index_bytes = mesh_data.index_buffer.size() * sizeof(uint32_t);
+  if (CompactIndices(mesh_data)) {
+    LogDebug(
+        "compact indices {} : {} -> {} bytes",
+        mesh_file,
+        long_index_bytes,
+        mesh_data.short_index_buffer.size() * sizeof(uint16_t));
+  }
+}
 
-      // only deals with triangle faces
-      if (fv != 3) {
-        continue;
-      }
+void RenderResourceBase::PackStaticMesh(const std::string& mesh_file, RenderMeshData& mesh_data) {
+  const auto full = mesh_data.vertex_buffer;
+  PackMeshData(mesh_data);
+
+  const auto error = MeasurePackingError(
+      full.data(), mesh_data.packed_vertex_buffer.data(), full.size(), mesh_data.quantization);
+  LogInfo(
+      "pack {} : {} -> {} vertex bytes, max error position {:.3g} normal {:.3f} deg "
+      "tangent {:.3f} deg uv {:.3g}",
+      mesh_file,
+      full.size() * sizeof(VulkanVertexData),
+      full.size() * sizeof(VulkanPackedVertexData),
+      error.position,
+      error.normal_degrees,
+      error.tangent_degrees,
+      error.texcoord);
+}
 
-      // expanding vertex data is not efficient and is for testing purposes only
-      for (size_t v = 0; v < fv; v++) {
-        auto idx = shape.mesh.indices[index_offset + v];
-        auto vx  = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-        auto vy  = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-        auto vz  = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
+RenderMesh RenderResourceBase::LoadMesh(const RenderMeshSource& source, BoudingBox& bounding_box) {
+  RenderMesh  ret;
+  const auto  start = std::chrono::steady_clock::now();
+  const char* path  = "cooked";
+
+  if (IsGltfFile(source.mesh_file)) {
+    ret.static_mesh_data = LoadGltfMesh(source, path);
+    bounding_box         = ret.static_mesh_data.bounds;
+  } else {
+    ASSERT_EXECPTION(std::filesystem::path(source.mesh_file).extension() != ".obj")
+        .SetErrorMessage(fmt::format("load mesh {} fail, unsupported format", source.mesh_file))
+        .Throw();
+    // a source that can not be read is not cached, LoadStaticMesh reports the error
+    MeshSourceKey key;
+    const bool    stated = key.Stat({source.mesh_file});
+    const bool    cached = stated && mesh_cache.Load(source, key, ret.static_mesh_data);
+    if (cached) {
+      bounding_box = ret.static_mesh_data.bounds;
+      path         = "cached";
+    } else {
+      ret.static_mesh_data = LoadStaticMesh(source.mesh_file, bounding_box);
+      CookStaticMesh(source, ret.static_mesh_data);
+      if (stated && !mesh_cache.Store(source, key, ret.static_mesh_data)) {
+        LogWarn("can not write mesh cache {}", mesh_cache.EntryPath(source));
+      }
+    }
+  }
+  LogInfo(
+      "load mesh {} ({}) in {:.2f} ms",
+      source.mesh_file,
+      path,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+  CacheBoudingBox(source, bounding_box);
+  return ret;
+}
 
-        vertex[v] = {static_cast<float>(vx), static_cast<float>(vy), static_cast<float>(vz)};
+std::shared_future<RenderMesh> RenderResourceBase::LoadMeshAsync(const RenderMeshSource& source) {
+  return GThreadPool
+      ->Submit([this, source]() {
+        BoudingBox bounding_box;
+        return LoadMesh(source, bounding_box);
+      })
+      .share();
+}
 
-        // TODO: bounding_box
-        bounding_box = 1;
-        // bounding_box.extend(vertex[v]);
+std::shared_future<RenderMaterial> RenderResourceBase::LoadMaterialAsync(
+    const RenderMaterialSource& source) {
+  return GThreadPool->Submit([this, source]() { return LoadMaterial(source); }).share();
+}
 
-        if (idx.normal_index >= 0) {
-          auto nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-          auto ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-          auto nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
+RenderMeshData RenderResourceBase::LoadGltfMesh(const RenderMeshSource& source, const char*& path) {
+  std::string  file;
+  uint32_t     mesh_index = 0;
+  GltfDocument document;
+  std::string  error;
+  SplitGltfReference(source.mesh_file, file, mesh_index);
+  ASSERT_EXECPTION(!document.Open(file, error))
+      .SetErrorMessage(fmt::format("load mesh {} fail, error : {} ", source.mesh_file, error))
+      .Throw();
+  ASSERT_EXECPTION(mesh_index >= document.GetMeshes().size())
+      .SetErrorMessage(
+          fmt::format("load mesh {} fail, {} has no such mesh", source.mesh_file, file))
+      .Throw();
+  const GltfMesh& mesh = document.GetMeshes()[mesh_index];
 
-          normal[v] = {static_cast<float>(nx), static_cast<float>(ny), static_cast<float>(nz)};
-        } else {
-          with_normal = false;
-        }
+  // nothing to cook, the upload copies the accessors from the mapping into staging memory
+  RenderMeshData mesh_data;
+  if (source.vertex_format == VertexFormat::kFull && source.optimize_flags == 0 &&
+      source.lod_count <= 1 && MapGltfMesh(document, mesh, mesh_data)) {
+    path = "mapped";
+    return mesh_data;
+  }
 
-        if (idx.texcoord_index >= 0) {
-          auto tx = attrib.texcoords[2 * size_t(idx.texcoord_index) + 0];
-          auto ty = attrib.texcoords[2 * size_t(idx.texcoord_index) + 1];
+  // the document and its external buffers together are the source of the cache entry
+  MeshSourceKey key;
+  const bool    stated = key.Stat(document.GetFiles());
+  if (stated && mesh_cache.Load(source, key, mesh_data)) {
+    path = "cached";
+    return mesh_data;
+  }
 
-          uv[v] = {static_cast<float>(tx), static_cast<float>(ty)};
-        } else {
-          with_texcoord = false;
-        }
-      }
-      index_offset += fv;
-
-      if (!with_normal) {
-        VertexType v0 = vertex[1] - vertex[0];
-        VertexType v1 = vertex[2] - vertex[1];
-        normal[0]     = glm::normalize(glm::cross(v0, v1));
-        normal[1]     = normal[0];
-        normal[2]     = normal[0];
-      }
+  const auto gather = GatherGltfMesh(mesh, mesh_data.vertex_buffer, mesh_data.index_buffer);
+  LogDebug(
+      "gather {} : {} primitives, {} vertices, {} indices",
+      source.mesh_file,
+      mesh.primitives.size(),
+      mesh_data.vertex_buffer.size(),
+      mesh_data.index_buffer.size());
+  if (gather.complete) {
+    mesh_data.bounds = MeshBounds::FromPositions(
+        mesh_data.vertex_buffer.empty() ? nullptr : &mesh_data.vertex_buffer[0].position,
+        mesh_data.vertex_buffer.size(),
+        sizeof(VulkanVertexData));
+  } else {
+    // triangles unwelded for their flat normals or vertices without tangents, finished like an
+    // obj
+    MeshWelder<VulkanVertexData> welder(mesh_data.index_buffer.size());
+    for (auto& index : mesh_data.index_buffer) {
+      index = welder.Weld(mesh_data.vertex_buffer[index]);
+    }
+    FinishStaticMesh(source.mesh_file, welder, mesh_data);
+  }
+  CookStaticMesh(source, mesh_data);
+  if (stated && !mesh_cache.Store(source, key, mesh_data)) {
+    LogWarn("can not write mesh cache {}", mesh_cache.EntryPath(source));
+  }
+  return mesh_data;
+}
 
-      if (!with_texcoord) {
-        uv[0] = UvType(0.5f, 0.5f);
-        uv[1] = UvType(0.5f, 0.5f);
-        uv[2] = UvType(0.5f, 0.5f);
-      }
+std::vector<MeshStreamChunk> RenderResourceBase::ImportMeshStream(
+    const RenderMeshSource& source, const ObjStreamOptions& options) {
+  const auto start = std::chrono::steady_clock::now();
+  // the budget decides where the chunks are cut
+  const uint64_t layout[] = {
+      options.memory_budget, options.chunk_triangle_count, options.cook_bytes_per_triangle};
+  MeshSourceKey key;
+  ASSERT_EXECPTION(!key.Stat({source.mesh_file}, HashBytes(layout, sizeof(layout))))
+      .SetErrorMessage(fmt::format("import mesh {} fail, can not read it", source.mesh_file))
+      .Throw();
 
-      VertexType tangent{1, 0, 0};
-      {
-        VertexType edge1    = vertex[1] - vertex[0];
-        VertexType edge2    = vertex[2] - vertex[1];
-        UvType     deltaUV1 = uv[1] - uv[0];
-        UvType     deltaUV2 = uv[2] - uv[1];
-
-        // auto divide = deltaUV1[0] * deltaUV2[1] - deltaUV2[0] * deltaUV1[1];
-        // if (divide >= 0.0f && divide < 0.000001f) {
-        //   divide = 0.000001f;
-        // } else if (divide < 0.0f && divide > -0.000001f) {
-        //   divide = -0.000001f;
-        // }
-
-        // float df = 1.0f / divide;
-
-        // tbn
-        // [e1,e2] = [t,b] * [u v]
-        // https://www.zhihu.com/column/c_1249465121615204352
-        // Matrix<float, 3, 2> e;
-        // e.col(0) = edge1;
-        // e.col(1) = edge2;
-        // Vector2f uv_inv_col1{deltaUV2[1], -deltaUV1[1]};
-        // tangent = (e * uv_inv_col1).col(0).normalized();
-
-        tangent = {
-            (deltaUV2[1] * edge1[0] - deltaUV1[1] * edge2[0]),
-            (deltaUV2[1] * edge1[1] - deltaUV1[1] * edge2[1]),
-            (deltaUV2[1] * edge1[2] - deltaUV1[1] * edge2[2])};
-        tangent = glm::normalize(tangent);
-      }
+  std::vector<MeshStreamChunk> chunks;
+  if (mesh_cache.LoadChunks(source, key, chunks)) {
+    LogInfo("import mesh {} (cached) : {} chunks", source.mesh_file, chunks.size());
+    return chunks;
+  }
+  uint64_t stream_hash = 0;
+  ASSERT_EXECPTION(!key.Hash(stream_hash))
+      .SetErrorMessage(fmt::format("import mesh {} fail, can not read it", source.mesh_file))
+      .Throw();
 
-      for (size_t i = 0; i < 3; i++) {
-        VulkanVertexData mesh_vert{};
-
-        mesh_vert.position = vertex[i];
-        mesh_vert.normal   = normal[i];
-        mesh_vert.texcoord = uv[i];
-        mesh_vert.tangent  = tangent;
-
-        const auto it = mesh_vertices.find(mesh_vert);
-        if (it == mesh_vertices.end()) {
-          mesh_vertices[mesh_vert] = static_cast<uint32_t>(mesh_data.vertex_buffer.size());
-          mesh_data.index_buffer.emplace_back(
-              static_cast<uint32_t>(mesh_data.vertex_buffer.size()));
-          mesh_data.vertex_buffer.emplace_back(mesh_vert);
-        } else {
-          mesh_data.index_buffer.emplace_back(it->second);
+  ObjStreamer streamer(GThreadPool.get());
+  std::string error;
+  const bool  streamed = streamer.Stream(
+      source.mesh_file,
+      options,
+      [&](uint32_t chunk, std::vector<VulkanVertexData>& corners) {
+        MeshStreamChunk piece;
+        piece.source         = MeshCache::ChunkSource(source, chunk);
+        piece.source_hash    = stream_hash;
+        piece.triangle_count = static_cast<uint32_t>(corners.size() / 3);
+
+        RenderMeshData               mesh_data;
+        MeshWelder<VulkanVertexData> welder(corners.size());
+        mesh_data.index_buffer.reserve(corners.size());
+        for (const auto& corner : corners) {
+          mesh_data.index_buffer.emplace_back(welder.Weld(corner));
         }
-      }
-    }
+        // the corners are the largest buffer of the chunk, gone before cooking
+        std::vector<VulkanVertexData>().swap(corners);
+        FinishStaticMesh(piece.source.mesh_file, welder, mesh_data);
+        CookStaticMesh(piece.source, mesh_data);
+        piece.bounds = mesh_data.bounds;
+        ASSERT_EXECPTION(!mesh_cache.Store(piece.source, key, mesh_data))
+            .SetErrorMessage(
+                fmt::format("can not write mesh cache {}", mesh_cache.EntryPath(piece.source)))
+            .Throw();
+        chunks.push_back(piece);
+      },
+      error);
+  ASSERT_EXECPTION(!streamed)
+      .SetErrorMessage(fmt::format("import mesh {} fail, error : {} ", source.mesh_file, error))
+      .Throw();
+  if (!mesh_cache.StoreChunks(source, key, chunks)) {
+    LogWarn("can not write mesh chunk list of {}", source.mesh_file);
   }
 
-  return mesh_data;
+  const auto& statistics = streamer.GetStatistics();
+  LogInfo(
+      "import mesh {} : {} bytes in {} windows, {} triangles, {} buckets, {} chunks, {} splits, "
+      "{} flushes, peak {} bytes, attributes {:.2f} ms, buckets {:.2f} ms, chunks {:.2f} ms, "
+      "total {:.2f} ms",
+      source.mesh_file,
+      statistics.bytes,
+      statistics.window_count,
+      statistics.triangle_count,
+      statistics.bucket_count,
+      statistics.chunk_count,
+      statistics.split_count,
+      statistics.flush_count,
+      statistics.peak_memory,
+      statistics.attribute_ms,
+      statistics.bucket_ms,
+      statistics.chunk_ms,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+          .count());
+  return chunks;
 }
 
-RenderMesh RenderResourceBase::LoadMesh(const RenderMeshSource& source, BoudingBox& bounding_box) {
-  RenderMesh ret;
+RenderMesh RenderResourceBase::LoadMeshChunk(
+    const MeshStreamChunk& chunk, BoudingBox& bounding_box) {
+  RenderMesh    ret;
+  MeshSourceKey key(chunk.source_hash);
+  // an empty mesh can not be allocated, the chunk list only knows the options of its import
+  ASSERT_EXECPTION(!mesh_cache.Load(chunk.source, key, ret.static_mesh_data))
+      .SetErrorMessage(fmt::format(
+          "load mesh chunk {} fail, its cache entry {} is gone or stale, import the source again",
+          chunk.source.mesh_file,
+          mesh_cache.EntryPath(chunk.source)))
+      .Throw();
+  bounding_box = ret.static_mesh_data.bounds;
+  CacheBoudingBox(chunk.source, bounding_box);
+  return ret;
+}
 
-  if (std::filesystem::path(source.mesh_file).extension() == ".obj") {
-    ret.static_mesh_data = LoadStaticMesh(source.mesh_file, bounding_box);
+RenderMaterial RenderResourceBase::LoadMaterial(const RenderMaterialSource& source) {
+  if (!source.material_file.empty()) {
+    return LoadGltfMaterial(source.material_file);
   }
-  GetCachedBoudingBox(source) = bounding_box;
+  RenderMaterial ret;
+  ret.base_color_texture = source.cooked_format == PixelFormat::UNKNOWN
+                               ? LoadTexture(source.base_color_file, true)
+                               : LoadCookedTexture(source.base_color_file, source.cooked_format);
   return ret;
 }
-RenderMaterial RenderResourceBase::LoadMaterial(const RenderMaterialSource& source) {
+
+RenderMaterial RenderResourceBase::LoadGltfMaterial(const std::string& material_file) {
+  std::string  file;
+  uint32_t     material_index = 0;
+  GltfDocument document;
+  std::string  error;
+  SplitGltfReference(material_file, file, material_index);
+  ASSERT_EXECPTION(!document.Open(file, error))
+      .SetErrorMessage(fmt::format("load material {} fail, error : {} ", material_file, error))
+      .Throw();
+  ASSERT_EXECPTION(material_index >= document.GetMaterials().size())
+      .SetErrorMessage(
+          fmt::format("load material {} fail, {} has no such material", material_file, file))
+      .Throw();
+  const GltfMaterial& material = document.GetMaterials()[material_index];
+
   RenderMaterial ret;
-  ret.base_color_texture = LoadTexture(source.base_color_file, true);
+  ret.base_color_factor = material.base_color_factor;
+  if (material.base_color_image >= 0) {
+    const GltfImage& image = document.GetImages()[material.base_color_image];
+    ret.base_color_texture = image.file.empty() ? LoadTexture(image.data, image.size, true)
+                                                : LoadTexture(image.file, true);
+    if (!ret.base_color_texture) {
+      LogWarn("can not decode base color texture of material {}", material_file);
+    }
+  }
+  if (!ret.base_color_texture) {
+    // the factor alone is the color, malloc like the images stb decodes
+    auto* white = static_cast<unsigned char*>(malloc(4));
+    memset(white, 0xff, 4);
+    ret.base_color_texture = MakeTexture(white, 1, 1, PixelFormat::R8G8B8A8_SRGB);
+  }
   return ret;
 }
 
 std::shared_ptr<RenderMaterialData> RenderResourceBase::LoadTextureHDR(
     const std::string& file, int desired_channels) {
-  int    iw, ih, n;
-  float* buffer = stbi_loadf(file.c_str(), &iw, &ih, &n, desired_channels);
-
-  if (!buffer) {
+  TextureDecodeRequest request;
+  request.hdr          = true;
+  request.hdr_channels = desired_channels;
+  MappedFile mapping;
+  if (!mapping.Open(file)) {
     return nullptr;
   }
+  return DecodeTexture(mapping.Data(), mapping.Size(), request);
+}
 
-  std::shared_ptr<RenderMaterialData> texture = std::make_shared<RenderMaterialData>();
-
-  texture->pixels       = buffer;
-  texture->width        = iw;
-  texture->height       = ih;
-  texture->depth        = 1;
-  texture->array_layers = 1;
-  texture->mip_levels   = 1;
-  texture->type         = ImageType::IMAGE_2D;
-  switch (desired_channels) {
-    case 2:
-      texture->format = PixelFormat::R32G32_FLOAT;
-      break;
-    case 4:
-      texture->format = PixelFormat::R32G32B32A32_FLOAT;
-      break;
-    default:
-      // three component format is not supported in some vulkan driver implementations
-      throw std::runtime_error("unsupported channels number");
-      break;
+std::shared_ptr<RenderMaterialData> RenderResourceBase::LoadCookedTexture(
+    const std::string& file, PixelFormat format) {
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t source_hash = 0;
+  if (!MeshCache::HashSource(file, source_hash)) {
+    LogWarn("can not read texture {}", file);
+    return nullptr;
   }
+  const char* path    = "cached";
+  auto        texture = texture_cache.Load(file, format, source_hash);
+  if (!texture) {
+    path        = "cooked";
+    auto source = LoadTexture(file, IsSrgb(format));
+    if (!source) {
+      return nullptr;
+    }
+    texture = CookTexture(*source, format, MipFilter::kKaiser, GThreadPool.get());
+    // the decoded texels are not kept, stb allocates them with malloc
+    free(source->pixels);
+    ASSERT_EXECPTION(!texture)
+        .SetErrorMessage(fmt::format(
+            "cook texture {} fail, it is not an 8 bit image or format {} can not be cooked",
+            file,
+            static_cast<uint32_t>(format)))
+        .Throw();
+    if (!texture_cache.Store(file, format, source_hash, *texture)) {
+      LogWarn("can not write texture cache {}", texture_cache.EntryPath(file, format));
+    }
+  }
+  LogInfo(
+      "load texture {} ({}) {}x{} with {} levels in {:.2f} ms",
+      file,
+      path,
+      texture->width,
+      texture->height,
+      texture->mip_levels,
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
   return texture;
 }
+
 std::shared_ptr<RenderMaterialData> RenderResourceBase::LoadTexture(
     const std::string& file, bool is_srgb) {
-  int            iw, ih, n;
-  unsigned char* buffer = stbi_load(file.c_str(), &iw, &ih, &n, 4);
-
-  if (!buffer) {
+  if (std::filesystem::path(file).extension() == ".ktx2") {
+    Ktx2File    ktx2;
+    std::string error;
+    if (!ktx2.Open(file, error)) {
+      LogWarn("can not read texture {} : {}", file, error);
+      return nullptr;
+    }
+    return ktx2.CopyTexture();
+  }
+  MappedFile mapping;
+  if (!mapping.Open(file)) {
     return nullptr;
   }
+  return LoadTexture(mapping.Data(), mapping.Size(), is_srgb);
+}
 
-  std::shared_ptr<RenderMaterialData> texture = std::make_shared<RenderMaterialData>();
-
-  texture->pixels       = buffer;
-  texture->width        = iw;
-  texture->height       = ih;
-  texture->format       = (is_srgb) ? PixelFormat::R8G8B8A8_SRGB : PixelFormat::R8G8B8A8_UNORM;
-  texture->depth        = 1;
-  texture->array_layers = 1;
-  texture->mip_levels   = 1;
-  texture->type         = ImageType::IMAGE_2D;
+std::shared_ptr<RenderMaterialData> RenderResourceBase::LoadTexture(
+    const void* data, size_t size, bool is_srgb) {
+  TextureDecodeRequest request;
+  request.is_srgb = is_srgb;
+  return DecodeTexture(data, size, request);
+}
 
-  return texture;
+void RenderResourceBase::LoadTextures(
+    const std::vector<TextureDecodeRequest>& requests,
+    const TextureDecodeOptions&              options,
+    const TextureDecoder::TextureConsumer&   consume) {
+  TextureDecoder decoder(GThreadPool.get());
+  decoder.Decode(requests, options, consume);
+
+  const auto& statistics = decoder.GetStatistics();
+  LogInfo(
+      "decoded {} textures in {:.2f} ms, peak {} bytes of a {} byte budget, {} waits",
+      requests.size(),
+      statistics.total_ms,
+      statistics.peak_memory,
+      options.memory_budget,
+      statistics.budget_waits);
+  for (size_t i = 0; i < static_cast<size_t>(TextureFileFormat::kCount); i++) {
+    const auto& format = statistics.formats[i];
+    if (format.image_count == 0) {
+      continue;
+    }
+    // per worker, the decodes of a format run side by side with the others
+    const double seconds = format.decode_ms / 1000.0;
+    LogInfo(
+        "  {} : {} images ({} failed), {} bytes into {} bytes, {:.2f} ms decoding, "
+        "{:.1f} MB/s encoded, {:.1f} MB/s decoded",
+        TextureFileFormatName(static_cast<TextureFileFormat>(i)),
+        format.image_count,
+        format.failed_count,
+        format.encoded_bytes,
+        format.decoded_bytes,
+        format.decode_ms,
+        seconds > 0.0 ? format.encoded_bytes / seconds / 1e6 : 0.0,
+        seconds > 0.0 ? format.decoded_bytes / seconds / 1e6 : 0.0);
+  }
 }
 
 }  // namespace vkengine
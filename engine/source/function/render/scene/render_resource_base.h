@@ -1,16 +1,24 @@
 #pragma once
 
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "forward.h"
+#include "function/render/mesh/mesh_cache.h"
+#include "function/render/mesh/mesh_welder.h"
+#include "function/render/mesh/obj_streamer.h"
 #include "function/render/scene/render_type.h"
+#include "function/render/texture/texture_cache.h"
+#include "function/render/texture/texture_decoder.h"
 
 namespace vkengine {
 class RenderResourceBase {
  public:
-  using BoudingBox = int;
+  using BoudingBox = MeshBounds;
 
  public:
   virtual ~RenderResourceBase() {}
@@ -30,16 +38,77 @@ class RenderResourceBase {
   RenderMesh     LoadMesh(const RenderMeshSource& source, BoudingBox& bounding_box);
   RenderMaterial LoadMaterial(const RenderMaterialSource& source);
 
-  BoudingBox& GetCachedBoudingBox(const RenderMeshSource& source);
+  // LoadMesh and LoadMaterial as a task of the worker pool: the file reads, decoding and
+  // cooking all run there, the caller uploads the result once it is ready. a load that throws
+  // rethrows from get(). the resource must outlive the loads it started
+  std::shared_future<RenderMesh>     LoadMeshAsync(const RenderMeshSource& source);
+  std::shared_future<RenderMaterial> LoadMaterialAsync(const RenderMaterialSource& source);
+
+  // out of core import of an obj too large for memory, cut into spatial chunks that are cooked
+  // into the mesh cache one at a time. an unchanged source imported with the same options takes
+  // the chunks from its chunk list
+  std::vector<MeshStreamChunk> ImportMeshStream(
+      const RenderMeshSource& source, const ObjStreamOptions& options = {});
+  // one chunk of ImportMeshStream, read from the mesh cache without hashing the source again.
+  // throws when its entry is gone, ImportMeshStream then has to run again
+  RenderMesh LoadMeshChunk(const MeshStreamChunk& chunk, BoudingBox& bounding_box);
+
+  // decode many textures at once on the worker pool within the memory budget of options, then
+  // log the decode throughput of every file format
+  void LoadTextures(
+      const std::vector<TextureDecodeRequest>& requests,
+      const TextureDecodeOptions&              options,
+      const TextureDecoder::TextureConsumer&   consume);
+
+  // a copy taken under the lock, loads still running on the pool write the cache. an empty box
+  // when source was not loaded yet
+  BoudingBox GetCachedBoudingBox(const RenderMeshSource& source) const;
 
  protected:
+  void CacheBoudingBox(const RenderMeshSource& source, const BoudingBox& bounding_box);
+
   RenderMeshData LoadStaticMesh(const std::string& mesh_file, BoudingBox& bounding_box);
+  // mesh "file.glb#n" of a gltf asset. a source asking for no cooking and laid out like
+  // VulkanVertexData is read in place from the mapping, path tells how it was loaded
+  RenderMeshData LoadGltfMesh(const RenderMeshSource& source, const char*& path);
+  // take the welded vertices, generate their tangents and the bounds
+  void FinishStaticMesh(
+      const std::string&            mesh_file,
+      MeshWelder<VulkanVertexData>& welder,
+      RenderMeshData&               mesh_data);
+  // the optimize, lod, meshlet, packing and index steps source asks for
+  void CookStaticMesh(const RenderMeshSource& source, RenderMeshData& mesh_data);
+  // reorder for the post-transform cache, overdraw and vertex fetch, log ACMR / ATVR
+  void OptimizeStaticMesh(
+      const std::string& mesh_file, uint32_t optimize_flags, RenderMeshData& mesh_data);
+  // append the simplified levels of detail to the index buffer
+  void BuildStaticMeshLods(
+      const std::string& mesh_file, uint32_t lod_count, RenderMeshData& mesh_data);
+  // cluster a base level of at least kMinMeshletTriangleCount triangles into meshlets
+  void BuildStaticMeshlets(const std::string& mesh_file, RenderMeshData& mesh_data);
+  // convert to VertexFormat::kPacked and log the quantization error
+  void PackStaticMesh(const std::string& mesh_file, RenderMeshData& mesh_data);
+  // switch to 16 bit indices when the mesh allows it
+  void CompactStaticMesh(const std::string& mesh_file, RenderMeshData& mesh_data);
   std::shared_ptr<RenderMaterialData> LoadTextureHDR(
       const std::string& file, int desired_channels = 4);
+  // a .ktx2 file is taken as it is, with all of its levels
   std::shared_ptr<RenderMaterialData> LoadTexture(const std::string& file, bool is_srgb = false);
+  // encoded image bytes, such as an image embedded in a glb
+  std::shared_ptr<RenderMaterialData> LoadTexture(
+      const void* data, size_t size, bool is_srgb = false);
+  // material "file.glb#n" of a gltf asset, a 1x1 white texture without a base color texture
+  RenderMaterial LoadGltfMaterial(const std::string& material_file);
+  // file cooked into format with all of its mips, from the texture cache when it is up to date
+  std::shared_ptr<RenderMaterialData> LoadCookedTexture(
+      const std::string& file, PixelFormat format);
 
   std::unordered_map<RenderMeshSource, BoudingBox, RenderMeshSource::HasHValue>
       bounding_box_cache_map;
+  // loads on the worker pool cache their boxes as well
+  mutable std::mutex bounding_box_mutex_;
+  MeshCache    mesh_cache{kMeshCacheDirectory};
+  TextureCache texture_cache{kMeshCacheDirectory};
 };
 
 }  // namespace vkengine
@@ -1,5 +1,9 @@
 #include "function/render/scene/render_scene.h"
 
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
 #include "function/render/camera/camera_base.h"
 #include "function/render/rhi/vulkanrhi.h"
 #include "function/render/scene/render_resource.h"
@@ -13,6 +17,9 @@ void RenderScene::Init(const RenderSceneInitInfo& info) {
 
   storage_buffer_object = std::make_shared<StorageBuffer>();
   CreateAndMapStorageBuffer();
+
+  instance_buffers_.resize(VulkanRhi::kMaxFramesInFight);
+  cluster_index_buffers_.resize(VulkanRhi::kMaxFramesInFight);
 }
 
 void RenderScene::CreateAndMapStorageBuffer() {
@@ -39,19 +46,339 @@ void RenderScene::CreateAndMapStorageBuffer() {
       storage_buffer_object->global_null_descriptor_storage_buffer,
       storage_buffer_object->global_null_descriptor_storage_buffer_memory);
 
-  // TODO: Unmap when program terminates
-  vkMapMemory(
-      rhi_->logic_device_,
-      storage_buffer_object->global_ubo_memory,
-      0,
-      VK_WHOLE_SIZE,
-      0,
-      &storage_buffer_object->ubo_map_ptr);
+  // host visible allocations stay mapped for their whole lifetime
+  storage_buffer_object->ubo_map_ptr = storage_buffer_object->global_ubo_memory.mapped;
 }
 
 void RenderScene::UpdatePerFrameBuffer() {
   cur_frame_ = rhi_->current_frame_;
   UpdateStorageBuffer();
+  UpdateEntityBounds();
+  UpdateEntityLods();
+  UpdateInstanceBatches();
+  UpdateClusterDraws();
+}
+
+void RenderScene::UpdateEntityBounds() {
+  const auto resource = std::static_pointer_cast<RenderResource>(resource_);
+  const auto count    = static_cast<uint32_t>(render_entities.size());
+
+  // entities whose mesh is not uploaded get an empty box and stay out of the tree
+  entity_boxes_.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    const auto& entity = render_entities[i];
+    const auto* mesh   = resource->FindMesh(entity.mesh_asset_id);
+    entity_boxes_[i]   = mesh ? mesh->bounds.box.Transform(entity.model_matrix) : AxisAlignedBox{};
+  }
+
+  // most entities move within their fattened box, which leaves the tree untouched
+  while (entity_proxies_.size() > count) {
+    if (entity_proxies_.back() != DynamicAabbTree::kNullNode) {
+      entity_tree_.Remove(entity_proxies_.back());
+    }
+    entity_proxies_.pop_back();
+  }
+  entity_proxies_.resize(count, DynamicAabbTree::kNullNode);
+  for (uint32_t i = 0; i < count; i++) {
+    auto&       proxy = entity_proxies_[i];
+    const auto& box   = entity_boxes_[i];
+    if (box.IsEmpty()) {
+      if (proxy != DynamicAabbTree::kNullNode) {
+        entity_tree_.Remove(proxy);
+        proxy = DynamicAabbTree::kNullNode;
+      }
+    } else if (proxy == DynamicAabbTree::kNullNode) {
+      proxy = entity_tree_.Insert(box, i);
+    } else {
+      entity_tree_.Move(proxy, box);
+    }
+  }
+}
+
+void RenderScene::UpdateEntityLods() {
+  const auto resource = std::static_pointer_cast<RenderResource>(resource_);
+  const auto count    = static_cast<uint32_t>(render_entities.size());
+
+  // pixels covered by one world unit at distance one, along the screen height
+  const glm::mat4 projection      = camera_->GetPersProjMatrix();
+  const float     pixels_per_unit = projection[1][1] * 0.5f * rhi_->swap_chain_extent_.height;
+  const glm::vec3 eye             = camera_->position();
+
+  entity_lods_.resize(count, 0);
+  for (uint32_t i = 0; i < count; i++) {
+    const auto& entity = render_entities[i];
+    const auto* mesh   = resource->FindMesh(entity.mesh_asset_id);
+    auto&       lod    = entity_lods_[i];
+    if (!mesh || mesh->lods.size() <= 1 || mesh->bounds.sphere.radius <= 0.0f) {
+      lod = 0;
+      continue;
+    }
+    const auto  sphere   = mesh->bounds.sphere.Transform(entity.model_matrix);
+    const float distance = glm::length(sphere.center - eye) - sphere.radius;
+    if (distance <= 0.0f) {
+      lod = 0;
+      continue;
+    }
+
+    // the error of a level is stored relative to the object space radius, scaling it by the
+    // projected radius gives pixels
+    const float projected_radius = sphere.radius * pixels_per_unit / distance;
+    const auto  pixel_error      = [&](size_t level) {
+      return mesh->lods[level].error / mesh->bounds.sphere.radius * projected_radius;
+    };
+    size_t wanted = 0;
+    while (wanted + 1 < mesh->lods.size() && pixel_error(wanted + 1) <= kLodPixelError) {
+      wanted++;
+    }
+    const size_t current = std::min<size_t>(lod, mesh->lods.size() - 1);
+    while (wanted > current && pixel_error(wanted) > kLodPixelError * (1.0f - kLodHysteresis)) {
+      wanted--;
+    }
+    lod = static_cast<uint8_t>(wanted);
+  }
+}
+
+void RenderScene::QueryEntities(const Frustum& frustum, std::vector<uint32_t>& result) const {
+  entity_tree_.QueryFrustum(frustum, result);
+}
+
+void RenderScene::QueryEntities(const BoundingSphere& sphere, std::vector<uint32_t>& result) const {
+  entity_tree_.QuerySphere(sphere, result);
+}
+
+int32_t RenderScene::PickEntity(
+    const glm::vec3& origin, const glm::vec3& direction, float max_distance) const {
+  std::vector<uint32_t> candidates;
+  entity_tree_.QueryRay(origin, direction, max_distance, candidates);
+
+  // the tree tests fattened boxes, the exact boxes decide the closest hit
+  const glm::vec3 inverse_direction = 1.0f / direction;
+  int32_t         picked            = -1;
+  float           closest           = max_distance;
+  for (const uint32_t entity : candidates) {
+    float distance = 0.0f;
+    if (entity_boxes_[entity].IntersectRay(origin, inverse_direction, closest, distance) &&
+        (picked == -1 || distance < closest)) {
+      picked  = static_cast<int32_t>(entity);
+      closest = distance;
+    }
+  }
+  return picked;
+}
+
+void RenderScene::ReserveHostBuffer(
+    HostBuffer& host_buffer, uint32_t count, VkDeviceSize element_size, VkBufferUsageFlags usage) {
+  if (count <= host_buffer.capacity) {
+    return;
+  }
+  uint32_t capacity = std::max(host_buffer.capacity, kMinHostBufferCapacity);
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  // the frame fence has been waited on, the gpu no longer reads the old buffer
+  if (host_buffer.buffer != VK_NULL_HANDLE) {
+    rhi_->DestroyBuffer(host_buffer.buffer, host_buffer.memory);
+  }
+  rhi_->CreateBuffer(
+      element_size * capacity,
+      usage,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      host_buffer.buffer,
+      host_buffer.memory);
+  host_buffer.capacity = capacity;
+}
+
+void RenderScene::UpdateInstanceBatches() {
+  const auto resource = std::static_pointer_cast<RenderResource>(resource_);
+  const auto count    = static_cast<uint32_t>(render_entities.size());
+
+  // empty boxes of entities without a mesh are never visible
+  culler_.Clear();
+  culler_.Reserve(count);
+  for (const auto& box : entity_boxes_) {
+    culler_.Add(box);
+  }
+  batch_order_.clear();
+  culler_.Cull(
+      Frustum::FromMatrix(storage_buffer_object->ubo[cur_frame_].per_frame_ubo.proj_view_matrix),
+      batch_order_);
+  const auto visible_count = static_cast<uint32_t>(batch_order_.size());
+  ReserveHostBuffer(
+      instance_buffers_[cur_frame_],
+      visible_count,
+      sizeof(VkPerInstanceData),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+  // material first so the per set path rebinds as little as possible
+  std::sort(batch_order_.begin(), batch_order_.end(), [this](uint32_t a, uint32_t b) {
+    const auto& lhs = render_entities[a];
+    const auto& rhs = render_entities[b];
+    return std::tie(lhs.material_asset_id, lhs.mesh_asset_id, entity_lods_[a]) <
+           std::tie(rhs.material_asset_id, rhs.mesh_asset_id, entity_lods_[b]);
+  });
+
+  auto* instances = static_cast<VkPerInstanceData*>(instance_buffers_[cur_frame_].memory.mapped);
+  batches_.clear();
+  frame_statistics_.triangles_submitted   = 0;
+  frame_statistics_.triangles_full_detail = 0;
+  for (uint32_t i = 0; i < visible_count; i++) {
+    const auto& entity = render_entities[batch_order_[i]];
+    const auto  lod    = entity_lods_[batch_order_[i]];
+    if (batches_.empty() || batches_.back().mesh_asset_id != entity.mesh_asset_id ||
+        batches_.back().material_asset_id != entity.material_asset_id ||
+        batches_.back().lod != lod) {
+      RenderBatch batch;
+      batch.mesh_asset_id     = entity.mesh_asset_id;
+      batch.material_asset_id = entity.material_asset_id;
+      batch.first_instance    = i;
+      batch.lod               = lod;
+      batches_.push_back(batch);
+    }
+    batches_.back().instance_count++;
+
+    const auto* mesh = resource->FindMesh(entity.mesh_asset_id);
+    if (mesh) {
+      frame_statistics_.triangles_submitted += mesh->lods[lod].index_count / 3;
+      frame_statistics_.triangles_full_detail += mesh->lods[0].index_count / 3;
+    }
+
+    const auto* material     = resource->FindMaterial(entity.material_asset_id);
+    const auto  quantization = mesh ? mesh->quantization : VertexQuantization{};
+
+    auto& instance             = instances[i];
+    instance.model_matrix      = entity.model_matrix;
+    instance.base_color_factor = entity.base_color_factor;
+    instance.position_offset   = glm::vec4(quantization.offset, 0.0f);
+    instance.position_scale    = glm::vec4(quantization.scale, 0.0f);
+    instance.material_id       = material ? material->material_id : 0;
+  }
+
+  frame_statistics_.entity_count          = count;
+  frame_statistics_.visible_count         = visible_count;
+  frame_statistics_.draws_before_batching = visible_count;
+  frame_statistics_.draws_after_batching  = static_cast<uint32_t>(batches_.size());
+}
+
+void RenderScene::UpdateClusterDraws() {
+  const auto resource = std::static_pointer_cast<RenderResource>(resource_);
+  const auto frustum =
+      Frustum::FromMatrix(storage_buffer_object->ubo[cur_frame_].per_frame_ubo.proj_view_matrix);
+  const glm::vec3 eye = camera_->position();
+
+  cluster_draws_.clear();
+  cluster_indices_.clear();
+  ClusterCullStatistics statistics;
+  for (auto& batch : batches_) {
+    const auto* mesh = resource->FindMesh(batch.mesh_asset_id);
+    if (!mesh || !mesh->meshlets || batch.lod != 0) {
+      continue;
+    }
+    batch.clustered          = true;
+    batch.first_cluster_draw = static_cast<uint32_t>(cluster_draws_.size());
+    for (uint32_t i = 0; i < batch.instance_count; i++) {
+      const auto& entity = render_entities[batch_order_[batch.first_instance + i]];
+
+      ClusterDraw draw;
+      draw.mesh_asset_id = batch.mesh_asset_id;
+      draw.instance      = batch.first_instance + i;
+      draw.view          = ClusterCullView::FromInstance(frustum, eye, entity.model_matrix);
+      if (!gpu_cluster_culling_) {
+        draw.first_index = static_cast<uint32_t>(cluster_indices_.size());
+        CullClusters(*mesh->meshlets, draw.view, cluster_indices_, statistics);
+        draw.index_count = static_cast<uint32_t>(cluster_indices_.size()) - draw.first_index;
+
+        // UpdateInstanceBatches counted the whole mesh
+        frame_statistics_.triangles_submitted -= mesh->lods[0].index_count / 3;
+        frame_statistics_.triangles_submitted += draw.index_count / 3;
+      }
+      cluster_draws_.push_back(draw);
+    }
+  }
+  frame_statistics_.clusters_tested          = statistics.tested;
+  frame_statistics_.clusters_frustum_culled  = statistics.frustum_culled;
+  frame_statistics_.clusters_backface_culled = statistics.backface_culled;
+
+  if (!cluster_indices_.empty()) {
+    auto& indices = cluster_index_buffers_[cur_frame_];
+    ReserveHostBuffer(
+        indices,
+        static_cast<uint32_t>(cluster_indices_.size()),
+        sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    std::memcpy(
+        indices.memory.mapped, cluster_indices_.data(), sizeof(uint32_t) * cluster_indices_.size());
+  }
+}
+
+void RenderScene::RecordBatchedDraws(
+    VkCommandBuffer command_buffer, VkPipelineLayout layout, VertexFormat vertex_format) {
+  const auto  resource = std::static_pointer_cast<RenderResource>(resource_);
+  const auto& pool     = resource->GetGeometryPool();
+  const bool  bindless = rhi_->device_capabilities_.bindless;
+
+  uint32_t        bound_page         = ~0u;
+  VkDescriptorSet bound_material_set = VK_NULL_HANDLE;
+  for (const auto& batch : batches_) {
+    const auto* mesh = resource->FindMesh(batch.mesh_asset_id);
+    if (!mesh || mesh->vertex_format != vertex_format ||
+        (batch.clustered && gpu_cluster_culling_)) {
+      continue;
+    }
+    if (!bindless) {
+      const auto* material = resource->FindMaterial(batch.material_asset_id);
+      if (material && material->material_descriptor_set != bound_material_set) {
+        bound_material_set = material->material_descriptor_set;
+        vkCmdBindDescriptorSets(
+            command_buffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            layout,
+            1,
+            1,
+            &bound_material_set,
+            0,
+            nullptr);
+      }
+    }
+    if (batch.clustered) {
+      if (cluster_indices_.empty()) {
+        continue;
+      }
+      // the page vertices with the indices of the surviving clusters, the page is bound again
+      // for the next batch
+      const VkDeviceSize offset        = 0;
+      const VkBuffer     vertex_buffer = pool.VertexBuffer(mesh->page);
+      vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, &offset);
+      vkCmdBindIndexBuffer(
+          command_buffer, cluster_index_buffers_[cur_frame_].buffer, 0, VK_INDEX_TYPE_UINT32);
+      bound_page = ~0u;
+      for (uint32_t i = 0; i < batch.instance_count; i++) {
+        const auto& draw = cluster_draws_[batch.first_cluster_draw + i];
+        if (draw.index_count == 0) {
+          continue;
+        }
+        vkCmdDrawIndexed(
+            command_buffer,
+            draw.index_count,
+            1,
+            draw.first_index,
+            static_cast<int32_t>(mesh->vertex_offset),
+            draw.instance);
+      }
+      continue;
+    }
+    if (mesh->page != bound_page) {
+      bound_page = mesh->page;
+      pool.Bind(command_buffer, bound_page);
+    }
+    const auto& lod = mesh->lods[std::min<size_t>(batch.lod, mesh->lods.size() - 1)];
+    vkCmdDrawIndexed(
+        command_buffer,
+        lod.index_count,
+        batch.instance_count,
+        lod.first_index,
+        static_cast<int32_t>(mesh->vertex_offset),
+        batch.first_instance);
+  }
 }
 
 void RenderScene::UpdateStorageBuffer() {
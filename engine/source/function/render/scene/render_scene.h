@@ -4,10 +4,51 @@
 #include <vector>
 
 #include "forward.h"
+#include "function/render/scene/cluster_culler.h"
+#include "function/render/scene/dynamic_aabb_tree.h"
+#include "function/render/scene/frustum_culler.h"
 #include "function/render/scene/render_type.h"
 
 namespace vkengine {
 
+// entities sharing mesh and material, drawn with one instanced vkCmdDrawIndexed
+struct RenderBatch {
+  size_t   mesh_asset_id     = 0;
+  size_t   material_asset_id = 0;
+  uint32_t first_instance    = 0;
+  uint32_t instance_count    = 0;
+  // index into VulkanVertexBuffer::lods
+  uint32_t lod = 0;
+  // lods[0] of a mesh with meshlets, every instance is culled cluster by cluster and drawn on
+  // its own, see ClusterDraw
+  bool     clustered          = false;
+  uint32_t first_cluster_draw = 0;
+};
+
+// one instance of a clustered batch. the cpu path writes the indices of its surviving clusters
+// to [first_index, first_index + index_count) of the cluster index buffer
+struct ClusterDraw {
+  size_t          mesh_asset_id = 0;
+  uint32_t        instance      = 0;
+  uint32_t        first_index   = 0;
+  uint32_t        index_count   = 0;
+  ClusterCullView view;
+};
+
+struct RenderFrameStatistics {
+  uint32_t entity_count          = 0;
+  uint32_t visible_count         = 0;
+  uint32_t draws_before_batching = 0;
+  uint32_t draws_after_batching  = 0;
+  // by the batched draws, and what the same entities cost at full detail
+  uint64_t triangles_submitted   = 0;
+  uint64_t triangles_full_detail = 0;
+  // meshlets of the clustered instances, left at zero when the gpu culls the clusters
+  uint32_t clusters_tested          = 0;
+  uint32_t clusters_frustum_culled  = 0;
+  uint32_t clusters_backface_culled = 0;
+};
+
 struct RenderSceneInitInfo {
   std::shared_ptr<VulkanRhi> rhi;
   std::shared_ptr<Camera>    camera;
@@ -15,6 +56,12 @@ struct RenderSceneInitInfo {
 
 class RenderScene {
  public:
+  // largest projected simplification error a level of detail may show, in pixels
+  static constexpr float kLodPixelError = 1.0f;
+  // a coarser level is only taken once its error is this much below the limit, so entities
+  // near a threshold do not switch every frame
+  static constexpr float kLodHysteresis = 0.25f;
+
   // render entities
   std::vector<RenderEntity> render_entities;
 
@@ -30,14 +77,80 @@ class RenderScene {
   void                  UpdatePerFrameBuffer();
   std::vector<uint32_t> GetStorageBufferOffset();
 
+  // clustered batches are then culled and drawn by ClusterCullingPass instead of the cpu
+  void SetGpuClusterCulling(bool enabled) { gpu_cluster_culling_ = enabled; }
+  bool IsGpuClusterCulling() const { return gpu_cluster_culling_; }
+
+  // one draw per batch, the geometry pool page is only rebound when it changes.
+  // in the per set material path the material set is bound at set 1 of layout, which the
+  // pipeline reads with shader_per_material.frag instead of the bindless shader.frag.
+  // only meshes of vertex_format are drawn, the caller binds the matching pipeline
+  // (shader.vert or shader_packed.vert) and calls once per format. clustered batches take
+  // one draw per instance from the cluster index buffer unless the gpu culls the clusters
+  void RecordBatchedDraws(
+      VkCommandBuffer  command_buffer,
+      VkPipelineLayout layout,
+      VertexFormat     vertex_format = VertexFormat::kFull);
+
+  const std::vector<RenderBatch>& GetBatches() const { return batches_; }
+  const std::vector<ClusterDraw>& GetClusterDraws() const { return cluster_draws_; }
+  VkBuffer GetInstanceBuffer() const { return instance_buffers_[cur_frame_].buffer; }
+  const RenderFrameStatistics& GetFrameStatistics() const { return frame_statistics_; }
+  CullKernel                   GetCullKernel() const { return culler_.GetKernel(); }
+  const DynamicAabbTree&       GetEntityTree() const { return entity_tree_; }
+  // level of detail picked for the entity by the last UpdatePerFrameBuffer
+  uint32_t GetEntityLod(uint32_t entity) const {
+    return entity < entity_lods_.size() ? entity_lods_[entity] : 0;
+  }
+
+  // queries over the entity boxes of the last UpdatePerFrameBuffer, the indices of
+  // render_entities are appended to result. boxes are fattened so results may be conservative
+  void QueryEntities(const Frustum& frustum, std::vector<uint32_t>& result) const;
+  void QueryEntities(const BoundingSphere& sphere, std::vector<uint32_t>& result) const;
+  // index of the entity whose world box the ray enters first, -1 if none is hit
+  int32_t PickEntity(const glm::vec3& origin, const glm::vec3& direction, float max_distance) const;
+
  private:
+  struct HostBuffer {
+    VkBuffer         buffer = VK_NULL_HANDLE;
+    VulkanAllocation memory;
+    uint32_t         capacity = 0;
+  };
+  static constexpr uint32_t kMinHostBufferCapacity = 1024;
+
   std::shared_ptr<VulkanRhi> rhi_;
   std::shared_ptr<Camera>    camera_;
 
   uint32_t cur_frame_;
 
+  // world space entity boxes, rebuilt every frame from RenderEntity::model_matrix
+  std::vector<AxisAlignedBox> entity_boxes_;
+  FrustumCuller               culler_;
+  // one proxy per entity, kNullNode while the entity has no mesh
+  DynamicAabbTree      entity_tree_;
+  std::vector<int32_t> entity_proxies_;
+  // kept between frames for the hysteresis
+  std::vector<uint8_t> entity_lods_;
+
+  // per frame in flight, host visible and persistently mapped
+  std::vector<HostBuffer>  instance_buffers_;
+  std::vector<HostBuffer>  cluster_index_buffers_;
+  std::vector<uint32_t>    batch_order_;
+  std::vector<RenderBatch> batches_;
+  std::vector<ClusterDraw> cluster_draws_;
+  std::vector<uint32_t>    cluster_indices_;
+  bool                     gpu_cluster_culling_ = false;
+  RenderFrameStatistics    frame_statistics_;
+
   void CreateAndMapStorageBuffer();
   void UpdateStorageBuffer();
+  // grow to at least count elements, the contents are not kept
+  void ReserveHostBuffer(
+      HostBuffer& host_buffer, uint32_t count, VkDeviceSize element_size, VkBufferUsageFlags usage);
+  void UpdateEntityBounds();
+  void UpdateEntityLods();
+  void UpdateInstanceBatches();
+  void UpdateClusterDraws();
 };
 
 }  // namespace vkengine
@@ -1,15 +1,23 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "core/utils/hash.h"
+#include "function/render/mesh/attribute_stream.h"
+#include "function/render/rhi/memory_allocator.h"
+#include "function/render/scene/bounding_volume.h"
 #include "glm/glm.hpp"
 #include "vulkan/vulkan.hpp"
 
 namespace vkengine {
+class MappedFile;
+
 #pragma region VulkanBufferType
 
 using VertexType = glm::vec3;
@@ -18,19 +26,19 @@ using UvType     = glm::vec2;
 struct VulkanVertexData {
   VertexType position;
   VertexType normal;
-  VertexType tangent;
-  UvType     texcoord;
-
-  bool operator==(const VulkanVertexData& rhs) const { return position == rhs.position; }
+  // w is the handedness of the bitangent, cross(normal, tangent) * w
+  glm::vec4 tangent;
+  UvType    texcoord;
+
+  // bitwise over all attributes to agree with HasHValue, vertices sharing a position but not a
+  // normal or uv stay apart
+  bool operator==(const VulkanVertexData& rhs) const {
+    return std::memcmp(this, &rhs, sizeof(VulkanVertexData)) == 0;
+  }
 
   struct HasHValue {
     size_t operator()(const VulkanVertexData& rhs) const {
-      size_t seed = 0;
-      for (int i = 0; i < rhs.position.length(); ++i) {
-        auto elem = rhs.position[i];
-        seed ^= std::hash<float>()(elem) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-      }
-      return seed;
+      return static_cast<size_t>(HashBytes(&rhs, sizeof(VulkanVertexData)));
     }
   };
 
@@ -58,7 +66,7 @@ struct VulkanVertexData {
 
     attributeDescriptions[2].binding  = 0;
     attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescriptions[2].format   = VK_FORMAT_R32G32B32A32_SFLOAT;
     attributeDescriptions[2].offset   = offsetof(VulkanVertexData, tangent);
 
     attributeDescriptions[3].binding  = 0;
@@ -69,27 +77,185 @@ struct VulkanVertexData {
     return attributeDescriptions;
   }
 };
+static_assert(sizeof(VulkanVertexData) == 12 * sizeof(float), "vertex is hashed as bytes");
+
+// vertex layout of a mesh, picks the vertex input state and the shader variant it is drawn with
+enum class VertexFormat : uint8_t { kFull = 0, kPacked };
+
+// stages of the mesh optimizer run after welding, see mesh_optimizer.h
+enum MeshOptimizeFlagBits : uint32_t {
+  // triangle order for post-transform cache reuse
+  kMeshOptimizeVertexCache = 1 << 0,
+  // cluster order for less overdraw, keeps the cache order inside each cluster
+  kMeshOptimizeOverdraw = 1 << 1,
+  // vertex order of first use, for vertex fetch locality
+  kMeshOptimizeVertexFetch = 1 << 2,
+  // clusters of the base level for per cluster culling, see meshlet_builder.h
+  kMeshOptimizeMeshlets = 1 << 3,
+  kMeshOptimizeAll = kMeshOptimizeVertexCache | kMeshOptimizeOverdraw | kMeshOptimizeVertexFetch |
+                     kMeshOptimizeMeshlets,
+};
 
-struct VulkanVertexBuffer {
-  uint32_t mesh_vertex_count;
-  uint32_t mesh_index_count;
+// object space position = offset + unorm position * scale, identity for kFull
+struct VertexQuantization {
+  glm::vec3 offset = glm::vec3(0.0f);
+  glm::vec3 scale  = glm::vec3(1.0f);
+};
+
+// 20 byte vertex of VertexFormat::kPacked, decoded by shader_packed.vert
+//   position  unorm16 x3 over the mesh aabb, w is the tangent handedness (0 for -1)
+//   normal    octahedral snorm16 x2
+//   tangent   octahedral snorm16 x2
+//   texcoord  half float x2
+struct VulkanPackedVertexData {
+  uint16_t position[4];
+  int16_t  normal[2];
+  int16_t  tangent[2];
+  uint16_t texcoord[2];
+
+  static VkVertexInputBindingDescription GetBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding   = 0;
+    bindingDescription.stride    = sizeof(VulkanPackedVertexData);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    return bindingDescription;
+  }
+
+  static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
 
-  VkBuffer       mesh_vertex_buffer = VK_NULL_HANDLE;
-  VkDeviceMemory mesh_vertex_memory = VK_NULL_HANDLE;
-  VkBuffer       mesh_index_buffer  = VK_NULL_HANDLE;
-  VkDeviceMemory mesh_index_memory  = VK_NULL_HANDLE;
+    attributeDescriptions[0].binding  = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format   = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset   = offsetof(VulkanPackedVertexData, position);
+
+    attributeDescriptions[1].binding  = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format   = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[1].offset   = offsetof(VulkanPackedVertexData, normal);
+
+    attributeDescriptions[2].binding  = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format   = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[2].offset   = offsetof(VulkanPackedVertexData, tangent);
+
+    attributeDescriptions[3].binding  = 0;
+    attributeDescriptions[3].location = 3;
+    attributeDescriptions[3].format   = VK_FORMAT_R16G16_SFLOAT;
+    attributeDescriptions[3].offset   = offsetof(VulkanPackedVertexData, texcoord);
 
-  VkDescriptorSet mesh_vertex_descriptor_set;
+    return attributeDescriptions;
+  }
+};
+static_assert(sizeof(VulkanPackedVertexData) == 20, "packed vertex is hashed as bytes");
+
+inline uint32_t GetVertexStride(VertexFormat format) {
+  return format == VertexFormat::kPacked ? sizeof(VulkanPackedVertexData)
+                                         : sizeof(VulkanVertexData);
+}
+
+inline VkVertexInputBindingDescription GetVertexBindingDescription(VertexFormat format) {
+  return format == VertexFormat::kPacked ? VulkanPackedVertexData::GetBindingDescription()
+                                         : VulkanVertexData::GetBindingDescription();
+}
+
+inline uint32_t GetIndexSize(VkIndexType index_type) {
+  return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+inline std::vector<VkVertexInputAttributeDescription> GetVertexAttributeDescriptions(
+    VertexFormat format) {
+  return format == VertexFormat::kPacked ? VulkanPackedVertexData::GetAttributeDescriptions()
+                                         : VulkanVertexData::GetAttributeDescriptions();
+}
+
+// one level of detail, a range of the mesh index buffer over the vertices shared by all levels.
+// error is the object space distance the simplification may have moved the surface, 0 for the
+// base mesh
+struct MeshLod {
+  uint32_t first_index = 0;
+  uint32_t index_count = 0;
+  float    error       = 0.0f;
 };
 
-struct VulkanMaterialBuffer {
-  VkImage        base_color_image        = VK_NULL_HANDLE;
-  VkImageView    base_color_image_view   = VK_NULL_HANDLE;
-  VkDeviceMemory base_color_image_memory = VK_NULL_HANDLE;
+static constexpr uint32_t kMaxMeshLods = 8;
+
+// limits of one cluster, local vertex indices fit in 8 bits and a cluster fits one workgroup
+static constexpr uint32_t kMeshletMaxVertices  = 64;
+static constexpr uint32_t kMeshletMaxTriangles = 124;
+
+// std430, one cluster of the base level (shader/007). the vertices are
+// MeshletData::vertices[vertex_offset, vertex_offset + vertex_count), triangle t packs three
+// 8 bit local vertex indices in MeshletData::triangles[triangle_offset + t]. every triangle
+// faces away from a viewer at v when dot(normalize(cone_apex - v), cone_axis) >= cone_cutoff
+struct Meshlet {
+  // object space center xyz and radius w
+  glm::vec4 bounding_sphere = glm::vec4(0.0f);
+  glm::vec4 cone_apex       = glm::vec4(0.0f);
+  // axis xyz and cutoff w, a zero axis with cutoff 1 is never back facing
+  glm::vec4 cone_axis       = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  uint32_t  vertex_offset   = 0;
+  uint32_t  vertex_count    = 0;
+  uint32_t  triangle_offset = 0;
+  uint32_t  triangle_count  = 0;
+};
+static_assert(sizeof(Meshlet) == 64, "meshlet is read by the cluster culling shader");
 
-  VkBuffer        material_uniform_buffer = VK_NULL_HANDLE;
-  VkDeviceMemory  material_uniform_memory = VK_NULL_HANDLE;
-  VkDescriptorSet material_descriptor_set;
+// the compact meshlet buffer of a mesh, vertices index the mesh vertex buffer
+struct MeshletData {
+  std::vector<Meshlet>  meshlets;
+  std::vector<uint32_t> vertices;
+  std::vector<uint32_t> triangles;
+
+  bool Empty() const { return meshlets.empty(); }
+};
+
+// ranges of a mesh inside the GeometryPool, the buffers belong to the pool page
+struct VulkanVertexBuffer {
+  uint32_t mesh_vertex_count = 0;
+  uint32_t mesh_index_count  = 0;
+
+  uint32_t page = 0;
+  // in vertices, vertexOffset of vkCmdDrawIndexed
+  uint32_t vertex_offset = 0;
+  // in indices, start of the range holding every level of detail
+  uint32_t first_index = 0;
+  // pages hold a single format, a page is drawn with the pipeline of its format
+  VertexFormat vertex_format = VertexFormat::kFull;
+  // also fixed per page, bound with the page index buffer
+  VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+  // first_index of every level is absolute in the page, lods[0] is the full mesh
+  std::vector<MeshLod> lods;
+
+  VertexQuantization quantization;
+  // object space, used for culling
+  MeshBounds bounds;
+
+  // clusters of lods[0], null for meshes drawn without cluster culling. the same data lives in
+  // meshlet_buffer as meshlets | vertices | triangles, each array at the offset below
+  std::shared_ptr<const MeshletData> meshlets;
+  VkBuffer                           meshlet_buffer          = VK_NULL_HANDLE;
+  VulkanAllocation                   meshlet_memory;
+  VkDeviceSize                       meshlet_vertex_offset   = 0;
+  VkDeviceSize                       meshlet_triangle_offset = 0;
+
+  VkDescriptorSet mesh_vertex_descriptor_set = VK_NULL_HANDLE;
+};
+
+struct VulkanMaterialBuffer {
+  VkImage          base_color_image      = VK_NULL_HANDLE;
+  VkImageView      base_color_image_view = VK_NULL_HANDLE;
+  VulkanAllocation base_color_image_memory;
+  VkSampler        base_color_sampler = VK_NULL_HANDLE;
+
+  // per set path, unused in bindless mode
+  VkBuffer         material_uniform_buffer = VK_NULL_HANDLE;
+  VulkanAllocation material_uniform_memory;
+  VkDescriptorSet  material_descriptor_set = VK_NULL_HANDLE;
+
+  // index into the BindlessMaterialTable in bindless mode
+  uint32_t material_id = 0;
 };
 
 #pragma endregion
@@ -101,6 +267,56 @@ struct VkPerMaterialUbo {
   glm::vec4 base_color_factor = {0.0f, 0.0f, 0.0f, 0.0f};
 };
 
+// push constant of the bindless path (shader/005)
+struct VkPerDrawConstant {
+  glm::mat4 model_matrix;
+  uint32_t  material_id;
+  uint32_t  _padding_1[3];
+};
+
+// std430, one record per instance in the per frame instance buffer (shader/006)
+struct VkPerInstanceData {
+  glm::mat4 model_matrix;
+  glm::vec4 base_color_factor;
+  // VertexQuantization of the mesh, read by the packed vertex shader
+  glm::vec4 position_offset;
+  glm::vec4 position_scale;
+  uint32_t  material_id;
+  uint32_t  _padding_1[3];
+};
+
+// std430, one record per entity for the gpu culling pass (shader/007). surviving entities
+// are drawn with firstInstance set to their index, so the record doubles as instance data
+struct VkCullObjectData {
+  glm::mat4 model_matrix;
+  glm::vec4 bounding_sphere;
+  glm::vec4 base_color_factor;
+  glm::vec4 position_offset;
+  glm::vec4 position_scale;
+  uint32_t  index_count;
+  uint32_t  first_index;
+  int32_t   vertex_offset;
+  uint32_t  material_id;
+  // geometry pool page, the first draw slot of that page and the counter of its draws, the index
+  // of the page among the pages drawn this frame
+  uint32_t page;
+  uint32_t draw_base;
+  uint32_t count_slot;
+  uint32_t _padding_1;
+};
+
+// std430, one record per clustered instance for the cluster culling pass (shader/007). the
+// frustum and the camera are in the object space of the instance, surviving clusters append
+// their indices behind first_index of the output index buffer and count them in the index count
+// of the indirect draw of the instance
+struct VkClusterDrawData {
+  glm::vec4 planes[6];
+  // w is 0 when the transform does not keep the normal cones and back faces are not culled
+  glm::vec4 camera_position;
+  uint32_t  first_index;
+  uint32_t  _padding_1[3];
+};
+
 struct VkPerframeStorageUbo {
   glm::mat4 proj_view_matrix;
   glm::vec3 camera_position;
@@ -128,20 +344,110 @@ struct RenderEntity {
 };
 
 struct RenderMeshSource {
-  std::string mesh_file;
-
-  bool operator==(const RenderMeshSource& rhs) const { return mesh_file == rhs.mesh_file; }
+  std::string  mesh_file;
+  VertexFormat vertex_format = VertexFormat::kFull;
+  // MeshOptimizeFlagBits
+  uint32_t optimize_flags = kMeshOptimizeAll;
+  // levels of detail including the base mesh, 1 disables simplification
+  uint32_t lod_count = 4;
+
+  bool operator==(const RenderMeshSource& rhs) const {
+    return mesh_file == rhs.mesh_file && vertex_format == rhs.vertex_format &&
+           optimize_flags == rhs.optimize_flags && lod_count == rhs.lod_count;
+  }
 
   struct HasHValue {
     size_t operator()(const RenderMeshSource& rhs) const {
-      return std::hash<std::string>{}(rhs.mesh_file);
+      return std::hash<std::string>{}(rhs.mesh_file) ^ static_cast<size_t>(rhs.vertex_format) ^
+             (static_cast<size_t>(rhs.optimize_flags) << 8) ^
+             (static_cast<size_t>(rhs.lod_count) << 16);
     }
   };
 };
 
+// one spatial piece of a mesh imported by RenderResourceBase::ImportMeshStream, cooked into a
+// mesh cache entry of its own
+struct MeshStreamChunk {
+  RenderMeshSource source;
+  // the key the entry was cooked with, the chunk loads without hashing the whole source again
+  uint64_t   source_hash    = 0;
+  uint32_t   triangle_count = 0;
+  MeshBounds bounds;
+};
+
 struct RenderMeshData {
   std::vector<VulkanVertexData> vertex_buffer;
   std::vector<uint32_t>         index_buffer;
+  MeshBounds                    bounds;
+  // ranges of the index buffer, the base mesh first. empty means a single level over all indices
+  std::vector<MeshLod> lods;
+  // clusters of the base level, empty for meshes without kMeshOptimizeMeshlets or too sparse to
+  // gain from cluster culling
+  MeshletData meshlets;
+
+  // meshes with at most 65536 vertices keep 16 bit indices in short_index_buffer, index_buffer
+  // then stays empty
+  VkIndexType           index_type = VK_INDEX_TYPE_UINT32;
+  std::vector<uint16_t> short_index_buffer;
+
+  // kPacked meshes keep their vertices in packed_vertex_buffer, vertex_buffer stays empty
+  VertexFormat                        vertex_format = VertexFormat::kFull;
+  std::vector<VulkanPackedVertexData> packed_vertex_buffer;
+  VertexQuantization                  quantization;
+
+  // set for meshes from the cooked cache. the vectors stay empty and the pointers reference the
+  // mapping, which lives as long as any copy of this data
+  std::shared_ptr<const MappedFile> cooked_file;
+  const void*                       cooked_vertices     = nullptr;
+  const void*                       cooked_indices      = nullptr;
+  uint32_t                          cooked_vertex_count = 0;
+  uint32_t                          cooked_index_count  = 0;
+  // set instead of cooked_vertices when the attributes lie apart in the mapping, they are
+  // interleaved while they are written to staging memory
+  std::vector<MeshAttributeStream> cooked_streams;
+
+  // GetVertexCount vertices of GetVertexStride(vertex_format) bytes, null for cooked_streams
+  const void* GetVertexData() const {
+    if (cooked_file) {
+      return cooked_vertices;
+    }
+    return vertex_format == VertexFormat::kPacked
+               ? static_cast<const void*>(packed_vertex_buffer.data())
+               : static_cast<const void*>(vertex_buffer.data());
+  }
+  // GetIndexCount indices of GetIndexSize(index_type) bytes
+  const void* GetIndexData() const {
+    if (cooked_file) {
+      return cooked_indices;
+    }
+    return index_type == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(short_index_buffer.data())
+                                              : static_cast<const void*>(index_buffer.data());
+  }
+  // the GetVertexCount vertices into dst, from whichever storage the mesh has
+  void WriteVertexData(void* dst) const {
+    const uint32_t stride = GetVertexStride(vertex_format);
+    if (!cooked_streams.empty()) {
+      GatherAttributeStreams(
+          cooked_streams.data(), cooked_streams.size(), GetVertexCount(), stride, dst);
+    } else {
+      std::memcpy(dst, GetVertexData(), static_cast<size_t>(GetVertexCount()) * stride);
+    }
+  }
+  uint32_t GetVertexCount() const {
+    if (cooked_file) {
+      return cooked_vertex_count;
+    }
+    return static_cast<uint32_t>(
+        vertex_format == VertexFormat::kPacked ? packed_vertex_buffer.size()
+                                               : vertex_buffer.size());
+  }
+  uint32_t GetIndexCount() const {
+    if (cooked_file) {
+      return cooked_index_count;
+    }
+    return static_cast<uint32_t>(
+        index_type == VK_INDEX_TYPE_UINT16 ? short_index_buffer.size() : index_buffer.size());
+  }
 };
 struct RenderMesh {
   RenderMeshData static_mesh_data;
@@ -155,20 +461,98 @@ enum class PixelFormat : uint8_t {
   R8G8B8A8_SRGB,
   R32G32_FLOAT,
   R32G32B32_FLOAT,
-  R32G32B32A32_FLOAT
+  R32G32B32A32_FLOAT,
+  // 4x4 blocks, 8 bytes for bc1 and 16 for the others. bc1 keeps one bit of alpha, bc3 adds an
+  // interpolated alpha channel, bc5 is two interpolated channels for normal maps
+  BC1_RGBA_UNORM,
+  BC1_RGBA_SRGB,
+  BC3_UNORM,
+  BC3_SRGB,
+  BC5_UNORM,
+  BC7_UNORM,
+  BC7_SRGB
 };
 enum class ImageType : uint8_t { UNKNOWM = 0, IMAGE_2D };
 
+inline bool IsBlockCompressed(PixelFormat format) {
+  return format >= PixelFormat::BC1_RGBA_UNORM && format <= PixelFormat::BC7_SRGB;
+}
+
+inline bool IsSrgb(PixelFormat format) {
+  return format == PixelFormat::R8G8B8_SRGB || format == PixelFormat::R8G8B8A8_SRGB ||
+         format == PixelFormat::BC1_RGBA_SRGB || format == PixelFormat::BC3_SRGB ||
+         format == PixelFormat::BC7_SRGB;
+}
+
+// bytes of one texel, or of one 4x4 block of a block compressed format
+inline uint32_t GetTexelBlockSize(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::R8G8B8_UNORM:
+    case PixelFormat::R8G8B8_SRGB:
+      return 3;
+    case PixelFormat::R8G8B8A8_UNORM:
+    case PixelFormat::R8G8B8A8_SRGB:
+      return 4;
+    case PixelFormat::R32G32_FLOAT:
+    case PixelFormat::BC1_RGBA_UNORM:
+    case PixelFormat::BC1_RGBA_SRGB:
+      return 8;
+    case PixelFormat::R32G32B32_FLOAT:
+      return 12;
+    case PixelFormat::R32G32B32A32_FLOAT:
+    case PixelFormat::BC3_UNORM:
+    case PixelFormat::BC3_SRGB:
+    case PixelFormat::BC5_UNORM:
+    case PixelFormat::BC7_UNORM:
+    case PixelFormat::BC7_SRGB:
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+// levels of a full chain down to 1x1
+inline uint32_t GetMipLevelCount(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  while ((width | height) > 1) {
+    width >>= 1;
+    height >>= 1;
+    levels++;
+  }
+  return levels;
+}
+
+// bytes of level of a width x height image, blocks cover the edge of levels that are not a
+// multiple of 4
+inline size_t GetMipLevelSize(PixelFormat format, uint32_t width, uint32_t height, uint32_t level) {
+  width  = std::max(width >> level, 1u);
+  height = std::max(height >> level, 1u);
+  if (IsBlockCompressed(format)) {
+    width  = (width + 3) / 4;
+    height = (height + 3) / 4;
+  }
+  return static_cast<size_t>(width) * height * GetTexelBlockSize(format);
+}
+
 struct RenderMaterialSource {
   std::string base_color_file;
+  // material "file.glb#n" of a gltf asset, takes the place of base_color_file when set
+  std::string material_file;
+  // format base_color_file is cooked into together with its mips, cached in the texture cache: a
+  // block compressed one, an srgb one for color, or R8G8B8A8_SRGB for mips without compression.
+  // UNKNOWN uploads the decoded texels and blits the mips on the gpu. a block compressed format
+  // is drawn grey on a device without DeviceCapabilities::texture_compression_bc
+  PixelFormat cooked_format = PixelFormat::UNKNOWN;
 
   bool operator==(const RenderMaterialSource& rhs) const {
-    return base_color_file == rhs.base_color_file;
+    return base_color_file == rhs.base_color_file && material_file == rhs.material_file &&
+           cooked_format == rhs.cooked_format;
   }
   struct HasHValue {
     size_t operator()(const RenderMaterialSource& rhs) const {
       size_t h0 = std::hash<std::string>{}(rhs.base_color_file);
-      return h0;
+      size_t h1 = std::hash<std::string>{}(rhs.material_file);
+      return h0 ^ (h1 << 1) ^ (static_cast<size_t>(rhs.cooked_format) << 2);
       // return (((h0 ^ (h1 << 1)) ^ (h2 << 1)) ^ (h3 << 1)) ^ (h4 << 1);
     }
   };
@@ -182,6 +566,7 @@ struct RenderMaterialData {
   uint32_t    array_layers = 0;
   PixelFormat format       = PixelFormat::UNKNOWN;
   ImageType   type         = ImageType::UNKNOWM;
+  // the mip_levels levels largest first, each tightly packed right after the one before
   void*       pixels       = nullptr;
 
   bool IsValid() const { return pixels != nullptr; }
@@ -189,17 +574,19 @@ struct RenderMaterialData {
 
 struct RenderMaterial {
   std::shared_ptr<RenderMaterialData> base_color_texture;
+  // factor of the source material, entities drawn with it take it as their base_color_factor
+  glm::vec4 base_color_factor{1.0f, 1.0f, 1.0f, 1.0f};
 };
 
 struct StorageBuffer {
-  VkBuffer       global_ubo_buffer;
-  VkDeviceMemory global_ubo_memory;
+  VkBuffer         global_ubo_buffer;
+  VulkanAllocation global_ubo_memory;
 
   std::vector<VkAllStorageUbo> ubo;
   void*                        ubo_map_ptr;
 
-  VkBuffer       global_null_descriptor_storage_buffer;
-  VkDeviceMemory global_null_descriptor_storage_buffer_memory;
+  VkBuffer         global_null_descriptor_storage_buffer;
+  VulkanAllocation global_null_descriptor_storage_buffer_memory;
 };
 
 #pragma endregion
@@ -0,0 +1,584 @@
+#include "function/render/texture/bc_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "core/utils/thread_pool.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VKENGINE_BC_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace vkengine {
+
+namespace {
+constexpr uint32_t kBlockTexels = 16;
+
+inline float Dot(const float* a, const float* b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+}
+
+// per channel minimum and maximum of the 16 texels
+void BoundsScalar(const uint8_t* texels, uint8_t* min, uint8_t* max) {
+  for (int c = 0; c < 4; c++) {
+    min[c] = 255;
+    max[c] = 0;
+  }
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    for (int c = 0; c < 4; c++) {
+      min[c] = std::min(min[c], texels[i * 4 + c]);
+      max[c] = std::max(max[c], texels[i * 4 + c]);
+    }
+  }
+}
+
+// index of every texel along the line from start in the direction of axis, quantized to the
+// steps + 1 points start, ..., start + axis. the clamp happens before the truncation so both
+// kernels round the same floats the same way
+void ProjectScalar(
+    const uint8_t* texels,
+    const float*   start,
+    const float*   axis,
+    uint32_t       steps,
+    uint8_t*       indices) {
+  const float length2 = Dot(axis, axis);
+  if (length2 <= 0.0f) {
+    std::memset(indices, 0, kBlockTexels);
+    return;
+  }
+  const float scale = static_cast<float>(steps) / length2;
+  const float limit = static_cast<float>(steps);
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    float delta[4];
+    for (int c = 0; c < 4; c++) {
+      delta[c] = static_cast<float>(texels[i * 4 + c]) - start[c];
+    }
+    const float t = std::min(std::max(Dot(delta, axis) * scale + 0.5f, 0.0f), limit);
+    indices[i]    = static_cast<uint8_t>(static_cast<int>(t));
+  }
+}
+
+#if defined(VKENGINE_BC_X86)
+
+void BoundsSse(const uint8_t* texels, uint8_t* min, uint8_t* max) {
+  const auto* rows = reinterpret_cast<const __m128i*>(texels);
+  __m128i     low  = _mm_loadu_si128(rows);
+  __m128i     high = low;
+  for (int i = 1; i < 4; i++) {
+    const __m128i row = _mm_loadu_si128(rows + i);
+    low               = _mm_min_epu8(low, row);
+    high              = _mm_max_epu8(high, row);
+  }
+  // fold the four texels of a register into the first
+  low  = _mm_min_epu8(low, _mm_srli_si128(low, 8));
+  high = _mm_max_epu8(high, _mm_srli_si128(high, 8));
+  low  = _mm_min_epu8(low, _mm_srli_si128(low, 4));
+  high = _mm_max_epu8(high, _mm_srli_si128(high, 4));
+  const int low_bits  = _mm_cvtsi128_si32(low);
+  const int high_bits = _mm_cvtsi128_si32(high);
+  std::memcpy(min, &low_bits, 4);
+  std::memcpy(max, &high_bits, 4);
+}
+
+void ProjectSse(
+    const uint8_t* texels,
+    const float*   start,
+    const float*   axis,
+    uint32_t       steps,
+    uint8_t*       indices) {
+  const float length2 = Dot(axis, axis);
+  if (length2 <= 0.0f) {
+    std::memset(indices, 0, kBlockTexels);
+    return;
+  }
+  const __m128  scale   = _mm_set1_ps(static_cast<float>(steps) / length2);
+  const __m128  limit   = _mm_set1_ps(static_cast<float>(steps));
+  const __m128  half    = _mm_set1_ps(0.5f);
+  const __m128  zero    = _mm_setzero_ps();
+  const __m128i mask    = _mm_set1_epi32(0xff);
+  const __m128  start_r = _mm_set1_ps(start[0]);
+  const __m128  start_g = _mm_set1_ps(start[1]);
+  const __m128  start_b = _mm_set1_ps(start[2]);
+  const __m128  start_a = _mm_set1_ps(start[3]);
+  const __m128  axis_r  = _mm_set1_ps(axis[0]);
+  const __m128  axis_g  = _mm_set1_ps(axis[1]);
+  const __m128  axis_b  = _mm_set1_ps(axis[2]);
+  const __m128  axis_a  = _mm_set1_ps(axis[3]);
+  const auto*   rows    = reinterpret_cast<const __m128i*>(texels);
+
+  alignas(16) int32_t lanes[kBlockTexels];
+
+  for (int i = 0; i < 4; i++) {
+    const __m128i texel = _mm_loadu_si128(rows + i);
+    const __m128  r     = _mm_cvtepi32_ps(_mm_and_si128(texel, mask));
+    const __m128  g     = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texel, 8), mask));
+    const __m128  b     = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(texel, 16), mask));
+    const __m128  a     = _mm_cvtepi32_ps(_mm_srli_epi32(texel, 24));
+    __m128        d     = _mm_mul_ps(_mm_sub_ps(r, start_r), axis_r);
+    d                   = _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(g, start_g), axis_g));
+    d                   = _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(b, start_b), axis_b));
+    d                   = _mm_add_ps(d, _mm_mul_ps(_mm_sub_ps(a, start_a), axis_a));
+    const __m128 t = _mm_min_ps(_mm_max_ps(_mm_add_ps(_mm_mul_ps(d, scale), half), zero), limit);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes + i * 4), _mm_cvttps_epi32(t));
+  }
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    indices[i] = static_cast<uint8_t>(lanes[i]);
+  }
+}
+
+#else
+
+void BoundsSse(const uint8_t* texels, uint8_t* min, uint8_t* max) {
+  BoundsScalar(texels, min, max);
+}
+
+void ProjectSse(
+    const uint8_t* texels,
+    const float*   start,
+    const float*   axis,
+    uint32_t       steps,
+    uint8_t*       indices) {
+  ProjectScalar(texels, start, axis, steps, indices);
+}
+
+#endif
+
+void Bounds(BcKernel kernel, const uint8_t* texels, uint8_t* min, uint8_t* max) {
+  if (kernel == BcKernel::kSse) {
+    BoundsSse(texels, min, max);
+  } else {
+    BoundsScalar(texels, min, max);
+  }
+}
+
+void Project(
+    BcKernel       kernel,
+    const uint8_t* texels,
+    const float*   start,
+    const float*   axis,
+    uint32_t       steps,
+    uint8_t*       indices) {
+  if (kernel == BcKernel::kSse) {
+    ProjectSse(texels, start, axis, steps, indices);
+  } else {
+    ProjectScalar(texels, start, axis, steps, indices);
+  }
+}
+
+// endpoints at the bounds of the channels, the ones running against the channel with the largest
+// range swapped by the sign of their covariance with it, then moved inwards by range / inset
+void DiagonalEndpoints(
+    const uint8_t* texels,
+    const uint8_t* min,
+    const uint8_t* max,
+    int            channels,
+    float          inset,
+    float*         start,
+    float*         end) {
+  int reference = 0;
+  for (int c = 1; c < channels; c++) {
+    if (max[c] - min[c] > max[reference] - min[reference]) {
+      reference = c;
+    }
+  }
+  float center[4];
+  for (int c = 0; c < channels; c++) {
+    center[c] = (static_cast<float>(min[c]) + static_cast<float>(max[c])) * 0.5f;
+  }
+  for (int c = 0; c < 4; c++) {
+    start[c] = 0.0f;
+    end[c]   = 0.0f;
+  }
+  for (int c = 0; c < channels; c++) {
+    float covariance = 0.0f;
+    for (uint32_t i = 0; i < kBlockTexels && c != reference; i++) {
+      covariance +=
+          (texels[i * 4 + reference] - center[reference]) * (texels[i * 4 + c] - center[c]);
+    }
+    const float inward = (max[c] - min[c]) / inset;
+    start[c]           = covariance < 0.0f ? min[c] + inward : max[c] - inward;
+    end[c]             = covariance < 0.0f ? max[c] - inward : min[c] + inward;
+  }
+}
+
+inline uint32_t Quantize(float value, uint32_t bits) {
+  const float limit = static_cast<float>((1u << bits) - 1);
+  return static_cast<uint32_t>(std::min(std::max(value * limit / 255.0f + 0.5f, 0.0f), limit));
+}
+
+inline uint32_t Expand5(uint32_t value) { return value << 3 | value >> 2; }
+inline uint32_t Expand6(uint32_t value) { return value << 2 | value >> 4; }
+
+uint16_t Pack565(const float* color) {
+  return static_cast<uint16_t>(
+      Quantize(color[0], 5) << 11 | Quantize(color[1], 6) << 5 | Quantize(color[2], 5));
+}
+
+void Unpack565(uint16_t packed, float* color) {
+  color[0] = static_cast<float>(Expand5(packed >> 11));
+  color[1] = static_cast<float>(Expand6((packed >> 5) & 0x3f));
+  color[2] = static_cast<float>(Expand5(packed & 0x1f));
+  color[3] = 0.0f;
+}
+
+// squared rgb error of the texels against the four colors of a bc1 block in four color mode
+uint32_t Bc1Error(const uint8_t* texels, uint16_t c0, uint16_t c1, uint32_t& bits) {
+  float e0[4], e1[4];
+  Unpack565(c0, e0);
+  Unpack565(c1, e1);
+  int palette[4][3];
+  for (int c = 0; c < 3; c++) {
+    const int a = static_cast<int>(e0[c]);
+    const int b = static_cast<int>(e1[c]);
+    palette[0][c] = a;
+    palette[1][c] = b;
+    palette[2][c] = (2 * a + b) / 3;
+    palette[3][c] = (a + 2 * b) / 3;
+  }
+  uint32_t error = 0;
+  bits           = 0;
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    uint32_t best       = 0;
+    uint32_t best_error = UINT32_MAX;
+    for (uint32_t p = 0; p < 4; p++) {
+      uint32_t distance = 0;
+      for (int c = 0; c < 3; c++) {
+        const int delta = texels[i * 4 + c] - palette[p][c];
+        distance += static_cast<uint32_t>(delta * delta);
+      }
+      if (distance < best_error) {
+        best_error = distance;
+        best       = p;
+      }
+    }
+    bits |= best << (2 * i);
+    error += best_error;
+  }
+  return error;
+}
+
+// indices of the projection onto the line between the 565 colors, in four color mode
+uint32_t Bc1Indices(BcKernel kernel, const uint8_t* texels, uint16_t c0, uint16_t c1) {
+  static constexpr uint32_t kOrder[4] = {0, 2, 3, 1};
+  float                     start[4], end[4], axis[4];
+  Unpack565(c0, start);
+  Unpack565(c1, end);
+  for (int c = 0; c < 4; c++) {
+    axis[c] = end[c] - start[c];
+  }
+  uint8_t indices[kBlockTexels];
+  Project(kernel, texels, start, axis, 3, indices);
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    bits |= kOrder[indices[i]] << (2 * i);
+  }
+  return bits;
+}
+
+void WriteBc1(uint16_t c0, uint16_t c1, uint32_t bits, uint8_t* block) {
+  std::memcpy(block, &c0, 2);
+  std::memcpy(block + 2, &c1, 2);
+  std::memcpy(block + 4, &bits, 4);
+}
+
+// four color mode, color0 > color1. a block of one color has all indices 0
+void EncodeBc1Colors(
+    BcKernel       kernel,
+    const uint8_t* texels,
+    const uint8_t* min,
+    const uint8_t* max,
+    uint8_t*       block) {
+  float start[4], end[4];
+  DiagonalEndpoints(texels, min, max, 3, 16.0f, start, end);
+  uint16_t c0   = Pack565(start);
+  uint16_t c1   = Pack565(end);
+  uint32_t bits = Bc1Indices(kernel, texels, c0, c1);
+
+  // least squares endpoints for the palette positions the texels took
+  static constexpr float kWeight[4] = {0.0f, 3.0f, 1.0f, 2.0f};
+  float                  aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float                  ax[3] = {}, bx[3] = {};
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    const float b = kWeight[(bits >> (2 * i)) & 3] / 3.0f;
+    const float a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 3; c++) {
+      ax[c] += a * texels[i * 4 + c];
+      bx[c] += b * texels[i * 4 + c];
+    }
+  }
+  const float determinant = aa * bb - ab * ab;
+  if (std::abs(determinant) > 1e-6f) {
+    float refined_start[4] = {}, refined_end[4] = {};
+    for (int c = 0; c < 3; c++) {
+      refined_start[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+      refined_end[c]   = (bx[c] * aa - ax[c] * ab) / determinant;
+    }
+    const uint16_t refined_c0   = Pack565(refined_start);
+    const uint16_t refined_c1   = Pack565(refined_end);
+    const uint32_t refined_bits = Bc1Indices(kernel, texels, refined_c0, refined_c1);
+    uint32_t       unused;
+    if (Bc1Error(texels, refined_c0, refined_c1, unused) < Bc1Error(texels, c0, c1, unused)) {
+      c0   = refined_c0;
+      c1   = refined_c1;
+      bits = refined_bits;
+    }
+  }
+
+  if (c0 == c1) {
+    bits = 0;
+  } else if (c0 < c1) {
+    // swapping the endpoints swaps palette entries 0 and 1, and 2 and 3
+    std::swap(c0, c1);
+    bits ^= 0x55555555;
+  }
+  WriteBc1(c0, c1, bits, block);
+}
+
+// three color mode, color0 <= color1, texels with alpha below 128 become transparent black
+void EncodeBc1Transparent(const uint8_t* texels, uint8_t* block) {
+  uint8_t min[4] = {255, 255, 255, 255}, max[4] = {0, 0, 0, 0};
+  uint8_t opaque[kBlockTexels * 4];
+  uint32_t opaque_count = 0;
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    if (texels[i * 4 + 3] < 128) {
+      continue;
+    }
+    std::memcpy(opaque + opaque_count * 4, texels + i * 4, 4);
+    opaque_count++;
+    for (int c = 0; c < 3; c++) {
+      min[c] = std::min(min[c], texels[i * 4 + c]);
+      max[c] = std::max(max[c], texels[i * 4 + c]);
+    }
+  }
+  if (opaque_count == 0) {
+    WriteBc1(0, 0, 0xffffffff, block);
+    return;
+  }
+  // pad with the first opaque texel, the diagonal only needs the covariance signs
+  for (uint32_t i = opaque_count; i < kBlockTexels; i++) {
+    std::memcpy(opaque + i * 4, opaque, 4);
+  }
+  float start[4], end[4];
+  DiagonalEndpoints(opaque, min, max, 3, 16.0f, start, end);
+  uint16_t c0 = Pack565(start);
+  uint16_t c1 = Pack565(end);
+  if (c0 > c1) {
+    std::swap(c0, c1);
+  }
+
+  float e0[4], e1[4], axis[4];
+  Unpack565(c0, e0);
+  Unpack565(c1, e1);
+  for (int c = 0; c < 4; c++) {
+    axis[c] = e1[c] - e0[c];
+  }
+  static constexpr uint32_t kOrder[3] = {0, 2, 1};
+  uint8_t                   indices[kBlockTexels];
+  ProjectScalar(texels, e0, axis, 2, indices);
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < kBlockTexels; i++) {
+    const uint32_t index = texels[i * 4 + 3] < 128 ? 3 : kOrder[indices[i]];
+    bits |= index << (2 * i);
+  }
+  WriteBc1(c0, c1, bits, block);
+}
+
+// eight interpolated values of one channel, value0 > value1. a block of one value has all
+// indices 0, which the six value mode it falls into reads as value0 as well
+void EncodeBc4(
+    BcKernel       kernel,
+    const uint8_t* texels,
+    int            channel,
+    uint8_t        low,
+    uint8_t        high,
+    uint8_t*       block) {
+  block[0]      = high;
+  block[1]      = low;
+  uint64_t bits = 0;
+  if (high > low) {
+    float start[4] = {}, axis[4] = {};
+    start[channel] = high;
+    axis[channel]  = static_cast<float>(low) - static_cast<float>(high);
+    uint8_t indices[kBlockTexels];
+    Project(kernel, texels, start, axis, 7, indices);
+    for (uint32_t i = 0; i < kBlockTexels; i++) {
+      // value0, the six interpolated values, value1
+      const uint64_t index = indices[i] == 0 ? 0 : indices[i] == 7 ? 1 : indices[i] + 1;
+      bits |= index << (3 * i);
+    }
+  }
+  for (int i = 0; i < 6; i++) {
+    block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+  }
+}
+
+// bc7 mode 6: 7 bit rgba endpoints with a p bit each, 4 bit indices
+void EncodeBc7Mode6(
+    BcKernel       kernel,
+    const uint8_t* texels,
+    const uint8_t* min,
+    const uint8_t* max,
+    uint8_t*       block) {
+  float start[4], end[4];
+  DiagonalEndpoints(texels, min, max, 4, 32.0f, start, end);
+
+  // the p bit that brings the quantized endpoint closest
+  uint32_t endpoints[2][4];
+  uint32_t pbits[2];
+  float    expanded[2][4];
+  for (int e = 0; e < 2; e++) {
+    const float* source     = e == 0 ? start : end;
+    float        best_error = -1.0f;
+    for (uint32_t p = 0; p < 2; p++) {
+      uint32_t quantized[4];
+      float    error = 0.0f;
+      for (int c = 0; c < 4; c++) {
+        const float value = std::min(std::max((source[c] - p) * 0.5f + 0.5f, 0.0f), 127.0f);
+        quantized[c]      = static_cast<uint32_t>(value);
+        const float delta = static_cast<float>(quantized[c] << 1 | p) - source[c];
+        error += delta * delta;
+      }
+      if (best_error < 0.0f || error < best_error) {
+        best_error = error;
+        pbits[e]   = p;
+        for (int c = 0; c < 4; c++) {
+          endpoints[e][c] = quantized[c];
+          expanded[e][c]  = static_cast<float>(quantized[c] << 1 | p);
+        }
+      }
+    }
+  }
+
+  float axis[4];
+  for (int c = 0; c < 4; c++) {
+    axis[c] = expanded[1][c] - expanded[0][c];
+  }
+  uint8_t indices[kBlockTexels];
+  Project(kernel, texels, expanded[0], axis, 15, indices);
+  // the most significant index bit of the first texel is implied 0
+  if (indices[0] & 8) {
+    for (int c = 0; c < 4; c++) {
+      std::swap(endpoints[0][c], endpoints[1][c]);
+    }
+    std::swap(pbits[0], pbits[1]);
+    for (uint32_t i = 0; i < kBlockTexels; i++) {
+      indices[i] = static_cast<uint8_t>(15 - indices[i]);
+    }
+  }
+
+  uint64_t   words[2] = {};
+  uint32_t   position = 0;
+  const auto write    = [&words, &position](uint64_t value, uint32_t bits) {
+    for (uint32_t i = 0; i < bits; i++, position++) {
+      words[position / 64] |= ((value >> i) & 1) << (position % 64);
+    }
+  };
+  write(1 << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    write(endpoints[0][c], 7);
+    write(endpoints[1][c], 7);
+  }
+  write(pbits[0], 1);
+  write(pbits[1], 1);
+  write(indices[0], 3);
+  for (uint32_t i = 1; i < kBlockTexels; i++) {
+    write(indices[i], 4);
+  }
+  std::memcpy(block, words, 16);
+}
+}  // namespace
+
+BcEncoder::BcEncoder() : kernel_(BestKernel()) {}
+
+BcKernel BcEncoder::BestKernel() {
+#if defined(VKENGINE_BC_X86)
+  // sse2 is part of x86-64
+  return BcKernel::kSse;
+#else
+  return BcKernel::kScalar;
+#endif
+}
+
+const char* BcEncoder::KernelName(BcKernel kernel) {
+  return kernel == BcKernel::kSse ? "sse" : "scalar";
+}
+
+void BcEncoder::SetKernel(BcKernel kernel) {
+  const BcKernel best = BestKernel();
+  kernel_             = kernel > best ? best : kernel;
+}
+
+void BcEncoder::EncodeBlock(PixelFormat format, const uint8_t* texels, uint8_t* block) const {
+  uint8_t min[4], max[4];
+  Bounds(kernel_, texels, min, max);
+  switch (format) {
+    case PixelFormat::BC1_RGBA_UNORM:
+    case PixelFormat::BC1_RGBA_SRGB:
+      if (min[3] < 128) {
+        EncodeBc1Transparent(texels, block);
+      } else {
+        EncodeBc1Colors(kernel_, texels, min, max, block);
+      }
+      break;
+    case PixelFormat::BC3_UNORM:
+    case PixelFormat::BC3_SRGB:
+      EncodeBc4(kernel_, texels, 3, min[3], max[3], block);
+      EncodeBc1Colors(kernel_, texels, min, max, block + 8);
+      break;
+    case PixelFormat::BC5_UNORM:
+      EncodeBc4(kernel_, texels, 0, min[0], max[0], block);
+      EncodeBc4(kernel_, texels, 1, min[1], max[1], block + 8);
+      break;
+    case PixelFormat::BC7_UNORM:
+    case PixelFormat::BC7_SRGB:
+      EncodeBc7Mode6(kernel_, texels, min, max, block);
+      break;
+    default:
+      break;
+  }
+}
+
+void BcEncoder::EncodeImage(
+    PixelFormat    format,
+    const uint8_t* texels,
+    uint32_t       width,
+    uint32_t       height,
+    uint8_t*       blocks,
+    ThreadPool*    pool) const {
+  const uint32_t blocks_x   = (width + 3) / 4;
+  const uint32_t blocks_y   = (height + 3) / 4;
+  const uint32_t block_size = GetTexelBlockSize(format);
+
+  const auto encode_row = [&](uint32_t row) {
+    uint8_t  block_texels[kBlockTexels * 4];
+    uint8_t* out = blocks + static_cast<size_t>(row) * blocks_x * block_size;
+    for (uint32_t bx = 0; bx < blocks_x; bx++) {
+      for (uint32_t y = 0; y < 4; y++) {
+        const uint32_t sy = std::min(row * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++) {
+          const uint32_t sx = std::min(bx * 4 + x, width - 1);
+          std::memcpy(
+              block_texels + (y * 4 + x) * 4,
+              texels + (static_cast<size_t>(sy) * width + sx) * 4,
+              4);
+        }
+      }
+      EncodeBlock(format, block_texels, out + bx * block_size);
+    }
+  };
+
+  if (pool) {
+    pool->ParallelFor(blocks_y, encode_row);
+  } else {
+    for (uint32_t row = 0; row < blocks_y; row++) {
+      encode_row(row);
+    }
+  }
+}
+
+}  // namespace vkengine
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+enum class BcKernel : uint8_t { kScalar = 0, kSse };
+
+// block compression of rgba8 texels into the BC1, BC3, BC5 and BC7 pixel formats. endpoints are
+// the bounds of a block along its dominant diagonal, inset by a fraction of a palette step:
+//   bc1  four colors, or three and transparent black for a block with alpha below 128. the four
+//        color endpoints are refined once by least squares
+//   bc3  bc1 color in four color mode and an eight value alpha block
+//   bc5  eight value blocks of red and green
+//   bc7  mode 6 only, one subset of rgba endpoints with 16 interpolated values
+// the bounds and the projection of the texels onto the endpoint line run 4 texels at a time with
+// sse2, every kernel produces the same bits. the kernel is picked once from the cpu
+class BcEncoder {
+ public:
+  BcEncoder();
+  ~BcEncoder() {}
+
+  BcKernel GetKernel() const { return kernel_; }
+  // kernels the cpu does not support fall back to the best supported one
+  void SetKernel(BcKernel kernel);
+
+  static BcKernel    BestKernel();
+  static const char* KernelName(BcKernel kernel);
+
+  // 16 rgba8 texels of one 4x4 block in row major order into GetTexelBlockSize(format) bytes
+  void EncodeBlock(PixelFormat format, const uint8_t* texels, uint8_t* block) const;
+  // width x height rgba8 texels into row major blocks, the blocks over the edge repeat the last
+  // row and column. rows of blocks are spread over the pool, single threaded without one
+  void EncodeImage(
+      PixelFormat    format,
+      const uint8_t* texels,
+      uint32_t       width,
+      uint32_t       height,
+      uint8_t*       blocks,
+      ThreadPool*    pool = nullptr) const;
+
+ private:
+  BcKernel kernel_ = BcKernel::kScalar;
+};
+
+}  // namespace vkengine
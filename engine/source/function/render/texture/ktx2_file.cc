@@ -0,0 +1,392 @@
+#include "function/render/texture/ktx2_file.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+#include "core/utils/temporary_path.h"
+#include "fmt/format.h"
+
+namespace vkengine {
+
+namespace {
+constexpr uint8_t kIdentifier[12] = {
+    0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+struct Header {
+  uint8_t  identifier[12];
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+  uint32_t dfd_byte_offset;
+  uint32_t dfd_byte_length;
+  uint32_t kvd_byte_offset;
+  uint32_t kvd_byte_length;
+  uint64_t sgd_byte_offset;
+  uint64_t sgd_byte_length;
+};
+static_assert(sizeof(Header) == 80, "ktx2 header is read as bytes");
+
+struct LevelIndex {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+};
+
+// data format descriptor values of the khronos basic descriptor block
+constexpr uint32_t kModelRgbsda      = 1;
+constexpr uint32_t kModelBc1a        = 128;
+constexpr uint32_t kModelBc3         = 130;
+constexpr uint32_t kModelBc5         = 132;
+constexpr uint32_t kModelBc7         = 134;
+constexpr uint32_t kPrimariesBt709   = 1;
+constexpr uint32_t kTransferLinear   = 1;
+constexpr uint32_t kTransferSrgb     = 2;
+constexpr uint32_t kChannelAlpha     = 15;
+constexpr uint32_t kQualifierLinear  = 0x10;
+constexpr uint32_t kQualifierSigned  = 0x40;
+constexpr uint32_t kQualifierFloat   = 0x80;
+constexpr uint32_t kDescriptorHeader = 24;
+constexpr uint32_t kSampleSize       = 16;
+
+struct FormatInfo {
+  PixelFormat format;
+  VkFormat    vk_format;
+  uint32_t    type_size;
+  uint32_t    model;
+  // channel of every sample, the samples are consecutive and of equal width
+  uint32_t    channels[4];
+  uint32_t    sample_count;
+};
+
+constexpr FormatInfo kFormats[] = {
+    {PixelFormat::R8G8B8_UNORM, VK_FORMAT_R8G8B8_UNORM, 1, kModelRgbsda, {0, 1, 2}, 3},
+    {PixelFormat::R8G8B8_SRGB, VK_FORMAT_R8G8B8_SRGB, 1, kModelRgbsda, {0, 1, 2}, 3},
+    {PixelFormat::R8G8B8A8_UNORM,
+     VK_FORMAT_R8G8B8A8_UNORM,
+     1,
+     kModelRgbsda,
+     {0, 1, 2, kChannelAlpha},
+     4},
+    {PixelFormat::R8G8B8A8_SRGB,
+     VK_FORMAT_R8G8B8A8_SRGB,
+     1,
+     kModelRgbsda,
+     {0, 1, 2, kChannelAlpha},
+     4},
+    {PixelFormat::R32G32_FLOAT, VK_FORMAT_R32G32_SFLOAT, 4, kModelRgbsda, {0, 1}, 2},
+    {PixelFormat::R32G32B32_FLOAT, VK_FORMAT_R32G32B32_SFLOAT, 4, kModelRgbsda, {0, 1, 2}, 3},
+    {PixelFormat::R32G32B32A32_FLOAT,
+     VK_FORMAT_R32G32B32A32_SFLOAT,
+     4,
+     kModelRgbsda,
+     {0, 1, 2, kChannelAlpha},
+     4},
+    // bc1 with alpha is the alpha present channel, bc3 stores alpha before color
+    {PixelFormat::BC1_RGBA_UNORM, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 1, kModelBc1a, {1}, 1},
+    {PixelFormat::BC1_RGBA_SRGB, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 1, kModelBc1a, {1}, 1},
+    {PixelFormat::BC3_UNORM, VK_FORMAT_BC3_UNORM_BLOCK, 1, kModelBc3, {kChannelAlpha, 0}, 2},
+    {PixelFormat::BC3_SRGB, VK_FORMAT_BC3_SRGB_BLOCK, 1, kModelBc3, {kChannelAlpha, 0}, 2},
+    {PixelFormat::BC5_UNORM, VK_FORMAT_BC5_UNORM_BLOCK, 1, kModelBc5, {0, 1}, 2},
+    {PixelFormat::BC7_UNORM, VK_FORMAT_BC7_UNORM_BLOCK, 1, kModelBc7, {0}, 1},
+    {PixelFormat::BC7_SRGB, VK_FORMAT_BC7_SRGB_BLOCK, 1, kModelBc7, {0}, 1},
+};
+
+const FormatInfo* FindFormat(PixelFormat format) {
+  for (const auto& info : kFormats) {
+    if (info.format == format) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+const FormatInfo* FindFormat(uint32_t vk_format) {
+  for (const auto& info : kFormats) {
+    if (static_cast<uint32_t>(info.vk_format) == vk_format) {
+      return &info;
+    }
+  }
+  return nullptr;
+}
+
+size_t AlignUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// basic descriptor block, every sample covers the bits of its channel in the texel block
+std::vector<uint32_t> BuildDataFormatDescriptor(const FormatInfo& info) {
+  const bool     compressed = IsBlockCompressed(info.format);
+  const uint32_t block_size = GetTexelBlockSize(info.format);
+  const uint32_t bits       = block_size * 8 / info.sample_count;
+
+  std::vector<uint32_t> words;
+  words.push_back(0);
+  words.push_back(0);
+  words.push_back(2 | (kDescriptorHeader + kSampleSize * info.sample_count) << 16);
+  words.push_back(
+      info.model | kPrimariesBt709 << 8 |
+      (IsSrgb(info.format) ? kTransferSrgb : kTransferLinear) << 16);
+  // texel block dimensions minus one
+  words.push_back(compressed ? 3 | 3 << 8 : 0);
+  words.push_back(block_size);
+  words.push_back(0);
+  for (uint32_t s = 0; s < info.sample_count; s++) {
+    uint32_t channel = info.channels[s];
+    uint32_t lower   = 0;
+    uint32_t upper   = compressed ? UINT32_MAX : (1u << bits) - 1;
+    if (!compressed && info.type_size == 4) {
+      // -1.0f and 1.0f
+      channel |= kQualifierFloat | kQualifierSigned;
+      lower = 0xbf800000;
+      upper = 0x3f800000;
+    } else if (channel == kChannelAlpha && IsSrgb(info.format)) {
+      channel |= kQualifierLinear;
+    }
+    words.push_back(s * bits | (bits - 1) << 16 | channel << 24);
+    words.push_back(0);
+    words.push_back(lower);
+    words.push_back(upper);
+  }
+  words[0] = static_cast<uint32_t>(words.size() * sizeof(uint32_t));
+  return words;
+}
+}  // namespace
+
+bool Ktx2File::Open(const std::string& file, std::string& error) {
+  levels_.clear();
+  key_values_      = nullptr;
+  key_values_size_ = 0;
+  if (!mapping_.Open(file)) {
+    error = "can not read the file";
+    return false;
+  }
+  const char*  data = mapping_.Data();
+  const size_t size = mapping_.Size();
+
+  Header header;
+  if (size < sizeof(Header)) {
+    error = "truncated header";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(Header));
+  if (std::memcmp(header.identifier, kIdentifier, sizeof(kIdentifier)) != 0) {
+    error = "not a ktx2 file";
+    return false;
+  }
+  if (header.supercompression_scheme != 0) {
+    error = fmt::format(
+        "supercompression scheme {} is not supported", header.supercompression_scheme);
+    return false;
+  }
+  if (header.pixel_width == 0 || header.pixel_height == 0 || header.pixel_depth > 1 ||
+      header.layer_count > 1 || header.face_count != 1) {
+    error = "not a single 2d image";
+    return false;
+  }
+  const FormatInfo* info = FindFormat(header.vk_format);
+  if (!info) {
+    error = fmt::format("vkFormat {} is not supported", header.vk_format);
+    return false;
+  }
+  // 0 asks for mips generated at load time, the file holds the base level only
+  const uint32_t level_count = std::max(header.level_count, 1u);
+  if (level_count > GetMipLevelCount(header.pixel_width, header.pixel_height)) {
+    error = fmt::format(
+        "{} levels for a {}x{} image", level_count, header.pixel_width, header.pixel_height);
+    return false;
+  }
+  const size_t level_index_end = sizeof(Header) + sizeof(LevelIndex) * level_count;
+  if (size < level_index_end) {
+    error = "truncated level index";
+    return false;
+  }
+  if (header.dfd_byte_offset > size || header.dfd_byte_length > size - header.dfd_byte_offset ||
+      header.kvd_byte_offset > size || header.kvd_byte_length > size - header.kvd_byte_offset) {
+    error = "descriptor or key/value data out of the file";
+    return false;
+  }
+
+  for (uint32_t level = 0; level < level_count; level++) {
+    LevelIndex index;
+    std::memcpy(&index, data + sizeof(Header) + sizeof(LevelIndex) * level, sizeof(LevelIndex));
+    const size_t expected =
+        GetMipLevelSize(info->format, header.pixel_width, header.pixel_height, level);
+    if (index.byte_length != expected || index.byte_offset > size ||
+        index.byte_length > size - index.byte_offset) {
+      error = fmt::format(
+          "level {} has {} bytes at {}, {} expected",
+          level,
+          index.byte_length,
+          index.byte_offset,
+          expected);
+      return false;
+    }
+    levels_.push_back(data + index.byte_offset);
+  }
+
+  format_          = info->format;
+  width_           = header.pixel_width;
+  height_          = header.pixel_height;
+  key_values_      = data + header.kvd_byte_offset;
+  key_values_size_ = header.kvd_byte_length;
+  return true;
+}
+
+std::string Ktx2File::GetValue(const std::string& key) const {
+  size_t offset = 0;
+  while (offset + sizeof(uint32_t) <= key_values_size_) {
+    uint32_t length;
+    std::memcpy(&length, key_values_ + offset, sizeof(length));
+    offset += sizeof(length);
+    if (length > key_values_size_ - offset) {
+      break;
+    }
+    // the key ends at its terminator, the value is the rest of the entry
+    const char* entry = key_values_ + offset;
+    const char* end   = static_cast<const char*>(std::memchr(entry, '\0', length));
+    if (end && key.size() == static_cast<size_t>(end - entry) &&
+        std::memcmp(entry, key.data(), key.size()) == 0) {
+      std::string value(end + 1, entry + length);
+      // values written as strings keep their terminator
+      if (!value.empty() && value.back() == '\0') {
+        value.pop_back();
+      }
+      return value;
+    }
+    offset = AlignUp(offset + length, 4);
+  }
+  return {};
+}
+
+std::shared_ptr<RenderMaterialData> Ktx2File::CopyTexture() const {
+  size_t size = 0;
+  for (uint32_t level = 0; level < GetLevelCount(); level++) {
+    size += GetMipLevelSize(format_, width_, height_, level);
+  }
+  auto* pixels = static_cast<char*>(malloc(size));
+  if (!pixels) {
+    return nullptr;
+  }
+  size_t offset = 0;
+  for (uint32_t level = 0; level < GetLevelCount(); level++) {
+    const size_t level_size = GetMipLevelSize(format_, width_, height_, level);
+    std::memcpy(pixels + offset, levels_[level], level_size);
+    offset += level_size;
+  }
+
+  auto texture          = std::make_shared<RenderMaterialData>();
+  texture->pixels       = pixels;
+  texture->width        = width_;
+  texture->height       = height_;
+  texture->format       = format_;
+  texture->depth        = 1;
+  texture->array_layers = 1;
+  texture->mip_levels   = GetLevelCount();
+  texture->type         = ImageType::IMAGE_2D;
+  return texture;
+}
+
+bool WriteKtx2File(
+    const std::string&                                      file,
+    const RenderMaterialData&                               texture,
+    const std::vector<std::pair<std::string, std::string>>& key_values,
+    std::string&                                            error) {
+  const FormatInfo* info = FindFormat(texture.format);
+  if (!info || !texture.pixels || texture.width == 0 || texture.height == 0) {
+    error = "the texture has no pixels or a format ktx2 can not hold";
+    return false;
+  }
+  const uint32_t level_count = std::max(texture.mip_levels, 1u);
+
+  // key/value entries are sorted by key, each padded to 4 bytes
+  auto sorted = key_values;
+  std::sort(sorted.begin(), sorted.end());
+  std::string key_value_data;
+  for (const auto& [key, value] : sorted) {
+    const auto length = static_cast<uint32_t>(key.size() + 1 + value.size() + 1);
+    key_value_data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    key_value_data.append(key).push_back('\0');
+    key_value_data.append(value).push_back('\0');
+    key_value_data.resize(AlignUp(key_value_data.size(), 4), '\0');
+  }
+
+  const std::vector<uint32_t> descriptor = BuildDataFormatDescriptor(*info);
+  Header                      header{};
+  std::memcpy(header.identifier, kIdentifier, sizeof(kIdentifier));
+  header.vk_format       = static_cast<uint32_t>(info->vk_format);
+  header.type_size       = info->type_size;
+  header.pixel_width     = texture.width;
+  header.pixel_height    = texture.height;
+  header.face_count      = 1;
+  header.level_count     = level_count;
+  header.dfd_byte_offset = static_cast<uint32_t>(sizeof(Header) + sizeof(LevelIndex) * level_count);
+  header.dfd_byte_length = static_cast<uint32_t>(descriptor.size() * sizeof(uint32_t));
+  header.kvd_byte_offset =
+      key_value_data.empty() ? 0 : header.dfd_byte_offset + header.dfd_byte_length;
+  header.kvd_byte_length = static_cast<uint32_t>(key_value_data.size());
+
+  // levels smallest first, each aligned to the texel block and to 4 bytes
+  const size_t alignment = std::lcm<size_t>(GetTexelBlockSize(info->format), 4);
+
+  std::vector<LevelIndex> levels(level_count);
+  std::vector<size_t>     source_offsets(level_count);
+  size_t                  source_offset = 0;
+  for (uint32_t level = 0; level < level_count; level++) {
+    const size_t level_size = GetMipLevelSize(info->format, texture.width, texture.height, level);
+    source_offsets[level]   = source_offset;
+    levels[level]           = {0, level_size, level_size};
+    source_offset += levels[level].byte_length;
+  }
+  size_t offset = header.dfd_byte_offset + header.dfd_byte_length + header.kvd_byte_length;
+  for (uint32_t level = level_count; level-- > 0;) {
+    offset                    = AlignUp(offset, alignment);
+    levels[level].byte_offset = offset;
+    offset += levels[level].byte_length;
+  }
+
+  // two workers may cook the same texture at once
+  const std::string temporary = ThreadTemporaryPath(file);
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      error = fmt::format("can not write {}", temporary);
+      return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(levels.data()), sizeof(LevelIndex) * level_count);
+    out.write(reinterpret_cast<const char*>(descriptor.data()), header.dfd_byte_length);
+    out.write(key_value_data.data(), key_value_data.size());
+    size_t written = header.dfd_byte_offset + header.dfd_byte_length + header.kvd_byte_length;
+    for (uint32_t level = level_count; level-- > 0;) {
+      const std::string padding(levels[level].byte_offset - written, '\0');
+      out.write(padding.data(), padding.size());
+      out.write(
+          static_cast<const char*>(texture.pixels) + source_offsets[level],
+          levels[level].byte_length);
+      written = levels[level].byte_offset + levels[level].byte_length;
+    }
+    if (!out) {
+      error = fmt::format("can not write {}", temporary);
+      return false;
+    }
+  }
+  std::error_code rename_error;
+  std::filesystem::rename(temporary, file, rename_error);
+  if (rename_error) {
+    error = fmt::format("can not rename {} : {}", temporary, rename_error.message());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace vkengine
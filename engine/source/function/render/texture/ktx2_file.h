@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/utils/mapped_file.h"
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// khronos texture 2.0 container of one 2d image and its mip levels, without supercompression.
+// the file keeps the levels smallest first as the format asks, the texel data of RenderMaterialData
+// is largest first. the data format descriptor is written for every PixelFormat but only
+// validated for its size on read
+class Ktx2File {
+ public:
+  Ktx2File() {}
+  ~Ktx2File() {}
+
+  // return false and set error if the file can not be read, is malformed, supercompressed, not a
+  // single 2d image or in a format that has no PixelFormat
+  bool Open(const std::string& file, std::string& error);
+
+  PixelFormat GetFormat() const { return format_; }
+  uint32_t    GetWidth() const { return width_; }
+  uint32_t    GetHeight() const { return height_; }
+  uint32_t    GetLevelCount() const { return static_cast<uint32_t>(levels_.size()); }
+  // texels of level inside the mapping, GetMipLevelSize bytes
+  const char* GetLevelData(uint32_t level) const { return levels_[level]; }
+  // value of key in the key/value data, empty when the file has none
+  std::string GetValue(const std::string& key) const;
+
+  // every level copied into one malloc allocation, largest first
+  std::shared_ptr<RenderMaterialData> CopyTexture() const;
+
+ private:
+  MappedFile               mapping_;
+  PixelFormat              format_ = PixelFormat::UNKNOWN;
+  uint32_t                 width_  = 0;
+  uint32_t                 height_ = 0;
+  std::vector<const char*> levels_;
+  const char*              key_values_      = nullptr;
+  size_t                   key_values_size_ = 0;
+};
+
+// write the mip_levels levels of texture to file with the key/value pairs, through a temporary
+// file that is renamed. false and error set when the format can not be stored or the file not
+// written
+bool WriteKtx2File(
+    const std::string&                                      file,
+    const RenderMaterialData&                               texture,
+    const std::vector<std::pair<std::string, std::string>>& key_values,
+    std::string&                                            error);
+
+}  // namespace vkengine
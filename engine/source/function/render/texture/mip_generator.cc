@@ -0,0 +1,441 @@
+#include "function/render/texture/mip_generator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "core/utils/thread_pool.h"
+#include "function/render/texture/texture_decoder.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define VKENGINE_MIP_X86 1
+#include <emmintrin.h>
+#endif
+
+namespace vkengine {
+
+namespace {
+constexpr uint32_t kKaiserTaps   = 6;
+constexpr double   kKaiserAlpha  = 4.0;
+// in texels of the level above, the outer taps are 2.5 texels from the center
+constexpr double   kKaiserRadius = 3.0;
+
+// how the texels of a format are read into and written from 4 floats
+struct TexelLayout {
+  uint32_t channels = 0;
+  // 8 bit unorm channels, 32 bit floats otherwise
+  bool     bytes    = false;
+  bool     srgb     = false;
+};
+
+bool GetTexelLayout(PixelFormat format, TexelLayout& layout) {
+  switch (format) {
+    case PixelFormat::R8G8B8_UNORM:
+    case PixelFormat::R8G8B8_SRGB:
+      layout = {3, true, IsSrgb(format)};
+      return true;
+    case PixelFormat::R8G8B8A8_UNORM:
+    case PixelFormat::R8G8B8A8_SRGB:
+      layout = {4, true, IsSrgb(format)};
+      return true;
+    case PixelFormat::R32G32_FLOAT:
+      layout = {2, false, false};
+      return true;
+    case PixelFormat::R32G32B32_FLOAT:
+      layout = {3, false, false};
+      return true;
+    case PixelFormat::R32G32B32A32_FLOAT:
+      layout = {4, false, false};
+      return true;
+    default:
+      return false;
+  }
+}
+
+// bins of the linear range that give the first srgb code to look at
+constexpr uint32_t kSrgbBins = 4096;
+
+struct SrgbTables {
+  float to_linear[256];
+  // linear value of the midpoint between the srgb codes i and i + 1, the code of a linear value
+  // is the number of midpoints below it
+  float midpoints[256];
+  // code of the lower end of every bin, at most two codes below the code of a value in the bin
+  uint8_t codes[kSrgbBins + 1];
+};
+
+double SrgbToLinear(double value) {
+  return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+}
+
+const SrgbTables& GetSrgbTables() {
+  static const SrgbTables tables = []() {
+    SrgbTables result;
+    for (uint32_t i = 0; i < 256; i++) {
+      result.to_linear[i] = static_cast<float>(SrgbToLinear(i / 255.0));
+      result.midpoints[i] = static_cast<float>(SrgbToLinear((i + 0.5) / 255.0));
+    }
+    result.midpoints[255] = std::numeric_limits<float>::infinity();
+    uint32_t code         = 0;
+    for (uint32_t bin = 0; bin <= kSrgbBins; bin++) {
+      while (result.midpoints[code] < static_cast<float>(bin) / kSrgbBins) {
+        code++;
+      }
+      result.codes[bin] = static_cast<uint8_t>(code);
+    }
+    return result;
+  }();
+  return tables;
+}
+
+// rounds to the nearest srgb code, walking up from the code of the bin
+inline uint8_t LinearToSrgb(float value, const SrgbTables& tables) {
+  value         = std::min(std::max(value, 0.0f), 1.0f);
+  uint32_t code = tables.codes[static_cast<uint32_t>(value * kSrgbBins)];
+  while (tables.midpoints[code] < value) {
+    code++;
+  }
+  return static_cast<uint8_t>(code);
+}
+
+inline uint8_t LinearToUnorm(float value) {
+  // the kaiser lobes may reach past [0, 1]
+  return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// texels into 4 floats each, the missing channels are 0
+void LoadRow(const TexelLayout& layout, const void* texels, uint32_t width, float* row) {
+  const uint32_t channels = layout.channels;
+  std::fill(row, row + static_cast<size_t>(width) * 4, 0.0f);
+  if (!layout.bytes) {
+    const auto* source = static_cast<const float*>(texels);
+    for (uint32_t x = 0; x < width; x++) {
+      std::copy(source + x * channels, source + (x + 1) * channels, row + x * 4);
+    }
+    return;
+  }
+  const auto*  source    = static_cast<const uint8_t*>(texels);
+  const float* to_linear = GetSrgbTables().to_linear;
+  const auto   color     = layout.srgb ? 3u : 0u;
+  for (uint32_t x = 0; x < width; x++) {
+    const uint8_t* texel = source + x * channels;
+    uint32_t       c     = 0;
+    for (; c < color; c++) {
+      row[x * 4 + c] = to_linear[texel[c]];
+    }
+    for (; c < channels; c++) {
+      row[x * 4 + c] = texel[c] * (1.0f / 255.0f);
+    }
+  }
+}
+
+void StoreRow(const TexelLayout& layout, const float* row, uint32_t width, void* texels) {
+  const uint32_t channels = layout.channels;
+  if (!layout.bytes) {
+    auto* target = static_cast<float*>(texels);
+    for (uint32_t x = 0; x < width; x++) {
+      std::copy(row + x * 4, row + x * 4 + channels, target + x * channels);
+    }
+    return;
+  }
+  auto*             target = static_cast<uint8_t*>(texels);
+  const SrgbTables& tables = GetSrgbTables();
+  const auto        color  = layout.srgb ? 3u : 0u;
+  for (uint32_t x = 0; x < width; x++) {
+    uint8_t* texel = target + x * channels;
+    uint32_t c     = 0;
+    for (; c < color; c++) {
+      texel[c] = LinearToSrgb(row[x * 4 + c], tables);
+    }
+    for (; c < channels; c++) {
+      texel[c] = LinearToUnorm(row[x * 4 + c]);
+    }
+  }
+}
+
+// modified bessel function of the first kind and order 0, by its power series
+double Bessel0(double x) {
+  double sum  = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+  return sum;
+}
+
+// weights of the 6 texels of the level above at -2.5 to 2.5 texels from the center of a texel of
+// the next level, a sinc with the cutoff of the next level under the window
+std::array<float, kKaiserTaps> KaiserWeights() {
+  constexpr double kPi = 3.14159265358979323846;
+
+  std::array<double, kKaiserTaps> weights;
+  double                          sum = 0.0;
+  for (uint32_t i = 0; i < kKaiserTaps; i++) {
+    const double distance = i - 2.5;
+    const double phase    = kPi * distance / 2.0;
+    const double window   = distance / kKaiserRadius;
+    // the scale of the window does not matter, the weights are normalized below
+    weights[i] = std::sin(phase) / phase * Bessel0(kKaiserAlpha * std::sqrt(1.0 - window * window));
+    sum += weights[i];
+  }
+  std::array<float, kKaiserTaps> result;
+  for (uint32_t i = 0; i < kKaiserTaps; i++) {
+    result[i] = static_cast<float>(weights[i] / sum);
+  }
+  return result;
+}
+
+// one texel of 4 floats, the kernels share the filters and differ in this type only
+struct ScalarTexel {
+  float v[4];
+
+  static ScalarTexel Zero() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+  static ScalarTexel Load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+  void               Store(float* p) const { std::memcpy(p, v, sizeof(v)); }
+  ScalarTexel        operator+(const ScalarTexel& rhs) const {
+    return {{v[0] + rhs.v[0], v[1] + rhs.v[1], v[2] + rhs.v[2], v[3] + rhs.v[3]}};
+  }
+  ScalarTexel operator*(float s) const { return {{v[0] * s, v[1] * s, v[2] * s, v[3] * s}}; }
+};
+
+#if defined(VKENGINE_MIP_X86)
+struct SseTexel {
+  __m128 v;
+
+  static SseTexel Zero() { return {_mm_setzero_ps()}; }
+  static SseTexel Load(const float* p) { return {_mm_loadu_ps(p)}; }
+  void            Store(float* p) const { _mm_storeu_ps(p, v); }
+  SseTexel        operator+(const SseTexel& rhs) const { return {_mm_add_ps(v, rhs.v)}; }
+  SseTexel        operator*(float s) const { return {_mm_mul_ps(v, _mm_set1_ps(s))}; }
+};
+#endif
+
+// texel x of the next level from the texels 2x and 2x + 1 of row0 and row1, the last texel of
+// an odd row is repeated
+template <typename Texel>
+void BoxRow(
+    const float* row0, const float* row1, uint32_t width, float* result, uint32_t result_width) {
+  for (uint32_t x = 0; x < result_width; x++) {
+    const uint32_t x0  = std::min(x * 2, width - 1) * 4;
+    const uint32_t x1  = std::min(x * 2 + 1, width - 1) * 4;
+    const Texel    sum = (Texel::Load(row0 + x0) + Texel::Load(row0 + x1)) +
+                      (Texel::Load(row1 + x0) + Texel::Load(row1 + x1));
+    (sum * 0.25f).Store(result + x * 4);
+  }
+}
+
+// horizontal pass of the kaiser filter, texel x from the texels 2x - 2 to 2x + 3 of row
+template <typename Texel>
+void KaiserRow(
+    const float* row, uint32_t width, const float* weights, float* result, uint32_t result_width) {
+  for (uint32_t x = 0; x < result_width; x++) {
+    Texel sum = Texel::Zero();
+    for (uint32_t i = 0; i < kKaiserTaps; i++) {
+      const int64_t source = std::clamp<int64_t>(int64_t{x} * 2 - 2 + i, 0, width - 1);
+      sum                  = sum + Texel::Load(row + source * 4) * weights[i];
+    }
+    sum.Store(result + x * 4);
+  }
+}
+
+// vertical pass, every float of the 6 rows is weighted by the weight of its row
+template <typename Texel>
+void KaiserColumns(const float* const* rows, uint32_t floats, const float* weights, float* result) {
+  for (uint32_t i = 0; i < floats; i += 4) {
+    Texel sum = Texel::Zero();
+    for (uint32_t tap = 0; tap < kKaiserTaps; tap++) {
+      sum = sum + Texel::Load(rows[tap] + i) * weights[tap];
+    }
+    sum.Store(result + i);
+  }
+}
+
+void ForEachRow(ThreadPool* pool, uint32_t rows, const std::function<void(uint32_t)>& task) {
+  if (pool) {
+    pool->ParallelFor(rows, task);
+  } else {
+    for (uint32_t row = 0; row < rows; row++) {
+      task(row);
+    }
+  }
+}
+
+// rows of the level a filter reads. the first level is converted a row at a time when it is read
+// instead of as a whole, its float texels would be four times the size of rgba8 ones
+struct LevelRows {
+  // linear texels of a level after the first
+  const float* level = nullptr;
+  // texels of the first level
+  const TexelLayout* layout     = nullptr;
+  const char*        texels     = nullptr;
+  size_t             texel_size = 0;
+  uint32_t           width      = 0;
+
+  // row y, converted into buffer for the first level
+  const float* Get(uint32_t y, std::vector<float>& buffer) const {
+    if (level) {
+      return level + static_cast<size_t>(y) * width * 4;
+    }
+    buffer.resize(static_cast<size_t>(width) * 4);
+    LoadRow(*layout, texels + static_cast<size_t>(y) * width * texel_size, width, buffer.data());
+    return buffer.data();
+  }
+};
+
+// width x height linear texels of level into the next level of the chain
+template <typename Texel>
+void FilterLevel(
+    MipFilter           filter,
+    const LevelRows&    level,
+    uint32_t            width,
+    uint32_t            height,
+    std::vector<float>& scratch,
+    std::vector<float>& result,
+    ThreadPool*         pool) {
+  static const std::array<float, kKaiserTaps> kWeights = KaiserWeights();
+
+  const uint32_t result_width  = std::max(width >> 1, 1u);
+  const uint32_t result_height = std::max(height >> 1, 1u);
+  const size_t   result_stride = static_cast<size_t>(result_width) * 4;
+  result.resize(result_stride * result_height);
+
+  if (filter == MipFilter::kBox) {
+    ForEachRow(pool, result_height, [&](uint32_t y) {
+      // one pair per worker, reused by every row it filters
+      thread_local std::vector<float> buffer0, buffer1;
+      BoxRow<Texel>(
+          level.Get(std::min(y * 2, height - 1), buffer0),
+          level.Get(std::min(y * 2 + 1, height - 1), buffer1),
+          width,
+          result.data() + y * result_stride,
+          result_width);
+    });
+    return;
+  }
+
+  // the horizontal pass reads every row of the level once, a side of a single texel is not
+  // filtered as the weights would only add rounding
+  scratch.resize(result_stride * height);
+  ForEachRow(pool, height, [&](uint32_t y) {
+    thread_local std::vector<float> buffer;
+    const float*                    row = level.Get(y, buffer);
+    if (width > 1) {
+      KaiserRow<Texel>(
+          row, width, kWeights.data(), scratch.data() + y * result_stride, result_width);
+    } else {
+      std::copy(row, row + result_stride, scratch.data() + y * result_stride);
+    }
+  });
+  if (height == 1) {
+    std::copy(scratch.begin(), scratch.begin() + result_stride, result.begin());
+    return;
+  }
+  ForEachRow(pool, result_height, [&](uint32_t y) {
+    const float* taps[kKaiserTaps];
+    for (uint32_t i = 0; i < kKaiserTaps; i++) {
+      const int64_t source = std::clamp<int64_t>(int64_t{y} * 2 - 2 + i, 0, height - 1);
+      taps[i]              = scratch.data() + source * result_stride;
+    }
+    KaiserColumns<Texel>(
+        taps,
+        static_cast<uint32_t>(result_stride),
+        kWeights.data(),
+        result.data() + y * result_stride);
+  });
+}
+}  // namespace
+
+MipGenerator::MipGenerator() : kernel_(BestKernel()) {}
+
+MipKernel MipGenerator::BestKernel() {
+#if defined(VKENGINE_MIP_X86)
+  // sse2 is part of x86-64
+  return MipKernel::kSse;
+#else
+  return MipKernel::kScalar;
+#endif
+}
+
+const char* MipGenerator::KernelName(MipKernel kernel) {
+  return kernel == MipKernel::kSse ? "sse" : "scalar";
+}
+
+void MipGenerator::SetKernel(MipKernel kernel) {
+  const MipKernel best = BestKernel();
+  kernel_              = kernel > best ? best : kernel;
+}
+
+std::shared_ptr<RenderMaterialData> MipGenerator::Generate(
+    const RenderMaterialData& texture,
+    MipFilter                 filter,
+    uint32_t                  level_count,
+    ThreadPool*               pool) const {
+  TexelLayout layout;
+  if (!texture.pixels || !GetTexelLayout(texture.format, layout)) {
+    return nullptr;
+  }
+  const uint32_t full_chain = GetMipLevelCount(texture.width, texture.height);
+  level_count               = level_count == 0 ? full_chain : std::min(level_count, full_chain);
+
+  size_t size = 0;
+  for (uint32_t level = 0; level < level_count; level++) {
+    size += GetMipLevelSize(texture.format, texture.width, texture.height, level);
+  }
+  auto* chain = static_cast<char*>(malloc(size));
+  if (!chain) {
+    return nullptr;
+  }
+  // the first level is kept as it is, not converted back and forth
+  const size_t texel_size = GetTexelBlockSize(texture.format);
+  size_t       offset     = GetMipLevelSize(texture.format, texture.width, texture.height, 0);
+  std::memcpy(chain, texture.pixels, offset);
+
+  std::vector<float> level, next_level, scratch;
+  uint32_t           width  = texture.width;
+  uint32_t           height = texture.height;
+  for (uint32_t index = 1; index < level_count; index++) {
+    LevelRows rows;
+    if (index == 1) {
+      rows.layout     = &layout;
+      rows.texels     = static_cast<const char*>(texture.pixels);
+      rows.texel_size = texel_size;
+    } else {
+      rows.level = level.data();
+    }
+    rows.width = width;
+#if defined(VKENGINE_MIP_X86)
+    if (kernel_ == MipKernel::kSse) {
+      FilterLevel<SseTexel>(filter, rows, width, height, scratch, next_level, pool);
+    } else {
+      FilterLevel<ScalarTexel>(filter, rows, width, height, scratch, next_level, pool);
+    }
+#else
+    FilterLevel<ScalarTexel>(filter, rows, width, height, scratch, next_level, pool);
+#endif
+    level.swap(next_level);
+    width  = std::max(width >> 1, 1u);
+    height = std::max(height >> 1, 1u);
+
+    char* texels = chain + offset;
+    ForEachRow(pool, height, [&](uint32_t y) {
+      StoreRow(
+          layout,
+          level.data() + static_cast<size_t>(y) * width * 4,
+          width,
+          texels + static_cast<size_t>(y) * width * texel_size);
+    });
+    offset += GetMipLevelSize(texture.format, texture.width, texture.height, index);
+  }
+
+  auto result        = MakeTexture(chain, texture.width, texture.height, texture.format);
+  result->mip_levels = level_count;
+  return result;
+}
+
+}  // namespace vkengine
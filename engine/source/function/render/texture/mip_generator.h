@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+enum class MipFilter : uint8_t {
+  // average of the 2x2 texels under every texel of the next level
+  kBox = 0,
+  // separable windowed sinc over 6x6 texels (kaiser window, alpha 4), sharper than the box and
+  // without its aliasing. the negative lobes may ring around hard edges
+  kKaiser
+};
+
+enum class MipKernel : uint8_t { kScalar = 0, kSse };
+
+// mip chains filtered on the cpu, for images that are cooked with their mips or whose format the
+// device can not blit with a linear filter. every level is filtered from the one above in float,
+// srgb texels are converted to linear first and back when a level is stored. alpha is linear in
+// every format. the filter runs 4 floats at a time with sse2, every kernel produces the same
+// bits. the kernel is picked once from the cpu
+class MipGenerator {
+ public:
+  MipGenerator();
+  ~MipGenerator() {}
+
+  MipKernel GetKernel() const { return kernel_; }
+  // kernels the cpu does not support fall back to the best supported one
+  void SetKernel(MipKernel kernel);
+
+  static MipKernel   BestKernel();
+  static const char* KernelName(MipKernel kernel);
+
+  // the first level of texture followed by level_count - 1 levels filtered from it, the whole
+  // chain down to 1x1 for 0. all levels in one malloc allocation like the decoded images, rows
+  // of every level are spread over the pool. nullptr for a block compressed texture
+  std::shared_ptr<RenderMaterialData> Generate(
+      const RenderMaterialData& texture,
+      MipFilter                 filter,
+      uint32_t                  level_count = 0,
+      ThreadPool*               pool        = nullptr) const;
+
+ private:
+  MipKernel kernel_ = MipKernel::kScalar;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,59 @@
+#include "function/render/texture/texture_cache.h"
+
+#include <filesystem>
+
+#include "core/utils/hash.h"
+#include "fmt/format.h"
+#include "function/render/texture/ktx2_file.h"
+
+namespace vkengine {
+
+namespace {
+constexpr char kSourceKey[] = "vkengine.source";
+
+std::string SourceValue(PixelFormat format, uint64_t source_hash) {
+  const uint64_t key[3] = {kTextureCookerVersion, static_cast<uint64_t>(format), source_hash};
+  return fmt::format("{:016x}", HashBytes(key, sizeof(key)));
+}
+}  // namespace
+
+std::shared_ptr<RenderMaterialData> TextureCache::Load(
+    const std::string& source_file, PixelFormat format, uint64_t source_hash) const {
+  Ktx2File    file;
+  std::string error;
+  if (!file.Open(EntryPath(source_file, format), error) || file.GetFormat() != format ||
+      file.GetValue(kSourceKey) != SourceValue(format, source_hash) ||
+      file.GetLevelCount() != GetMipLevelCount(file.GetWidth(), file.GetHeight())) {
+    return nullptr;
+  }
+  return file.CopyTexture();
+}
+
+bool TextureCache::Store(
+    const std::string&        source_file,
+    PixelFormat               format,
+    uint64_t                  source_hash,
+    const RenderMaterialData& texture) const {
+  std::error_code directory_error;
+  std::filesystem::create_directories(directory_, directory_error);
+  if (directory_error) {
+    return false;
+  }
+  std::string error;
+  return WriteKtx2File(
+      EntryPath(source_file, format),
+      texture,
+      {{kSourceKey, SourceValue(format, source_hash)}},
+      error);
+}
+
+std::string TextureCache::EntryPath(const std::string& source_file, PixelFormat format) const {
+  const auto     path = std::filesystem::path(source_file);
+  const uint64_t key  = HashBytes(source_file.data(), source_file.size());
+  return (std::filesystem::path(directory_) /
+          fmt::format(
+              "{}-{:016x}-{}.ktx2", path.stem().string(), key, static_cast<uint32_t>(format)))
+      .string();
+}
+
+}  // namespace vkengine
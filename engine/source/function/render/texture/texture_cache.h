@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+// bump whenever the encoders or the mip filter change, old entries are then cooked again on
+// their next load
+static constexpr uint32_t kTextureCookerVersion = 2;
+
+// cooked textures as ktx2 files next to the cooked meshes, one entry per source path and cooked
+// format. the entry keeps the hash of the source, the cooker version and the format as a key/value
+// pair and is stale when one of them differs
+class TextureCache {
+ public:
+  explicit TextureCache(std::string directory) : directory_(std::move(directory)) {}
+  ~TextureCache() {}
+
+  // nullptr when there is no entry or it is stale, the levels are copied out of the file
+  std::shared_ptr<RenderMaterialData> Load(
+      const std::string& source_file, PixelFormat format, uint64_t source_hash) const;
+  bool Store(
+      const std::string&        source_file,
+      PixelFormat               format,
+      uint64_t                  source_hash,
+      const RenderMaterialData& texture) const;
+
+  std::string EntryPath(const std::string& source_file, PixelFormat format) const;
+
+ private:
+  std::string directory_;
+};
+
+}  // namespace vkengine
@@ -0,0 +1,57 @@
+#include "function/render/texture/texture_cooker.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "function/render/texture/bc_encoder.h"
+#include "function/render/texture/texture_decoder.h"
+
+namespace vkengine {
+
+std::shared_ptr<RenderMaterialData> CookTexture(
+    const RenderMaterialData& texture, PixelFormat format, MipFilter filter, ThreadPool* pool) {
+  const bool rgba8 = texture.format == PixelFormat::R8G8B8A8_UNORM ||
+                     texture.format == PixelFormat::R8G8B8A8_SRGB;
+  if (!texture.pixels || !rgba8 || (!IsBlockCompressed(format) && format != texture.format)) {
+    return nullptr;
+  }
+
+  MipGenerator generator;
+  auto         chain = generator.Generate(texture, filter, 0, pool);
+  if (!chain || !IsBlockCompressed(format)) {
+    return chain;
+  }
+
+  size_t size = 0;
+  for (uint32_t level = 0; level < chain->mip_levels; level++) {
+    size += GetMipLevelSize(format, texture.width, texture.height, level);
+  }
+  // malloc like the decoded images, RenderMaterialData never frees its pixels itself
+  auto* blocks = static_cast<uint8_t*>(malloc(size));
+  if (!blocks) {
+    free(chain->pixels);
+    return nullptr;
+  }
+
+  BcEncoder   encoder;
+  const auto* texels = static_cast<const uint8_t*>(chain->pixels);
+  size_t      offset = 0;
+  for (uint32_t level = 0; level < chain->mip_levels; level++) {
+    encoder.EncodeImage(
+        format,
+        texels,
+        std::max(texture.width >> level, 1u),
+        std::max(texture.height >> level, 1u),
+        blocks + offset,
+        pool);
+    texels += GetMipLevelSize(texture.format, texture.width, texture.height, level);
+    offset += GetMipLevelSize(format, texture.width, texture.height, level);
+  }
+  free(chain->pixels);
+
+  auto cooked        = MakeTexture(blocks, texture.width, texture.height, format);
+  cooked->mip_levels = chain->mip_levels;
+  return cooked;
+}
+
+}  // namespace vkengine
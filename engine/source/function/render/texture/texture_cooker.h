@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+
+#include "function/render/scene/render_type.h"
+#include "function/render/texture/mip_generator.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+// rgba8 texture of a single level together with its whole mip chain down to 1x1 largest first,
+// filtered by MipGenerator. format is either block compressed, every level is then encoded by
+// BcEncoder a row of blocks per task of the pool, or the format of texture to keep the texels as
+// they are. nullptr when texture is not rgba8 or format is neither
+std::shared_ptr<RenderMaterialData> CookTexture(
+    const RenderMaterialData& texture,
+    PixelFormat               format,
+    MipFilter                 filter = MipFilter::kKaiser,
+    ThreadPool*               pool   = nullptr);
+
+}  // namespace vkengine
@@ -0,0 +1,263 @@
+#include "function/render/texture/texture_decoder.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "core/utils/mapped_file.h"
+#include "core/utils/thread_pool.h"
+#include "macro.h"
+
+namespace vkengine {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// stb keeps up to two images of the source channels next to its output: the inflated scanlines
+// of a png or the component planes of a jpeg, and the image before the channel conversion
+constexpr size_t kScratchImages = 2;
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// bytes reserved by the images in flight. a reservation waits until it fits, or until nothing
+// else is reserved so an image over the budget still goes through alone
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t budget) : budget_(budget) {}
+
+  // true when it had to wait
+  bool Reserve(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    const auto fits   = [this, bytes]() { return reserved_ == 0 || reserved_ + bytes <= budget_; };
+    const bool waited = !fits();
+    released_.wait(lock, fits);
+    reserved_ += bytes;
+    peak_ = std::max(peak_, reserved_);
+    return waited;
+  }
+  void Release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      reserved_ -= bytes;
+    }
+    released_.notify_all();
+  }
+  size_t GetPeak() const { return peak_; }
+
+ private:
+  size_t                  budget_   = 0;
+  size_t                  reserved_ = 0;
+  size_t                  peak_     = 0;
+  std::mutex              mutex_;
+  std::condition_variable released_;
+};
+
+bool HasPrefix(const void* data, size_t size, const char* prefix) {
+  const size_t length = std::strlen(prefix);
+  return size >= length && std::memcmp(data, prefix, length) == 0;
+}
+}  // namespace
+
+const char* TextureFileFormatName(TextureFileFormat format) {
+  switch (format) {
+    case TextureFileFormat::kPng:
+      return "png";
+    case TextureFileFormat::kJpeg:
+      return "jpeg";
+    case TextureFileFormat::kHdr:
+      return "hdr";
+    case TextureFileFormat::kBmp:
+      return "bmp";
+    default:
+      return "other";
+  }
+}
+
+TextureFileFormat DetectTextureFileFormat(const void* data, size_t size) {
+  if (HasPrefix(data, size, "\x89PNG\r\n\x1a\n")) {
+    return TextureFileFormat::kPng;
+  }
+  if (HasPrefix(data, size, "\xff\xd8\xff")) {
+    return TextureFileFormat::kJpeg;
+  }
+  if (HasPrefix(data, size, "#?RADIANCE") || HasPrefix(data, size, "#?RGBE")) {
+    return TextureFileFormat::kHdr;
+  }
+  if (HasPrefix(data, size, "BM")) {
+    return TextureFileFormat::kBmp;
+  }
+  return TextureFileFormat::kOther;
+}
+
+std::shared_ptr<RenderMaterialData> MakeTexture(
+    void* pixels, uint32_t width, uint32_t height, PixelFormat format) {
+  if (!pixels) {
+    return nullptr;
+  }
+
+  std::shared_ptr<RenderMaterialData> texture = std::make_shared<RenderMaterialData>();
+
+  texture->pixels       = pixels;
+  texture->width        = width;
+  texture->height       = height;
+  texture->format       = format;
+  texture->depth        = 1;
+  texture->array_layers = 1;
+  texture->mip_levels   = 1;
+  texture->type         = ImageType::IMAGE_2D;
+
+  return texture;
+}
+
+std::shared_ptr<RenderMaterialData> DecodeTexture(
+    const void* data, size_t size, const TextureDecodeRequest& request) {
+  if (size > static_cast<size_t>(INT_MAX)) {
+    return nullptr;
+  }
+  const auto* bytes  = static_cast<const stbi_uc*>(data);
+  const int   length = static_cast<int>(size);
+  int         iw, ih, n;
+
+  if (!request.hdr) {
+    unsigned char* buffer = stbi_load_from_memory(bytes, length, &iw, &ih, &n, 4);
+    return MakeTexture(
+        buffer,
+        iw,
+        ih,
+        request.is_srgb ? PixelFormat::R8G8B8A8_SRGB : PixelFormat::R8G8B8A8_UNORM);
+  }
+
+  PixelFormat format = PixelFormat::UNKNOWN;
+  switch (request.hdr_channels) {
+    case 2:
+      format = PixelFormat::R32G32_FLOAT;
+      break;
+    case 4:
+      format = PixelFormat::R32G32B32A32_FLOAT;
+      break;
+    default:
+      // three component format is not supported in some vulkan driver implementations
+      throw std::runtime_error("unsupported channels number");
+  }
+  float* buffer = stbi_loadf_from_memory(bytes, length, &iw, &ih, &n, request.hdr_channels);
+  return MakeTexture(buffer, iw, ih, format);
+}
+
+void TextureDecoder::Decode(
+    const std::vector<TextureDecodeRequest>& requests,
+    const TextureDecodeOptions&              options,
+    const TextureConsumer&                   consume) {
+  const auto start = Clock::now();
+  statistics_      = TextureDecodeStatistics{};
+
+  MemoryBudget budget(options.memory_budget);
+  std::mutex   statistics_mutex;
+  // given back when the image is done, even when the decode or the consumer throws
+  struct Reservation {
+    MemoryBudget& budget;
+    size_t        bytes = 0;
+    ~Reservation() {
+      if (bytes > 0) {
+        budget.Release(bytes);
+      }
+    }
+  };
+
+  const auto decode = [&](uint32_t index) {
+    const TextureDecodeRequest& request = requests[index];
+    MappedFile                  mapping;
+    const void*                 data = request.data;
+    size_t                      size = request.size;
+    if (!request.file.empty()) {
+      if (!mapping.Open(request.file)) {
+        LogWarn("can not read texture {}", request.file);
+        {
+          std::lock_guard<std::mutex> lock(statistics_mutex);
+
+          auto& stats = statistics_.formats[static_cast<size_t>(TextureFileFormat::kOther)];
+          stats.image_count++;
+          stats.failed_count++;
+        }
+        consume(index, nullptr);
+        return;
+      }
+      data = mapping.Data();
+      size = mapping.Size();
+    }
+    const TextureFileFormat format = DetectTextureFileFormat(data, size);
+
+    // the size is read from the header, the texels are only estimated
+    int        iw = 0, ih = 0, n = 0;
+    const bool readable =
+        size <= static_cast<size_t>(INT_MAX) &&
+        stbi_info_from_memory(
+            static_cast<const stbi_uc*>(data), static_cast<int>(size), &iw, &ih, &n);
+
+    const size_t texel_size = request.hdr ? sizeof(float) * request.hdr_channels : 4;
+    Reservation  reservation{budget};
+    bool         waited = false;
+    if (readable) {
+      const size_t texels = static_cast<size_t>(iw) * static_cast<size_t>(ih);
+      const size_t bytes  = size + texels * (texel_size + kScratchImages * n);
+      waited              = budget.Reserve(bytes);
+      reservation.bytes   = bytes;
+    }
+
+    const auto                          decode_start = Clock::now();
+    std::shared_ptr<RenderMaterialData> texture;
+    if (readable) {
+      texture = DecodeTexture(data, size, request);
+    }
+    const double decode_ms = ElapsedMs(decode_start);
+    if (!texture) {
+      LogWarn(
+          "can not decode texture {}: {}",
+          request.file.empty() ? "in memory" : request.file,
+          stbi_failure_reason());
+    }
+    // the mapping is not needed by the consumer
+    mapping.Close();
+
+    {
+      std::lock_guard<std::mutex> lock(statistics_mutex);
+
+      auto& stats = statistics_.formats[static_cast<size_t>(format)];
+      stats.image_count++;
+      stats.encoded_bytes += size;
+      stats.decode_ms += decode_ms;
+      if (texture) {
+        stats.decoded_bytes += static_cast<size_t>(texture->width) * texture->height * texel_size;
+      } else {
+        stats.failed_count++;
+      }
+      statistics_.budget_waits += waited ? 1 : 0;
+    }
+
+    consume(index, std::move(texture));
+  };
+
+  const auto count = static_cast<uint32_t>(requests.size());
+  if (pool_) {
+    pool_->ParallelFor(count, decode);
+  } else {
+    for (uint32_t i = 0; i < count; i++) {
+      decode(i);
+    }
+  }
+
+  statistics_.peak_memory = budget.GetPeak();
+  statistics_.total_ms    = ElapsedMs(start);
+}
+
+}  // namespace vkengine
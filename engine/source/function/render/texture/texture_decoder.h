@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "function/render/scene/render_type.h"
+
+namespace vkengine {
+
+class ThreadPool;
+
+// container of an encoded image, told by its first bytes. tga has no signature and counts as
+// kOther with every other format stb reads
+enum class TextureFileFormat : uint8_t { kPng = 0, kJpeg, kHdr, kBmp, kOther, kCount };
+
+const char*       TextureFileFormatName(TextureFileFormat format);
+TextureFileFormat DetectTextureFileFormat(const void* data, size_t size);
+
+struct TextureDecodeRequest {
+  // a file, or encoded bytes that stay valid until the decode returns when file is empty
+  std::string file;
+  const void* data    = nullptr;
+  size_t      size    = 0;
+  bool        is_srgb = false;
+  // float texels with hdr_channels components, 2 or 4, instead of 8 bit rgba
+  bool hdr          = false;
+  int  hdr_channels = 4;
+};
+
+struct TextureDecodeOptions {
+  // ceiling of the bytes held at once by the images in flight: the mapped file, the decoded
+  // texels and the intermediate image stb keeps while converting. an image larger than the
+  // budget is decoded alone
+  size_t memory_budget = size_t(1) << 30;
+};
+
+struct TextureFormatStatistics {
+  uint32_t image_count   = 0;
+  uint32_t failed_count  = 0;
+  size_t   encoded_bytes = 0;
+  size_t   decoded_bytes = 0;
+  // summed over the workers, the consumer is not counted
+  double decode_ms = 0.0;
+};
+
+struct TextureDecodeStatistics {
+  TextureFormatStatistics formats[static_cast<size_t>(TextureFileFormat::kCount)];
+  size_t                  peak_memory = 0;
+  // images that waited for others to leave the budget
+  uint32_t budget_waits = 0;
+  double   total_ms     = 0.0;
+};
+
+// decodes many images at once on the pool. the files are memory mapped and decoded from the
+// mapping, every image reserves its estimated memory before it is decoded and gives it back once
+// the consumer returns, so a consumer that uploads or writes out the texels and drops them keeps
+// the peak within the budget
+class TextureDecoder {
+ public:
+  // called on the thread that decoded image index, with null when it can not be read or
+  // decoded. the consumer may take the texture
+  using TextureConsumer =
+      std::function<void(uint32_t index, std::shared_ptr<RenderMaterialData> texture)>;
+
+  // single threaded without a pool
+  explicit TextureDecoder(ThreadPool* pool = nullptr) : pool_(pool) {}
+  ~TextureDecoder() {}
+
+  // return once every image went to the consumer. an exception of the consumer is rethrown
+  void Decode(
+      const std::vector<TextureDecodeRequest>& requests,
+      const TextureDecodeOptions&              options,
+      const TextureConsumer&                   consume);
+
+  const TextureDecodeStatistics& GetStatistics() const { return statistics_; }
+
+ private:
+  ThreadPool*             pool_ = nullptr;
+  TextureDecodeStatistics statistics_;
+};
+
+// 2d texture of one mip level taking ownership of malloc allocated pixels, null without pixels
+std::shared_ptr<RenderMaterialData> MakeTexture(
+    void* pixels, uint32_t width, uint32_t height, PixelFormat format);
+
+// decode the encoded image as request asks for, null when stb can not decode it. throws for hdr
+// channel counts other than 2 and 4
+std::shared_ptr<RenderMaterialData> DecodeTexture(
+    const void* data, size_t size, const TextureDecodeRequest& request);
+
+}  // namespace vkengine
@@ -2,12 +2,15 @@
 
 #include "core/exception/assert_exception.h"
 #include "core/logsystem/log_system.h"
+#include "core/utils/thread_pool.h"
 #include "function/global/global_context.h"
 
 #define GContext vkengine::GlobalContext::GetInstance()
 
 #define GLog GContext.MustFindObject<vkengine::LogSystem>(kLogSystem)
 
+#define GThreadPool GContext.MustFindObject<vkengine::ThreadPool>(kThreadPool)
+
 #define LOG_HELPER(LOG_LEVEL, ...) GLog->Log(LOG_LEVEL, SRC, __VA_ARGS__)
 
 #define LogDebug(...) LOG_HELPER(LogSystem::LogLevel::debug, __VA_ARGS__)